@@ -9,6 +9,7 @@
 
 #include "../src/board_config.h"
 #include "HDMI.h"
+#include "../src/cgaline.h"
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
@@ -20,7 +21,11 @@
 #include "pico/multicore.h"
 #include "hardware/clocks.h"
 #include "hardware/irq.h"
+#include "hardware/sync.h"
 #include "pico/platform.h"
+#ifndef __riscv
+#include "hardware/structs/m33.h"
+#endif
 
 // Flag to defer IRQ handler setup to Core 1
 // When true, hdmi_init() will NOT set the IRQ handler - Core 1 must call
@@ -35,6 +40,13 @@ int graphics_buffer_shift_y = 0;
 
 static volatile uint32_t graphics_frame_count = 0;
 
+#ifdef FB_DOUBLE
+// Which of the two screens is being shown, and whether graphics_flip() is
+// waiting for vsync to show the other one
+static volatile uint8_t fb_front __scratch_x("fb_front") = 0;
+static volatile bool fb_flip_pending __scratch_x("fb_flip_pending") = false;
+#endif
+
 uint32_t get_frame_count(void) {
     return graphics_frame_count;
 }
@@ -77,6 +89,13 @@ int __scratch_x() get_video_mode() {
 void __scratch_x() vsync_handler() {
     // Called from DMA IRQ at frame boundary.
     graphics_frame_count++;
+#ifdef FB_DOUBLE
+    // Line 0 of the new frame has not been read yet, so the switch is clean
+    if (fb_flip_pending) {
+        fb_front ^= 1;
+        fb_flip_pending = false;
+    }
+#endif
 }
 
 // --- New HDMI Driver Code ---
@@ -99,6 +118,14 @@ static uint8_t color_substitute[4] __scratch_x("color_substitute") = {239, 239,
 #define SCREEN_WIDTH (320)
 #define SCREEN_HEIGHT (240)
 
+// FB_2BPP: the framebuffer holds 2bpp CGA bytes, expanded per line through
+// cgaline_lut[]; otherwise 4bpp nibbles, low nibble = left pixel
+#ifdef FB_2BPP
+#define FB_LINE_BYTES (SCREEN_WIDTH / 4)
+#else
+#define FB_LINE_BYTES (SCREEN_WIDTH / 2)
+#endif
+
 // #define HDMI_WIDTH 480 //480 Default
 // #define HDMI_HEIGHT 644 //524 Default
 // #define HDMI_HZ 52 //60 Default
@@ -124,6 +151,46 @@ alignas(4096) uint32_t conv_color[1224];
 static uint32_t irq_inx = 0;
 static uint32_t last_check_irq = 0;
 
+// What the sync and blanking bytes of each line buffer are set up for.
+// They only change when a buffer goes from one kind of line to another,
+// so most IRQs write just the pixels.
+enum { LINE_NONE, LINE_VISIBLE, LINE_VSYNC, LINE_BLANK };
+static uint8_t line_kind[2] __scratch_x("line_kind") = { LINE_NONE, LINE_NONE };
+
+// Cycles spent in dma_handler_HDMI(), from the DWT cycle counter of the
+// core it runs on. The IRQ runs on core 1 and the log reads them on core 0,
+// so disabling interrupts is not enough: every access holds this hardware
+// spinlock
+static struct hdmi_irq_stats irq_stats __scratch_x("irq_stats");
+static spin_lock_t *irq_stats_lock;
+
+static inline uint32_t __scratch_x() irq_cycles(void) {
+#ifndef __riscv
+    return m33_hw->dwt_cyccnt;
+#else
+    return 0;
+#endif
+}
+
+// Start the cycle counter of the core that is taking the HDMI IRQ
+static void irq_cycles_enable(void) {
+#ifndef __riscv
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+#endif
+}
+
+static inline void __scratch_x() irq_cycles_done(uint32_t start) {
+    uint32_t n = irq_cycles() - start;
+    uint32_t save = spin_lock_blocking(irq_stats_lock);
+
+    irq_stats.count++;
+    irq_stats.total += n;
+    if (n > irq_stats.max)
+        irq_stats.max = n;
+    spin_unlock(irq_stats_lock, save);
+}
+
 /* Apple II emulator headers removed - not needed for Digger */
 volatile int lock_y = -1;
 
@@ -162,6 +229,36 @@ bool hdmi_check_and_restart(void) {
     return false;
 }
 
+// Cycles the IRQ handler has taken since the last reset, and what one
+// HDMI line gives it. Each IRQ is one line, so max has to stay under budget.
+void hdmi_get_irq_stats(struct hdmi_irq_stats *st, bool reset) {
+    struct video_mode_t mode = video_mode[0];
+    uint32_t save = spin_lock_blocking(irq_stats_lock);
+
+    *st = irq_stats;
+    if (reset)
+        memset(&irq_stats, 0, sizeof(irq_stats));
+    spin_unlock(irq_stats_lock, save);
+    st->budget = clock_get_hz(clk_sys) / (mode.freq * (mode.h_total + 1));
+}
+
+// Print the IRQ load every 5 seconds or so
+void hdmi_log_irq_budget(void) {
+    static uint32_t last_time = 0;
+    struct hdmi_irq_stats st;
+    uint32_t now = time_us_32();
+
+    if (now - last_time < 5000000)
+        return;
+    last_time = now;
+    hdmi_get_irq_stats(&st, true);
+    if (st.count == 0)
+        return;
+    MII_DEBUG_PRINTF("HDMI: IRQ %lu cycles avg, %lu max, %lu budget\n",
+                     (unsigned long)(st.total / st.count), (unsigned long)st.max,
+                     (unsigned long)st.budget);
+}
+
 // Pause HDMI output - stops DMA but keeps configuration
 void hdmi_pause(void) {
     // Disable IRQ
@@ -294,6 +391,7 @@ static void pio_set_x(PIO pio, const int sm, uint32_t v) {
 static void __scratch_x() dma_handler_HDMI() {
     static uint32_t inx_buf_dma;
     static uint line = 0;
+    uint32_t start = irq_cycles();
     struct video_mode_t mode = video_mode[0];
     irq_inx++;
 
@@ -307,63 +405,73 @@ static void __scratch_x() dma_handler_HDMI() {
         ++line;
     }
 
-    if ((line & 1) == 0) return;
+    if ((line & 1) == 0) {
+        irq_cycles_done(start);
+        return;
+    }
     inx_buf_dma++;
 
     uint8_t* activ_buf = (uint8_t *)dma_lines[inx_buf_dma & 1];
+    uint8_t* kind = &line_kind[inx_buf_dma & 1];
 
     if (line < mode.h_width ) {
         int y = line >> 1;
-        register uint8_t* input_buffer = graphics_get_buffer() + y * (SCREEN_WIDTH / 2);
+        register uint8_t* input_buffer = graphics_get_buffer() + y * FB_LINE_BYTES;
         register uint8_t* output_buffer = activ_buf + 72; //для выравнивания синхры;
         // Copy from framebuffer, substituting HDMI reserved colors
         lock_y = y;
-        for (register int i = 0; i < SCREEN_WIDTH / 2; i++) {
-            register uint8_t c = input_buffer[i];
-            register int j = i << 1;
-            output_buffer[j] = c & 0xF;
-            output_buffer[j+1] = c >> 4;
-        }
+#ifdef FB_2BPP
+        cgaline_expand((uint32_t *)output_buffer, input_buffer, FB_LINE_BYTES);
+#else
+        cgaline_expand4((uint32_t *)output_buffer, input_buffer, FB_LINE_BYTES);
+#endif
         lock_y = -1;
-        
-        //ССИ
-        //для выравнивания синхры
-
-        // --|_|---|_|---|_|----
-        //---|___________|-----
-        memset(activ_buf + 48,BASE_HDMI_CTRL_INX, 24);
-        memset(activ_buf,BASE_HDMI_CTRL_INX + 1, 48);
-        memset(activ_buf + 392,BASE_HDMI_CTRL_INX, 8);
-
-        //без выравнивания
-        // --|_|---|_|---|_|----
-        //------|___________|----
-        //   memset(activ_buf+320,BASE_HDMI_CTRL_INX,8);
-        //   memset(activ_buf+328,BASE_HDMI_CTRL_INX+1,48);
-        //   memset(activ_buf+376,BASE_HDMI_CTRL_INX,24);
-    }
-    else {
-        if ((line >= 490) && (line < 492)) {
-            //кадровый синхроимпульс
+
+        if (*kind != LINE_VISIBLE) {
+            //ССИ
             //для выравнивания синхры
+
             // --|_|---|_|---|_|----
             //---|___________|-----
-            memset(activ_buf + 48,BASE_HDMI_CTRL_INX + 2, 352);
-            memset(activ_buf,BASE_HDMI_CTRL_INX + 3, 48);
+            memset(activ_buf + 48,BASE_HDMI_CTRL_INX, 24);
+            memset(activ_buf,BASE_HDMI_CTRL_INX + 1, 48);
+            memset(activ_buf + 392,BASE_HDMI_CTRL_INX, 8);
+            *kind = LINE_VISIBLE;
+
             //без выравнивания
             // --|_|---|_|---|_|----
-            //-------|___________|----
-
-            // memset(activ_buf,BASE_HDMI_CTRL_INX+2,328);
-            // memset(activ_buf+328,BASE_HDMI_CTRL_INX+3,48);
-            // memset(activ_buf+376,BASE_HDMI_CTRL_INX+2,24);
+            //------|___________|----
+            //   memset(activ_buf+320,BASE_HDMI_CTRL_INX,8);
+            //   memset(activ_buf+328,BASE_HDMI_CTRL_INX+1,48);
+            //   memset(activ_buf+376,BASE_HDMI_CTRL_INX,24);
         }
-        else {
+    }
+    else {
+        if ((line >= 490) && (line < 492)) {
+            if (*kind != LINE_VSYNC) {
+                //кадровый синхроимпульс
+                //для выравнивания синхры
+                // --|_|---|_|---|_|----
+                //---|___________|-----
+                memset(activ_buf + 48,BASE_HDMI_CTRL_INX + 2, 352);
+                memset(activ_buf,BASE_HDMI_CTRL_INX + 3, 48);
+                *kind = LINE_VSYNC;
+                //без выравнивания
+                // --|_|---|_|---|_|----
+                //-------|___________|----
+
+                // memset(activ_buf,BASE_HDMI_CTRL_INX+2,328);
+                // memset(activ_buf+328,BASE_HDMI_CTRL_INX+3,48);
+                // memset(activ_buf+376,BASE_HDMI_CTRL_INX+2,24);
+            }
+        }
+        else if (*kind != LINE_BLANK) {
             //ССИ без изображения
             //для выравнивания синхры
 
             memset(activ_buf + 48,BASE_HDMI_CTRL_INX, 352);
             memset(activ_buf,BASE_HDMI_CTRL_INX + 1, 48);
+            *kind = LINE_BLANK;
 
             // memset(activ_buf,BASE_HDMI_CTRL_INX,328);
             // memset(activ_buf+328,BASE_HDMI_CTRL_INX+1,48);
@@ -371,6 +479,7 @@ static void __scratch_x() dma_handler_HDMI() {
         };
     }
 
+    irq_cycles_done(start);
 
     // y=(y==524)?0:(y+1);
     // inx_buf_dma++;
@@ -383,6 +492,7 @@ static inline void irq_remove_handler_DMA_core1() {
 }
 
 static inline void irq_set_exclusive_handler_DMA_core1() {
+    irq_cycles_enable();
     irq_set_exclusive_handler(VIDEO_DMA_IRQ, dma_handler_HDMI);
     irq_set_priority(VIDEO_DMA_IRQ, 0);
     irq_set_enabled(VIDEO_DMA_IRQ, true);
@@ -521,6 +631,7 @@ static inline bool hdmi_init() {
     //настройки DMA
     dma_lines[0] = &conv_color[1024];
     dma_lines[1] = &conv_color[1124];
+    line_kind[0] = line_kind[1] = LINE_NONE;
 
     //основной рабочий канал
     dma_channel_config cfg_dma = dma_channel_get_default_config(dma_chan);
@@ -679,6 +790,9 @@ void graphics_set_palette_hdmi(uint8_t i, uint32_t color888) {
 
 void graphics_init_hdmi() {
     MII_DEBUG_PRINTF("HDMI: Claiming PIO resources...\n");
+    cgaline_init();
+    if (irq_stats_lock == NULL)
+        irq_stats_lock = spin_lock_instance(spin_lock_claim_unused(true));
     
     // Initialize default palette with basic colors before hdmi_init
     // This ensures the conv_color table has valid TMDS data
@@ -745,12 +859,51 @@ void graphics_restore_sync_colors(void) {
     conv_color64[2 * (base_inx + 3) + 1] = get_ser_diff_data(b0, b0, b0);
 }
 
-static uint8_t graphics_buffer[SCREEN_WIDTH * SCREEN_HEIGHT / 2] __aligned(4096) = { 0 };
+#ifdef FB_DOUBLE
+static uint8_t graphics_buffer[2][FB_LINE_BYTES * SCREEN_HEIGHT] __aligned(4096) = { 0 };
 
 uint8_t* __scratch_x("graphics_get_buffer") graphics_get_buffer() {
+    return graphics_buffer[fb_front];
+}
+
+uint8_t* graphics_get_back_buffer(void) {
+    return graphics_buffer[fb_front ^ 1];
+}
+
+void graphics_flip(void) {
+    uint32_t start = time_us_32();
+
+    fb_flip_pending = true;
+    while (fb_flip_pending) {
+        // No vsync for 2 frames: the output is paused or stalled, so
+        // nothing is being scanned and the switch can be made here
+        if (time_us_32() - start > 33000) {
+            uint32_t save = save_and_disable_interrupts();
+            if (fb_flip_pending) {
+                fb_front ^= 1;
+                fb_flip_pending = false;
+            }
+            restore_interrupts(save);
+            break;
+        }
+        tight_loop_contents();
+    }
+}
+#else
+static uint8_t graphics_buffer[FB_LINE_BYTES * SCREEN_HEIGHT] __aligned(4096) = { 0 };
+
+uint8_t* __scratch_x("graphics_get_buffer") graphics_get_buffer() {
+    return graphics_buffer;
+}
+
+uint8_t* graphics_get_back_buffer(void) {
     return graphics_buffer;
 }
 
+void graphics_flip(void) {
+}
+#endif
+
 // Wrappers for existing API
 void graphics_init(g_out g_out) {
     graphics_init_hdmi();
@@ -776,6 +929,7 @@ void graphics_init_irq_on_this_core(void) {
     // Initialize the HDMI DMA IRQ handler on the current core.
     // Call this from Core 1 after graphics_init() was called with defer mode.
     // This ensures HDMI keeps running even when Core 0 is busy with SD card I/O.
+    irq_cycles_enable();
     irq_set_exclusive_handler(VIDEO_DMA_IRQ, dma_handler_HDMI);
     irq_set_priority(VIDEO_DMA_IRQ, 0);
     irq_set_enabled(VIDEO_DMA_IRQ, true);
@@ -803,6 +957,7 @@ void graphics_rebind_irq_to_current_core(void) {
     }
     
     // Set the handler on this core (Core 1)
+    irq_cycles_enable();
     irq_set_exclusive_handler(VIDEO_DMA_IRQ, dma_handler_HDMI);
     irq_set_priority(VIDEO_DMA_IRQ, 0);
     irq_set_enabled(VIDEO_DMA_IRQ, true);
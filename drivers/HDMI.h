@@ -60,7 +60,14 @@ enum graphics_mode_t {
     GRAPHICSMODE_DEFAULT,
 };
 
+// The screen the HDMI output is showing
 uint8_t* graphics_get_buffer();
+// The screen to draw into. With FB_DOUBLE this is the one not being shown,
+// otherwise the same as graphics_get_buffer().
+uint8_t* graphics_get_back_buffer(void);
+// Show the back buffer from the next vsync on, and wait for it. Without
+// FB_DOUBLE it does nothing.
+void graphics_flip(void);
 void graphics_init(g_out g_out);
 // Returns a monotonically increasing frame counter (incremented on vsync).
 uint32_t get_frame_count(void);
@@ -69,6 +76,17 @@ uint32_t hdmi_get_irq_count(void);
 // Check if HDMI DMA is still running and restart if stalled.
 // Returns true if a restart was needed.
 bool hdmi_check_and_restart(void);
+// Cycles spent in the HDMI DMA IRQ handler
+struct hdmi_irq_stats {
+    uint32_t count;     // IRQs measured
+    uint64_t total;     // cycles in all of them
+    uint32_t max;       // cycles in the longest one
+    uint32_t budget;    // cycles in one HDMI line at the current clock
+};
+// Copy the IRQ statistics, and start them over if reset is set.
+void hdmi_get_irq_stats(struct hdmi_irq_stats *st, bool reset);
+// Log the IRQ load against its budget every few seconds.
+void hdmi_log_irq_budget(void);
 // Pause HDMI output (stops DMA, keeps PIO configured)
 void hdmi_pause(void);
 // Resume HDMI output (restarts DMA)
@@ -23,7 +23,7 @@
 #include "hardware/resets.h"
 
 //=============================================================================
-// State - Chained double buffer (ping-pong) DMA
+// State - Ring of DMA buffers, played in turn by two chained channels
 //=============================================================================
 
 // NOTE: HDMI uses DMA_IRQ_0 with an exclusive handler.
@@ -35,17 +35,27 @@
 #define AUDIO_DMA_CH_A 10
 #define AUDIO_DMA_CH_B 11
 
-#define DMA_BUFFER_COUNT 2
-#define DMA_BUFFER_MAX_SAMPLES AUDIO_BUFFER_SAMPLES
+// The ring's buffers are carved out of this at i2s_init()
+static uint32_t __attribute__((aligned(4))) dma_pool[AUDIO_POOL_SAMPLES];
 
-static uint32_t __attribute__((aligned(4))) dma_buffers[DMA_BUFFER_COUNT][DMA_BUFFER_MAX_SAMPLES];
+static uint32_t ring_count;
+static uint32_t *ring_buf[AUDIO_MAX_BUFFERS];
 
-// Bitmask of buffers the CPU is allowed to write (1 = free)
-static volatile uint32_t dma_buffers_free_mask = 0;
+// The buffer each channel is set up with: A plays the even turns, B the
+// odd ones, so when one finishes it goes on to two buffers later
+static volatile uint32_t chan_buf[2];
 
-// Pre-roll: fill both buffers before starting playback
-#define PREROLL_BUFFERS 2
-static volatile int preroll_count = 0;
+// Buffers played, and (push mode) written, since playback started. The
+// DMA takes them in ring order, so buffer n is ring_buf[n % ring_count]
+// and ring_written - ring_played of them are waiting to be played.
+static volatile uint32_t ring_played = 0;
+static volatile uint32_t ring_written = 0;
+
+// Updated by the writer on core 0 and by the DMA IRQ, which in pull mode
+// runs on core 1, so disabling interrupts is not enough: every access
+// holds this hardware spinlock
+static struct i2s_stats stats;
+static spin_lock_t *stats_lock;
 
 static int dma_channel_a = -1;
 static int dma_channel_b = -1;
@@ -55,6 +65,10 @@ static uint32_t dma_transfer_count;
 
 static volatile bool audio_running = false;
 
+// Pull mode: where the IRQ gets the next buffer of samples, and its volume
+static i2s_fill_t pull_fill = NULL;
+static uint8_t pull_volume;
+
 static void audio_dma_irq_handler(void);
 
 //=============================================================================
@@ -71,8 +85,10 @@ i2s_config_t i2s_get_default_config(void) {
         .sm = 0,
         .dma_channel = 0,
         .dma_trans_count = AUDIO_BUFFER_SAMPLES,
+        .buffer_count = AUDIO_BUFFER_COUNT,
         .dma_buf = NULL,
         .volume = 0,
+        .fill = NULL,
     };
     return config;
 }
@@ -80,6 +96,8 @@ i2s_config_t i2s_get_default_config(void) {
 void i2s_init(i2s_config_t *config) {
     audio_pio = config->pio;
     dma_transfer_count = config->dma_trans_count;
+    if (stats_lock == NULL)
+        stats_lock = spin_lock_instance(spin_lock_claim_unused(true));
 
     // Full hardware reset of PIO0 (but NOT DMA - HDMI uses DMA!)
     reset_block(RESETS_RESET_PIO0_BITS);
@@ -114,15 +132,23 @@ void i2s_init(i2s_config_t *config) {
     uint32_t divider = sys_clk * 4 / config->sample_freq;
     pio_sm_set_clkdiv_int_frac(audio_pio, audio_sm, divider >> 8u, divider & 0xffu);
 
-    // Validate transfer count fits our static buffers
+    // Carve the ring out of the pool: at least 2 buffers, all of them
+    // dma_transfer_count samples
+    ring_count = config->buffer_count;
+    if (ring_count < 2) ring_count = 2;
+    if (ring_count > AUDIO_MAX_BUFFERS) ring_count = AUDIO_MAX_BUFFERS;
+    config->buffer_count = (uint8_t)ring_count;
     dma_transfer_count = config->dma_trans_count;
     if (dma_transfer_count == 0) dma_transfer_count = 1;
-    if (dma_transfer_count > DMA_BUFFER_MAX_SAMPLES) dma_transfer_count = DMA_BUFFER_MAX_SAMPLES;
+    if (dma_transfer_count > AUDIO_POOL_SAMPLES / ring_count)
+        dma_transfer_count = AUDIO_POOL_SAMPLES / ring_count;
     config->dma_trans_count = (uint16_t)dma_transfer_count;
+    for (uint32_t i = 0; i < ring_count; i++)
+        ring_buf[i] = &dma_pool[i * dma_transfer_count];
 
     // Initialize DMA buffers with silence
-    memset(dma_buffers, 0, sizeof(dma_buffers));
-    config->dma_buf = (uint16_t *)(void *)dma_buffers[0];
+    memset(dma_pool, 0, sizeof(dma_pool));
+    config->dma_buf = (uint16_t *)(void *)ring_buf[0];
 
     // Use fixed DMA channels for audio
     dma_channel_abort(AUDIO_DMA_CH_A);
@@ -158,7 +184,7 @@ void i2s_init(i2s_config_t *config) {
         dma_channel_a,
         &cfg_a,
         &audio_pio->txf[audio_sm],
-        dma_buffers[0],
+        ring_buf[0],
         dma_transfer_count,
         false
     );
@@ -167,15 +193,19 @@ void i2s_init(i2s_config_t *config) {
         dma_channel_b,
         &cfg_b,
         &audio_pio->txf[audio_sm],
-        dma_buffers[1],
+        ring_buf[1],
         dma_transfer_count,
         false
     );
 
-    // Set up DMA IRQ1 handler (avoid HDMI's DMA_IRQ_0 exclusive handler)
-    irq_set_exclusive_handler(AUDIO_DMA_IRQ, audio_dma_irq_handler);
-    irq_set_priority(AUDIO_DMA_IRQ, 0x80);
-    irq_set_enabled(AUDIO_DMA_IRQ, true);
+    // Set up DMA IRQ1 handler (avoid HDMI's DMA_IRQ_0 exclusive handler).
+    // In pull mode i2s_start_pull() does it, on the core that fills.
+    pull_fill = NULL;
+    if (config->fill == NULL) {
+        irq_set_exclusive_handler(AUDIO_DMA_IRQ, audio_dma_irq_handler);
+        irq_set_priority(AUDIO_DMA_IRQ, 0x80);
+        irq_set_enabled(AUDIO_DMA_IRQ, true);
+    }
 
     // Enable IRQ1 for both channels
     dma_hw->ints1 = (1u << dma_channel_a) | (1u << dma_channel_b);
@@ -186,43 +216,40 @@ void i2s_init(i2s_config_t *config) {
     pio_sm_set_enabled(audio_pio, audio_sm, true);
 
     // Initialize state
-    preroll_count = 0;
-    dma_buffers_free_mask = (1u << DMA_BUFFER_COUNT) - 1u; // both free
+    chan_buf[0] = 0;
+    chan_buf[1] = 1;
+    ring_played = ring_written = 0;
+    memset(&stats, 0, sizeof(stats));
+    stats.min_free = ring_count;
     audio_running = false;
 }
 
+// Push mode: copy sample_count stereo samples into the next buffer of the
+// ring, waiting for one to be free. Playback starts once every buffer has
+// been written.
 void i2s_dma_write_count(i2s_config_t *config, const int16_t *samples, uint32_t sample_count) {
     if (sample_count > dma_transfer_count) sample_count = dma_transfer_count;
     if (sample_count == 0) sample_count = 1;
 
-    // Wait for a free buffer, then claim it (atomically vs DMA IRQ)
-    uint8_t buf_index = 0;
-    while (true) {
-        uint32_t irq_state = save_and_disable_interrupts();
-        uint32_t free_mask = dma_buffers_free_mask;
-
-        if (!audio_running) {
-            // Pre-roll fills buffer 0 then buffer 1 to preserve ordering
-            buf_index = (uint8_t)preroll_count;
-            if (buf_index < DMA_BUFFER_COUNT && (free_mask & (1u << buf_index))) {
-                dma_buffers_free_mask &= ~(1u << buf_index);
-                restore_interrupts(irq_state);
-                break;
-            }
-        } else {
-            if (free_mask) {
-                buf_index = (free_mask & 1u) ? 0 : 1;
-                dma_buffers_free_mask &= ~(1u << buf_index);
-                restore_interrupts(irq_state);
-                break;
-            }
-        }
-
-        restore_interrupts(irq_state);
-        tight_loop_contents();
+    // Wait for a free buffer (the IRQ only ever adds to them)
+    uint32_t nfree = ring_count - (ring_written - ring_played);
+    uint32_t save = spin_lock_blocking(stats_lock);
+    if (audio_running && nfree < stats.min_free)
+        stats.min_free = nfree;
+    if (nfree == 0)
+        stats.overruns++;
+    spin_unlock(stats_lock, save);
+    if (nfree == 0) {
+        uint64_t start = time_us_64();
+
+        while (ring_written - ring_played >= ring_count)
+            tight_loop_contents();
+        save = spin_lock_blocking(stats_lock);
+        stats.wait_us += time_us_64() - start;
+        spin_unlock(stats_lock, save);
     }
 
-    uint32_t *write_ptr = dma_buffers[buf_index];
+    uint32_t *write_ptr = ring_buf[ring_written % ring_count];
     int16_t *write_ptr16 = (int16_t *)(void *)write_ptr;
 
     if (config->volume == 0) {
@@ -242,16 +269,65 @@ void i2s_dma_write_count(i2s_config_t *config, const int16_t *samples, uint32_t
     // Memory barrier to ensure writes are visible before DMA reads
     __dmb();
 
-    if (!audio_running) {
-        preroll_count++;
-        if (preroll_count >= PREROLL_BUFFERS) {
-            // Both buffers are filled and queued; start playback on channel A
-            dma_channel_start(dma_channel_a);
-            audio_running = true;
-        }
+    save = save_and_disable_interrupts();
+    ring_written++;
+    restore_interrupts(save);
+
+    if (!audio_running && ring_written >= ring_count) {
+        // The ring is full; start playback on channel A
+        audio_running = true;
+        dma_channel_start(dma_channel_a);
+    }
+}
+
+// Fill buffer i from pull_fill(), at the set volume; a short fill is an
+// underrun
+static void __not_in_flash_func(pull_buffer)(uint32_t i) {
+    int16_t *p = (int16_t *)(void *)ring_buf[i];
+
+    if (pull_fill(p, dma_transfer_count) < dma_transfer_count) {
+        uint32_t save = spin_lock_blocking(stats_lock);
+        stats.underruns++;
+        spin_unlock(stats_lock, save);
+    }
+    if (pull_volume != 0) {
+        for (uint32_t j = 0; j < dma_transfer_count * 2; j++)
+            p[j] >>= pull_volume;
     }
 }
 
+void i2s_start_pull(i2s_config_t *config) {
+    pull_fill = config->fill;
+    pull_volume = config->volume;
+    for (uint32_t i = 0; i < ring_count; i++)
+        pull_buffer(i);
+    uint32_t save = spin_lock_blocking(stats_lock);
+    stats.underruns = 0;        // the game has not started yet
+    spin_unlock(stats_lock, save);
+    __dmb();
+
+    irq_set_exclusive_handler(AUDIO_DMA_IRQ, audio_dma_irq_handler);
+    // Below HDMI's 0, so a long fill never holds up a scanline
+    irq_set_priority(AUDIO_DMA_IRQ, 0x80);
+    irq_set_enabled(AUDIO_DMA_IRQ, true);
+
+    ring_written = ring_count;
+    audio_running = true;
+    dma_channel_start(dma_channel_a);
+}
+
+void i2s_get_stats(struct i2s_stats *st, bool reset) {
+    uint32_t save = spin_lock_blocking(stats_lock);
+
+    *st = stats;
+    st->buffers = ring_played;
+    if (reset) {
+        memset(&stats, 0, sizeof(stats));
+        stats.min_free = ring_count;
+    }
+    spin_unlock(stats_lock, save);
+}
+
 void i2s_dma_write(i2s_config_t *config, const int16_t *samples) {
     i2s_dma_write_count(config, samples, dma_transfer_count);
 }
@@ -259,17 +335,45 @@ void i2s_dma_write(i2s_config_t *config, const int16_t *samples) {
 void i2s_volume(i2s_config_t *config, uint8_t volume) {
     if (volume > 16) volume = 16;
     config->volume = volume;
+    pull_volume = config->volume;
 }
 
 void i2s_increase_volume(i2s_config_t *config) {
     if (config->volume > 0) config->volume--;
+    pull_volume = config->volume;
 }
 
 void i2s_decrease_volume(i2s_config_t *config) {
     if (config->volume < 16) config->volume++;
+    pull_volume = config->volume;
 }
 
-static void audio_dma_irq_handler(void) {
+// Channel c (0 = A) has played its buffer and the other one has gone on to
+// the next. Set c up with the buffer after that, then in pull mode refill
+// the one just played: it is now the last in the ring. In push mode it is
+// free, and if the buffer now playing was never written it is an underrun.
+static void __not_in_flash_func(channel_done)(int c, int chan) {
+    uint32_t done = chan_buf[c];
+
+    dma_hw->ints1 = (1u << chan);
+    chan_buf[c] = (done + 2) % ring_count;
+    dma_channel_set_read_addr(chan, ring_buf[chan_buf[c]], false);
+    dma_channel_set_trans_count(chan, dma_transfer_count, false);
+    ring_played++;
+    if (pull_fill != NULL) {
+        pull_buffer(done);
+        ring_written++;
+    } else if (ring_written < ring_played + 1) {
+        uint32_t save = spin_lock_blocking(stats_lock);
+        stats.underruns++;
+        spin_unlock(stats_lock, save);
+        ring_written = ring_played + 1;
+    }
+}
+
+// In RAM: in pull mode this runs on core 1, which flash writes on core 0
+// rely on never touching flash
+static void __not_in_flash_func(audio_dma_irq_handler)(void) {
     uint32_t ints = dma_hw->ints1;
     uint32_t mask = 0;
     if (dma_channel_a >= 0) mask |= (1u << dma_channel_a);
@@ -277,17 +381,13 @@ static void audio_dma_irq_handler(void) {
     ints &= mask;
     if (!ints) return;
 
-    if ((dma_channel_a >= 0) && (ints & (1u << dma_channel_a))) {
-        dma_hw->ints1 = (1u << dma_channel_a);
-        dma_channel_set_read_addr(dma_channel_a, dma_buffers[0], false);
-        dma_channel_set_trans_count(dma_channel_a, dma_transfer_count, false);
-        dma_buffers_free_mask |= 1u;
-    }
+    // If both have finished (the IRQ was held up), the one whose turn came
+    // first goes first: A plays the even turns
+    for (int k = 0; k < 2; k++) {
+        int c = (ring_played & 1) ^ k;
+        int chan = c ? dma_channel_b : dma_channel_a;
 
-    if ((dma_channel_b >= 0) && (ints & (1u << dma_channel_b))) {
-        dma_hw->ints1 = (1u << dma_channel_b);
-        dma_channel_set_read_addr(dma_channel_b, dma_buffers[1], false);
-        dma_channel_set_trans_count(dma_channel_b, dma_transfer_count, false);
-        dma_buffers_free_mask |= 2u;
+        if (chan >= 0 && (ints & (1u << chan)))
+            channel_done(c, chan);
     }
 }
@@ -20,9 +20,23 @@
 // Audio sample rate for Digger (matches SDL default)
 #define AUDIO_SAMPLE_RATE 44100
 
-// Audio buffer size - enough for one game frame at 12.5 Hz
-// 44100 / 12.5 = 3528 samples per frame, round up with headroom
-#define AUDIO_BUFFER_SAMPLES 4096
+// The DMA ring: buffers, and stereo samples in each. Both are defaults,
+// set at build time (AUDIO_BUFFER_COUNT and AUDIO_BUFFER_SAMPLES in CMake)
+// and at run time through i2s_config_t, as long as the ring fits in the
+// pool. Sound is played (count - 1) * samples after it is made.
+#ifndef AUDIO_BUFFER_COUNT
+#define AUDIO_BUFFER_COUNT 4
+#endif
+#ifndef AUDIO_BUFFER_SAMPLES
+#define AUDIO_BUFFER_SAMPLES 256
+#endif
+#define AUDIO_MAX_BUFFERS 16
+#define AUDIO_POOL_SAMPLES 8192
+
+// Pull mode: called from the DMA IRQ for the next sample_count stereo
+// samples, into a buffer that has just finished playing. Returns how many
+// of them it had sound for; fewer is an underrun.
+typedef uint32_t (*i2s_fill_t)(int16_t *samples, uint32_t sample_count);
 
 // I2S configuration structure
 typedef struct {
@@ -33,17 +47,37 @@ typedef struct {
     PIO      pio;
     uint8_t  sm;
     uint8_t  dma_channel;
-    uint16_t dma_trans_count;
+    uint16_t dma_trans_count;  // samples in each buffer of the ring
+    uint8_t  buffer_count;     // buffers in the ring
     uint16_t *dma_buf;
     uint8_t  volume;  // 0 = max volume, higher = quieter (shift amount)
+    i2s_fill_t fill;  // NULL = push samples with i2s_dma_write_count()
 } i2s_config_t;
 
+// How the ring has done since the last reset
+struct i2s_stats {
+    uint32_t buffers;     // buffers played since playback started
+    uint32_t underruns;   // buffers played unwritten (push) or filled short (pull)
+    uint32_t overruns;    // writes that found no free buffer and waited (push)
+    uint32_t min_free;    // fewest free buffers a write found (push)
+    uint64_t wait_us;     // time spent waiting in i2s_dma_write_count() (push)
+};
+
 // Get default I2S configuration
 i2s_config_t i2s_get_default_config(void);
 
-// Initialize I2S with the given configuration
+// Initialize I2S with the given configuration. In push mode this also
+// sets up the DMA IRQ, on the calling core.
 void i2s_init(i2s_config_t *config);
 
+// Pull mode: fill both buffers through config->fill and start playback.
+// The DMA IRQ, which refills each buffer as soon as it has been played, is
+// taken by the core this is called on, so fill runs there.
+void i2s_start_pull(i2s_config_t *config);
+
+// Copy the ring statistics, and start them over if reset is set
+void i2s_get_stats(struct i2s_stats *st, bool reset);
+
 // Write samples to I2S via DMA (non-blocking after first call)
 // samples: pointer to stereo samples (interleaved L/R as 32-bit words)
 void i2s_dma_write(i2s_config_t *config, const int16_t *samples);
@@ -4,7 +4,7 @@
 extern const uint8_t * const ascii2vga[];
 extern const uint8_t * const ascii2cga[];
 
-#ifdef _RP2350
+#if defined(_RP2350) || defined(_HOST)
 #define isvalchar(ch) ((((ch) - 32) < 0x5f) && ((ch) >= 32) && ascii2cga[(ch) - 32] != NULL)
 #else
 #define isvalchar(ch) ((((ch) - 32) < 0x5f) && ((ch) >= 32) && ascii2vga[(ch) - 32] != NULL)
@@ -11,14 +11,7 @@
 #include "monster.h"
 #include "digger.h"
 #include "scores.h"
-#include "game.h"
-
-static struct bag {
-  int16_t x,y,h,v,xr,yr,dir,wt,gt,fallh;
-  bool wobbling,unfallen,exist;
-} bagdat1[BAGS],bagdat2[BAGS],bagdat[BAGS];
-
-static int16_t pushcount=0,goldtime=0;
+#include "game_ctx.h"
 
 static void updatebag(struct digger_draw_api *, int16_t bag);
 static void baghitground(int16_t bag);
@@ -28,102 +21,106 @@ static void getgold(struct digger_draw_api *, int16_t bag);
 
 void initbags(void)
 {
+  struct bags_state *st=&dgctx->bags;
   int16_t bag,x,y;
-  pushcount=0;
-  goldtime=150-levof10()*10;
+  st->pushcount=0;
+  st->goldtime=150-levof10()*10;
   for (bag=0;bag<BAGS;bag++)
-    bagdat[bag].exist=false;
+    st->bagdat[bag].exist=false;
   bag=0;
   for (x=0;x<MWIDTH;x++)
     for (y=0;y<MHEIGHT;y++)
       if (getlevch(x,y,levplan())=='B')
         if (bag<BAGS) {
-          bagdat[bag].exist=true;
-          bagdat[bag].gt=0;
-          bagdat[bag].fallh=0;
-          bagdat[bag].dir=DIR_NONE;
-          bagdat[bag].wobbling=false;
-          bagdat[bag].wt=15;
-          bagdat[bag].unfallen=true;
-          bagdat[bag].x=x*20+12;
-          bagdat[bag].y=y*18+18;
-          bagdat[bag].h=x;
-          bagdat[bag].v=y;
-          bagdat[bag].xr=0;
-          bagdat[bag++].yr=0;
+          st->bagdat[bag].exist=true;
+          st->bagdat[bag].gt=0;
+          st->bagdat[bag].fallh=0;
+          st->bagdat[bag].dir=DIR_NONE;
+          st->bagdat[bag].wobbling=false;
+          st->bagdat[bag].wt=15;
+          st->bagdat[bag].unfallen=true;
+          st->bagdat[bag].x=x*20+12;
+          st->bagdat[bag].y=y*18+18;
+          st->bagdat[bag].h=x;
+          st->bagdat[bag].v=y;
+          st->bagdat[bag].xr=0;
+          st->bagdat[bag++].yr=0;
         }
-  if (dgstate.curplayer==0)
-    memcpy(bagdat1,bagdat,BAGS*sizeof(struct bag));
+  if (dgctx->game.curplayer==0)
+    memcpy(st->bagdat1,st->bagdat,BAGS*sizeof(struct bag));
   else
-    memcpy(bagdat2,bagdat,BAGS*sizeof(struct bag));
+    memcpy(st->bagdat2,st->bagdat,BAGS*sizeof(struct bag));
 }
 
 void drawbags(void)
 {
+  struct bags_state *st=&dgctx->bags;
   int16_t bag;
   for (bag=0;bag<BAGS;bag++) {
-    if (dgstate.curplayer==0)
-      memcpy(&bagdat[bag],&bagdat1[bag],sizeof(struct bag));
+    if (dgctx->game.curplayer==0)
+      memcpy(&st->bagdat[bag],&st->bagdat1[bag],sizeof(struct bag));
     else
-      memcpy(&bagdat[bag],&bagdat2[bag],sizeof(struct bag));
-    if (bagdat[bag].exist)
-      movedrawspr(bag+FIRSTBAG,bagdat[bag].x,bagdat[bag].y);
+      memcpy(&st->bagdat[bag],&st->bagdat2[bag],sizeof(struct bag));
+    if (st->bagdat[bag].exist)
+      movedrawspr(bag+FIRSTBAG,st->bagdat[bag].x,st->bagdat[bag].y);
   }
 }
 
 void cleanupbags(void)
 {
+  struct bags_state *st=&dgctx->bags;
   int16_t bag;
   soundfalloff();
   for (bag=0;bag<BAGS;bag++) {
-    if (bagdat[bag].exist && ((bagdat[bag].h==7 && bagdat[bag].v==9) ||
-        bagdat[bag].xr!=0 || bagdat[bag].yr!=0 || bagdat[bag].gt!=0 ||
-        bagdat[bag].fallh!=0 || bagdat[bag].wobbling)) {
-      bagdat[bag].exist=false;
+    if (st->bagdat[bag].exist && ((st->bagdat[bag].h==7 && st->bagdat[bag].v==9) ||
+        st->bagdat[bag].xr!=0 || st->bagdat[bag].yr!=0 || st->bagdat[bag].gt!=0 ||
+        st->bagdat[bag].fallh!=0 || st->bagdat[bag].wobbling)) {
+      st->bagdat[bag].exist=false;
       erasespr(bag+FIRSTBAG);
     }
-    if (dgstate.curplayer==0)
-      memcpy(&bagdat1[bag],&bagdat[bag],sizeof(struct bag));
+    if (dgctx->game.curplayer==0)
+      memcpy(&st->bagdat1[bag],&st->bagdat[bag],sizeof(struct bag));
     else
-      memcpy(&bagdat2[bag],&bagdat[bag],sizeof(struct bag));
+      memcpy(&st->bagdat2[bag],&st->bagdat[bag],sizeof(struct bag));
   }
 }
 
 void dobags(struct digger_draw_api *ddap)
 {
+  struct bags_state *st=&dgctx->bags;
   int16_t bag;
   bool soundfalloffflag=true,soundwobbleoffflag=true;
   for (bag=0;bag<BAGS;bag++)
-    if (bagdat[bag].exist) {
-      if (bagdat[bag].gt!=0) {
-        if (bagdat[bag].gt==1) {
+    if (st->bagdat[bag].exist) {
+      if (st->bagdat[bag].gt!=0) {
+        if (st->bagdat[bag].gt==1) {
           soundbreak();
-          drawgold(bag,4,bagdat[bag].x,bagdat[bag].y);
+          drawgold(bag,4,st->bagdat[bag].x,st->bagdat[bag].y);
           incpenalty();
         }
-        if (bagdat[bag].gt==3) {
-          drawgold(bag,5,bagdat[bag].x,bagdat[bag].y);
+        if (st->bagdat[bag].gt==3) {
+          drawgold(bag,5,st->bagdat[bag].x,st->bagdat[bag].y);
           incpenalty();
         }
-        if (bagdat[bag].gt==5) {
-          drawgold(bag,6,bagdat[bag].x,bagdat[bag].y);
+        if (st->bagdat[bag].gt==5) {
+          drawgold(bag,6,st->bagdat[bag].x,st->bagdat[bag].y);
           incpenalty();
         }
-        bagdat[bag].gt++;
-        if (bagdat[bag].gt==goldtime)
+        st->bagdat[bag].gt++;
+        if (st->bagdat[bag].gt==st->goldtime)
           removebag(bag);
         else
-          if (bagdat[bag].v<MHEIGHT-1 && bagdat[bag].gt<goldtime-10)
-            if ((getfield(bagdat[bag].h,bagdat[bag].v+1)&0x2000)==0)
-              bagdat[bag].gt=goldtime-10;
+          if (st->bagdat[bag].v<MHEIGHT-1 && st->bagdat[bag].gt<st->goldtime-10)
+            if ((getfield(st->bagdat[bag].h,st->bagdat[bag].v+1)&0x2000)==0)
+              st->bagdat[bag].gt=st->goldtime-10;
       }
       else
         updatebag(ddap, bag);
     }
   for (bag=0;bag<BAGS;bag++) {
-    if (bagdat[bag].dir==DIR_DOWN && bagdat[bag].exist)
+    if (st->bagdat[bag].dir==DIR_DOWN && st->bagdat[bag].exist)
       soundfalloffflag=false;
-    if (bagdat[bag].dir!=DIR_DOWN && bagdat[bag].wobbling && bagdat[bag].exist)
+    if (st->bagdat[bag].dir!=DIR_DOWN && st->bagdat[bag].wobbling && st->bagdat[bag].exist)
       soundwobbleoffflag=false;
   }
   if (soundfalloffflag)
@@ -137,24 +134,25 @@ static int16_t wblanim[4]={2,0,1,0};
 static void
 updatebag(struct digger_draw_api *ddap, int16_t bag)
 {
+  struct bags_state *st=&dgctx->bags;
   int16_t x,h,xr,y,v,yr,wbl;
-  x=bagdat[bag].x;
-  h=bagdat[bag].h;
-  xr=bagdat[bag].xr;
-  y=bagdat[bag].y;
-  v=bagdat[bag].v;
-  yr=bagdat[bag].yr;
-  switch (bagdat[bag].dir) {
+  x=st->bagdat[bag].x;
+  h=st->bagdat[bag].h;
+  xr=st->bagdat[bag].xr;
+  y=st->bagdat[bag].y;
+  v=st->bagdat[bag].v;
+  yr=st->bagdat[bag].yr;
+  switch (st->bagdat[bag].dir) {
     case DIR_NONE:
       if (y<180 && xr==0) {
-        if (bagdat[bag].wobbling) {
-          if (bagdat[bag].wt==0) {
-            bagdat[bag].dir=DIR_DOWN;
+        if (st->bagdat[bag].wobbling) {
+          if (st->bagdat[bag].wt==0) {
+            st->bagdat[bag].dir=DIR_DOWN;
             soundfall();
             break;
           }
-          bagdat[bag].wt--;
-          wbl=bagdat[bag].wt%8;
+          st->bagdat[bag].wt--;
+          wbl=st->bagdat[bag].wt%8;
           if (!(wbl&1)) {
             drawgold(bag,wblanim[wbl>>1],x,y);
             incpenalty();
@@ -164,19 +162,19 @@ updatebag(struct digger_draw_api *ddap, int16_t bag)
         else
           if ((getfield(h,v+1)&0xfdf)!=0xfdf)
             if (!checkdiggerunderbag(h,v+1))
-              bagdat[bag].wobbling=true;
+              st->bagdat[bag].wobbling=true;
       }
       else {
-        bagdat[bag].wt=15;
-        bagdat[bag].wobbling=false;
+        st->bagdat[bag].wt=15;
+        st->bagdat[bag].wobbling=false;
       }
       break;
     case DIR_RIGHT:
     case DIR_LEFT:
       if (xr==0) {
         if (y<180 && (getfield(h,v+1)&0xfdf)!=0xfdf) {
-          bagdat[bag].dir=DIR_DOWN;
-          bagdat[bag].wt=0;
+          st->bagdat[bag].dir=DIR_DOWN;
+          st->bagdat[bag].wt=0;
           soundfall();
         }
         else
@@ -185,39 +183,40 @@ updatebag(struct digger_draw_api *ddap, int16_t bag)
       break;
     case DIR_DOWN:
       if (yr==0)
-        bagdat[bag].fallh++;
+        st->bagdat[bag].fallh++;
       if (y>=180)
         baghitground(bag);
       else
         if ((getfield(h,v+1)&0xfdf)==0xfdf)
           if (yr==0)
             baghitground(bag);
-      checkmonscared(bagdat[bag].h);
+      checkmonscared(st->bagdat[bag].h);
   }
-  if (bagdat[bag].dir!=DIR_NONE) {
-    if (bagdat[bag].dir!=DIR_DOWN && pushcount!=0)
-      pushcount--;
+  if (st->bagdat[bag].dir!=DIR_NONE) {
+    if (st->bagdat[bag].dir!=DIR_DOWN && st->pushcount!=0)
+      st->pushcount--;
     else
-      pushbag(ddap, bag,bagdat[bag].dir);
+      pushbag(ddap, bag,st->bagdat[bag].dir);
   }
 }
 
 static void
 baghitground(int16_t bag)
 {
+  struct bags_state *st=&dgctx->bags;
   int clfirst[TYPES],clcoll[SPRITES],i;
-  if (bagdat[bag].dir==DIR_DOWN && bagdat[bag].fallh>1)
-    bagdat[bag].gt=1;
+  if (st->bagdat[bag].dir==DIR_DOWN && st->bagdat[bag].fallh>1)
+    st->bagdat[bag].gt=1;
   else
-    bagdat[bag].fallh=0;
-  bagdat[bag].dir=DIR_NONE;
-  bagdat[bag].wt=15;
-  bagdat[bag].wobbling=false;
-  drawgold(bag,0,bagdat[bag].x,bagdat[bag].y);
+    st->bagdat[bag].fallh=0;
+  st->bagdat[bag].dir=DIR_NONE;
+  st->bagdat[bag].wt=15;
+  st->bagdat[bag].wobbling=false;
+  drawgold(bag,0,st->bagdat[bag].x,st->bagdat[bag].y);
   for (i=0;i<TYPES;i++)
-    clfirst[i]=first[i];
+    clfirst[i]=dgctx->sprite.first[i];
   for (i=0;i<SPRITES;i++)
-    clcoll[i]=coll[i];
+    clcoll[i]=dgctx->sprite.coll[i];
   incpenalty();
   i=clfirst[1];
   while (i!=-1) {
@@ -229,28 +228,29 @@ baghitground(int16_t bag)
 static bool
 pushbag(struct digger_draw_api *ddap, int16_t bag,int16_t dir)
 {
+  struct bags_state *st=&dgctx->bags;
   int16_t x,y,h,v,ox,oy;
   int clfirst[TYPES],clcoll[SPRITES],i;
   bool push=true,digf;
-  ox=x=bagdat[bag].x;
-  oy=y=bagdat[bag].y;
-  h=bagdat[bag].h;
-  v=bagdat[bag].v;
-  if (bagdat[bag].gt!=0) {
+  ox=x=st->bagdat[bag].x;
+  oy=y=st->bagdat[bag].y;
+  h=st->bagdat[bag].h;
+  v=st->bagdat[bag].v;
+  if (st->bagdat[bag].gt!=0) {
     getgold(ddap, bag);
     return true;
   }
-  if (bagdat[bag].dir==DIR_DOWN && (dir==DIR_RIGHT || dir==DIR_LEFT)) {
+  if (st->bagdat[bag].dir==DIR_DOWN && (dir==DIR_RIGHT || dir==DIR_LEFT)) {
     drawgold(bag,3,x,y);
     for (i=0;i<TYPES;i++)
-      clfirst[i]=first[i];
+      clfirst[i]=dgctx->sprite.first[i];
     for (i=0;i<SPRITES;i++)
-      clcoll[i]=coll[i];
+      clcoll[i]=dgctx->sprite.coll[i];
     incpenalty();
     i=clfirst[4];
     while (i!=-1) {
-      if (diggery(i-FIRSTDIGGER+dgstate.curplayer)>=y)
-        killdigger(i-FIRSTDIGGER+dgstate.curplayer,1,bag);
+      if (diggery(i-FIRSTDIGGER+dgctx->game.curplayer)>=y)
+        killdigger(i-FIRSTDIGGER+dgctx->game.curplayer,1,bag);
       i=clcoll[i];
     }
     if (clfirst[2]!=-1)
@@ -269,8 +269,8 @@ pushbag(struct digger_draw_api *ddap, int16_t bag,int16_t dir)
         x-=4;
         break;
       case DIR_DOWN:
-        if (bagdat[bag].unfallen) {
-          bagdat[bag].unfallen=false;
+        if (st->bagdat[bag].unfallen) {
+          st->bagdat[bag].unfallen=false;
           drawsquareblob(x,y);
           drawtopblob(x,y+21);
         }
@@ -284,14 +284,14 @@ pushbag(struct digger_draw_api *ddap, int16_t bag,int16_t dir)
       case DIR_DOWN:
         drawgold(bag,3,x,y);
         for (i=0;i<TYPES;i++)
-          clfirst[i]=first[i];
+          clfirst[i]=dgctx->sprite.first[i];
         for (i=0;i<SPRITES;i++)
-          clcoll[i]=coll[i];
+          clcoll[i]=dgctx->sprite.coll[i];
         incpenalty();
         i=clfirst[4];
         while (i!=-1) {
-          if (diggery(i-FIRSTDIGGER+dgstate.curplayer)>=y)
-            killdigger(i-FIRSTDIGGER+dgstate.curplayer,1,bag);
+          if (diggery(i-FIRSTDIGGER+dgctx->game.curplayer)>=y)
+            killdigger(i-FIRSTDIGGER+dgctx->game.curplayer,1,bag);
           i=clcoll[i];
         }
         if (clfirst[2]!=-1)
@@ -299,15 +299,15 @@ pushbag(struct digger_draw_api *ddap, int16_t bag,int16_t dir)
         break;
       case DIR_RIGHT:
       case DIR_LEFT:
-        bagdat[bag].wt=15;
-        bagdat[bag].wobbling=false;
+        st->bagdat[bag].wt=15;
+        st->bagdat[bag].wobbling=false;
         drawgold(bag,0,x,y);
         for (i=0;i<TYPES;i++)
-          clfirst[i]=first[i];
+          clfirst[i]=dgctx->sprite.first[i];
         for (i=0;i<SPRITES;i++)
-          clcoll[i]=coll[i];
+          clcoll[i]=dgctx->sprite.coll[i];
         incpenalty();
-        pushcount=1;
+        st->pushcount=1;
         if (clfirst[1]!=-1)
           if (!pushbags(ddap, dir,clfirst,clcoll)) {
             x=ox;
@@ -319,7 +319,7 @@ pushbag(struct digger_draw_api *ddap, int16_t bag,int16_t dir)
         i=clfirst[4];
         digf=false;
         while (i!=-1) {
-          if (digalive(i-FIRSTDIGGER+dgstate.curplayer))
+          if (digalive(i-FIRSTDIGGER+dgctx->game.curplayer))
             digf=true;
           i=clcoll[i];
         }
@@ -332,15 +332,15 @@ pushbag(struct digger_draw_api *ddap, int16_t bag,int16_t dir)
         }
     }
     if (push)
-      bagdat[bag].dir=dir;
+      st->bagdat[bag].dir=dir;
     else
-      bagdat[bag].dir=reversedir(dir);
-    bagdat[bag].x=x;
-    bagdat[bag].y=y;
-    bagdat[bag].h=(x-12)/20;
-    bagdat[bag].v=(y-18)/18;
-    bagdat[bag].xr=(x-12)%20;
-    bagdat[bag].yr=(y-18)%18;
+      st->bagdat[bag].dir=reversedir(dir);
+    st->bagdat[bag].x=x;
+    st->bagdat[bag].y=y;
+    st->bagdat[bag].h=(x-12)/20;
+    st->bagdat[bag].v=(y-18)/18;
+    st->bagdat[bag].xr=(x-12)%20;
+    st->bagdat[bag].yr=(y-18)%18;
   }
   return push;
 }
@@ -362,7 +362,7 @@ bool pushudbags(struct digger_draw_api *ddap, int *clfirst,int *clcoll)
   bool push=true;
   int next=clfirst[1];
   while (next!=-1) {
-    if (bagdat[next-FIRSTBAG].gt!=0)
+    if (dgctx->bags.bagdat[next-FIRSTBAG].gt!=0)
       getgold(ddap, next-FIRSTBAG);
     else
       push=false;
@@ -374,26 +374,28 @@ bool pushudbags(struct digger_draw_api *ddap, int *clfirst,int *clcoll)
 static void
 removebag(int16_t bag)
 {
-  if (bagdat[bag].exist) {
-    bagdat[bag].exist=false;
+  struct bags_state *st=&dgctx->bags;
+  if (st->bagdat[bag].exist) {
+    st->bagdat[bag].exist=false;
     erasespr(bag+FIRSTBAG);
   }
 }
 
 bool bagexist(int bag)
 {
-  return bagdat[bag].exist;
+  return dgctx->bags.bagdat[bag].exist;
 }
 
 int16_t bagy(int16_t bag)
 {
-  return bagdat[bag].y;
+  return dgctx->bags.bagdat[bag].y;
 }
 
 int16_t getbagdir(int16_t bag)
 {
-  if (bagdat[bag].exist)
-    return bagdat[bag].dir;
+  struct bags_state *st=&dgctx->bags;
+  if (st->bagdat[bag].exist)
+    return st->bagdat[bag].dir;
   return -1;
 }
 
@@ -408,10 +410,11 @@ void removebags(int *clfirst,int *clcoll)
 
 int16_t getnmovingbags(void)
 {
+  struct bags_state *st=&dgctx->bags;
   int16_t bag,n=0;
   for (bag=0;bag<BAGS;bag++)
-    if (bagdat[bag].exist && bagdat[bag].gt<10 &&
-        (bagdat[bag].gt!=0 || bagdat[bag].wobbling))
+    if (st->bagdat[bag].exist && st->bagdat[bag].gt<10 &&
+        (st->bagdat[bag].gt!=0 || st->bagdat[bag].wobbling))
       n++;
   return n;
 }
@@ -419,19 +422,20 @@ int16_t getnmovingbags(void)
 static void
 getgold(struct digger_draw_api *ddap, int16_t bag)
 {
+  struct bags_state *st=&dgctx->bags;
   bool f=true;
   int i;
-  drawgold(bag,6,bagdat[bag].x,bagdat[bag].y);
+  drawgold(bag,6,st->bagdat[bag].x,st->bagdat[bag].y);
   incpenalty();
-  i=first[4];
+  i=dgctx->sprite.first[4];
   while (i!=-1) {
-    if (digalive(i-FIRSTDIGGER+dgstate.curplayer)) {
-      scoregold(ddap, i-FIRSTDIGGER+dgstate.curplayer);
+    if (digalive(i-FIRSTDIGGER+dgctx->game.curplayer)) {
+      scoregold(ddap, i-FIRSTDIGGER+dgctx->game.curplayer);
       soundgold();
-      digresettime(i-FIRSTDIGGER+dgstate.curplayer);
+      digresettime(i-FIRSTDIGGER+dgctx->game.curplayer);
       f=false;
     }
-    i=coll[i];
+    i=dgctx->sprite.coll[i];
   }
   if (f)
     mongold();
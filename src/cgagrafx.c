@@ -3184,3 +3184,138 @@ const uint8_t *cgatable[]={
   cgaexp1b,     cgaexp1bmask,
   cgaexp2b,     cgaexp2bmask,
   cgaexp3b,     cgaexp3bmask};
+
+
+/* Bytes in each of the images above */
+const uint8_t cgatablesize[]={
+  sizeof(cgazero60),    sizeof(cgaediggermask),    /* 0 */
+  sizeof(cgardigger1),  sizeof(cgardigger1mask),
+  sizeof(cgardigger2),  sizeof(cgardigger2mask),
+  sizeof(cgardigger3),  sizeof(cgardigger3mask),
+  sizeof(cgarxdigger1), sizeof(cgarxdigger1mask),
+  sizeof(cgarxdigger2), sizeof(cgarxdigger2mask),  /* 5 */
+  sizeof(cgarxdigger3), sizeof(cgarxdigger3mask),
+  sizeof(cgaudigger1),  sizeof(cgaudigger1mask),
+  sizeof(cgaudigger2),  sizeof(cgaudigger2mask),
+  sizeof(cgaudigger3),  sizeof(cgaudigger3mask),
+  sizeof(cgauxdigger1), sizeof(cgauxdigger1mask),  /* 10 */
+  sizeof(cgauxdigger2), sizeof(cgauxdigger2mask),
+  sizeof(cgauxdigger3), sizeof(cgauxdigger3mask),
+  sizeof(cgaldigger1),  sizeof(cgaldigger1mask),
+  sizeof(cgaldigger2),  sizeof(cgaldigger2mask),
+  sizeof(cgaldigger3),  sizeof(cgaldigger3mask),   /* 15 */
+  sizeof(cgalxdigger1), sizeof(cgalxdigger1mask),
+  sizeof(cgalxdigger2), sizeof(cgalxdigger2mask),
+  sizeof(cgalxdigger3), sizeof(cgalxdigger3mask),
+  sizeof(cgaddigger1),  sizeof(cgaddigger1mask),
+  sizeof(cgaddigger2),  sizeof(cgaddigger2mask),   /* 20 */
+  sizeof(cgaddigger3),  sizeof(cgaddigger3mask),
+  sizeof(cgadxdigger1), sizeof(cgadxdigger1mask),
+  sizeof(cgadxdigger2), sizeof(cgadxdigger2mask),
+  sizeof(cgadxdigger3), sizeof(cgadxdigger3mask),
+  sizeof(cgadiggerd),   sizeof(cgadiggerdmask),    /* 25 */
+  sizeof(cgagrave1),    sizeof(cgagrave1mask),
+  sizeof(cgagrave2),    sizeof(cgagrave2mask),
+  sizeof(cgagrave3),    sizeof(cgagrave3mask),
+  sizeof(cgagrave4),    sizeof(cgagrave4mask),
+  sizeof(cgagrave5),    sizeof(cgagrave5mask),     /* 30 */
+
+  sizeof(cgazero60),    sizeof(cgaediggermask),
+  sizeof(cgarbigger1),  sizeof(cgarbigger1mask),
+  sizeof(cgarbigger2),  sizeof(cgarbigger2mask),
+  sizeof(cgarbigger3),  sizeof(cgarbigger3mask),
+  sizeof(cgarxbigger1), sizeof(cgarxbigger1mask),  /* 35 */
+  sizeof(cgarxbigger2), sizeof(cgarxbigger2mask),
+  sizeof(cgarxbigger3), sizeof(cgarxbigger3mask),
+  sizeof(cgaubigger1),  sizeof(cgaubigger1mask),
+  sizeof(cgaubigger2),  sizeof(cgaubigger2mask),
+  sizeof(cgaubigger3),  sizeof(cgaubigger3mask),   /* 40 */
+  sizeof(cgauxbigger1), sizeof(cgauxbigger1mask),
+  sizeof(cgauxbigger2), sizeof(cgauxbigger2mask),
+  sizeof(cgauxbigger3), sizeof(cgauxbigger3mask),
+  sizeof(cgalbigger1),  sizeof(cgalbigger1mask),
+  sizeof(cgalbigger2),  sizeof(cgalbigger2mask),   /* 45 */
+  sizeof(cgalbigger3),  sizeof(cgalbigger3mask),
+  sizeof(cgalxbigger1), sizeof(cgalxbigger1mask),
+  sizeof(cgalxbigger2), sizeof(cgalxbigger2mask),
+  sizeof(cgalxbigger3), sizeof(cgalxbigger3mask),
+  sizeof(cgadbigger1),  sizeof(cgadbigger1mask),   /* 50 */
+  sizeof(cgadbigger2),  sizeof(cgadbigger2mask),
+  sizeof(cgadbigger3),  sizeof(cgadbigger3mask),
+  sizeof(cgadxbigger1), sizeof(cgadxbigger1mask),
+  sizeof(cgadxbigger2), sizeof(cgadxbigger2mask),
+  sizeof(cgadxbigger3), sizeof(cgadxbigger3mask),  /* 55 */
+  sizeof(cgabiggerd),   sizeof(cgabiggerdmask),
+  sizeof(cgagrave1),    sizeof(cgagrave1mask),
+  sizeof(cgagrave2),    sizeof(cgagrave2mask),
+  sizeof(cgagrave3),    sizeof(cgagrave3mask),
+  sizeof(cgagrave4),    sizeof(cgagrave4mask),     /* 60 */
+  sizeof(cgagrave5),    sizeof(cgagrave5mask),
+
+  sizeof(cgasbag),      sizeof(cgasbagmask),
+  sizeof(cgarbag),      sizeof(cgarbagmask),
+  sizeof(cgalbag),      sizeof(cgalbagmask),
+  sizeof(cgafbag),      sizeof(cgafbagmask),       /* 65 */
+  sizeof(cgagold1),     sizeof(cgagold1mask),
+  sizeof(cgagold2),     sizeof(cgagold2mask),
+  sizeof(cgagold3),     sizeof(cgagold3mask),
+
+  sizeof(cganobbin1),   sizeof(cganobbin1mask),
+  sizeof(cganobbin2),   sizeof(cganobbin2mask),    /* 70 */
+  sizeof(cganobbin3),   sizeof(cganobbin3mask),
+  sizeof(cganobbind),   sizeof(cganobbindmask),
+  sizeof(cgarhobbin1),  sizeof(cgarhobbin1mask),
+  sizeof(cgarhobbin2),  sizeof(cgarhobbin2mask),
+  sizeof(cgarhobbin3),  sizeof(cgarhobbin3mask),   /* 75 */
+  sizeof(cgarhobbind),  sizeof(cgarhobbindmask),
+  sizeof(cgalhobbin1),  sizeof(cgalhobbin1mask),
+  sizeof(cgalhobbin2),  sizeof(cgalhobbin2mask),
+  sizeof(cgalhobbin3),  sizeof(cgalhobbin3mask),
+  sizeof(cgalhobbind),  sizeof(cgalhobbindmask),   /* 80 */
+
+  sizeof(cgabonus),     sizeof(cgaediggermask),
+
+  sizeof(cgafire1),     sizeof(cgafire1mask),
+  sizeof(cgafire2),     sizeof(cgafire2mask),
+  sizeof(cgafire3),     sizeof(cgafire3mask),
+  sizeof(cgaexp1),      sizeof(cgaexp1mask),       /* 85 */
+  sizeof(cgaexp2),      sizeof(cgaexp2mask),
+  sizeof(cgaexp3),      sizeof(cgaexp3mask),
+
+  sizeof(cgafire1),     sizeof(cgafire1mask),
+  sizeof(cgafire2),     sizeof(cgafire2mask),
+  sizeof(cgafire3),     sizeof(cgafire3mask),      /* 90 */
+  sizeof(cgaexp1),      sizeof(cgaexp1mask),
+  sizeof(cgaexp2),      sizeof(cgaexp2mask),
+  sizeof(cgaexp3),      sizeof(cgaexp3mask),
+
+  sizeof(cgaback1),     sizeof(cgazero60),
+  sizeof(cgaback2),     sizeof(cgazero60),         /* 95 */
+  sizeof(cgaback3),     sizeof(cgazero60),
+  sizeof(cgaback4),     sizeof(cgazero60),
+  sizeof(cgaback5),     sizeof(cgazero60),
+  sizeof(cgaback6),     sizeof(cgazero60),
+  sizeof(cgaback7),     sizeof(cgazero60),         /* 100 */
+  sizeof(cgaback8),     sizeof(cgazero60),
+
+  sizeof(cgazero60),    sizeof(cgarightblobmask),
+  sizeof(cgazero60),    sizeof(cgatopblobmask),
+  sizeof(cgazero60),    sizeof(cgaleftblobmask),
+  sizeof(cgazero60),    sizeof(cgabottomblobmask), /* 105 */
+  sizeof(cgazero60),    sizeof(cgasquareblobmask),
+  sizeof(cgazero60),    sizeof(cgafurryblobmask),
+
+  sizeof(cgaemerald),   sizeof(cgaemeraldmask),
+  sizeof(cgazero60),    sizeof(cgaemeraldmask),
+
+  sizeof(cgaliferight), sizeof(cgaliferightmask),  /* 110 */
+  sizeof(cgalifeleft),  sizeof(cgalifeleftmask),
+  sizeof(cgazero60),    sizeof(cgaelifemask),
+  sizeof(cgaleftlife),  sizeof(cgaleftlifemask),
+
+  sizeof(cgafire1b),    sizeof(cgafire1bmask),
+  sizeof(cgafire2b),    sizeof(cgafire2bmask),     /* 115 */
+  sizeof(cgafire3b),    sizeof(cgafire3bmask),
+  sizeof(cgaexp1b),     sizeof(cgaexp1bmask),
+  sizeof(cgaexp2b),     sizeof(cgaexp2bmask),
+  sizeof(cgaexp3b),     sizeof(cgaexp3bmask)};
@@ -0,0 +1,27 @@
+/*
+ * cgaline.c - 2bpp CGA Scanline Expansion
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <string.h>
+#include <stdint.h>
+
+#include "cgaline.h"
+
+uint32_t cgaline_lut[256];
+
+void cgaline_init(void)
+{
+    for (int b = 0; b < 256; b++) {
+        uint8_t px[4];
+
+        for (int i = 0; i < 4; i++)
+            px[i] = (b >> (6 - i * 2)) & 3;
+        /* Byte order in memory is pixel order, whatever the endianness */
+        memcpy(&cgaline_lut[b], px, sizeof(px));
+    }
+}
@@ -0,0 +1,60 @@
+/*
+ * cgaline.h - 2bpp CGA Scanline Expansion
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __CGALINE_H
+#define __CGALINE_H
+
+#include <stdint.h>
+
+/*
+ * The expanders run in the HDMI scanline IRQ, from scratch RAM. They have
+ * to be inlined there whatever the optimiser thinks: a call would go to
+ * flash, which stalls on a cache miss and cannot be read at all while a
+ * recording is being written to it.
+ */
+#ifdef _RP2350
+#include "pico.h"
+#elif !defined(__force_inline)
+#define __force_inline inline __attribute__((always_inline))
+#endif
+
+/*
+ * A 2bpp screen is stored as CGA does it: 4 pixels to a byte, leftmost
+ * pixel in the top 2 bits. The HDMI driver wants a palette index byte per
+ * pixel, so each screen byte is looked up as the 4 output bytes at once.
+ */
+extern uint32_t cgaline_lut[256];
+
+/* Fill cgaline_lut[]; has to be done before the first line is expanded */
+void cgaline_init(void);
+
+/* Expand n screen bytes at in to 4n index bytes at out */
+static __force_inline void cgaline_expand(uint32_t *out, const uint8_t *in, int n)
+{
+    for (int i = 0; i < n; i++)
+        out[i] = cgaline_lut[in[i]];
+}
+
+/*
+ * A 4bpp screen has 2 pixels to a byte, low nibble first: expand n screen
+ * bytes at in to 2n index bytes at out. A table of pixel pairs looked up
+ * a word at a time was tried, and on the host at -O3, as the firmware is
+ * built, it is several times slower than this (see /N).
+ */
+static __force_inline void cgaline_expand4(uint32_t *out, const uint8_t *in, int n)
+{
+    uint8_t *o = (uint8_t *)out;
+
+    for (int i = 0; i < n; i++) {
+        o[i * 2] = in[i] & 0xF;
+        o[i * 2 + 1] = in[i] >> 4;
+    }
+}
+
+#endif
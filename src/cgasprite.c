@@ -0,0 +1,264 @@
+/*
+ * cgasprite.c - Masked CGA Sprite Blitter
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cgasprite.h"
+
+/* CGA sprite table from cgagrafx.c */
+extern const uint8_t *cgatable[];
+extern const uint8_t cgatablesize[];
+
+/*
+ * A CGA byte is 4 pixels, 2 bits each, MSB first. In the framebuffer the
+ * same 4 pixels are 2 bytes, so each byte of a sprite is expanded to a
+ * 16-bit mask and a 16-bit image, in framebuffer byte order, and a sprite
+ * is drawn 4 pixels at a time as (screen & mask) | image.
+ *
+ * Per pixel the CGA rule is: where the mask is not 3, screen & mask |
+ * sprite; where it is 3, the screen unless the sprite is set there, in
+ * which case the sprite. The second case becomes mask 0xF or 0.
+ */
+static struct {
+    bool ready;
+    uint8_t len[CGASPRITES];
+    uint16_t mask[CGASPRITES][CGASPRMAX];
+    uint16_t image[CGASPRITES][CGASPRMAX];
+} atlas;
+
+static uint16_t expand(const uint8_t b[4])
+{
+    uint8_t fb[2];
+    uint16_t v;
+
+    fb[0] = b[0] | (b[1] << 4);
+    fb[1] = b[2] | (b[3] << 4);
+    memcpy(&v, fb, sizeof(v));
+    return v;
+}
+
+int cgaspr_len(int16_t ch)
+{
+    int s = cgatablesize[ch * 2], m = cgatablesize[ch * 2 + 1];
+
+    return s < m ? s : m;
+}
+
+void cgaspr_init(void)
+{
+    uint8_t m[4], s[4];
+    int ch, i, p, n;
+
+    if (atlas.ready)
+        return;
+    for (ch = 0; ch < CGASPRITES; ch++) {
+        n = cgaspr_len(ch);
+        if (n > CGASPRMAX)
+            n = 0;              /* Too big for the atlas: drawn by pixel */
+        atlas.len[ch] = n;
+        for (i = 0; i < n; i++) {
+            for (p = 0; p < 4; p++) {
+                uint8_t spix = (cgatable[ch * 2][i] >> (6 - p * 2)) & 3;
+                uint8_t mpix = (cgatable[ch * 2 + 1][i] >> (6 - p * 2)) & 3;
+
+                s[p] = spix;
+                if (mpix != 3)
+                    m[p] = mpix;
+                else
+                    m[p] = spix ? 0 : 0xF;
+            }
+            atlas.mask[ch][i] = expand(m);
+            atlas.image[ch][i] = expand(s);
+        }
+    }
+    atlas.ready = true;
+}
+
+/*
+ * Sprites are placed at x & -4 (see drawspr()), so every CGA byte of a
+ * sprite lands on 2 whole framebuffer bytes and is either all on screen
+ * or all off it. Clipping is worked out once, for rows and columns.
+ */
+void cgaspr_put(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                int16_t w, int16_t h)
+{
+    const uint16_t *mask, *image;
+    int r0, r1, c0, c1, row, col;
+
+    if ((x & 3) != 0 || ch < 0 || ch >= CGASPRITES || !atlas.ready ||
+        w * h > atlas.len[ch]) {
+        cgaspr_putref(fb, x, y, ch, w, h);
+        return;
+    }
+    r0 = -(y + fb->yoff);
+    if (r0 < 0)
+        r0 = 0;
+    r1 = fb->height - (y + fb->yoff);
+    if (r1 > h)
+        r1 = h;
+    c0 = (x < 0) ? -x / 4 : 0;
+    c1 = (fb->width - x) / 4;
+    if (c1 > w)
+        c1 = w;
+    if (c0 >= c1)
+        return;
+
+    mask = atlas.mask[ch];
+    image = atlas.image[ch];
+    for (row = r0; row < r1; row++) {
+        uint8_t *d = fb->pixels + (y + fb->yoff + row) * fb->stride +
+                     (x >> 1) + c0 * 2;
+        int i = row * w + c0;
+
+        for (col = c0; col < c1; col++, i++, d += 2) {
+            uint16_t v;
+
+            memcpy(&v, d, sizeof(v));
+            v = (v & mask[i]) | image[i];
+            memcpy(d, &v, sizeof(v));
+        }
+    }
+}
+
+static inline void setpixel(const struct cgafb *fb, int x, int y,
+                            uint8_t color)
+{
+    int fb_y = y + fb->yoff;
+    uint8_t *p;
+
+    if (fb_y < 0 || fb_y >= fb->height || x < 0 || x >= fb->width)
+        return;
+    p = &fb->pixels[fb_y * fb->stride + (x >> 1)];
+    if (x & 1)
+        *p = (*p & 0x0F) | ((color & 0x0F) << 4);
+    else
+        *p = (*p & 0xF0) | (color & 0x0F);
+}
+
+static inline uint8_t getpixel(const struct cgafb *fb, int x, int y)
+{
+    int fb_y = y + fb->yoff;
+    uint8_t b;
+
+    if (fb_y < 0 || fb_y >= fb->height || x < 0 || x >= fb->width)
+        return 0;
+    b = fb->pixels[fb_y * fb->stride + (x >> 1)];
+    return (x & 1) ? (b >> 4) & 0x0F : b & 0x0F;
+}
+
+void cgaspr_putref(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                   int16_t w, int16_t h)
+{
+    const uint8_t *sprite = cgatable[ch * 2];
+    const uint8_t *mask = cgatable[ch * 2 + 1];
+
+    for (int row = 0; row < h; row++) {
+        int px = x;
+        for (int col = 0; col < w; col++) {
+            uint8_t sbyte = sprite[row * w + col];
+            uint8_t mbyte = mask[row * w + col];
+
+            /* Each byte has 4 pixels at 2 bits each, MSB first */
+            for (int bit = 6; bit >= 0; bit -= 2) {
+                uint8_t spix = (sbyte >> bit) & 0x03;
+                uint8_t mpix = (mbyte >> bit) & 0x03;
+
+                if (mpix != 0x03) {
+                    /* Not fully transparent - blend */
+                    uint8_t screen_pix = getpixel(fb, px, y + row);
+                    setpixel(fb, px, y + row, (screen_pix & mpix) | spix);
+                } else if (spix != 0) {
+                    /* Mask is fully transparent but sprite has data */
+                    setpixel(fb, px, y + row, spix);
+                }
+                px++;
+            }
+        }
+    }
+}
+
+/* Pixel helpers for a 2bpp buffer, for sprites that are not at x & -4 */
+static inline void setpixel2(const struct cgafb *fb, int x, int y,
+                             uint8_t color)
+{
+    int fb_y = y + fb->yoff, shift = 6 - (x & 3) * 2;
+    uint8_t *p;
+
+    if (fb_y < 0 || fb_y >= fb->height || x < 0 || x >= fb->width)
+        return;
+    p = &fb->pixels[fb_y * fb->stride + (x >> 2)];
+    *p = (*p & ~(3 << shift)) | ((color & 3) << shift);
+}
+
+static inline uint8_t getpixel2(const struct cgafb *fb, int x, int y)
+{
+    int fb_y = y + fb->yoff;
+
+    if (fb_y < 0 || fb_y >= fb->height || x < 0 || x >= fb->width)
+        return 0;
+    return (fb->pixels[fb_y * fb->stride + (x >> 2)] >> (6 - (x & 3) * 2)) & 3;
+}
+
+/*
+ * The blend rule above, a byte at a time: a mask of 3 over a set sprite
+ * pixel is taken as 0, and then it is (screen & mask) | sprite.
+ */
+static inline uint8_t blend2(uint8_t screen, uint8_t m, uint8_t s)
+{
+    uint8_t set = (s | (s >> 1)) & 0x55;        /* sprite pixel not 0 */
+    uint8_t three = m & (m >> 1) & 0x55;        /* mask pixel 3 */
+
+    m &= ~((set & three) * 3);
+    return (screen & m) | s;
+}
+
+void cgaspr_put2(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                 int16_t w, int16_t h)
+{
+    const uint8_t *sprite = cgatable[ch * 2];
+    const uint8_t *mask = cgatable[ch * 2 + 1];
+    int r0, r1, c0, c1, row, col;
+
+    if ((x & 3) != 0) {
+        for (row = 0; row < h; row++)
+            for (col = 0; col < w * 4; col++) {
+                int i = row * w + (col >> 2), shift = 6 - (col & 3) * 2;
+                uint8_t s = (sprite[i] >> shift) & 3;
+                uint8_t m = (mask[i] >> shift) & 3;
+
+                if (m != 3 || s != 0)
+                    setpixel2(fb, x + col, y + row,
+                              blend2(getpixel2(fb, x + col, y + row), m, s));
+            }
+        return;
+    }
+    r0 = -(y + fb->yoff);
+    if (r0 < 0)
+        r0 = 0;
+    r1 = fb->height - (y + fb->yoff);
+    if (r1 > h)
+        r1 = h;
+    c0 = (x < 0) ? -x / 4 : 0;
+    c1 = (fb->width - x) / 4;
+    if (c1 > w)
+        c1 = w;
+    if (c0 >= c1)
+        return;
+
+    for (row = r0; row < r1; row++) {
+        uint8_t *d = fb->pixels + (y + fb->yoff + row) * fb->stride +
+                     (x >> 2) + c0;
+        int i = row * w + c0;
+
+        for (col = c0; col < c1; col++, i++, d++)
+            *d = blend2(*d, mask[i], sprite[i]);
+    }
+}
@@ -0,0 +1,53 @@
+/*
+ * cgasprite.h - Masked CGA Sprite Blitter
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __CGASPRITE_H
+#define __CGASPRITE_H
+
+#include <stdint.h>
+
+/* Sprites in cgatable[], and bytes in the largest of them */
+#define CGASPRITES 120
+#define CGASPRMAX  60
+
+/*
+ * The framebuffer a sprite is drawn into: 4 bits per pixel, low nibble =
+ * even x, stride bytes per row, width x height pixels. Game y 0 is row
+ * yoff of the buffer.
+ */
+struct cgafb {
+    uint8_t *pixels;
+    int stride, width, height, yoff;
+};
+
+/* Expand every sprite and its mask into the atlas. Only the first call
+   does anything. */
+void cgaspr_init(void);
+
+/* Draw sprite ch, w CGA bytes by h rows, at x, y: the screen is kept
+   where the mask is set and the sprite is or-ed in. */
+void cgaspr_put(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                int16_t w, int16_t h);
+
+/* The same, a pixel at a time straight from cgatable[], for comparison */
+void cgaspr_putref(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                   int16_t w, int16_t h);
+
+/*
+ * Draw into a 2bpp framebuffer, laid out like CGA memory: 4 pixels to a
+ * byte, leftmost in the top 2 bits. This works on the cgatable[] bytes
+ * themselves and needs no atlas.
+ */
+void cgaspr_put2(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                 int16_t w, int16_t h);
+
+/* Bytes in sprite ch that may be drawn */
+int cgaspr_len(int16_t ch);
+
+#endif
@@ -0,0 +1,241 @@
+/*
+ * cgatext.c - CGA Text and Rectangle Fill
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "alpha.h"
+#include "cgatext.h"
+
+#define GLYPHS 0x5f             /* ascii2cga[], from ' ' */
+#define GLYPH_H 12
+#define GLYPH_W 12
+
+/*
+ * Every glyph row as the 6 bytes it takes in a 4bpp framebuffer, with 0xF
+ * for a set pixel. Anded with the colour in both nibbles it is the row as
+ * drawn, so one copy of the font serves all colours.
+ */
+static struct {
+    bool ready;
+    uint8_t rows[GLYPHS][GLYPH_H][GLYPH_W / 2];
+} glyphs;
+
+void cgatext_init(void)
+{
+    const uint8_t *font;
+    int ch, row, col, p;
+
+    if (glyphs.ready)
+        return;
+    for (ch = 0; ch < GLYPHS; ch++) {
+        font = ascii2cga[ch];
+        if (font == NULL)
+            continue;
+        for (row = 0; row < GLYPH_H; row++)
+            for (col = 0; col < GLYPH_W / 2; col++) {
+                uint8_t b = font[row * 3 + col / 2], v = 0;
+
+                for (p = 0; p < 2; p++)
+                    if ((b >> (6 - ((col & 1) * 2 + p) * 2)) & 3)
+                        v |= 0xF << (p * 4);
+                glyphs.rows[ch][row][col] = v;
+            }
+    }
+    glyphs.ready = true;
+}
+
+static inline void setpixel(const struct cgafb *fb, int x, int y,
+                            uint8_t color)
+{
+    int fb_y = y + fb->yoff;
+    uint8_t *p;
+
+    if (fb_y < 0 || fb_y >= fb->height || x < 0 || x >= fb->width)
+        return;
+    p = &fb->pixels[fb_y * fb->stride + (x >> 1)];
+    if (x & 1)
+        *p = (*p & 0x0F) | ((color & 0x0F) << 4);
+    else
+        *p = (*p & 0xF0) | (color & 0x0F);
+}
+
+static inline void setpixel2(const struct cgafb *fb, int x, int y,
+                             uint8_t color)
+{
+    int fb_y = y + fb->yoff, shift = 6 - (x & 3) * 2;
+    uint8_t *p;
+
+    if (fb_y < 0 || fb_y >= fb->height || x < 0 || x >= fb->width)
+        return;
+    p = &fb->pixels[fb_y * fb->stride + (x >> 2)];
+    *p = (*p & ~(3 << shift)) | ((color & 3) << shift);
+}
+
+/* True if the cell at x is all across the screen and starts on a byte;
+   then *r0 to *r1 - 1 are its rows that are on screen at y */
+static inline bool cellfits(const struct cgafb *fb, int x, int y, int align,
+                            int *r0, int *r1)
+{
+    *r0 = -(y + fb->yoff);
+    if (*r0 < 0)
+        *r0 = 0;
+    *r1 = fb->height - (y + fb->yoff);
+    if (*r1 > GLYPH_H)
+        *r1 = GLYPH_H;
+    return (x & (align - 1)) == 0 && x >= 0 && x + GLYPH_W <= fb->width;
+}
+
+void cgatext_putref(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                    int16_t c)
+{
+    const uint8_t *font;
+
+    if (!isvalchar(ch))
+        return;
+    font = ascii2cga[ch - 32];
+    for (int row = 0; row < GLYPH_H; row++) {
+        int px = x;
+
+        for (int col = 0; col < 3; col++) {
+            uint8_t byte = font[row * 3 + col];
+
+            for (int bit = 6; bit >= 0; bit -= 2) {
+                setpixel(fb, px, y + row, ((byte >> bit) & 3) ? c : 0);
+                px++;
+            }
+        }
+    }
+}
+
+/* A glyph row is 6 bytes, so with the cell on screen and x even a
+   character is 12 masked row copies */
+void cgatext_put(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                 int16_t c)
+{
+    uint8_t colour = (c & 0x0F) * 0x11, *d;
+    int r0, r1, row, i;
+
+    if (!isvalchar(ch))
+        return;
+    if (!glyphs.ready || !cellfits(fb, x, y, 2, &r0, &r1)) {
+        cgatext_putref(fb, x, y, ch, c);
+        return;
+    }
+    d = fb->pixels + (y + fb->yoff + r0) * fb->stride + (x >> 1);
+    for (row = r0; row < r1; row++, d += fb->stride) {
+        const uint8_t *g = glyphs.rows[ch - 32][row];
+
+        for (i = 0; i < GLYPH_W / 2; i++)
+            d[i] = g[i] & colour;
+    }
+}
+
+/* The font is already 2bpp, with 3 for a set pixel: at x & -4 a row is
+   3 bytes anded with the colour */
+void cgatext_put2(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                  int16_t c)
+{
+    const uint8_t *font;
+    uint8_t colour = (c & 3) * 0x55, *d;
+    int r0, r1, row, col;
+
+    if (!isvalchar(ch))
+        return;
+    font = ascii2cga[ch - 32];
+    if (!cellfits(fb, x, y, 4, &r0, &r1)) {
+        for (row = 0; row < GLYPH_H; row++)
+            for (col = 0; col < GLYPH_W; col++)
+                setpixel2(fb, x + col, y + row,
+                          ((font[row * 3 + (col >> 2)] >> (6 - (col & 3) * 2)) & 3) ?
+                          c : 0);
+        return;
+    }
+    d = fb->pixels + (y + fb->yoff + r0) * fb->stride + (x >> 2);
+    for (row = r0; row < r1; row++, d += fb->stride) {
+        d[0] = font[row * 3] & colour;
+        d[1] = font[row * 3 + 1] & colour;
+        d[2] = font[row * 3 + 2] & colour;
+    }
+}
+
+/* Clip w x h at x, y to the framebuffer; false if nothing is left */
+static bool clip(const struct cgafb *fb, int16_t *x, int16_t *y, int16_t *w,
+                 int16_t *h)
+{
+    int x0 = *x, y0 = *y + fb->yoff, x1 = x0 + *w, y1 = y0 + *h;
+
+    if (x0 < 0)
+        x0 = 0;
+    if (y0 < 0)
+        y0 = 0;
+    if (x1 > fb->width)
+        x1 = fb->width;
+    if (y1 > fb->height)
+        y1 = fb->height;
+    if (x0 >= x1 || y0 >= y1)
+        return false;
+    *x = x0;
+    *y = y0;                    /* a framebuffer row from here on */
+    *w = x1 - x0;
+    *h = y1 - y0;
+    return true;
+}
+
+void cgatext_fill(const struct cgafb *fb, int16_t x, int16_t y, int16_t w,
+                  int16_t h, int16_t c)
+{
+    uint8_t colour = (c & 0x0F) * 0x11;
+
+    if (!clip(fb, &x, &y, &w, &h))
+        return;
+    for (; h > 0; h--, y++) {
+        uint8_t *d = fb->pixels + y * fb->stride + (x >> 1);
+        int n = w;
+
+        if (x & 1) {
+            *d = (*d & 0x0F) | (colour & 0xF0);
+            d++;
+            n--;
+        }
+        memset(d, colour, n >> 1);
+        if (n & 1)
+            d[n >> 1] = (d[n >> 1] & 0xF0) | (colour & 0x0F);
+    }
+}
+
+void cgatext_fill2(const struct cgafb *fb, int16_t x, int16_t y, int16_t w,
+                   int16_t h, int16_t c)
+{
+    uint8_t colour = (c & 3) * 0x55;
+    int x0, x1, b0, b1;
+
+    if (!clip(fb, &x, &y, &w, &h))
+        return;
+    x0 = x;
+    x1 = x + w;                 /* pixels x0 to x1 - 1 */
+    b0 = (x0 + 3) >> 2;         /* whole bytes b0 to b1 - 1 */
+    b1 = x1 >> 2;
+    for (; h > 0; h--, y++) {
+        uint8_t *d = fb->pixels + y * fb->stride;
+        int px;
+
+        if (b0 > b1) {          /* all in one byte */
+            for (px = x0; px < x1; px++)
+                setpixel2(fb, px, y - fb->yoff, c);
+            continue;
+        }
+        for (px = x0; px < b0 * 4; px++)
+            setpixel2(fb, px, y - fb->yoff, c);
+        memset(d + b0, colour, b1 - b0);
+        for (px = b1 * 4; px < x1; px++)
+            setpixel2(fb, px, y - fb->yoff, c);
+    }
+}
@@ -0,0 +1,40 @@
+/*
+ * cgatext.h - CGA Text and Rectangle Fill
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __CGATEXT_H
+#define __CGATEXT_H
+
+#include <stdint.h>
+
+#include "cgasprite.h"
+
+/* Expand the alpha font into framebuffer rows. Only the first call does
+   anything. */
+void cgatext_init(void);
+
+/* Draw character ch at x, y into a 4bpp framebuffer: its 12x12 cell is
+   set to colour c where the glyph is set and to black elsewhere. */
+void cgatext_put(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                 int16_t c);
+
+/* The same, a pixel at a time straight from ascii2cga[], for comparison */
+void cgatext_putref(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                    int16_t c);
+
+/* The same for a 2bpp framebuffer in CGA layout (see cgaspr_put2()) */
+void cgatext_put2(const struct cgafb *fb, int16_t x, int16_t y, int16_t ch,
+                  int16_t c);
+
+/* Set w x h pixels from x, y to colour c, in a 4bpp or a 2bpp framebuffer */
+void cgatext_fill(const struct cgafb *fb, int16_t x, int16_t y, int16_t w,
+                  int16_t h, int16_t c);
+void cgatext_fill2(const struct cgafb *fb, int16_t x, int16_t y, int16_t w,
+                   int16_t h, int16_t c);
+
+#endif
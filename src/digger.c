@@ -18,24 +18,7 @@
 #include "scores.h"
 #include "bags.h"
 #include "bullet_obj.h"
-#include "game.h"
-
-static struct digger
-{
-  int16_t h,v,rx,ry,mdir,bagtime,rechargetime,
-        deathstage,deathbag,deathani,deathtime,emocttime,emn,msc,lives,ivt;
-  bool notfiring,firepressed,dead,levdone,invin;
-  struct digger_obj dob;
-  struct bullet_obj bob;
-} digdat[DIGGERS];
-
-static int16_t startbonustimeleft=0,bonustimeleft;
-
-static int16_t emmask=0;
-
-static int8_t emfield[MSIZE];
-
-bool bonusvisible=false,bonusmode=false,digvisible;
+#include "game_ctx.h"
 
 static void updatedigger(struct digger_draw_api *, int n);
 static void updatefire(struct digger_draw_api *, int n);
@@ -47,117 +30,119 @@ static void drawdig(int n);
 
 void initdigger(void)
 {
+  struct digger_state *st=&dgctx->digger;
   int dig;
   int16_t dir, x, y;
 
-  for (dig=dgstate.curplayer;dig<dgstate.diggers+dgstate.curplayer;dig++) {
-    if (digdat[dig].lives==0)
+  for (dig=dgctx->game.curplayer;dig<dgctx->game.diggers+dgctx->game.curplayer;dig++) {
+    if (st->digdat[dig].lives==0)
       continue;
-    digdat[dig].v=9;
-    digdat[dig].mdir=4;
-    digdat[dig].h=(dgstate.diggers==1) ? 7 : (8-dig*2);
-    x = digdat[dig].h * 20 + 12;
+    st->digdat[dig].v=9;
+    st->digdat[dig].mdir=4;
+    st->digdat[dig].h=(dgctx->game.diggers==1) ? 7 : (8-dig*2);
+    x = st->digdat[dig].h * 20 + 12;
     dir = (dig == 0) ? DIR_RIGHT : DIR_LEFT;
-    digdat[dig].rx=0;
-    digdat[dig].ry=0;
-    digdat[dig].bagtime=0;
-    digdat[dig].dead=false; /* alive !=> !dead but dead => !alive */
-    digdat[dig].invin=false;
-    digdat[dig].ivt=0;
-    digdat[dig].deathstage=1;
-    y = digdat[dig].v * 18 + 18;
-    digger_obj_init(&digdat[dig].dob, dig - dgstate.curplayer, dir, x, y);
-    CALL_METHOD(&digdat[dig].dob, put);
-    digdat[dig].notfiring=true;
-    digdat[dig].emocttime=0;
-    digdat[dig].bob.expsn=0;
-    digdat[dig].firepressed=false;
-    digdat[dig].rechargetime=0;
-    digdat[dig].emn=0;
-    digdat[dig].msc=1;
+    st->digdat[dig].rx=0;
+    st->digdat[dig].ry=0;
+    st->digdat[dig].bagtime=0;
+    st->digdat[dig].dead=false; /* alive !=> !dead but dead => !alive */
+    st->digdat[dig].invin=false;
+    st->digdat[dig].ivt=0;
+    st->digdat[dig].deathstage=1;
+    y = st->digdat[dig].v * 18 + 18;
+    digger_obj_init(&st->digdat[dig].dob, dig - dgctx->game.curplayer, dir, x, y);
+    CALL_METHOD(&st->digdat[dig].dob, put);
+    st->digdat[dig].notfiring=true;
+    st->digdat[dig].emocttime=0;
+    st->digdat[dig].bob.expsn=0;
+    st->digdat[dig].firepressed=false;
+    st->digdat[dig].rechargetime=0;
+    st->digdat[dig].emn=0;
+    st->digdat[dig].msc=1;
   }
-  digvisible=true;
-  bonusvisible=bonusmode=false;
+  st->digvisible=true;
+  st->bonusvisible=st->bonusmode=false;
 }
 
 #if defined(INTDRF) || 1
-static uint32_t frame;
 #endif
 
 uint32_t
 getframe(void)
 {
 
-  return (frame);
+  return (dgctx->digger.frame);
 }
 
+/* Start a new frame. Whoever drives digger_step() has already waited for
+   it. */
 void newframe(void)
 {
 
-  gethrt(sounddiedone ? false : true);
   checkkeyb();
 
 #if defined(INTDRF) || 1
-  frame++;
+  dgctx->digger.frame++;
 #endif
 
 }
 
 void drawdig(int n)
 {
-  CALL_METHOD(&digdat[n].dob, animate);
-  if (digdat[n].invin) {
-    digdat[n].ivt--;
-    if (digdat[n].ivt==0)
-      digdat[n].invin=false;
+  struct digger_state *st=&dgctx->digger;
+  CALL_METHOD(&st->digdat[n].dob, animate);
+  if (st->digdat[n].invin) {
+    st->digdat[n].ivt--;
+    if (st->digdat[n].ivt==0)
+      st->digdat[n].invin=false;
     else
-      if (digdat[n].ivt%10<5)
-        erasespr(FIRSTDIGGER+n-dgstate.curplayer);
+      if (st->digdat[n].ivt%10<5)
+        erasespr(FIRSTDIGGER+n-dgctx->game.curplayer);
   }
 }
 
 void
 dodigger(struct digger_draw_api *ddap)
 {
+  struct digger_state *st=&dgctx->digger;
   int n;
   int16_t tdir;
 
-  newframe();
-  if (dgstate.gauntlet) {
+  if (dgctx->game.gauntlet) {
     drawlives(ddap);
-    if (dgstate.cgtime<dgstate.ftime)
-      dgstate.timeout=true;
-    dgstate.cgtime-=dgstate.ftime;
+    if (dgctx->game.cgtime<dgctx->game.ftime)
+      dgctx->game.timeout=true;
+    dgctx->game.cgtime-=dgctx->game.ftime;
   }
-  for (n=dgstate.curplayer;n<dgstate.diggers+dgstate.curplayer;n++) {
-    if (digdat[n].bob.expsn!=0)
+  for (n=dgctx->game.curplayer;n<dgctx->game.diggers+dgctx->game.curplayer;n++) {
+    if (st->digdat[n].bob.expsn!=0)
       drawexplosion(n);
     else
       updatefire(ddap, n);
-    if (digvisible) {
-      if (digdat[n].dob.alive)
-        if (digdat[n].bagtime!=0) {
-          tdir = digdat[n].dob.dir;
-          digdat[n].dob.dir = digdat[n].mdir;
+    if (st->digvisible) {
+      if (st->digdat[n].dob.alive)
+        if (st->digdat[n].bagtime!=0) {
+          tdir = st->digdat[n].dob.dir;
+          st->digdat[n].dob.dir = st->digdat[n].mdir;
           drawdig(n);
-          digdat[n].dob.dir = tdir;
+          st->digdat[n].dob.dir = tdir;
           incpenalty();
-          digdat[n].bagtime--;
+          st->digdat[n].bagtime--;
         }
         else
           updatedigger(ddap, n);
       else
         diggerdie(ddap, n);
     }
-    if (digdat[n].emocttime>0)
-      digdat[n].emocttime--;
+    if (st->digdat[n].emocttime>0)
+      st->digdat[n].emocttime--;
   }
-  if (bonusmode && isalive()) {
-    if (bonustimeleft!=0) {
-      bonustimeleft--;
-      if (startbonustimeleft!=0 || bonustimeleft<20) {
-        startbonustimeleft--;
-        if (bonustimeleft&1) {
+  if (st->bonusmode && isalive()) {
+    if (st->bonustimeleft!=0) {
+      st->bonustimeleft--;
+      if (st->startbonustimeleft!=0 || st->bonustimeleft<20) {
+        st->startbonustimeleft--;
+        if (st->bonustimeleft&1) {
           ddap->ginten(0);
           soundbonus();
         }
@@ -165,7 +150,7 @@ dodigger(struct digger_draw_api *ddap)
           ddap->ginten(1);
           soundbonus();
         }
-        if (startbonustimeleft==0) {
+        if (st->startbonustimeleft==0) {
           music(0, 1.0);
           soundbonusoff();
           ddap->ginten(1);
@@ -178,7 +163,7 @@ dodigger(struct digger_draw_api *ddap)
       music(1, 1.0);
     }
   }
-  if (bonusmode && !isalive()) {
+  if (st->bonusmode && !isalive()) {
     endbonusmode(ddap);
     soundbonusoff();
     music(1, 1.0);
@@ -188,93 +173,94 @@ dodigger(struct digger_draw_api *ddap)
 static void
 updatefire(struct digger_draw_api *ddap, int n)
 {
+  struct digger_state *st=&dgctx->digger;
   int16_t pix=0, fx, fy;
   int clfirst[TYPES],clcoll[SPRITES],i;
   bool clflag;
-  if (digdat[n].notfiring) {
-    if (digdat[n].rechargetime!=0) {
-      digdat[n].rechargetime--;
-      if (digdat[n].rechargetime == 0) {
-        CALL_METHOD(&digdat[n].dob, recharge);
+  if (st->digdat[n].notfiring) {
+    if (st->digdat[n].rechargetime!=0) {
+      st->digdat[n].rechargetime--;
+      if (st->digdat[n].rechargetime == 0) {
+        CALL_METHOD(&st->digdat[n].dob, recharge);
       }
     } else {
-      if (getfirepflag(n-dgstate.curplayer)) {
-        if (digdat[n].dob.alive) {
-          CALL_METHOD(&digdat[n].dob, discharge);
-          digdat[n].rechargetime=levof10()*3+60;
-          digdat[n].notfiring=false;
-          switch (digdat[n].dob.dir) {
+      if (getfirepflag(n-dgctx->game.curplayer)) {
+        if (st->digdat[n].dob.alive) {
+          CALL_METHOD(&st->digdat[n].dob, discharge);
+          st->digdat[n].rechargetime=levof10()*3+60;
+          st->digdat[n].notfiring=false;
+          switch (st->digdat[n].dob.dir) {
             case DIR_RIGHT:
-              fx = digdat[n].dob.x + 8;
-              fy = digdat[n].dob.y + 4;
+              fx = st->digdat[n].dob.x + 8;
+              fy = st->digdat[n].dob.y + 4;
               break;
             case DIR_UP:
-              fx = digdat[n].dob.x + 4;
-              fy = digdat[n].dob.y;
+              fx = st->digdat[n].dob.x + 4;
+              fy = st->digdat[n].dob.y;
               break;
             case DIR_LEFT:
-              fx = digdat[n].dob.x;
-              fy = digdat[n].dob.y + 4;
+              fx = st->digdat[n].dob.x;
+              fy = st->digdat[n].dob.y + 4;
               break;
             case DIR_DOWN:
-              fx = digdat[n].dob.x + 4;
-              fy = digdat[n].dob.y + 8;
+              fx = st->digdat[n].dob.x + 4;
+              fy = st->digdat[n].dob.y + 8;
               break;
             default:
               abort();
           }
-          bullet_obj_init(&digdat[n].bob, n - dgstate.curplayer, digdat[n].dob.dir, fx, fy);
-          CALL_METHOD(&digdat[n].bob, put);
+          bullet_obj_init(&st->digdat[n].bob, n - dgctx->game.curplayer, st->digdat[n].dob.dir, fx, fy);
+          CALL_METHOD(&st->digdat[n].bob, put);
         }
       }
     }
   }
   else {
-    switch (digdat[n].bob.dir) {
+    switch (st->digdat[n].bob.dir) {
       case DIR_RIGHT:
-        digdat[n].bob.x+=8;
-        pix=ddap->ggetpix(digdat[n].bob.x,digdat[n].bob.y+4)|
-            ddap->ggetpix(digdat[n].bob.x+4,digdat[n].bob.y+4);
+        st->digdat[n].bob.x+=8;
+        pix=ddap->ggetpix(st->digdat[n].bob.x,st->digdat[n].bob.y+4)|
+            ddap->ggetpix(st->digdat[n].bob.x+4,st->digdat[n].bob.y+4);
         break;
       case DIR_UP:
-        digdat[n].bob.y-=7;
+        st->digdat[n].bob.y-=7;
         pix=0;
         for (i=0;i<7;i++)
-          pix|=ddap->ggetpix(digdat[n].bob.x+4,digdat[n].bob.y+i);
+          pix|=ddap->ggetpix(st->digdat[n].bob.x+4,st->digdat[n].bob.y+i);
         pix&=0xc0;
         break;
       case DIR_LEFT:
-        digdat[n].bob.x-=8;
-        pix=ddap->ggetpix(digdat[n].bob.x,digdat[n].bob.y+4)|
-            ddap->ggetpix(digdat[n].bob.x+4,digdat[n].bob.y+4);
+        st->digdat[n].bob.x-=8;
+        pix=ddap->ggetpix(st->digdat[n].bob.x,st->digdat[n].bob.y+4)|
+            ddap->ggetpix(st->digdat[n].bob.x+4,st->digdat[n].bob.y+4);
         break;
       case DIR_DOWN:
-        digdat[n].bob.y+=7;
+        st->digdat[n].bob.y+=7;
         pix=0;
         for (i=0;i<7;i++)
-          pix|=ddap->ggetpix(digdat[n].bob.x,digdat[n].bob.y+i);
+          pix|=ddap->ggetpix(st->digdat[n].bob.x,st->digdat[n].bob.y+i);
         pix&=0x3;
         break;       
     }
-    CALL_METHOD(&digdat[n].bob, animate);
+    CALL_METHOD(&st->digdat[n].bob, animate);
     for (i=0;i<TYPES;i++)
-      clfirst[i]=first[i];
+      clfirst[i]=dgctx->sprite.first[i];
     for (i=0;i<SPRITES;i++)
-      clcoll[i]=coll[i];
+      clcoll[i]=dgctx->sprite.coll[i];
     incpenalty();
     i=clfirst[2];
     while (i!=-1) {
       killmon(i-FIRSTMONSTER);
       scorekill(ddap, n);
-      CALL_METHOD(&digdat[n].bob, explode);
+      CALL_METHOD(&st->digdat[n].bob, explode);
       i=clcoll[i];
     }
     i=clfirst[4];
     while (i!=-1) {
-      if (i-FIRSTDIGGER+dgstate.curplayer!=n && !digdat[i-FIRSTDIGGER+dgstate.curplayer].invin
-          && digdat[i-FIRSTDIGGER+dgstate.curplayer].dob.alive) {
-        killdigger(i-FIRSTDIGGER+dgstate.curplayer,3,0);
-        CALL_METHOD(&digdat[n].bob, explode);
+      if (i-FIRSTDIGGER+dgctx->game.curplayer!=n && !st->digdat[i-FIRSTDIGGER+dgctx->game.curplayer].invin
+          && st->digdat[i-FIRSTDIGGER+dgctx->game.curplayer].dob.alive) {
+        killdigger(i-FIRSTDIGGER+dgctx->game.curplayer,3,0);
+        CALL_METHOD(&st->digdat[n].bob, explode);
       }
       i=clcoll[i];
     }
@@ -284,57 +270,57 @@ updatefire(struct digger_draw_api *ddap, int n)
     else
       clflag=false;
     if (clfirst[0]!=-1 || clfirst[1]!=-1 || clfirst[3]!=-1) {
-      CALL_METHOD(&digdat[n].bob, explode);
+      CALL_METHOD(&st->digdat[n].bob, explode);
       i=clfirst[3];
       while (i!=-1) {
-        if (digdat[i-FIRSTFIREBALL+dgstate.curplayer].bob.expsn==0) {
-          CALL_METHOD(&digdat[i-FIRSTFIREBALL+dgstate.curplayer].bob, explode);
+        if (st->digdat[i-FIRSTFIREBALL+dgctx->game.curplayer].bob.expsn==0) {
+          CALL_METHOD(&st->digdat[i-FIRSTFIREBALL+dgctx->game.curplayer].bob, explode);
         }
         i=clcoll[i];
       }
     }
-    switch (digdat[n].bob.dir) {
+    switch (st->digdat[n].bob.dir) {
       case DIR_RIGHT:
-        if (digdat[n].bob.x>296) {
-          CALL_METHOD(&digdat[n].bob, explode);
+        if (st->digdat[n].bob.x>296) {
+          CALL_METHOD(&st->digdat[n].bob, explode);
         } else {
           if (pix!=0 && !clflag) {
-            digdat[n].bob.x-=8;
-            CALL_METHOD(&digdat[n].bob, animate);
-            CALL_METHOD(&digdat[n].bob, explode);
+            st->digdat[n].bob.x-=8;
+            CALL_METHOD(&st->digdat[n].bob, animate);
+            CALL_METHOD(&st->digdat[n].bob, explode);
           }
         }
         break;
       case DIR_UP:
-        if (digdat[n].bob.y<15) {
-          CALL_METHOD(&digdat[n].bob, explode);
+        if (st->digdat[n].bob.y<15) {
+          CALL_METHOD(&st->digdat[n].bob, explode);
         } else {
           if (pix!=0 && !clflag) {
-            digdat[n].bob.y+=7;
-            CALL_METHOD(&digdat[n].bob, animate);
-            CALL_METHOD(&digdat[n].bob, explode);
+            st->digdat[n].bob.y+=7;
+            CALL_METHOD(&st->digdat[n].bob, animate);
+            CALL_METHOD(&st->digdat[n].bob, explode);
           }
         }
         break;
       case DIR_LEFT:
-        if (digdat[n].bob.x<16) {
-          CALL_METHOD(&digdat[n].bob, explode);
+        if (st->digdat[n].bob.x<16) {
+          CALL_METHOD(&st->digdat[n].bob, explode);
         } else {
           if (pix!=0 && !clflag) {
-            digdat[n].bob.x+=8;
-            CALL_METHOD(&digdat[n].bob, animate);
-            CALL_METHOD(&digdat[n].bob, explode);
+            st->digdat[n].bob.x+=8;
+            CALL_METHOD(&st->digdat[n].bob, animate);
+            CALL_METHOD(&st->digdat[n].bob, explode);
           }
         }
         break;
       case DIR_DOWN:
-        if (digdat[n].bob.y>183) {
-          CALL_METHOD(&digdat[n].bob, explode);
+        if (st->digdat[n].bob.y>183) {
+          CALL_METHOD(&st->digdat[n].bob, explode);
         } else {
           if (pix!=0 && !clflag) {
-            digdat[n].bob.y-=7;
-            CALL_METHOD(&digdat[n].bob, animate);
-            CALL_METHOD(&digdat[n].bob, explode);
+            st->digdat[n].bob.y-=7;
+            CALL_METHOD(&st->digdat[n].bob, animate);
+            CALL_METHOD(&st->digdat[n].bob, explode);
           }
         }
     }
@@ -344,16 +330,17 @@ updatefire(struct digger_draw_api *ddap, int n)
 void erasediggers(void)
 {
   int i;
-  for (i=0;i<dgstate.diggers;i++)
+  for (i=0;i<dgctx->game.diggers;i++)
     erasespr(FIRSTDIGGER+i);
-  digvisible=false;
+  dgctx->digger.digvisible=false;
 }
 
 void drawexplosion(int n)
 {
+  struct digger_state *st=&dgctx->digger;
 
-  if (digdat[n].bob.expsn < 4) {
-    CALL_METHOD(&digdat[n].bob, animate);
+  if (st->digdat[n].bob.expsn < 4) {
+    CALL_METHOD(&st->digdat[n].bob, animate);
     incpenalty();
   } else {
     killfire(n);
@@ -362,80 +349,82 @@ void drawexplosion(int n)
 
 void killfire(int n)
 {
-  if (!digdat[n].notfiring) {
-    digdat[n].notfiring=true;
-    CALL_METHOD(&digdat[n].bob, remove);
+  struct digger_state *st=&dgctx->digger;
+  if (!st->digdat[n].notfiring) {
+    st->digdat[n].notfiring=true;
+    CALL_METHOD(&st->digdat[n].bob, remove);
   }
 }
 
 static void
 updatedigger(struct digger_draw_api *ddap, int n)
 {
+  struct digger_state *st=&dgctx->digger;
   int16_t dir,ddir,diggerox,diggeroy,nmon;
   bool push=true,bagf;
   int clfirst[TYPES],clcoll[SPRITES],i;
-  readdirect(n-dgstate.curplayer);
-  dir=getdirect(n-dgstate.curplayer);
+  readdirect(n-dgctx->game.curplayer);
+  dir=getdirect(n-dgctx->game.curplayer);
   if (dir==DIR_RIGHT || dir==DIR_UP || dir==DIR_LEFT || dir==DIR_DOWN)
     ddir=dir;
   else
     ddir=DIR_NONE;
-  if (digdat[n].rx==0 && (ddir==DIR_UP || ddir==DIR_DOWN))
-    digdat[n].dob.dir=digdat[n].mdir=ddir;
-  if (digdat[n].ry==0 && (ddir==DIR_RIGHT || ddir==DIR_LEFT))
-    digdat[n].dob.dir=digdat[n].mdir=ddir;
+  if (st->digdat[n].rx==0 && (ddir==DIR_UP || ddir==DIR_DOWN))
+    st->digdat[n].dob.dir=st->digdat[n].mdir=ddir;
+  if (st->digdat[n].ry==0 && (ddir==DIR_RIGHT || ddir==DIR_LEFT))
+    st->digdat[n].dob.dir=st->digdat[n].mdir=ddir;
   if (dir==DIR_NONE)
-    digdat[n].mdir=DIR_NONE;
+    st->digdat[n].mdir=DIR_NONE;
   else
-    digdat[n].mdir=digdat[n].dob.dir;
-  if ((digdat[n].dob.x==292 && digdat[n].mdir==DIR_RIGHT) ||
-      (digdat[n].dob.x==12 && digdat[n].mdir==DIR_LEFT) ||
-      (digdat[n].dob.y==180 && digdat[n].mdir==DIR_DOWN) ||
-      (digdat[n].dob.y==18 && digdat[n].mdir==DIR_UP))
-    digdat[n].mdir=DIR_NONE;
-  diggerox=digdat[n].dob.x;
-  diggeroy=digdat[n].dob.y;
-  if (digdat[n].mdir!=DIR_NONE)
-    eatfield(diggerox,diggeroy,digdat[n].mdir);
-  switch (digdat[n].mdir) {
+    st->digdat[n].mdir=st->digdat[n].dob.dir;
+  if ((st->digdat[n].dob.x==292 && st->digdat[n].mdir==DIR_RIGHT) ||
+      (st->digdat[n].dob.x==12 && st->digdat[n].mdir==DIR_LEFT) ||
+      (st->digdat[n].dob.y==180 && st->digdat[n].mdir==DIR_DOWN) ||
+      (st->digdat[n].dob.y==18 && st->digdat[n].mdir==DIR_UP))
+    st->digdat[n].mdir=DIR_NONE;
+  diggerox=st->digdat[n].dob.x;
+  diggeroy=st->digdat[n].dob.y;
+  if (st->digdat[n].mdir!=DIR_NONE)
+    eatfield(diggerox,diggeroy,st->digdat[n].mdir);
+  switch (st->digdat[n].mdir) {
     case DIR_RIGHT:
-      drawrightblob(digdat[n].dob.x,digdat[n].dob.y);
-      digdat[n].dob.x+=4;
+      drawrightblob(st->digdat[n].dob.x,st->digdat[n].dob.y);
+      st->digdat[n].dob.x+=4;
       break;
     case DIR_UP:
-      drawtopblob(digdat[n].dob.x,digdat[n].dob.y);
-      digdat[n].dob.y-=3;
+      drawtopblob(st->digdat[n].dob.x,st->digdat[n].dob.y);
+      st->digdat[n].dob.y-=3;
       break;
     case DIR_LEFT:
-      drawleftblob(digdat[n].dob.x,digdat[n].dob.y);
-      digdat[n].dob.x-=4;
+      drawleftblob(st->digdat[n].dob.x,st->digdat[n].dob.y);
+      st->digdat[n].dob.x-=4;
       break;
     case DIR_DOWN:
-      drawbottomblob(digdat[n].dob.x,digdat[n].dob.y);
-      digdat[n].dob.y+=3;
+      drawbottomblob(st->digdat[n].dob.x,st->digdat[n].dob.y);
+      st->digdat[n].dob.y+=3;
       break;
   }
-  if (hitemerald((digdat[n].dob.x-12)/20,(digdat[n].dob.y-18)/18,
-                 (digdat[n].dob.x-12)%20,(digdat[n].dob.y-18)%18,
-                 digdat[n].mdir)) {
-    if (digdat[n].emocttime==0)
-      digdat[n].emn=0;
+  if (hitemerald((st->digdat[n].dob.x-12)/20,(st->digdat[n].dob.y-18)/18,
+                 (st->digdat[n].dob.x-12)%20,(st->digdat[n].dob.y-18)%18,
+                 st->digdat[n].mdir)) {
+    if (st->digdat[n].emocttime==0)
+      st->digdat[n].emn=0;
     scoreemerald(ddap, n);
     soundem();
-    soundemerald(digdat[n].emn);
+    soundemerald(st->digdat[n].emn);
 
-    digdat[n].emn++;
-    if (digdat[n].emn==8) {
-      digdat[n].emn=0;
+    st->digdat[n].emn++;
+    if (st->digdat[n].emn==8) {
+      st->digdat[n].emn=0;
       scoreoctave(ddap, n);
     }
-    digdat[n].emocttime=9;
+    st->digdat[n].emocttime=9;
   }
   drawdig(n);
   for (i=0;i<TYPES;i++)
-    clfirst[i]=first[i];
+    clfirst[i]=dgctx->sprite.first[i];
   for (i=0;i<SPRITES;i++)
-    clcoll[i]=coll[i];
+    clcoll[i]=dgctx->sprite.coll[i];
   incpenalty();
 
   i=clfirst[1];
@@ -449,23 +438,23 @@ updatedigger(struct digger_draw_api *ddap, int n)
   }
 
   if (bagf) {
-    if (digdat[n].mdir==DIR_RIGHT || digdat[n].mdir==DIR_LEFT) {
-      push=pushbags(ddap, digdat[n].mdir,clfirst,clcoll);
-      digdat[n].bagtime++;
+    if (st->digdat[n].mdir==DIR_RIGHT || st->digdat[n].mdir==DIR_LEFT) {
+      push=pushbags(ddap, st->digdat[n].mdir,clfirst,clcoll);
+      st->digdat[n].bagtime++;
     }
     else
       if (!pushudbags(ddap, clfirst,clcoll))
         push=false;
     if (!push) { /* Strange, push not completely defined */
-      digdat[n].dob.x=diggerox;
-      digdat[n].dob.y=diggeroy;
-      digdat[n].dob.dir = digdat[n].mdir;
+      st->digdat[n].dob.x=diggerox;
+      st->digdat[n].dob.y=diggeroy;
+      st->digdat[n].dob.dir = st->digdat[n].mdir;
       drawdig(n);
       incpenalty();
-      digdat[n].dob.dir=reversedir(digdat[n].mdir);
+      st->digdat[n].dob.dir=reversedir(st->digdat[n].mdir);
     }
   }
-  if (clfirst[2]!=-1 && bonusmode && digdat[n].dob.alive)
+  if (clfirst[2]!=-1 && st->bonusmode && st->digdat[n].dob.alive)
     for (nmon=killmonsters(clfirst,clcoll);nmon!=0;nmon--) {
       soundeatm();
       sceatm(ddap, n);
@@ -474,16 +463,17 @@ updatedigger(struct digger_draw_api *ddap, int n)
     scorebonus(ddap, n);
     initbonusmode(ddap);
   }
-  digdat[n].h=(digdat[n].dob.x-12)/20;
-  digdat[n].rx=(digdat[n].dob.x-12)%20;
-  digdat[n].v=(digdat[n].dob.y-18)/18;
-  digdat[n].ry=(digdat[n].dob.y-18)%18;
+  st->digdat[n].h=(st->digdat[n].dob.x-12)/20;
+  st->digdat[n].rx=(st->digdat[n].dob.x-12)%20;
+  st->digdat[n].v=(st->digdat[n].dob.y-18)/18;
+  st->digdat[n].ry=(st->digdat[n].dob.y-18)%18;
 }
 
 void sceatm(struct digger_draw_api *ddap, int n)
 {
-  scoreeatm(ddap, n,digdat[n].msc);
-  digdat[n].msc<<=1;
+  struct digger_state *st=&dgctx->digger;
+  scoreeatm(ddap, n,st->digdat[n].msc);
+  st->digdat[n].msc<<=1;
 }
 
 static int16_t deatharc[7]={3,5,6,6,5,3,0};
@@ -491,121 +481,122 @@ static int16_t deatharc[7]={3,5,6,6,5,3,0};
 static void
 diggerdie(struct digger_draw_api *ddap, int n)
 {
+  struct digger_state *st=&dgctx->digger;
   int clfirst[TYPES],clcoll[SPRITES],i;
   bool alldead;
-  switch (digdat[n].deathstage) {
+  switch (st->digdat[n].deathstage) {
     case 1:
-      if (bagy(digdat[n].deathbag)+6>digdat[n].dob.y)
-        digdat[n].dob.y=bagy(digdat[n].deathbag)+6;
-      drawdigger(n-dgstate.curplayer,15,digdat[n].dob.x,digdat[n].dob.y,false);
+      if (bagy(st->digdat[n].deathbag)+6>st->digdat[n].dob.y)
+        st->digdat[n].dob.y=bagy(st->digdat[n].deathbag)+6;
+      drawdigger(n-dgctx->game.curplayer,15,st->digdat[n].dob.x,st->digdat[n].dob.y,false);
       incpenalty();
-      if (getbagdir(digdat[n].deathbag)+1==0) {
+      if (getbagdir(st->digdat[n].deathbag)+1==0) {
         soundddie();
-        digdat[n].deathtime=5;
-        digdat[n].deathstage=2;
-        digdat[n].deathani=0;
-        digdat[n].dob.y-=6;
+        st->digdat[n].deathtime=5;
+        st->digdat[n].deathstage=2;
+        st->digdat[n].deathani=0;
+        st->digdat[n].dob.y-=6;
       }
       break;
     case 2:
-      if (digdat[n].deathtime!=0) {
-        digdat[n].deathtime--;
+      if (st->digdat[n].deathtime!=0) {
+        st->digdat[n].deathtime--;
         break;
       }
-      if (digdat[n].deathani==0)
-        music(2, (dgstate.diggers > 1) ? 0.7 : 1.0);
-      drawdigger(n-dgstate.curplayer,14-digdat[n].deathani,digdat[n].dob.x,digdat[n].dob.y,
+      if (st->digdat[n].deathani==0)
+        music(2, (dgctx->game.diggers > 1) ? 0.7 : 1.0);
+      drawdigger(n-dgctx->game.curplayer,14-st->digdat[n].deathani,st->digdat[n].dob.x,st->digdat[n].dob.y,
                  false);
       for (i=0;i<TYPES;i++)
-        clfirst[i]=first[i];
+        clfirst[i]=dgctx->sprite.first[i];
       for (i=0;i<SPRITES;i++)
-        clcoll[i]=coll[i];
+        clcoll[i]=dgctx->sprite.coll[i];
       incpenalty();
-      if (digdat[n].deathani==0 && clfirst[2]!=-1)
+      if (st->digdat[n].deathani==0 && clfirst[2]!=-1)
         killmonsters(clfirst,clcoll);
-      if (digdat[n].deathani<4) {
-        digdat[n].deathani++;
-        digdat[n].deathtime=2;
+      if (st->digdat[n].deathani<4) {
+        st->digdat[n].deathani++;
+        st->digdat[n].deathtime=2;
       }
       else {
-        digdat[n].deathstage=4;
-        if (musicflag || dgstate.diggers>1)
-          digdat[n].deathtime=60;
+        st->digdat[n].deathstage=4;
+        if (dgctx->sound.musicflag || dgctx->game.diggers>1)
+          st->digdat[n].deathtime=60;
         else
-          digdat[n].deathtime=10;
+          st->digdat[n].deathtime=10;
       }
       break;
     case 3:
-      digdat[n].deathstage=5;
-      digdat[n].deathani=0;
-      digdat[n].deathtime=0;
+      st->digdat[n].deathstage=5;
+      st->digdat[n].deathani=0;
+      st->digdat[n].deathtime=0;
       break;
     case 5:
-      if (digdat[n].deathani>=0 && digdat[n].deathani<=6) {
-        drawdigger(n-dgstate.curplayer,15,digdat[n].dob.x,
-                   digdat[n].dob.y-deatharc[digdat[n].deathani],false);
-        if (digdat[n].deathani==6 && !isalive())
+      if (st->digdat[n].deathani>=0 && st->digdat[n].deathani<=6) {
+        drawdigger(n-dgctx->game.curplayer,15,st->digdat[n].dob.x,
+                   st->digdat[n].dob.y-deatharc[st->digdat[n].deathani],false);
+        if (st->digdat[n].deathani==6 && !isalive())
           musicoff();
         incpenalty();
-        digdat[n].deathani++;
-        if (digdat[n].deathani==1)
+        st->digdat[n].deathani++;
+        if (st->digdat[n].deathani==1)
           soundddie();
-        if (digdat[n].deathani==7) {
-          digdat[n].deathtime=5;
-          digdat[n].deathani=0;
-          digdat[n].deathstage=2;
+        if (st->digdat[n].deathani==7) {
+          st->digdat[n].deathtime=5;
+          st->digdat[n].deathani=0;
+          st->digdat[n].deathstage=2;
         }
       }
       break;
     case 4:
-      if (digdat[n].deathtime!=0)
-        digdat[n].deathtime--;
+      if (st->digdat[n].deathtime!=0)
+        st->digdat[n].deathtime--;
       else {
-	if (dgstate.diggers == 1 && !sounddiedone) {
-	    frame -= 1;
+	if (dgctx->game.diggers == 1 && !dgctx->sound.sounddiedone) {
+	    st->frame -= 1;
 	    break;
 	}
-        digdat[n].dead=true;
+        st->digdat[n].dead=true;
         alldead=true;
-        for (i=0;i<dgstate.diggers;i++)
-          if (!digdat[i].dead) {
+        for (i=0;i<dgctx->game.diggers;i++)
+          if (!st->digdat[i].dead) {
             alldead=false;
             break;
           }
         if (alldead)
           setdead(true);
         else
-          if (isalive() && digdat[n].lives>0) {
-            if (!dgstate.gauntlet)
-              digdat[n].lives--;
+          if (isalive() && st->digdat[n].lives>0) {
+            if (!dgctx->game.gauntlet)
+              st->digdat[n].lives--;
             drawlives(ddap);
-            if (digdat[n].lives>0) {
-              digdat[n].v=9;
-              digdat[n].mdir=4;
-              digdat[n].h=(dgstate.diggers==1) ? 7 : (8-n*2);
-              digdat[n].dob.x=digdat[n].h*20+12;
-              digdat[n].dob.dir=(n==0) ? DIR_RIGHT : DIR_LEFT;
-              digdat[n].rx=0;
-              digdat[n].ry=0;
-              digdat[n].bagtime=0;
-              digdat[n].dob.alive=true;
-              digdat[n].dead=false;
-              digdat[n].invin=true;
-              digdat[n].ivt=50;
-              digdat[n].deathstage=1;
-              digdat[n].dob.y=digdat[n].v*18+18;
-              erasespr(n+FIRSTDIGGER-dgstate.curplayer);
-              CALL_METHOD(&digdat[n].dob, put);
-              digdat[n].notfiring=true;
-              digdat[n].emocttime=0;
-              digdat[n].firepressed=false;
-              digdat[n].bob.expsn=0;
-              digdat[n].rechargetime=0;
-              digdat[n].emn=0;
-              digdat[n].msc=1;
+            if (st->digdat[n].lives>0) {
+              st->digdat[n].v=9;
+              st->digdat[n].mdir=4;
+              st->digdat[n].h=(dgctx->game.diggers==1) ? 7 : (8-n*2);
+              st->digdat[n].dob.x=st->digdat[n].h*20+12;
+              st->digdat[n].dob.dir=(n==0) ? DIR_RIGHT : DIR_LEFT;
+              st->digdat[n].rx=0;
+              st->digdat[n].ry=0;
+              st->digdat[n].bagtime=0;
+              st->digdat[n].dob.alive=true;
+              st->digdat[n].dead=false;
+              st->digdat[n].invin=true;
+              st->digdat[n].ivt=50;
+              st->digdat[n].deathstage=1;
+              st->digdat[n].dob.y=st->digdat[n].v*18+18;
+              erasespr(n+FIRSTDIGGER-dgctx->game.curplayer);
+              CALL_METHOD(&st->digdat[n].dob, put);
+              st->digdat[n].notfiring=true;
+              st->digdat[n].emocttime=0;
+              st->digdat[n].firepressed=false;
+              st->digdat[n].bob.expsn=0;
+              st->digdat[n].rechargetime=0;
+              st->digdat[n].emn=0;
+              st->digdat[n].msc=1;
             }
             clearfire(n);
-            if (bonusmode)
+            if (st->bonusmode)
               music(0, 1.0);
             else
               music(1, 1.0);
@@ -616,35 +607,37 @@ diggerdie(struct digger_draw_api *ddap, int n)
 
 void createbonus(void)
 {
-  bonusvisible=true;
+  dgctx->digger.bonusvisible=true;
   drawbonus(292,18);
 }
 
 static void
 initbonusmode(struct digger_draw_api *ddap)
 {
+  struct digger_state *st=&dgctx->digger;
   int i;
-  bonusmode=true;
+  st->bonusmode=true;
   erasebonus(ddap);
   ddap->ginten(1);
-  bonustimeleft=250-levof10()*20;
-  startbonustimeleft=20;
-  for (i=0;i<dgstate.diggers;i++)
-    digdat[i].msc=1;
+  st->bonustimeleft=250-levof10()*20;
+  st->startbonustimeleft=20;
+  for (i=0;i<dgctx->game.diggers;i++)
+    st->digdat[i].msc=1;
 }
 
 static void
 endbonusmode(struct digger_draw_api *ddap)
 {
-  bonusmode=false;
+  dgctx->digger.bonusmode=false;
   ddap->ginten(0);
 }
 
 void
 erasebonus(struct digger_draw_api *ddap)
 {
-  if (bonusvisible) {
-    bonusvisible=false;
+  struct digger_state *st=&dgctx->digger;
+  if (st->bonusvisible) {
+    st->bonusvisible=false;
     erasespr(FIRSTBONUS);
   }
   ddap->ginten(0);
@@ -663,46 +656,50 @@ int16_t reversedir(int16_t dir)
 
 bool checkdiggerunderbag(int16_t h,int16_t v)
 {
+  struct digger_state *st=&dgctx->digger;
   int n;
-  for (n=dgstate.curplayer;n<dgstate.diggers+dgstate.curplayer;n++)
-    if (digdat[n].dob.alive)
-      if (digdat[n].mdir==DIR_UP || digdat[n].mdir==DIR_DOWN)
-        if ((digdat[n].dob.x-12)/20==h)
-          if ((digdat[n].dob.y-18)/18==v || (digdat[n].dob.y-18)/18+1==v)
+  for (n=dgctx->game.curplayer;n<dgctx->game.diggers+dgctx->game.curplayer;n++)
+    if (st->digdat[n].dob.alive)
+      if (st->digdat[n].mdir==DIR_UP || st->digdat[n].mdir==DIR_DOWN)
+        if ((st->digdat[n].dob.x-12)/20==h)
+          if ((st->digdat[n].dob.y-18)/18==v || (st->digdat[n].dob.y-18)/18+1==v)
             return true;
   return false;
 }
 
 void killdigger(int n,int16_t stage,int16_t bag)
 {
-  if (digdat[n].invin)
+  struct digger_state *st=&dgctx->digger;
+  if (st->digdat[n].invin)
     return;
-  if (digdat[n].deathstage<2 || digdat[n].deathstage>4) {
-    digdat[n].dob.alive=false;
-    digdat[n].deathstage=stage;
-    digdat[n].deathbag=bag;
+  if (st->digdat[n].deathstage<2 || st->digdat[n].deathstage>4) {
+    st->digdat[n].dob.alive=false;
+    st->digdat[n].deathstage=stage;
+    st->digdat[n].deathbag=bag;
   }
 }
 
 void makeemfield(void)
 {
+  struct digger_state *st=&dgctx->digger;
   int16_t x,y;
-  emmask=1<<dgstate.curplayer;
+  st->emmask=1<<dgctx->game.curplayer;
   for (x=0;x<MWIDTH;x++)
     for (y=0;y<MHEIGHT;y++)
       if (getlevch(x,y,levplan())=='C')
-        emfield[y*MWIDTH+x]|=emmask;
+        st->emfield[y*MWIDTH+x]|=st->emmask;
       else
-        emfield[y*MWIDTH+x]&=~emmask;
+        st->emfield[y*MWIDTH+x]&=~st->emmask;
 }
 
 void drawemeralds(void)
 {
+  struct digger_state *st=&dgctx->digger;
   int16_t x,y;
-  emmask=1<<dgstate.curplayer;
+  st->emmask=1<<dgctx->game.curplayer;
   for (x=0;x<MWIDTH;x++)
     for (y=0;y<MHEIGHT;y++)
-      if (emfield[y*MWIDTH+x]&emmask)
+      if (st->emfield[y*MWIDTH+x]&st->emmask)
         drawemerald(x*20+12,y*18+21);
 }
 
@@ -710,6 +707,7 @@ static const int16_t embox[8]={8,12,12,9,16,12,6,9};
 
 bool hitemerald(int16_t x,int16_t y,int16_t rx,int16_t ry,int16_t dir)
 {
+  struct digger_state *st=&dgctx->digger;
   bool hit=false;
   int16_t r;
   if (dir!=DIR_RIGHT && dir!=DIR_UP && dir!=DIR_LEFT && dir!=DIR_DOWN)
@@ -722,7 +720,7 @@ bool hitemerald(int16_t x,int16_t y,int16_t rx,int16_t ry,int16_t dir)
     r=rx;
   else
     r=ry;
-  if (emfield[y*MWIDTH+x]&emmask) {
+  if (st->emfield[y*MWIDTH+x]&st->emmask) {
     if (r==embox[dir]) {
       drawemerald(x*20+12,y*18+21);
       incpenalty();
@@ -731,7 +729,7 @@ bool hitemerald(int16_t x,int16_t y,int16_t rx,int16_t ry,int16_t dir)
       eraseemerald(x*20+12,y*18+21);
       incpenalty();
       hit=true;
-      emfield[y*MWIDTH+x]&=~emmask;
+      st->emfield[y*MWIDTH+x]&=~st->emmask;
     }
   }
   return hit;
@@ -739,18 +737,20 @@ bool hitemerald(int16_t x,int16_t y,int16_t rx,int16_t ry,int16_t dir)
 
 int16_t countem(void)
 {
+  struct digger_state *st=&dgctx->digger;
   int16_t x,y,n=0;
   for (x=0;x<MWIDTH;x++)
     for (y=0;y<MHEIGHT;y++)
-      if (emfield[y*MWIDTH+x]&emmask)
+      if (st->emfield[y*MWIDTH+x]&st->emmask)
         n++;
   return n;
 }
 
 void killemerald(int16_t x,int16_t y)
 {
-  if (emfield[(y+1)*MWIDTH+x]&emmask) {
-    emfield[(y+1)*MWIDTH+x]&=~emmask;
+  struct digger_state *st=&dgctx->digger;
+  if (st->emfield[(y+1)*MWIDTH+x]&st->emmask) {
+    st->emfield[(y+1)*MWIDTH+x]&=~st->emmask;
     eraseemerald(x*20+12,(y+1)*18+21);
   }
 }
@@ -758,58 +758,58 @@ void killemerald(int16_t x,int16_t y)
 static bool
 getfirepflag(int n)
 {
-  return n==0 ? firepflag : fire2pflag;
+  return n==0 ? dgctx->input.firepflag : dgctx->input.fire2pflag;
 }
 
 int diggerx(int n)
 {
-  return digdat[n].dob.x;
+  return dgctx->digger.digdat[n].dob.x;
 }
 
 int diggery(int n)
 {
-  return digdat[n].dob.y;
+  return dgctx->digger.digdat[n].dob.y;
 }
 
 bool digalive(int n)
 {
-  return digdat[n].dob.alive;
+  return dgctx->digger.digdat[n].dob.alive;
 }
 
 void digresettime(int n)
 {
-  digdat[n].bagtime=0;
+  dgctx->digger.digdat[n].bagtime=0;
 }
 
 bool isalive(void)
 {
   int i;
-  for (i=dgstate.curplayer;i<dgstate.diggers+dgstate.curplayer;i++)
-    if (digdat[i].dob.alive)
+  for (i=dgctx->game.curplayer;i<dgctx->game.diggers+dgctx->game.curplayer;i++)
+    if (dgctx->digger.digdat[i].dob.alive)
       return true;
   return false;
 }
 
 int getlives(int pl)
 {
-  return digdat[pl].lives;
+  return dgctx->digger.digdat[pl].lives;
 }
 
 void addlife(int pl)
 {
-  digdat[pl].lives++;
+  dgctx->digger.digdat[pl].lives++;
   sound1up();
 }
 
 void initlives(void)
 {
   int i;
-  for (i=0;i<dgstate.diggers+dgstate.nplayers-1;i++)
-    digdat[i].lives=3;
+  for (i=0;i<dgctx->game.diggers+dgctx->game.nplayers-1;i++)
+    dgctx->digger.digdat[i].lives=3;
 }
 
 void declife(int pl)
 {
-  if (!dgstate.gauntlet)
-    digdat[pl].lives--;
+  if (!dgctx->game.gauntlet)
+    dgctx->digger.digdat[pl].lives--;
 }
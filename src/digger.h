@@ -30,9 +30,7 @@ void addlife(int pl);
 void initlives(void);
 void declife(int pl);
 
-extern bool bonusvisible,digonscr,bonusmode;
 
 #ifdef INTDRF
-extern uint32_t frame;
 #endif
 uint32_t getframe(void);
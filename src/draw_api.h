@@ -14,6 +14,7 @@ struct digger_draw_api {
   int16_t (*ggetpix)(int16_t x,int16_t y);
   void (*gtitle)(void);
   void (*gwrite)(int16_t x,int16_t y,int16_t ch,int16_t c);
+  void (*gfill)(int16_t x,int16_t y,int16_t w,int16_t h,int16_t c);
 
   void (*gflush)(void);
 };
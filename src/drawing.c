@@ -16,26 +16,18 @@
 #include "sprite.h"
 #include "digger.h"
 #include "sound.h"
-#include "game.h"
-
-static int16_t field1[MSIZE],field2[MSIZE];
-int16_t field[MSIZE];
-
-static uint8_t monbufs[MONSTERS][480],bagbufs[BAGS][480],bonusbufs[BONUSES][480],
-      diggerbufs[DIGGERS][480],firebufs[FIREBALLS][128];
+#include "game_ctx.h"
 
 static uint16_t bitmasks[12]={0xfffe,0xfffd,0xfffb,0xfff7,0xffef,0xffdf,0xffbf,0xff7f,
                     0xfeff,0xfdff,0xfbff,0xf7ff};
 
-static int16_t digspr[DIGGERS],digspd[DIGGERS],firespr[FIREBALLS];
-
 static void drawlife(int16_t t,int16_t x,int16_t y);
+static bool livesdrawn(int n,int16_t lives,int16_t x,int16_t w);
 static void createdbfspr(void);
 static void initdbfspr(void);
-static void drawbackg(int16_t l);
+static void drawbackg(struct digger_draw_api *ddap,int16_t l);
 static void drawfield(void);
-
-static const char empty_line[MAX_TEXT_LEN + 1] = "                          ";
+static void fieldblobs(bool draw);
 
 static void outtextl(struct digger_draw_api *ddap, const char *p,int16_t x,int16_t y,int16_t c, int16_t l)
 {
@@ -56,67 +48,113 @@ void outtext(struct digger_draw_api *ddap, const char *p,int16_t x,int16_t y,int
   outtextl(ddap, p, x, y, c, strlen(p));
 }
 
+/* Text on the top row drawn for owner (see sethud()), where *h has what
+   it last drew: only the characters that are not still on the screen are
+   drawn */
+void hudtext(struct digger_draw_api *ddap, struct hudtext *h, int16_t owner,
+             const char *p, int16_t x, int16_t c)
+{
+  int16_t i,l=strlen(p);
+  bool same;
+
+#if defined(DIGGER_DEBUG)
+  assert(l <= HUD_TEXT_LEN);
+#endif
+  same=(h->x==x && h->c==c && strlen(h->s)==(size_t)l);
+  sethud(owner);
+  for (i=0;i<l;i++)
+    if (!same || h->s[i]!=p[i] || !hudintact(owner,x+i*CHR_W,CHR_W))
+      ddap->gwrite(x+i*CHR_W,0,isvalchar(p[i]) ? p[i] : ' ',c);
+  sethud(HUD_NONE);
+  h->x=x;
+  h->c=c;
+  strcpy(h->s,p);
+}
+
+/* n spaces, which are all black whatever the colour */
 void erasetext(struct digger_draw_api *ddap, int16_t n, int16_t x, int16_t y, int16_t c)
 {
 
-  outtextl(ddap, empty_line, x, y, c, n);
+#if defined(DIGGER_DEBUG)
+  assert(n > 0 && n <= MAX_TEXT_LEN);
+#endif
+  ddap->gfill(x,y,n*CHR_W,CHR_H,0);
 }
 
 void makefield(void)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int16_t c,x,y;
   for (x=0;x<MWIDTH;x++)
     for (y=0;y<MHEIGHT;y++) {
-      field[y*MWIDTH+x]=-1;
+      st->field[y*MWIDTH+x]=-1;
       c=getlevch(x,y,levplan());
       if (c=='S' || c=='V')
-        field[y*MWIDTH+x]&=0xd03f;
+        st->field[y*MWIDTH+x]&=0xd03f;
       if (c=='S' || c=='H')
-        field[y*MWIDTH+x]&=0xdfe0;
-      if (dgstate.curplayer==0)
-        field1[y*MWIDTH+x]=field[y*MWIDTH+x];
+        st->field[y*MWIDTH+x]&=0xdfe0;
+      if (dgctx->game.curplayer==0)
+        st->field1[y*MWIDTH+x]=st->field[y*MWIDTH+x];
       else
-        field2[y*MWIDTH+x]=field[y*MWIDTH+x];
+        st->field2[y*MWIDTH+x]=st->field[y*MWIDTH+x];
     }
 }
 
 void drawstatics(struct digger_draw_api *ddap)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int16_t x,y;
   for (x=0;x<MWIDTH;x++)
     for (y=0;y<MHEIGHT;y++)
-      if (dgstate.curplayer==0)
-        field[y*MWIDTH+x]=field1[y*MWIDTH+x];
+      if (dgctx->game.curplayer==0)
+        st->field[y*MWIDTH+x]=st->field1[y*MWIDTH+x];
       else
-        field[y*MWIDTH+x]=field2[y*MWIDTH+x];
+        st->field[y*MWIDTH+x]=st->field2[y*MWIDTH+x];
   setretr(true);
   ddap->gpal(0);
   ddap->ginten(0);
-  drawbackg(levplan());
+  drawbackg(ddap,levplan());
   drawfield();
 }
 
-void savefield(void)
+/* The background and the tunnels drawn again from field, which is left as
+   it is: a cell dug part of the way is drawn as on a player switch */
+void redrawfield(struct digger_draw_api *ddap)
 {
-  int16_t x,y;
-  for (x=0;x<MWIDTH;x++)
-    for (y=0;y<MHEIGHT;y++)
-      if (dgstate.curplayer==0)
-        field1[y*MWIDTH+x]=field[y*MWIDTH+x];
-      else
-        field2[y*MWIDTH+x]=field[y*MWIDTH+x];
+  struct drawing_state *st=&dgctx->drawing;
+  int16_t keep[MSIZE];
+  memcpy(keep,st->field,sizeof(keep));
+  drawbackg(ddap,levplan());
+  drawfield();
+  memcpy(st->field,keep,sizeof(keep));
 }
 
-static void drawfield(void)
+#if defined(_HOST)
+/* drawstatics() the way it was, a background tile and a blob at a time,
+   to check and time the batched one against */
+void drawstaticsref(struct digger_draw_api *ddap)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int16_t x,y,xp,yp;
   for (x=0;x<MWIDTH;x++)
     for (y=0;y<MHEIGHT;y++)
-      if ((field[y*MWIDTH+x]&0x2000)==0) {
+      if (dgctx->game.curplayer==0)
+        st->field[y*MWIDTH+x]=st->field1[y*MWIDTH+x];
+      else
+        st->field[y*MWIDTH+x]=st->field2[y*MWIDTH+x];
+  setretr(true);
+  ddap->gpal(0);
+  ddap->ginten(0);
+  for (y=14;y<200;y+=4)
+    for (x=0;x<320;x+=20)
+      drawmiscspr(x,y,93+levplan(),5,4);
+  for (x=0;x<MWIDTH;x++)
+    for (y=0;y<MHEIGHT;y++)
+      if ((st->field[y*MWIDTH+x]&0x2000)==0) {
         xp=x*20+12;
         yp=y*18+18;
-        if ((field[y*MWIDTH+x]&0xfc0)!=0xfc0) {
-          field[y*MWIDTH+x]&=0xd03f;
+        if ((st->field[y*MWIDTH+x]&0xfc0)!=0xfc0) {
+          st->field[y*MWIDTH+x]&=0xd03f;
           drawbottomblob(xp,yp-15);
           drawbottomblob(xp,yp-12);
           drawbottomblob(xp,yp-9);
@@ -124,8 +162,8 @@ static void drawfield(void)
           drawbottomblob(xp,yp-3);
           drawtopblob(xp,yp+3);
         }
-        if ((field[y*MWIDTH+x]&0x1f)!=0x1f) {
-          field[y*MWIDTH+x]&=0xdfe0;
+        if ((st->field[y*MWIDTH+x]&0x1f)!=0x1f) {
+          st->field[y*MWIDTH+x]&=0xdfe0;
           drawrightblob(xp-16,yp);
           drawrightblob(xp-12,yp);
           drawrightblob(xp-8,yp);
@@ -133,25 +171,110 @@ static void drawfield(void)
           drawleftblob(xp+4,yp);
         }
         if (x<14)
-          if ((field[y*MWIDTH+x+1]&0xfdf)!=0xfdf)
+          if ((st->field[y*MWIDTH+x+1]&0xfdf)!=0xfdf)
             drawrightblob(xp,yp);
         if (y<9)
-          if ((field[(y+1)*MWIDTH+x]&0xfdf)!=0xfdf)
+          if ((st->field[(y+1)*MWIDTH+x]&0xfdf)!=0xfdf)
             drawbottomblob(xp,yp);
       }
 }
+#endif
+
+void savefield(void)
+{
+  struct drawing_state *st=&dgctx->drawing;
+  int16_t x,y;
+  for (x=0;x<MWIDTH;x++)
+    for (y=0;y<MHEIGHT;y++)
+      if (dgctx->game.curplayer==0)
+        st->field1[y*MWIDTH+x]=st->field[y*MWIDTH+x];
+      else
+        st->field2[y*MWIDTH+x]=st->field[y*MWIDTH+x];
+}
+
+/* Where drawrightblob(), drawleftblob(), drawtopblob() and
+   drawbottomblob() put their sprite, and which one it is */
+enum { BLOB_RIGHT, BLOB_LEFT, BLOB_TOP, BLOB_BOTTOM };
+
+static const struct {
+  int16_t dx,dy,ch,wid,hei;
+} blobspr[]={
+  {16,-1,102,2,18},
+  {-8,-1,104,2,18},
+  {-4,-6,103,6,6},
+  {-4,15,105,6,6}
+};
+
+static void fieldblob(bool draw,int b,int16_t x,int16_t y)
+{
+  x+=blobspr[b].dx;
+  y+=blobspr[b].dy;
+  if (draw)
+    drawmiscspr(x,y,blobspr[b].ch,blobspr[b].wid,blobspr[b].hei);
+  else
+    addmiscspr(x,y,blobspr[b].wid,blobspr[b].hei);
+}
+
+/* Draw every tunnel of the field. The blobs are gone through twice, first
+   to find the sprites under them, then to draw them, so those sprites are
+   only taken off and put back once. The field bits cleared on the first
+   pass do not change which blobs the second one draws. */
+static void drawfield(void)
+{
+  initmiscsprs();
+  fieldblobs(false);
+  erasemiscsprs();
+  fieldblobs(true);
+  getis();
+}
+
+static void fieldblobs(bool draw)
+{
+  struct drawing_state *st=&dgctx->drawing;
+  int16_t x,y,xp,yp;
+  for (x=0;x<MWIDTH;x++)
+    for (y=0;y<MHEIGHT;y++)
+      if ((st->field[y*MWIDTH+x]&0x2000)==0) {
+        xp=x*20+12;
+        yp=y*18+18;
+        if ((st->field[y*MWIDTH+x]&0xfc0)!=0xfc0) {
+          st->field[y*MWIDTH+x]&=0xd03f;
+          fieldblob(draw,BLOB_BOTTOM,xp,yp-15);
+          fieldblob(draw,BLOB_BOTTOM,xp,yp-12);
+          fieldblob(draw,BLOB_BOTTOM,xp,yp-9);
+          fieldblob(draw,BLOB_BOTTOM,xp,yp-6);
+          fieldblob(draw,BLOB_BOTTOM,xp,yp-3);
+          fieldblob(draw,BLOB_TOP,xp,yp+3);
+        }
+        if ((st->field[y*MWIDTH+x]&0x1f)!=0x1f) {
+          st->field[y*MWIDTH+x]&=0xdfe0;
+          fieldblob(draw,BLOB_RIGHT,xp-16,yp);
+          fieldblob(draw,BLOB_RIGHT,xp-12,yp);
+          fieldblob(draw,BLOB_RIGHT,xp-8,yp);
+          fieldblob(draw,BLOB_RIGHT,xp-4,yp);
+          fieldblob(draw,BLOB_LEFT,xp+4,yp);
+        }
+        if (x<14)
+          if ((st->field[y*MWIDTH+x+1]&0xfdf)!=0xfdf)
+            fieldblob(draw,BLOB_RIGHT,xp,yp);
+        if (y<9)
+          if ((st->field[(y+1)*MWIDTH+x]&0xfdf)!=0xfdf)
+            fieldblob(draw,BLOB_BOTTOM,xp,yp);
+      }
+}
 
 void eatfield(int16_t x,int16_t y,int16_t dir)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int16_t h=(x-12)/20,xr=((x-12)%20)/4,v=(y-18)/18,yr=((y-18)%18)/3;
   incpenalty();
   switch (dir) {
     case DIR_RIGHT:
       h++;
-      field[v*MWIDTH+h]&=bitmasks[xr];
-      if (field[v*MWIDTH+h]&0x1f)
+      st->field[v*MWIDTH+h]&=bitmasks[xr];
+      if (st->field[v*MWIDTH+h]&0x1f)
         break;
-      field[v*MWIDTH+h]&=0xdfff;
+      st->field[v*MWIDTH+h]&=0xdfff;
       break;
     case DIR_UP:
       yr--;
@@ -159,10 +282,10 @@ void eatfield(int16_t x,int16_t y,int16_t dir)
         yr+=6;
         v--;
       }
-      field[v*MWIDTH+h]&=bitmasks[6+yr];
-      if (field[v*MWIDTH+h]&0xfc0)
+      st->field[v*MWIDTH+h]&=bitmasks[6+yr];
+      if (st->field[v*MWIDTH+h]&0xfc0)
         break;
-      field[v*MWIDTH+h]&=0xdfff;
+      st->field[v*MWIDTH+h]&=0xdfff;
       break;
     case DIR_LEFT:
       xr--;
@@ -170,27 +293,28 @@ void eatfield(int16_t x,int16_t y,int16_t dir)
         xr+=5;
         h--;
       }
-      field[v*MWIDTH+h]&=bitmasks[xr];
-      if (field[v*MWIDTH+h]&0x1f)
+      st->field[v*MWIDTH+h]&=bitmasks[xr];
+      if (st->field[v*MWIDTH+h]&0x1f)
         break;
-      field[v*MWIDTH+h]&=0xdfff;
+      st->field[v*MWIDTH+h]&=0xdfff;
       break;
     case DIR_DOWN:
       v++;
-      field[v*MWIDTH+h]&=bitmasks[6+yr];
-      if (field[v*MWIDTH+h]&0xfc0)
+      st->field[v*MWIDTH+h]&=bitmasks[6+yr];
+      if (st->field[v*MWIDTH+h]&0xfc0)
         break;
-      field[v*MWIDTH+h]&=0xdfff;
+      st->field[v*MWIDTH+h]&=0xdfff;
   }
 }
 
 void creatembspr(void)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int16_t i;
   for (i=0;i<BAGS;i++)
-    createspr(FIRSTBAG+i,62,bagbufs[i],4,15,0,0);
+    createspr(FIRSTBAG+i,62,st->bagbufs[i],4,15,0,0);
   for (i=0;i<MONSTERS;i++)
-    createspr(FIRSTMONSTER+i,71,monbufs[i],4,15,0,0);
+    createspr(FIRSTMONSTER+i,71,st->monbufs[i],4,15,0,0);
   createdbfspr();
 }
 
@@ -231,30 +355,32 @@ void eraseemerald(int16_t x,int16_t y)
 
 static void createdbfspr(void)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int i;
   for (i=0;i<DIGGERS;i++) {
-    digspd[i]=1;
-    digspr[i]=0;
+    st->digspd[i]=1;
+    st->digspr[i]=0;
   }
   for (i=0;i<FIREBALLS;i++)
-    firespr[i]=0;
+    st->firespr[i]=0;
   for (i=FIRSTDIGGER;i<LASTDIGGER;i++)
-    createspr(i,0,diggerbufs[i-FIRSTDIGGER],4,15,0,0);
+    createspr(i,0,st->diggerbufs[i-FIRSTDIGGER],4,15,0,0);
   for (i=FIRSTBONUS;i<LASTBONUS;i++)
-    createspr(i,81,bonusbufs[i-FIRSTBONUS],4,15,0,0);
+    createspr(i,81,st->bonusbufs[i-FIRSTBONUS],4,15,0,0);
   for (i=FIRSTFIREBALL;i<LASTFIREBALL;i++)
-    createspr(i,82,firebufs[i-FIRSTFIREBALL],2,8,0,0);
+    createspr(i,82,st->firebufs[i-FIRSTFIREBALL],2,8,0,0);
 }
 
 static void initdbfspr(void)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int i;
   for (i=0;i<DIGGERS;i++) {
-    digspd[i]=1;
-    digspr[i]=0;
+    st->digspd[i]=1;
+    st->digspr[i]=0;
   }
   for (i=0;i<FIREBALLS;i++)
-    firespr[i]=0;
+    st->firespr[i]=0;
   for (i=FIRSTDIGGER;i<LASTDIGGER;i++)
     initspr(i,0,4,15,0,0);
   for (i=FIRSTBONUS;i<LASTBONUS;i++)
@@ -305,23 +431,32 @@ void drawsquareblob(int16_t x,int16_t y)
   getis();
 }
 
-static void drawbackg(int16_t l)
+/* The background is one 20x4 tile all over, and its mask is empty, so it
+   looks the same whatever it is drawn over. Draw one row of tiles along
+   the top and copy that down the screen, a pixel row at a time. rowbuf
+   holds a screen-wide row at up to 4 bits a pixel. */
+static void drawbackg(struct digger_draw_api *ddap,int16_t l)
 {
-  int16_t x,y;
-  for (y=14;y<200;y+=4) {
-    for (x=0;x<320;x+=20)
-      drawmiscspr(x,y,93+l,5,4);
+  uint8_t rowbuf[MAX_W/2];
+  int16_t x,y,r;
+  for (x=0;x<320;x+=20)
+    drawmiscspr(x,14,93+l,5,4);
+  for (r=0;r<4;r++) {
+    ddap->ggeti(0,14+r,rowbuf,MAX_W/4,1);
+    for (y=18+r;y<200+r;y+=4)
+      ddap->gputi(0,y,rowbuf,MAX_W/4,1);
   }
 }
 
 void drawfire(int n,int16_t x,int16_t y,int16_t t)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int nn=(n==0) ? 0 : 32;
   if (t==0) {
-    firespr[n]++;
-    if (firespr[n]>2)
-      firespr[n]=0;
-    initspr(FIRSTFIREBALL+n,82+firespr[n]+nn,2,8,0,0);
+    st->firespr[n]++;
+    if (st->firespr[n]>2)
+      st->firespr[n]=0;
+    initspr(FIRSTFIREBALL+n,82+st->firespr[n]+nn,2,8,0,0);
   }
   else
     initspr(FIRSTFIREBALL+n,84+t+nn,2,8,0,0);
@@ -337,16 +472,17 @@ void drawbonus(int16_t x,int16_t y)
 
 void drawdigger(int n,int16_t t,int16_t x,int16_t y,bool f)
 {
+  struct drawing_state *st=&dgctx->drawing;
   int nn=(n==0) ? 0 : 31;
-  digspr[n]+=digspd[n];
-  if (digspr[n]==2 || digspr[n]==0)
-    digspd[n]=-digspd[n];
-  if (digspr[n]>2)
-    digspr[n]=2;
-  if (digspr[n]<0)
-    digspr[n]=0;
+  st->digspr[n]+=st->digspd[n];
+  if (st->digspr[n]==2 || st->digspr[n]==0)
+    st->digspd[n]=-st->digspd[n];
+  if (st->digspr[n]>2)
+    st->digspr[n]=2;
+  if (st->digspr[n]<0)
+    st->digspr[n]=0;
   if (t>=0 && t<=6 && !(t&1)) {
-    initspr(FIRSTDIGGER+n,(t+(f ? 0 : 1))*3+digspr[n]+1+nn,4,15,0,0);
+    initspr(FIRSTDIGGER+n,(t+(f ? 0 : 1))*3+st->digspr[n]+1+nn,4,15,0,0);
     drawspr(FIRSTDIGGER+n,x,y);
     return;
   }
@@ -355,57 +491,79 @@ void drawdigger(int n,int16_t t,int16_t x,int16_t y,bool f)
     drawspr(FIRSTDIGGER+n,x,y);
     return;
   }
-  first[0]=first[1]=first[2]=first[3]=first[4]=-1;
+  dgctx->sprite.first[0]=dgctx->sprite.first[1]=dgctx->sprite.first[2]=
+        dgctx->sprite.first[3]=dgctx->sprite.first[4]=-1;
+}
+
+/* The lives of player or digger n, drawn as owner HUD_LIVES+n. Nothing is
+   drawn if the same number is still on the screen. */
+static bool livesdrawn(int n,int16_t lives,int16_t x,int16_t w)
+{
+  struct drawing_state *st=&dgctx->drawing;
+  if (st->hudlives[n]==lives && hudintact(HUD_LIVES+n,x,w))
+    return true;
+  st->hudlives[n]=lives;
+  sethud(HUD_LIVES+n);
+  return false;
 }
 
 void drawlives(struct digger_draw_api *ddap)
 {
   int16_t l,n,g;
   char buf[10];
-  if (dgstate.gauntlet) {
-    g=(int16_t)(dgstate.cgtime/1193181l);
+  if (dgctx->game.gauntlet) {
+    g=(int16_t)(dgctx->game.cgtime/1193181l);
     sprintf(buf,"%3i:%02i",g/60,g%60);
-    outtext(ddap, buf,124,0,3);
+    hudtext(ddap,&dgctx->drawing.hudtime,HUD_LIVES,buf,124,3);
     return;
   }
   n=getlives(0)-1;
-  erasetext(ddap, 5, 96,0,2);
-  if (n>4) {
-    drawlife(0,80,0);
-    sprintf(buf,"X%i",n);
-    outtext(ddap, buf,100,0,2);
-  }
-  else
-    for (l=1;l<5;l++) {
-      drawlife(n>0 ? 0 : 2,l*20+60,0);
-      n--;
-    }
-  if (dgstate.nplayers==2) {
-    erasetext(ddap, 5, 164,0,2);
-    n=getlives(1)-1;
+  if (!livesdrawn(0,n,80,76)) {
+    erasetext(ddap, 5, 96,0,2);
     if (n>4) {
-      sprintf(buf,"%iX",n);
-      outtext(ddap, buf,220-strlen(buf)*CHR_W,0,2);
-      drawlife(1,224,0);
+      drawlife(0,80,0);
+      sprintf(buf,"X%i",n);
+      outtext(ddap, buf,100,0,2);
     }
     else
       for (l=1;l<5;l++) {
-        drawlife(n>0 ? 1 : 2,244-l*20,0);
+        drawlife(n>0 ? 0 : 2,l*20+60,0);
         n--;
       }
+    sethud(HUD_NONE);
   }
-  if (dgstate.diggers==2) {
-    erasetext(ddap, 5, 164,0,1);
+  if (dgctx->game.nplayers==2) {
     n=getlives(1)-1;
-    if (n>4) {
-      sprintf(buf,"%iX",n);
-      outtext(ddap, buf,220-strlen(buf)*CHR_W,0,1);
-      drawlife(3,224,0);
+    if (!livesdrawn(1,n,164,76)) {
+      erasetext(ddap, 5, 164,0,2);
+      if (n>4) {
+        sprintf(buf,"%iX",n);
+        outtext(ddap, buf,220-strlen(buf)*CHR_W,0,2);
+        drawlife(1,224,0);
+      }
+      else
+        for (l=1;l<5;l++) {
+          drawlife(n>0 ? 1 : 2,244-l*20,0);
+          n--;
+        }
+      sethud(HUD_NONE);
     }
-    else
-      for (l=1;l<5;l++) {
-        drawlife(n>0 ? 3 : 2,244-l*20,0);
-        n--;
+  }
+  if (dgctx->game.diggers==2) {
+    n=getlives(1)-1;
+    if (!livesdrawn(1,n,164,76)) {
+      erasetext(ddap, 5, 164,0,1);
+      if (n>4) {
+        sprintf(buf,"%iX",n);
+        outtext(ddap, buf,220-strlen(buf)*CHR_W,0,1);
+        drawlife(3,224,0);
       }
+      else
+        for (l=1;l<5;l++) {
+          drawlife(n>0 ? 3 : 2,244-l*20,0);
+          n--;
+        }
+      sethud(HUD_NONE);
+    }
   }
 }
@@ -4,9 +4,12 @@
 #define MAX_TEXT_LEN (MAX_W / CHR_W)
 
 struct digger_draw_api;
+struct hudtext;
 
 void outtext(struct digger_draw_api *, const char *p,int16_t x,int16_t y,int16_t c);
 void erasetext(struct digger_draw_api *ddap, int16_t n, int16_t x, int16_t y, int16_t c);
+void hudtext(struct digger_draw_api *ddap, struct hudtext *h, int16_t owner,
+             const char *p, int16_t x, int16_t c);
 
 void creatembspr(void);
 void initmbspr(void);
@@ -19,6 +22,10 @@ void drawlives(struct digger_draw_api *);
 void savefield(void);
 void makefield(void);
 void drawstatics(struct digger_draw_api *);
+void redrawfield(struct digger_draw_api *);
+#if defined(_HOST)
+void drawstaticsref(struct digger_draw_api *);
+#endif
 void drawfire(int n,int16_t x,int16_t y,int16_t t);
 void eatfield(int16_t x,int16_t y,int16_t dir);
 void drawrightblob(int16_t x,int16_t y);
@@ -28,4 +35,3 @@ void drawbottomblob(int16_t x,int16_t y);
 void drawfurryblob(int16_t x,int16_t y);
 void drawsquareblob(int16_t x,int16_t y);
 
-extern int16_t field[];
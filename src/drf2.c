@@ -0,0 +1,619 @@
+/*
+ * drf2.c - Binary DRF Recording Format
+ *
+ * A binary DRF holds the same things as a text one, packed:
+ *
+ *   0x89 'D' 'R' 'F' 0x02
+ *   version and mode line: varint length, then the characters
+ *   bonus score: varint
+ *   0: the built-in levels, 1: 8 levels of 10x15 characters follow
+ *   events until 0xf0
+ *   0xf0, CRC-32 of everything before it, little endian
+ *
+ * An event byte 0x00-0x9f is a run of frames with the same input: the
+ * high nibble is the direction (s, r, u, l, d, then the same firing) and
+ * the low nibble the number of frames, or 0 for a varint count after it.
+ * 0xa0 starts a level with the 32-bit random seed that follows, 0xb0 ends
+ * a level, 0xc0 ends the game and 0xd0 is followed by the three initials
+ * entered for the high score. 0xe0 is a bare E, which a text DRF made by
+ * hand may use to stop playback. Varints are 7 bits per byte, low first.
+ *
+ * The encoder hands its output to a sink DRF2_CHUNK bytes at a time, so a
+ * recording can be as long as the sink allows in constant memory.
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdarg.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "def.h"
+#include "game.h"
+#include "drf2.h"
+
+#define DRF2_FORMAT 2
+
+enum {
+    OP_RAND = 0xa0,
+    OP_EOL = 0xb0,
+    OP_EOG = 0xc0,
+    OP_INIT = 0xd0,
+    OP_STOP = 0xe0,
+    OP_END = 0xf0
+};
+
+static const uint8_t drf2_magic[4] = {0x89, 'D', 'R', 'F'};
+static const char dirchars[] = "sruldSRULD";
+
+static uint32_t crc32_update(uint32_t crc, uint8_t b)
+{
+    static const uint32_t tab[16] = {
+        0x00000000, 0x1db71064, 0x3b6e20c8, 0x26d930ac,
+        0x76dc4190, 0x6b6b51f4, 0x4db26158, 0x5005713c,
+        0xedb88320, 0xf00f9344, 0xd6d6a3e8, 0xcb61b38c,
+        0x9b64c2b0, 0x86d3d2d4, 0xa00ae278, 0xbdbdf21c
+    };
+
+    crc ^= b;
+    crc = (crc >> 4) ^ tab[crc & 15];
+    return (crc >> 4) ^ tab[crc & 15];
+}
+
+bool drf2_detect(const void *buf, size_t len)
+{
+    return len >= sizeof(drf2_magic) + 1 &&
+        memcmp(buf, drf2_magic, sizeof(drf2_magic)) == 0;
+}
+
+/* Encoder */
+
+static void flush(struct drf2_enc *enc)
+{
+    if (enc->len == 0)
+        return;
+    if (enc->sink != NULL && !enc->failed &&
+        !enc->sink(enc->arg, enc->buf, enc->len))
+        enc->failed = true;
+    enc->size += enc->len;
+    enc->len = 0;
+}
+
+static void putbyte(struct drf2_enc *enc, uint8_t b)
+{
+    enc->crc = crc32_update(enc->crc, b);
+    enc->buf[enc->len++] = b;
+    if (enc->len == DRF2_CHUNK)
+        flush(enc);
+}
+
+static void putvarint(struct drf2_enc *enc, uint32_t v)
+{
+    while (v >= 0x80) {
+        putbyte(enc, (v & 0x7f) | 0x80);
+        v >>= 7;
+    }
+    putbyte(enc, v);
+}
+
+static void putu32(struct drf2_enc *enc, uint32_t v)
+{
+    int i;
+
+    for (i = 0; i < 4; i++)
+        putbyte(enc, v >> (i * 8));
+}
+
+static void putstr(struct drf2_enc *enc, const char *s)
+{
+    size_t n = strlen(s);
+
+    putvarint(enc, n);
+    while (n-- > 0)
+        putbyte(enc, *s++);
+}
+
+static void putrun(struct drf2_enc *enc)
+{
+    if (enc->runlen == 0)
+        return;
+    if (enc->runlen < 16)
+        putbyte(enc, (enc->runcode << 4) | enc->runlen);
+    else {
+        putbyte(enc, enc->runcode << 4);
+        putvarint(enc, enc->runlen);
+    }
+    enc->runlen = 0;
+}
+
+static void putdirs(struct drf2_enc *enc, char d, uint32_t n)
+{
+    const char *p = strchr(dirchars, d);
+    uint8_t code = (p != NULL && d != 0) ? p - dirchars : 0;
+
+    if (enc->runlen > 0 && enc->runcode != code)
+        putrun(enc);
+    enc->runcode = code;
+    enc->runlen += n;
+}
+
+void drf2_begin(struct drf2_enc *enc, drf2_sink_t sink, void *arg,
+                const char *version, const char *mode, int32_t bonus,
+                const int8_t levels[8][10][15])
+{
+    size_t i;
+
+    memset(enc, 0, sizeof(*enc));
+    enc->sink = sink;
+    enc->arg = arg;
+    enc->crc = 0xffffffff;
+    for (i = 0; i < sizeof(drf2_magic); i++)
+        putbyte(enc, drf2_magic[i]);
+    putbyte(enc, DRF2_FORMAT);
+    putstr(enc, version);
+    putstr(enc, mode);
+    putvarint(enc, bonus);
+    if (memcmp(levels, defleveldat, sizeof(defleveldat)) == 0)
+        putbyte(enc, 0);
+    else {
+        putbyte(enc, 1);
+        for (i = 0; i < sizeof(defleveldat); i++)
+            putbyte(enc, ((const uint8_t *)levels)[i]);
+    }
+}
+
+void drf2_putdir(struct drf2_enc *enc, char d)
+{
+    putdirs(enc, d, 1);
+}
+
+void drf2_putrand(struct drf2_enc *enc, uint32_t randv)
+{
+    putrun(enc);
+    putbyte(enc, OP_RAND);
+    putu32(enc, randv);
+}
+
+void drf2_puteol(struct drf2_enc *enc)
+{
+    putrun(enc);
+    putbyte(enc, OP_EOL);
+}
+
+void drf2_puteog(struct drf2_enc *enc)
+{
+    putrun(enc);
+    putbyte(enc, OP_EOG);
+}
+
+void drf2_putinit(struct drf2_enc *enc, const char *init)
+{
+    int i;
+
+    putrun(enc);
+    putbyte(enc, OP_INIT);
+    for (i = 0; i < 3; i++)
+        putbyte(enc, init[i]);
+}
+
+bool drf2_end(struct drf2_enc *enc)
+{
+    if (!enc->ended) {
+        putrun(enc);
+        putbyte(enc, OP_END);
+        putu32(enc, enc->crc ^ 0xffffffff);
+        flush(enc);
+        enc->ended = true;
+    }
+    return !enc->failed;
+}
+
+/* Text to binary */
+
+struct txtin {
+    const char *p, *end;
+};
+
+/* A line of the first part of a text DRF, as smart_fgets() reads it */
+static bool getline_txt(struct txtin *in, char *buf, size_t size)
+{
+    size_t n = 0;
+
+    if (in->p >= in->end)
+        return false;
+    while (in->p < in->end && *in->p != '\n') {
+        if (n < size - 1)
+            buf[n++] = *in->p;
+        in->p++;
+    }
+    if (in->p < in->end)
+        in->p++;
+    if (n > 0 && buf[n - 1] == '\r')
+        n--;
+    buf[n] = '\0';
+    return true;
+}
+
+/* Next character of the second part, where line breaks do not count */
+static int getc_txt(struct txtin *in)
+{
+    while (in->p < in->end && *in->p < ' ')
+        in->p++;
+    return in->p < in->end ? *in->p++ : -1;
+}
+
+static int peekc_txt(struct txtin *in)
+{
+    while (in->p < in->end && *in->p < ' ')
+        in->p++;
+    return in->p < in->end ? *in->p : -1;
+}
+
+static int hexval(int c)
+{
+    if (c >= '0' && c <= '9')
+        return c - '0';
+    if (c >= 'A' && c <= 'F')
+        return c - 'A' + 10;
+    if (c >= 'a' && c <= 'f')
+        return c - 'a' + 10;
+    return -1;
+}
+
+bool drf2_fromtext(const char *txt, size_t len, drf2_sink_t sink, void *arg)
+{
+    struct txtin in = {txt, txt + len};
+    struct drf2_enc enc;
+    char version[80], mode[80], buf[80], init[3];
+    int8_t levels[8][10][15];
+    bool needrand = true;
+    uint32_t r, n;
+    int c, i, l, y, x;
+
+    if (!getline_txt(&in, buf, sizeof(buf)) || strncmp(buf, "DRF", 3) != 0 ||
+        !getline_txt(&in, version, sizeof(version)) ||
+        !getline_txt(&in, mode, sizeof(mode)) ||
+        !getline_txt(&in, buf, sizeof(buf)))
+        return false;
+    for (l = 0; l < 8; l++)
+        for (y = 0; y < 10; y++) {
+            char line[80];
+
+            if (!getline_txt(&in, line, sizeof(line)))
+                return false;
+            for (x = 0; x < 15; x++)
+                levels[l][y][x] = x < (int)strlen(line) ? line[x] : ' ';
+        }
+    drf2_begin(&enc, sink, arg, version, mode, atoi(buf), levels);
+
+    while ((c = getc_txt(&in)) != -1) {
+        if (c == '*') {
+            for (i = 0; i < 3; i++) {
+                if ((c = getc_txt(&in)) == -1)
+                    return false;
+                init[i] = c;
+            }
+            drf2_putinit(&enc, init);
+        } else if (c == 'E' || c == 'e') {
+            if (in.end - in.p >= 2 && in.p[0] == 'O' && in.p[1] == 'L') {
+                in.p += 2;
+                drf2_puteol(&enc);
+                needrand = true;
+            } else if (in.end - in.p >= 2 && in.p[0] == 'O' && in.p[1] == 'G') {
+                in.p += 2;
+                drf2_puteog(&enc);
+            } else {
+                putrun(&enc);
+                putbyte(&enc, OP_STOP);
+            }
+        } else if (needrand) {
+            r = 0;
+            for (i = 0; i < 8; i++, c = getc_txt(&in)) {
+                if (hexval(c) < 0)
+                    return false;
+                r = (r << 4) | hexval(c);
+            }
+            in.p--;             /* the character after the seed */
+            drf2_putrand(&enc, r);
+            needrand = false;
+        } else if (strchr(dirchars, c) != NULL) {
+            n = 0;
+            while ((x = peekc_txt(&in)) >= '0' && x <= '9')
+                n = n * 10 + (getc_txt(&in) - '0');
+            putdirs(&enc, c, n > 0 ? n : 1);
+        } else
+            return false;
+    }
+    return drf2_end(&enc);
+}
+
+/* Binary to text */
+
+struct binin {
+    const uint8_t *p, *end;
+    uint32_t crc;
+    bool bad;
+};
+
+static uint8_t getbyte(struct binin *in)
+{
+    if (in->p >= in->end) {
+        in->bad = true;
+        return 0;
+    }
+    in->crc = crc32_update(in->crc, *in->p);
+    return *in->p++;
+}
+
+static uint32_t getvarint(struct binin *in)
+{
+    uint32_t v = 0;
+    int shift;
+    uint8_t b;
+
+    for (shift = 0; shift < 35; shift += 7) {
+        b = getbyte(in);
+        v |= (uint32_t)(b & 0x7f) << shift;
+        if (!(b & 0x80))
+            return v;
+    }
+    in->bad = true;
+    return 0;
+}
+
+static uint32_t getu32(struct binin *in)
+{
+    uint32_t v = 0;
+    int i;
+
+    for (i = 0; i < 4; i++)
+        v |= (uint32_t)getbyte(in) << (i * 8);
+    return v;
+}
+
+static void getstr(struct binin *in, char *buf, size_t size)
+{
+    uint32_t n = getvarint(in), i;
+
+    if (n >= size) {
+        in->bad = true;
+        n = 0;
+    }
+    for (i = 0; i < n; i++)
+        buf[i] = getbyte(in);
+    buf[n] = '\0';
+}
+
+struct txtout {
+    drf2_sink_t sink;
+    void *arg;
+    bool failed;
+    int reccc;                  /* characters on the line, as putrun() kept */
+};
+
+static void tprintf(struct txtout *out, const char *f, ...)
+    __attribute__((format(printf, 2, 3)));
+
+static void tprintf(struct txtout *out, const char *f, ...)
+{
+    va_list ap;
+    char buf[80];
+    int n;
+
+    if (out->sink == NULL || out->failed)
+        return;
+    va_start(ap, f);
+    n = vsnprintf(buf, sizeof(buf), f, ap);
+    va_end(ap);
+    if (!out->sink(out->arg, buf, n))
+        out->failed = true;
+}
+
+/* Runs the way the text recorder wrote them: at most 999 frames each, and
+   a line break once a line has reached 60 characters */
+static void textrun(struct txtout *out, char d, uint32_t n)
+{
+    uint32_t k;
+
+    while (n > 0) {
+        k = n > 999 ? 999 : n;
+        n -= k;
+        if (k > 1)
+            tprintf(out, "%c%u", d, (unsigned int)k);
+        else
+            tprintf(out, "%c", d);
+        out->reccc += 1 + (k > 1) + (k >= 10) + (k >= 100);
+        if (out->reccc >= 60) {
+            tprintf(out, "\n");
+            out->reccc = 0;
+        }
+    }
+}
+
+static bool getheader(struct binin *in, char version[80], char mode[80],
+                      int32_t *bonus, int8_t levels[8][10][15])
+{
+    uint8_t b;
+    int i;
+
+    if (!drf2_detect(in->p, in->end - in->p))
+        return false;
+    for (i = 0; i < 4; i++)
+        getbyte(in);
+    if (getbyte(in) != DRF2_FORMAT)
+        return false;
+    getstr(in, version, 80);
+    getstr(in, mode, 80);
+    *bonus = getvarint(in);
+    b = getbyte(in);
+    if (b == 0 && levels != NULL)
+        memcpy(levels, defleveldat, sizeof(defleveldat));
+    else if (b == 1)
+        for (i = 0; i < (int)sizeof(defleveldat); i++) {
+            if (levels != NULL)
+                ((uint8_t *)levels)[i] = getbyte(in);
+            else
+                getbyte(in);
+        }
+    return !in->bad && b <= 1;
+}
+
+/* Read the events up to the trailer and check it, writing them as text to
+   out if it has a sink. end is set to where the trailer starts. */
+static bool getevents(struct binin *in, struct txtout *out,
+                      const uint8_t **end)
+{
+    uint32_t n, crc;
+    uint8_t b;
+    int i;
+
+    while (!in->bad) {
+        *end = in->p;
+        b = getbyte(in);
+        if (in->bad)
+            break;
+        if (b < 0xa0) {
+            n = b & 15;
+            if (n == 0)
+                n = getvarint(in);
+            textrun(out, dirchars[b >> 4], n);
+            continue;
+        }
+        switch (b) {
+        case OP_RAND:
+            tprintf(out, "%08lX\n", (unsigned long)getu32(in));
+            out->reccc = 0;
+            break;
+        case OP_EOL:
+            if (out->reccc > 0)
+                tprintf(out, "\n");
+            tprintf(out, "EOL\n");
+            break;
+        case OP_EOG:
+            tprintf(out, "EOG\n");
+            break;
+        case OP_INIT:
+            tprintf(out, "*");
+            for (i = 0; i < 3; i++)
+                tprintf(out, "%c", getbyte(in));
+            tprintf(out, "\n");
+            break;
+        case OP_STOP:
+            if (out->reccc > 0)
+                tprintf(out, "\n");
+            tprintf(out, "E\n");
+            out->reccc = 0;
+            break;
+        case OP_END:
+            crc = in->crc ^ 0xffffffff;
+            return getu32(in) == crc && !in->bad && in->p == in->end &&
+                !out->failed;
+        default:
+            return false;
+        }
+    }
+    return false;
+}
+
+bool drf2_totext(const uint8_t *buf, size_t len, drf2_sink_t sink, void *arg)
+{
+    struct binin in = {buf, buf + len, 0xffffffff, false};
+    struct txtout out = {sink, arg, false, 0};
+    const uint8_t *end;
+    char version[80], mode[80];
+    int8_t levels[8][10][15];
+    int32_t bonus;
+    int l, y;
+
+    if (!getheader(&in, version, mode, &bonus, levels))
+        return false;
+    tprintf(&out, "DRF\n%s\n%s\n%u\n", version, mode, (unsigned int)bonus);
+    for (l = 0; l < 8; l++)
+        for (y = 0; y < 10; y++)
+            tprintf(&out, "%.15s\n", (const char *)levels[l][y]);
+    return getevents(&in, &out, &end);
+}
+
+/* Playback */
+
+bool drf2_open(struct drf2_dec *dec, const uint8_t *buf, size_t len,
+               char version[80], char mode[80], int32_t *bonus,
+               int8_t levels[8][10][15])
+{
+    struct binin in = {buf, buf + len, 0xffffffff, false};
+    struct txtout out = {NULL, NULL, false, 0};
+    const uint8_t *end;
+
+    memset(dec, 0, sizeof(*dec));
+    if (!getheader(&in, version, mode, bonus, NULL))
+        return false;
+    dec->pos = in.p - buf;
+    if (!getevents(&in, &out, &end))
+        return false;
+    dec->len = end - buf;
+    /* Only now that it is known to be good, read the levels */
+    in.p = buf;
+    return getheader(&in, version, mode, bonus, levels);
+}
+
+static uint32_t decvarint(struct drf2_dec *dec, const uint8_t *buf)
+{
+    uint32_t v = 0;
+    int shift;
+
+    for (shift = 0; shift < 35 && dec->pos < dec->len; shift += 7) {
+        v |= (uint32_t)(buf[dec->pos] & 0x7f) << shift;
+        if (!(buf[dec->pos++] & 0x80))
+            break;
+    }
+    return v;
+}
+
+bool drf2_getdir(struct drf2_dec *dec, const uint8_t *buf, char *d)
+{
+    uint8_t b;
+
+    if (dec->runlen == 0) {
+        if (dec->pos >= dec->len || (b = buf[dec->pos]) >= 0xa0)
+            return false;
+        dec->pos++;
+        dec->runcode = b >> 4;
+        dec->runlen = b & 15;
+        if (dec->runlen == 0)
+            dec->runlen = decvarint(dec, buf);
+        if (dec->runlen == 0)
+            dec->runlen = 1;
+    }
+    dec->runlen--;
+    *d = dirchars[dec->runcode];
+    return true;
+}
+
+bool drf2_getrand(struct drf2_dec *dec, const uint8_t *buf, uint32_t *r)
+{
+    int i;
+
+    *r = 0;
+    if (dec->pos + 4 <= dec->len && buf[dec->pos] == OP_INIT)
+        dec->pos += 4;
+    if (dec->pos + 5 > dec->len || buf[dec->pos] != OP_RAND)
+        return false;
+    for (i = 0; i < 4; i++)
+        *r |= (uint32_t)buf[dec->pos + 1 + i] << (i * 8);
+    dec->pos += 5;
+    return true;
+}
+
+bool drf2_skipeol(struct drf2_dec *dec, const uint8_t *buf)
+{
+    if (dec->pos >= dec->len || buf[dec->pos] != OP_EOL)
+        return false;
+    dec->pos++;
+    return true;
+}
@@ -0,0 +1,99 @@
+/*
+ * drf2.h - Binary DRF Recording Format
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __DRF2_H
+#define __DRF2_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* Bytes buffered before they are handed to the sink */
+#define DRF2_CHUNK 128
+
+/* Receives the encoded stream in order; returns false if it failed */
+typedef bool (*drf2_sink_t)(void *arg, const void *buf, size_t len);
+
+struct drf2_enc {
+    drf2_sink_t sink;           /* NULL: encode and throw away */
+    void *arg;
+    uint32_t crc;
+    uint32_t size;              /* bytes handed to the sink so far */
+    uint32_t runlen;            /* frames of the run not yet written */
+    uint8_t runcode;
+    bool failed, ended;
+    uint16_t len;
+    uint8_t buf[DRF2_CHUNK];
+};
+
+/* True if buf starts like a binary DRF */
+bool drf2_detect(const void *buf, size_t len);
+
+/*
+ * Start a recording. version and mode are the second and third line of
+ * the text DRF, levels the 8 levels played.
+ */
+void drf2_begin(struct drf2_enc *enc, drf2_sink_t sink, void *arg,
+                const char *version, const char *mode, int32_t bonus,
+                const int8_t levels[8][10][15]);
+
+/* One frame of input, as the text DRF writes it: s, r, u, l or d, in upper
+   case when firing */
+void drf2_putdir(struct drf2_enc *enc, char d);
+void drf2_putrand(struct drf2_enc *enc, uint32_t randv);
+void drf2_puteol(struct drf2_enc *enc);
+void drf2_puteog(struct drf2_enc *enc);
+void drf2_putinit(struct drf2_enc *enc, const char *init);
+
+/* Write the trailer and flush; false if anything was lost on the way */
+bool drf2_end(struct drf2_enc *enc);
+
+/*
+ * Convert between the text DRF and the binary one. The text a binary DRF
+ * is turned into is the one the text recorder would have written for the
+ * same game. Both return false on a damaged or unknown input.
+ */
+bool drf2_fromtext(const char *txt, size_t len, drf2_sink_t sink, void *arg);
+bool drf2_totext(const uint8_t *buf, size_t len, drf2_sink_t sink, void *arg);
+
+/*
+ * Playback straight from a binary DRF. The decoder keeps offsets rather
+ * than pointers, so it can be saved with the rest of the game; the buffer
+ * is passed again to each call.
+ */
+struct drf2_dec {
+    uint32_t pos, len;          /* next event, start of the trailer */
+    uint32_t runlen;            /* frames left in the current run */
+    uint8_t runcode;
+};
+
+/* Check the whole recording and read its header: version and mode take up
+   to 80 characters. Nothing is read into levels unless the check passed. */
+bool drf2_open(struct drf2_dec *dec, const uint8_t *buf, size_t len,
+               char version[80], char mode[80], int32_t *bonus,
+               int8_t levels[8][10][15]);
+
+/* The input for the next frame; false at the end of a level or of the
+   recording */
+bool drf2_getdir(struct drf2_dec *dec, const uint8_t *buf, char *d);
+
+/*
+ * The next two read what the text player reads at a level boundary, and
+ * return false where it would find something else: the recording has got
+ * out of step with the game, and playback has to stop.
+ */
+
+/* The random seed a level starts with, after one set of initials if there
+   are any */
+bool drf2_getrand(struct drf2_dec *dec, const uint8_t *buf, uint32_t *r);
+
+/* Move past the end of a level */
+bool drf2_skipeol(struct drf2_dec *dec, const uint8_t *buf);
+
+#endif
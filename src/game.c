@@ -3,92 +3,170 @@
 
 #include <stdbool.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
 
+#include "def.h"
 #include "game.h"
+#include "game_ctx.h"
+#include "digger_types.h"
+#include "monster_obj.h"
+#include "soundgen.h"
 
-/* Game state that is shared by multiple modules */
-struct gamestate dgstate = {
-  .nplayers = 1, .diggers = 1, .curplayer = 0, .startlev = 1,
-  .levfflag = false, .randv = 0, .gtime = 0, .gauntlet = false,
-  .timeout = false, .unlimlives = false,
-  .leveldat = {{"S   B     HHHHS",
-                "V  CC  C  V B  ",
-                "VB CC  C  V    ",
-                "V  CCB CB V CCC",
-                "V  CC  C  V CCC",
-                "HH CC  C  V CCC",
-                " V    B B V    ",
-                " HHHH     V    ",
-                "C   V     V   C",
-                "CC  HHHHHHH  CC"},
-               {"SHHHHH  B B  HS",
-                " CC  V       V ",
-                " CC  V CCCCC V ",
-                "BCCB V CCCCC V ",
-                "CCCC V       V ",
-                "CCCC V B  HHHH ",
-                " CC  V CC V    ",
-                " BB  VCCCCV CC ",
-                "C    V CC V CC ",
-                "CC   HHHHHH    "},
-               {"SHHHHB B BHHHHS",
-                "CC  V C C V BB ",
-                "C   V C C V CC ",
-                " BB V C C VCCCC",
-                "CCCCV C C VCCCC",
-                "CCCCHHHHHHH CC ",
-                " CC  C V C  CC ",
-                " CC  C V C     ",
-                "C    C V C    C",
-                "CC   C H C   CC"},
-               {"SHBCCCCBCCCCBHS",
-                "CV  CCCCCCC  VC",
-                "CHHH CCCCC HHHC",
-                "C  V  CCC  V  C",
-                "   HHH C HHH   ",
-                "  B  V B V  B  ",
-                "  C  VCCCV  C  ",
-                " CCC HHHHH CCC ",
-                "CCCCC CVC CCCCC",
-                "CCCCC CHC CCCCC"},
-               {"SHHHHHHHHHHHHHS",
-                "VBCCCCBVCCCCCCV",
-                "VCCCCCCV CCBC V",
-                "V CCCC VCCBCCCV",
-                "VCCCCCCV CCCC V",
-                "V CCCC VBCCCCCV",
-                "VCCBCCCV CCCC V",
-                "V CCBC VCCCCCCV",
-                "VCCCCCCVCCCCCCV",
-                "HHHHHHHHHHHHHHH"},
-               {"SHHHHHHHHHHHHHS",
-                "VCBCCV V VCCBCV",
-                "VCCC VBVBV CCCV",
-                "VCCCHH V HHCCCV",
-                "VCC V CVC V CCV",
-                "VCCHH CVC HHCCV",
-                "VC V CCVCC V CV",
-                "VCHHBCCVCCBHHCV",
-                "VCVCCCCVCCCCVCV",
-                "HHHHHHHHHHHHHHH"},
-               {"SHCCCCCVCCCCCHS",
-                " VCBCBCVCBCBCV ",
-                "BVCCCCCVCCCCCVB",
-                "CHHCCCCVCCCCHHC",
-                "CCV CCCVCCC VCC",
-                "CCHHHCCVCCHHHCC",
-                "CCCCV CVC VCCCC",
-                "CCCCHH V HHCCCC",
-                "CCCCCV V VCCCCC",
-                "CCCCCHHHHHCCCCC"},
-               {"HHHHHHHHHHHHHHS",
-                "V CCBCCCCCBCC V",
-                "HHHCCCCBCCCCHHH",
-                "VBV CCCCCCC VBV",
-                "VCHHHCCCCCHHHCV",
-                "VCCBV CCC VBCCV",
-                "VCCCHHHCHHHCCCV",
-                "VCCCC V V CCCCV",
-                "VCCCCCV VCCCCCV",
-                "HHHHHHHHHHHHHHH"}}
+const int8_t defleveldat[8][10][15] = {
+   {"S   B     HHHHS",
+    "V  CC  C  V B  ",
+    "VB CC  C  V    ",
+    "V  CCB CB V CCC",
+    "V  CC  C  V CCC",
+    "HH CC  C  V CCC",
+    " V    B B V    ",
+    " HHHH     V    ",
+    "C   V     V   C",
+    "CC  HHHHHHH  CC"},
+   {"SHHHHH  B B  HS",
+    " CC  V       V ",
+    " CC  V CCCCC V ",
+    "BCCB V CCCCC V ",
+    "CCCC V       V ",
+    "CCCC V B  HHHH ",
+    " CC  V CC V    ",
+    " BB  VCCCCV CC ",
+    "C    V CC V CC ",
+    "CC   HHHHHH    "},
+   {"SHHHHB B BHHHHS",
+    "CC  V C C V BB ",
+    "C   V C C V CC ",
+    " BB V C C VCCCC",
+    "CCCCV C C VCCCC",
+    "CCCCHHHHHHH CC ",
+    " CC  C V C  CC ",
+    " CC  C V C     ",
+    "C    C V C    C",
+    "CC   C H C   CC"},
+   {"SHBCCCCBCCCCBHS",
+    "CV  CCCCCCC  VC",
+    "CHHH CCCCC HHHC",
+    "C  V  CCC  V  C",
+    "   HHH C HHH   ",
+    "  B  V B V  B  ",
+    "  C  VCCCV  C  ",
+    " CCC HHHHH CCC ",
+    "CCCCC CVC CCCCC",
+    "CCCCC CHC CCCCC"},
+   {"SHHHHHHHHHHHHHS",
+    "VBCCCCBVCCCCCCV",
+    "VCCCCCCV CCBC V",
+    "V CCCC VCCBCCCV",
+    "VCCCCCCV CCCC V",
+    "V CCCC VBCCCCCV",
+    "VCCBCCCV CCCC V",
+    "V CCBC VCCCCCCV",
+    "VCCCCCCVCCCCCCV",
+    "HHHHHHHHHHHHHHH"},
+   {"SHHHHHHHHHHHHHS",
+    "VCBCCV V VCCBCV",
+    "VCCC VBVBV CCCV",
+    "VCCCHH V HHCCCV",
+    "VCC V CVC V CCV",
+    "VCCHH CVC HHCCV",
+    "VC V CCVCC V CV",
+    "VCHHBCCVCCBHHCV",
+    "VCVCCCCVCCCCVCV",
+    "HHHHHHHHHHHHHHH"},
+   {"SHCCCCCVCCCCCHS",
+    " VCBCBCVCBCBCV ",
+    "BVCCCCCVCCCCCVB",
+    "CHHCCCCVCCCCHHC",
+    "CCV CCCVCCC VCC",
+    "CCHHHCCVCCHHHCC",
+    "CCCCV CVC VCCCC",
+    "CCCCHH V HHCCCC",
+    "CCCCCV V VCCCCC",
+    "CCCCCHHHHHCCCCC"},
+   {"HHHHHHHHHHHHHHS",
+    "V CCBCCCCCBCC V",
+    "HHHCCCCBCCCCHHH",
+    "VBV CCCCCCC VBV",
+    "VCHHHCCCCCHHHCV",
+    "VCCBV CCC VBCCV",
+    "VCCCHHHCHHHCCCV",
+    "VCCCC V V CCCCV",
+    "VCCCCCV VCCCCCV",
+    "HHHHHHHHHHHHHHH"}
 };
+
+#if defined(_RP2350)
+struct digger_ctx dgctx_single;
+#else
+static struct digger_ctx dgctx_main;
+
+/* The game each thread is currently running; defaults to the main one */
+_Thread_local struct digger_ctx *dgctx = &dgctx_main;
+#endif
+
+/* Put a context into the state a freshly started program has */
+void dgctx_init(struct digger_ctx *ctx)
+{
+  memset(ctx, 0, sizeof(*ctx));
+  ctx->game.nplayers = 1;
+  ctx->game.diggers = 1;
+  ctx->game.startlev = 1;
+  memcpy(ctx->game.leveldat, defleveldat, sizeof(defleveldat));
+  ctx->sprite.retrflag = true;
+  ctx->sprbatch.on = true;
+  ctx->sprbatch.hud = true;
+  ctx->sound.pulsewidth = 1;
+  ctx->sound.soundflag = true;
+  ctx->sound.musicflag = true;
+  ctx->sound.sounddiedone = true;
+  ctx->scores.bonusscore = 20000;
+  ctx->input.dynamicdir = ctx->input.dynamicdir2 = DIR_NONE;
+  ctx->input.staticdir = ctx->input.staticdir2 = DIR_NONE;
+  ctx->record.drfvalid = true;
+#if defined(_HOST)
+  ctx->host.audio_fill = true;
+#endif
+}
+
+#if !defined(_RP2350)
+struct digger_ctx *dgctx_new(void)
+{
+  struct digger_ctx *ctx;
+
+  ctx = malloc(sizeof(*ctx));
+  if (ctx == NULL)
+    return (NULL);
+  dgctx_init(ctx);
+  return (ctx);
+}
+
+void dgctx_free(struct digger_ctx *ctx)
+{
+  int i;
+
+  for (i = 0; i < MONSTERS; i++)
+    if (ctx->monster.mondat[i].mop != NULL)
+      CALL_METHOD(ctx->monster.mondat[i].mop, dtor);
+  if (ctx->newsnd.ssp != NULL)
+    sgen_dtor(ctx->newsnd.ssp);
+  if (ctx->record.recf != NULL)
+    fclose(ctx->record.recf);
+  if (ctx->record.idx.f != NULL)
+    fclose(ctx->record.idx.f);
+  free(ctx->record.idx.snap);
+  if (ctx != &dgctx_main)
+    free(ctx);
+}
+
+/* Make ctx the game run by the calling thread, returning the previous one */
+struct digger_ctx *dgctx_bind(struct digger_ctx *ctx)
+{
+  struct digger_ctx *octx;
+
+  octx = dgctx;
+  dgctx = ctx;
+  return (octx);
+}
+#endif
@@ -1,6 +1,9 @@
 /* Digger Remastered
    Copyright (c) Andrew Jenner 1998-2004 */
 
+#ifndef __GAME_H
+#define __GAME_H
+
 struct gamestate {
   int16_t nplayers,diggers,curplayer,startlev;
   bool levfflag;
@@ -13,4 +16,7 @@ struct gamestate {
   uint32_t ftime, cgtime;
 };
 
-extern struct gamestate dgstate;
+/* The levels the game comes with */
+extern const int8_t defleveldat[8][10][15];
+
+#endif
@@ -0,0 +1,289 @@
+/* Digger Remastered
+   Copyright (c) Andrew Jenner 1998-2004 */
+
+#ifndef __GAME_CTX_H
+#define __GAME_CTX_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "def.h"
+#include "digger_obj.h"
+#include "bullet_obj.h"
+#include "game.h"
+#include "drf2.h"
+#if defined(_HOST)
+#include "host.h"
+#endif
+
+struct monster_obj;
+struct sgen_state;
+
+/* Everything that changes while a game runs, grouped by the module that owns
+   it. One digger_ctx is one independent game: modules reach their state
+   through dgctx, which points at the context currently being run. */
+
+struct main_state {
+  struct game {
+    int16_t level;
+    bool levdone;
+  } gamedat[2];
+  bool levnotdrawn,alldead,started;
+  int16_t penalty;
+  bool inited;
+  int16_t mode;               /* where digger_step() resumes */
+  int16_t modet,modec;        /* frame counters of the current mode */
+  bool nextframe,single,flashplayer;
+  uint32_t randseed;          /* level seed when not playing back */
+  struct monster_obj *nobbin,*hobbin;
+  struct digger_obj odigger;  /* title screen cast */
+};
+
+struct digger_state {
+  struct digger {
+    int16_t h,v,rx,ry,mdir,bagtime,rechargetime,
+          deathstage,deathbag,deathani,deathtime,emocttime,emn,msc,lives,ivt;
+    bool notfiring,firepressed,dead,levdone,invin;
+    struct digger_obj dob;
+    struct bullet_obj bob;
+  } digdat[DIGGERS];
+  int16_t startbonustimeleft,bonustimeleft,emmask;
+  int8_t emfield[MSIZE];
+  bool bonusvisible,bonusmode,digvisible;
+  uint32_t frame;
+};
+
+struct monster_state {
+  struct monster {
+    int16_t h,v,xr,yr,dir,t,hnt,death,bag,dtime,stime,chase;
+    bool flag;
+    struct monster_obj *mop;
+  } mondat[MONSTERS];
+  int16_t nextmonster,totalmonsters,maxmononscr,nextmontime,mongaptime,chase;
+  bool unbonusflag,mongotgold;
+};
+
+struct bags_state {
+  struct bag {
+    int16_t x,y,h,v,xr,yr,dir,wt,gt,fallh;
+    bool wobbling,unfallen,exist;
+  } bagdat1[BAGS],bagdat2[BAGS],bagdat[BAGS];
+  int16_t pushcount,goldtime;
+};
+
+/* A line of HUD text as last drawn by hudtext() */
+#define HUD_TEXT_LEN 8
+
+struct hudtext {
+  int16_t x,c;
+  char s[HUD_TEXT_LEN+1];
+};
+
+struct drawing_state {
+  int16_t field1[MSIZE],field2[MSIZE],field[MSIZE];
+  uint8_t monbufs[MONSTERS][480],bagbufs[BAGS][480],bonusbufs[BONUSES][480],
+        diggerbufs[DIGGERS][480],firebufs[FIREBALLS][128];
+  int16_t digspr[DIGGERS],digspd[DIGGERS],firespr[FIREBALLS];
+  int16_t hudlives[DIGGERS];       /* lives last drawn, see drawlives() */
+  struct hudtext hudtime;          /* the gauntlet time */
+};
+
+/* 4-pixel columns of the top text row, for the HUD owners */
+#define HUD_W 80
+
+struct sprite_state {
+  bool retrflag;
+  bool sprrdrwf[SPRITES+1],sprrecf[SPRITES+1],sprenf[SPRITES];
+  int16_t sprch[SPRITES+1];
+  uint8_t *sprmov[SPRITES];
+  int16_t sprx[SPRITES+1],spry[SPRITES+1],sprwid[SPRITES+1],sprhei[SPRITES+1];
+  int16_t sprbwid[SPRITES],sprbhei[SPRITES],sprnch[SPRITES],sprnwid[SPRITES],
+        sprnhei[SPRITES],sprnbwid[SPRITES],sprnbhei[SPRITES];
+  int first[TYPES],coll[SPRITES];
+  uint8_t hudown[HUD_W];           /* who last drew the top text row */
+  uint8_t hudowner;                /* who is drawing now, see sethud() */
+};
+
+/* Sprite moves queued in a frame until flushsprites() puts them all on the
+   screen at once; see sprite.c. Never pending between frames, so not part
+   of a snapshot. */
+struct sprbatch_state {
+  bool on;
+  bool pend[SPRITES];
+  int16_t npend;
+  int16_t oldx[SPRITES],oldy[SPRITES],oldwid[SPRITES],oldhei[SPRITES];
+  uint32_t pixels,framepixels;   /* written by sprite.c, this and last frame */
+  bool hud;                      /* redraw only the HUD cells that changed */
+  uint32_t hudpixels,framehud;   /* written by the HUD, this and last frame */
+};
+
+struct sound_state {
+  int16_t wavetype,musvol;
+  uint16_t t2val,t0val;
+  int16_t spkrmode,pulsewidth,volume;
+  int8_t timerclock;
+  bool soundflag,musicflag;
+  bool sndflag,soundpausedflag;
+  int32_t randvs;
+  bool soundlevdoneflag;
+  int8_t levdonetimer;
+  int16_t nljpointer,nljnoteduration;
+  bool soundfallflag,soundfallf;
+  int16_t soundfallvalue,soundfalln;
+  bool soundbreakflag;
+  int16_t soundbreakduration,soundbreakvalue;
+  bool soundwobbleflag;
+  int16_t soundwobblen;
+  bool soundfireflag[FIREBALLS],sff[FIREBALLS];
+  int16_t soundfirevalue[FIREBALLS],soundfiren[FIREBALLS];
+  int soundfirew;
+  bool soundexplodeflag[FIREBALLS],sef[FIREBALLS];
+  int16_t soundexplodevalue[FIREBALLS],soundexplodeduration[FIREBALLS];
+  int soundexplodew;
+  bool soundbonusflag;
+  int16_t soundbonusn;
+  bool soundemflag;
+  bool soundemeraldflag;
+  int16_t soundemeraldduration,emerfreq,soundemeraldn;
+  bool soundgoldflag,soundgoldf;
+  int16_t soundgoldvalue1,soundgoldvalue2,soundgoldduration;
+  bool soundeatmflag;
+  int16_t soundeatmvalue,soundeatmduration,soundeatmn;
+  bool soundddieflag;
+  int16_t soundddien,soundddievalue;
+  bool sound1upflag;
+  int16_t sound1upduration;
+  bool musicplaying;
+  int16_t musicp,tuneno,noteduration,notevalue,musicmaxvol,
+        musicattackrate,musicsustainlevel,musicdecayrate,musicnotewidth,
+        musicreleaserate,musicstage,musicn,musicdfac;
+  bool sounddiedone;
+  bool soundt0flag;
+};
+
+struct newsnd_state {
+  struct sgen_state *ssp;
+  unsigned int intmod;
+  uint16_t t0rate;
+};
+
+struct scores_state {
+  struct scdat {
+    int32_t score, nextbs, tscore;
+  } scdat[DIGGERS];
+  char highbuf[10];
+  int32_t scorehigh[12];
+  char scoreinit[11][4];
+  int32_t scoret;
+  char hsbuf[36];
+  char scorebuf[512];
+  struct hudtext hudscore[DIGGERS];
+  uint16_t bonusscore;
+  int16_t eog,eogplayer,eogtime,initpos,initwait;
+  bool initflag;
+};
+
+struct input_state {
+  bool escape,firepflag,fire2pflag,pausef,mode_change,rewindf,replayf;
+  bool aleftpressed,arightpressed,auppressed,adownpressed,start,af1pressed;
+  bool aleft2pressed,aright2pressed,aup2pressed,adown2pressed,af12pressed;
+  int16_t akeypressed;
+  int16_t dynamicdir,dynamicdir2,staticdir,staticdir2,joyx,joyy;
+  bool joybut1;
+  int16_t keydir,keydir2,jleftthresh,jupthresh,jrightthresh,
+        jdownthresh,joyanax,joyanay;
+  bool joyflag;
+  bool oupressed,odpressed,olpressed,orpressed;
+  bool ou2pressed,od2pressed,ol2pressed,or2pressed;
+};
+
+/* Header of the seek index kept next to a recording, see record.c */
+struct playidx_hdr {
+  char magic[4];
+  uint16_t version,every;
+  uint32_t snapsize;
+  uint32_t drflen,drfhash;    /* of the recording the index was made from */
+  uint32_t count;             /* keyframes written so far */
+};
+
+struct record_state {
+  char *plb,*plp;
+  FILE *recf;                 /* the recording streams to this file */
+  bool playing,savedrf,gotname,gotgame,drfvalid,kludge;
+  bool plbin;                 /* playing back a binary DRF, with dec */
+  struct drf2_dec dec;
+  char rname[128];
+  int rlleft;
+  char rld;
+  uint32_t playframe;         /* frames played back so far */
+  struct drf2_enc enc;        /* recording of the game being played */
+  /* These belong to the playback rather than the game, so a snapshot
+     leaves them out and restore() keeps them */
+  struct {                    /* settings playclose() puts back */
+    int gtime;
+    bool gauntlet;
+    int16_t startlev,nplayers,diggers;
+  } orig;
+  struct {                    /* seek index of the recording played back */
+    FILE *f;
+    struct playidx_hdr hdr;
+    uint8_t *snap;
+  } idx;
+};
+
+#if defined(_HOST)
+/* Headless backend: each game draws into its own framebuffer and has its
+   own key queue and audio sink. */
+struct spkfeed;
+
+struct host_state {
+  uint8_t framebuffer[HOST_FB_SIZE];
+  int16_t pal,inten;
+  int16_t kbuffer[HOST_KBLEN];
+  int16_t klen;
+  bool keyheld[256];
+  bool audio_initialized,audio_paused,audio_fill;
+  int16_t audio_buf[HOST_AUDIO_SAMPLES*2];  /* one frame, stereo */
+  bool audio_persample;          /* getsample() a sample at a time, for /1 */
+  uint32_t audio_hash;           /* of every sample made */
+  uint64_t audio_samples,audio_cycles;      /* made, and host_cycles() taken */
+  struct spkfeed *audio_feed;    /* queue the sound here instead, as the
+                                    device does; for /1:file,count,samples */
+};
+#endif
+
+struct digger_ctx {
+  struct gamestate game;
+  struct main_state main;
+  struct digger_state digger;
+  struct monster_state monster;
+  struct bags_state bags;
+  struct drawing_state drawing;
+  struct sprite_state sprite;
+  struct sprbatch_state sprbatch;
+  struct sound_state sound;
+  struct newsnd_state newsnd;
+  struct scores_state scores;
+  struct input_state input;
+  struct record_state record;
+#if defined(_HOST)
+  struct host_state host;
+#endif
+};
+
+#if defined(_RP2350)
+/* Only ever one game on the device, so keep the state at a fixed address. */
+extern struct digger_ctx dgctx_single;
+#define dgctx (&dgctx_single)
+#else
+extern _Thread_local struct digger_ctx *dgctx;
+
+struct digger_ctx *dgctx_new(void);
+void dgctx_free(struct digger_ctx *ctx);
+struct digger_ctx *dgctx_bind(struct digger_ctx *ctx);
+#endif
+
+void dgctx_init(struct digger_ctx *ctx);
+
+#endif
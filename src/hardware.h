@@ -2,6 +2,7 @@ void olddelay(int16_t t);
 int32_t getkips(void);
 void inittimer(void);
 void gethrt(bool);
+void audio_fill_and_submit(void);
 
 void s0soundoff(void);
 void s0setspkrt2(void);
@@ -16,6 +17,8 @@ void initkeyb(void);
 void restorekeyb(void);
 int16_t getkey(bool);
 bool kbhit(void);
+struct digger_input;
+void kbdfeed(const struct digger_input *in);
 
 void graphicsoff(void);
 void gretrace(void);
@@ -24,11 +27,13 @@ void cgainit(void);
 void cgaclear(void);
 void cgapal(int16_t pal);
 void cgainten(int16_t inten);
+void cgagetpal(int16_t *pal,int16_t *inten);
 void cgaputi(int16_t x,int16_t y,uint8_t *p,int16_t w,int16_t h);
 void cgageti(int16_t x,int16_t y,uint8_t *p,int16_t w,int16_t h);
 void cgaputim(int16_t x,int16_t y,int16_t ch,int16_t w,int16_t h);
 int16_t cgagetpix(int16_t x,int16_t y);
 void cgawrite(int16_t x,int16_t y,int16_t ch,int16_t c);
+void cgafill(int16_t x,int16_t y,int16_t w,int16_t h,int16_t c);
 void cgatitle(void);
 
 void vgainit(void);
@@ -40,4 +45,5 @@ void vgageti(int16_t x,int16_t y,uint8_t *p,int16_t w,int16_t h);
 void vgaputim(int16_t x,int16_t y,int16_t ch,int16_t w,int16_t h);
 int16_t vgagetpix(int16_t x,int16_t y);
 void vgawrite(int16_t x,int16_t y,int16_t ch,int16_t c);
+void vgafill(int16_t x,int16_t y,int16_t w,int16_t h,int16_t c);
 void vgatitle(void);
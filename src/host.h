@@ -0,0 +1,45 @@
+/*
+ * host.h - Headless Host Backend Hooks
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __HOST_H
+#define __HOST_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+/* In-memory framebuffer: 320x200, 4-bit nibble-packed like the HDMI buffer */
+#define HOST_FB_WIDTH  320
+#define HOST_FB_HEIGHT 200
+#define HOST_FB_SIZE   ((HOST_FB_WIDTH / 2) * HOST_FB_HEIGHT)
+
+uint8_t *host_framebuffer(void);
+void host_palette(int16_t *pal, int16_t *inten);
+
+/* Synthetic keyboard queue length */
+#define HOST_KBLEN 30
+
+/* Synthetic keyboard: queue a key press or set a key's held state (HID codes) */
+void host_pushkey(int16_t scancode);
+void host_setkey(uint8_t key, bool held);
+
+/* Samples in one frame of audio, as on the device (see rp2350_snd.c) */
+#define HOST_AUDIO_SAMPLES 3528
+
+/* Null audio sink: skip waveform synthesis but keep soundint() timing */
+void host_setaudiofill(bool fill);
+
+/* A cycle count for benchmarks: the time stamp counter on x86, else
+   nanoseconds */
+uint64_t host_cycles(void);
+
+/* Run the benchmark or check of command line option argch (host_bench.c);
+   returns the exit status, or -1 if argch is not one of them */
+int hostbench(int argch, char *arg);
+
+#endif
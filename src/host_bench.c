@@ -0,0 +1,917 @@
+/*
+ * host_bench.c - Benchmarks and Checks of the Headless Host Build
+ *
+ * The command line modes of murmdigger_host that time a part of the game,
+ * or check a fast way of doing something against the plain one, and exit.
+ * The modes that play a recording share one replay harness. A check that
+ * finds the two ways disagree prints MISMATCH and exits with 1, so they
+ * can be run from a script or ctest.
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+
+#include "def.h"
+#include "digger_types.h"
+#include "hardware.h"
+#include "draw_api.h"
+#include "game_ctx.h"
+#include "main.h"
+#include "digger.h"
+#include "drawing.h"
+#include "scores.h"
+#include "record.h"
+#include "drf2.h"
+#include "rewind.h"
+#include "spkfeed.h"
+#include "soundgen.h"
+#include "cgasprite.h"
+#include "cgaline.h"
+#include "cgatext.h"
+#include "host.h"
+#include "host_env.h"
+
+extern struct digger_draw_api *ddap;
+
+static double
+wallclock(void)
+{
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* A recording being played back by the benchmarks, and what it did */
+struct replay {
+  struct digger_ctx *ctx,*octx;   /* octx: bound before a fresh game */
+  uint32_t steps;           /* digger_step() calls, title and level starts too */
+  double t,pixels;          /* time in digger_step(), sprite pixels drawn */
+  double hud;               /* HUD pixels drawn */
+  uint32_t hudsteps;        /* steps in which the HUD drew anything */
+  /* Filled in by replay_close() */
+  uint32_t getframe;        /* frames of play, as the recording counts them */
+  int32_t score;
+  int16_t level;
+  uint32_t audiohash;       /* of the samples made, if audio_fill is set */
+  uint64_t samples,cycles;  /* samples made and host_cycles() taken */
+};
+
+/* Start playing a DRF back with no waveform synthesis. With fresh it is
+   played in a new game context, else in the one the command line set up.
+   setup(), if given, is applied to the context before the recording is
+   opened. Exits if the recording cannot be played. */
+static void
+replay_open(struct replay *r, const char *who, char *name, bool index,
+            bool fresh, void (*setup)(struct digger_ctx *, int), int pass)
+{
+  memset(r, 0, sizeof(*r));
+  r->octx=dgctx;
+  if (fresh) {
+    r->ctx=dgctx_new();
+    if (r->ctx==NULL) {
+      fprintf(stderr, "%s: no memory\n", who);
+      exit(1);
+    }
+    dgctx_bind(r->ctx);
+    inigame();
+  }
+  else
+    r->ctx=dgctx;
+  r->ctx->host.audio_fill=false;
+  maininit();
+  if (setup!=NULL)
+    setup(r->ctx, pass);
+  if (!playopen(name, index)) {
+    fprintf(stderr, "%s: cannot play %s\n", who, name);
+    exit(1);
+  }
+  startgame();
+}
+
+/* Play one frame; false once the recording is over */
+static bool
+replay_step(struct replay *r)
+{
+  struct digger_ctx *ctx=r->ctx;
+  double t0=wallclock();
+  bool more=digger_step(NULL);
+
+  r->t+=wallclock()-t0;
+  r->pixels+=ctx->sprbatch.framepixels;
+  r->hud+=ctx->sprbatch.framehud;
+  if (ctx->sprbatch.framehud!=0)
+    r->hudsteps++;
+  r->steps++;
+  return more;
+}
+
+static void
+replay_close(struct replay *r)
+{
+  struct digger_ctx *ctx=r->ctx;
+
+  r->getframe=getframe();
+  r->score=gettscore(0);
+  r->level=levno();
+  r->audiohash=ctx->host.audio_hash;
+  r->samples=ctx->host.audio_samples;
+  r->cycles=ctx->host.audio_cycles;
+  playclose();
+  if (ctx!=r->octx) {
+    dgctx_bind(r->octx);
+    dgctx_free(ctx);
+  }
+  else
+    ctx->host.audio_fill=true;
+}
+
+static void
+replay_emit(const struct replay *r)
+{
+  printf("score=%d level=%d frames=%u\n", (int)r->score, r->level,
+   (unsigned int)r->getframe);
+}
+
+/* Replay a DRF with no frame pacing and no waveform synthesis, then report
+   how fast the game core ran. */
+static int
+benchplay(char *name)
+{
+  struct replay r;
+
+  replay_open(&r, "benchplay", name, false, false, NULL, 0);
+  while (replay_step(&r))
+    ;
+  replay_close(&r);
+  printf("wall=%.6fs frames=%u fps=%.1f\n", r.t, (unsigned int)r.getframe,
+   (r.t>0) ? r.getframe / r.t : 0.0);
+  replay_emit(&r);
+  return 0;
+}
+
+/* Scrub through a DRF: seek to each frame in turn through the index of the
+   recording, then play on to the end. arg is "file,frame[,frame...]". The
+   index is built as the recording plays, so the first run of a recording
+   has to simulate its way forward. */
+static int
+benchseek(char *arg)
+{
+  struct replay r;
+  char *p=strchr(arg, ',');
+  uint32_t frame;
+  double t0, t1;
+  bool ok;
+
+  if (p==NULL) {
+    fprintf(stderr, "benchseek: expected file,frame\n");
+    return 1;
+  }
+  *p++=0;
+  replay_open(&r, "benchseek", arg, true, false, NULL, 0);
+  while (p!=NULL) {
+    frame=strtoul(p, &p, 10);
+    t0=wallclock();
+    ok=playseek(frame);
+    t1=wallclock();
+    printf("seek=%u %s wall=%.6fs\n", (unsigned int)frame,
+     ok ? "ok" : "failed", t1 - t0);
+    p=(*p==',') ? p+1 : NULL;
+  }
+  while (replay_step(&r))
+    ;
+  replay_close(&r);
+  replay_emit(&r);
+  return 0;
+}
+
+/* Replay a DRF with rewind capture on every frame of play, then report
+   what the savestates cost. */
+static int
+benchrewind(char *name)
+{
+  struct replay r;
+  struct rewind_stats rs;
+
+  if (!rewind_init(REWIND_RING)) {
+    fprintf(stderr, "benchrewind: no memory for the rewind ring\n");
+    return 1;
+  }
+  replay_open(&r, "benchrewind", name, false, false, NULL, 0);
+  while (replay_step(&r))
+    ;
+  replay_close(&r);
+  rewind_getstats(&rs);
+  if (rs.captures==0) {
+    fprintf(stderr, "benchrewind: nothing was captured\n");
+    return 1;
+  }
+  printf("captures=%u bytes/frame=%.1f us/capture=%.2f\n",
+   (unsigned int)rs.captures, (double)rs.bytes / rs.captures,
+   rs.capture_ns / 1e3 / rs.captures);
+  printf("ring=%lu held=%u frames in %lu bytes ram=%lu\n",
+   (unsigned long)rs.ring, (unsigned int)rs.frames, (unsigned long)rs.used,
+   (unsigned long)rs.mem);
+  replay_emit(&r);
+  rewind_free();
+  return 0;
+}
+
+#define BENCHSPRITES 200000
+
+/* Draw BENCHSPRITES sprites at random places, partly off screen, into a
+   scratch framebuffer: a pixel at a time, through the 4bpp atlas, and
+   into a 2bpp screen. Report pixels per second for each; all three have
+   to leave the same picture. */
+static int
+benchsprites(void)
+{
+  static uint8_t fb0[HOST_FB_SIZE], fb1[HOST_FB_SIZE], fb2[HOST_FB_SIZE/2];
+  static uint32_t line[HOST_FB_WIDTH/4];
+  struct cgafb fb = { NULL, HOST_FB_WIDTH/2, HOST_FB_WIDTH, HOST_FB_HEIGHT, 0 };
+  double t[3], px=0;
+  uint32_t r;
+  int pass, n, x, y;
+  bool same;
+
+  cgaspr_init();
+  cgaline_init();
+  for (pass=0;pass<3;pass++) {
+    fb.pixels=(pass==0) ? fb0 : (pass==1) ? fb1 : fb2;
+    fb.stride=(pass==2) ? HOST_FB_WIDTH/4 : HOST_FB_WIDTH/2;
+    r=1;
+    t[pass]=wallclock();
+    for (n=0;n<BENCHSPRITES;n++) {
+      int16_t ch, sx, sy;
+      r=r*0x15a4e35l+1;
+      ch=(r>>16)%CGASPRITES;
+      sx=(int16_t)((r>>4)%84)*4-8;
+      sy=(int16_t)((r>>10)%220)-10;
+      if (pass==0) {
+        cgaspr_putref(&fb, sx, sy, ch, 4, cgaspr_len(ch)/4);
+        px+=cgaspr_len(ch)*4;
+      }
+      else if (pass==1)
+        cgaspr_put(&fb, sx, sy, ch, 4, cgaspr_len(ch)/4);
+      else
+        cgaspr_put2(&fb, sx, sy, ch, 4, cgaspr_len(ch)/4);
+    }
+    t[pass]=wallclock()-t[pass];
+  }
+  same=memcmp(fb0, fb1, sizeof(fb0))==0;
+  for (y=0;y<HOST_FB_HEIGHT && same;y++) {
+    cgaline_expand(line, fb2+y*HOST_FB_WIDTH/4, HOST_FB_WIDTH/4);
+    for (x=0;x<HOST_FB_WIDTH;x++)
+      if (((uint8_t *)line)[x]!=((fb0[y*HOST_FB_WIDTH/2+x/2]>>((x&1)*4))&15))
+        same=false;
+  }
+  printf("sprites=%d pixel=%.1fMpx/s atlas=%.1fMpx/s 2bpp=%.1fMpx/s %s\n",
+   BENCHSPRITES, px / t[0] / 1e6, px / t[1] / 1e6, px / t[2] / 1e6,
+   same ? "match" : "MISMATCH");
+  return same ? 0 : 1;
+}
+
+#define BENCHCHARS 200000
+
+/* Draw BENCHCHARS characters in random colours at random places, partly
+   off screen and mostly at x & -4 as the game puts them, into a scratch
+   framebuffer: a pixel at a time, from the expanded font, and into a 2bpp
+   screen. Every 16th is a cleared rectangle instead. Report characters per second for each; all three
+   have to leave the same picture. */
+static int
+benchtext(void)
+{
+  static uint8_t fb0[HOST_FB_SIZE], fb1[HOST_FB_SIZE], fb2[HOST_FB_SIZE/2];
+  static uint32_t line[HOST_FB_WIDTH/4];
+  struct cgafb fb = { NULL, HOST_FB_WIDTH/2, HOST_FB_WIDTH, HOST_FB_HEIGHT, 0 };
+  double t[3];
+  uint32_t r;
+  int pass, n, x, y;
+  bool same;
+
+  cgatext_init();
+  cgaline_init();
+  for (pass=0;pass<3;pass++) {
+    fb.pixels=(pass==0) ? fb0 : (pass==1) ? fb1 : fb2;
+    fb.stride=(pass==2) ? HOST_FB_WIDTH/4 : HOST_FB_WIDTH/2;
+    r=1;
+    t[pass]=wallclock();
+    for (n=0;n<BENCHCHARS;n++) {
+      int16_t ch, c, tx, ty;
+      r=r*0x15a4e35l+1;
+      ch=(r>>16)%0x5f+32;
+      c=(r>>8)&3;
+      tx=(int16_t)((r>>4)%340)-10;
+      if (n&3)
+        tx&=-4;
+      ty=(int16_t)((r>>12)%220)-10;
+      if ((n&15)==15) {
+        if (pass==2)
+          cgatext_fill2(&fb, tx, ty, (r>>20)&63, (r>>26)&31, c);
+        else
+          cgatext_fill(&fb, tx, ty, (r>>20)&63, (r>>26)&31, c);
+      }
+      else if (pass==0)
+        cgatext_putref(&fb, tx, ty, ch, c);
+      else if (pass==1)
+        cgatext_put(&fb, tx, ty, ch, c);
+      else
+        cgatext_put2(&fb, tx, ty, ch, c);
+    }
+    t[pass]=wallclock()-t[pass];
+  }
+  same=memcmp(fb0, fb1, sizeof(fb0))==0;
+  for (y=0;y<HOST_FB_HEIGHT && same;y++) {
+    cgaline_expand(line, fb2+y*HOST_FB_WIDTH/4, HOST_FB_WIDTH/4);
+    for (x=0;x<HOST_FB_WIDTH;x++)
+      if (((uint8_t *)line)[x]!=((fb0[y*HOST_FB_WIDTH/2+x/2]>>((x&1)*4))&15))
+        same=false;
+  }
+  printf("chars=%d pixel=%.2fMchar/s glyphs=%.2fMchar/s 2bpp=%.2fMchar/s %s\n",
+   BENCHCHARS, BENCHCHARS / t[0] / 1e6, BENCHCHARS / t[1] / 1e6,
+   BENCHCHARS / t[2] / 1e6, same ? "match" : "MISMATCH");
+  return same ? 0 : 1;
+}
+
+#define BENCHSRATE 44100
+#define BENCHSECS 100
+#define BENCHSWITCH (BENCHSRATE-12345)
+
+/* The sgen_test() wave, 1607 Hz then 2087 Hz from the same phase, for
+   BENCHSECS seconds at the device's sample rate: from the double-precision
+   generator of soundgen_ref.c, then the fixed-point one a sample at a time,
+   then the same in frame-sized stereo blocks. The first two have to give
+   the same level changes and the same shortest and longest runs, and the
+   blocks the same samples as the second. Report the samples per second
+   each makes and the samples that moved. */
+static int
+benchsound(void)
+{
+  static int16_t out[2][BENCHSRATE*BENCHSECS], stereo[BENCHSRATE*BENCHSECS*2];
+  struct sgenref_state *rsp=sgenref_ctor(BENCHSRATE, 2);
+  struct sgen_state *ssp=sgen_ctor(BENCHSRATE, 2), *bsp=sgen_ctor(BENCHSRATE, 2);
+  struct sgen_wavestats ws[2];
+  double t[3], rphase;
+  int i, k, n=BENCHSRATE*BENCHSECS, differ=0;
+  bool same=true;
+
+  if (rsp==NULL || ssp==NULL || bsp==NULL) {
+    fprintf(stderr, "benchsound: no memory\n");
+    return 1;
+  }
+  sgenref_setband(rsp, 0, 1607.0, 1.0);
+  sgenref_setphase(rsp, 0, 0.25);
+  t[0]=wallclock();
+  for (i=0;i<n;i++) {
+    if (i==BENCHSWITCH) {
+      rphase=sgenref_getphase(rsp, 0);
+      sgenref_setband(rsp, 0, 2087.0, 1.0);
+      sgenref_setphase(rsp, 0, rphase);
+    }
+    out[0][i]=sgenref_getsample(rsp);
+  }
+  t[0]=wallclock()-t[0];
+  sgen_setband(ssp, 0, 1607.0, 1.0);
+  sgen_setphase(ssp, 0, 0.25);
+  t[1]=wallclock();
+  for (i=0;i<n;i++) {
+    if (i==BENCHSWITCH) {
+      rphase=sgen_getphase(ssp, 0);
+      sgen_setband(ssp, 0, 2087.0, 1.0);
+      sgen_setphase(ssp, 0, rphase);
+    }
+    out[1][i]=sgen_getsample(ssp);
+  }
+  t[1]=wallclock()-t[1];
+  sgen_setband(bsp, 0, 1607.0, 1.0);
+  sgen_setphase(bsp, 0, 0.25);
+  t[2]=wallclock();
+  for (i=0;i<n;i+=k) {
+    k=(n-i<HOST_AUDIO_SAMPLES) ? n-i : HOST_AUDIO_SAMPLES;
+    if (i<BENCHSWITCH && i+k>BENCHSWITCH)
+      k=BENCHSWITCH-i;
+    if (i==BENCHSWITCH) {
+      rphase=sgen_getphase(bsp, 0);
+      sgen_setband(bsp, 0, 2087.0, 1.0);
+      sgen_setphase(bsp, 0, rphase);
+    }
+    sgen_fill(bsp, stereo+i*2, k, 2);
+  }
+  t[2]=wallclock()-t[2];
+  sgenref_dtor(rsp);
+  sgen_dtor(ssp);
+  sgen_dtor(bsp);
+  for (i=0;i<n;i++) {
+    if (out[0][i]!=out[1][i])
+      differ++;
+    if (stereo[i*2]!=out[1][i] || stereo[i*2+1]!=out[1][i])
+      same=false;
+  }
+  sgen_wavestats(out[0], n, &ws[0]);
+  sgen_wavestats(out[1], n, &ws[1]);
+  same=same && ws[0].ntrans==ws[1].ntrans && ws[0].nzero==ws[1].nzero &&
+    ws[0].posdur_min==ws[1].posdur_min && ws[0].posdur_max==ws[1].posdur_max &&
+    ws[0].negdur_min==ws[1].negdur_min && ws[0].negdur_max==ws[1].negdur_max;
+  printf("samples=%d double=%.2fMsample/s fixed=%.2fMsample/s "
+   "block=%.2fMsample/s changes=%u/%u runs=%u-%u/%u-%u differ=%d %s\n", n,
+   n / t[0] / 1e6, n / t[1] / 1e6, n / t[2] / 1e6, ws[0].ntrans,
+   ws[1].ntrans, ws[0].posdur_min, ws[0].posdur_max, ws[1].posdur_min,
+   ws[1].posdur_max, differ, same ? "match" : "MISMATCH");
+  return same ? 0 : 1;
+}
+
+#define BENCHLINES 200000
+
+/* The 4bpp line expanded through a table of pixel pairs, a word at a time:
+   tried for the HDMI IRQ and kept here to time the nibble split against */
+static uint16_t pairlut[256];
+
+static void
+pairexpand(uint32_t *out, const uint8_t *in, int n)
+{
+  int i;
+  for (i=0;i<n;i+=2)
+    *out++=pairlut[in[i]] | (uint32_t)pairlut[in[i+1]]<<16;
+}
+
+/* Check the scanline expansion of the HDMI IRQ: the 2bpp table against
+   the pixels of every byte value, the 4bpp nibble split and the pair table
+   against each other. Then time all three over BENCHLINES 320-pixel lines.
+   Only a build with the firmware's -O3 (CMAKE_BUILD_TYPE=Release) says
+   which is faster. */
+static int
+benchline(void)
+{
+  static uint8_t fb4[160*240], fb2[80*240];
+  static uint32_t out[400/4], ref[400/4];
+  uint8_t *o=(uint8_t *)out, b;
+  uint32_t sum[3]={0,0,0};
+  double t[3];
+  int n, i, bad=0;
+
+  cgaline_init();
+  for (i=0;i<256;i++) {
+    b=i;
+    cgaline_expand(out, &b, 1);
+    for (n=0;n<4;n++)
+      if (o[n]!=((i>>(6-n*2))&3))
+        bad++;
+    o[0]=i&0xF;
+    o[1]=i>>4;
+    memcpy(&pairlut[i], o, sizeof(pairlut[i]));
+  }
+  for (i=0;i<(int)sizeof(fb4);i++)
+    fb4[i]=i*0x9e3779b1u>>24;
+  for (i=0;i<(int)sizeof(fb2);i++)
+    fb2[i]=i*0x9e3779b1u>>24;
+  for (n=0;n<240;n++) {
+    cgaline_expand4(ref, fb4+n*160, 160);
+    pairexpand(out, fb4+n*160, 160);
+    if (memcmp(out, ref, 320)!=0)
+      bad++;
+  }
+  t[0]=wallclock();
+  for (n=0;n<BENCHLINES;n++) {
+    cgaline_expand4(out, fb4+(n%240)*160, 160);
+    sum[0]+=out[n%80];
+  }
+  t[0]=wallclock()-t[0];
+  t[1]=wallclock();
+  for (n=0;n<BENCHLINES;n++) {
+    pairexpand(out, fb4+(n%240)*160, 160);
+    sum[1]+=out[n%80];
+  }
+  t[1]=wallclock()-t[1];
+  t[2]=wallclock();
+  for (n=0;n<BENCHLINES;n++) {
+    cgaline_expand(out, fb2+(n%240)*80, 80);
+    sum[2]+=out[n%80];
+  }
+  t[2]=wallclock()-t[2];
+  printf("lines=%d nibble=%.1fns/line pairs=%.1fns/line 2bpp=%.1fns/line "
+   "sum=%08x%08x%08x %s\n", BENCHLINES, t[0] / BENCHLINES * 1e9,
+   t[1] / BENCHLINES * 1e9, t[2] / BENCHLINES * 1e9, (unsigned int)sum[0],
+   (unsigned int)sum[1], (unsigned int)sum[2], bad ? "MISMATCH" : "match");
+  return bad ? 1 : 0;
+}
+
+#define BENCHLEVELS 500
+
+/* Draw the background and tunnels of each of the 8 level plans, as at the
+   start of a level, BENCHLEVELS times: a tile and a blob at a time, then
+   copying the background and batching the blobs. Report the time each
+   takes; both have to leave the same picture. */
+static int
+benchlevel(void)
+{
+  static uint8_t fb[8][HOST_FB_SIZE];
+  double t[2], t0;
+  int pass, lev, n;
+  bool same=true;
+
+  dgctx->game.curplayer=0;
+  for (pass=0;pass<2;pass++) {
+    t[pass]=0;
+    for (lev=1;lev<=8;lev++) {
+      dgctx->main.gamedat[0].level=lev;
+      makefield();
+      creatembspr();
+      ddap->gclear();
+      t0=wallclock();
+      for (n=0;n<BENCHLEVELS;n++)
+        if (pass==0)
+          drawstaticsref(ddap);
+        else
+          drawstatics(ddap);
+      t[pass]+=wallclock()-t0;
+      if (pass==0)
+        memcpy(fb[lev-1], host_framebuffer(), HOST_FB_SIZE);
+      else if (memcmp(fb[lev-1], host_framebuffer(), HOST_FB_SIZE)!=0)
+        same=false;
+    }
+  }
+  printf("levels=%d tiles=%.1fus/level batched=%.1fus/level %s\n",
+   8 * BENCHLEVELS, t[0] / (8 * BENCHLEVELS) * 1e6,
+   t[1] / (8 * BENCHLEVELS) * 1e6, same ? "match" : "MISMATCH");
+  return same ? 0 : 1;
+}
+
+/* Play name0 and then name1 in fresh games, each set up by setup(), and
+   check that the screen is the same after every frame of both passes. */
+static bool
+playboth(char *name0, char *name1, const char *who,
+         void (*setup)(struct digger_ctx *, int), struct replay res[2])
+{
+  uint32_t *hash=NULL, h;
+  size_t nhash=0, i;
+  bool same=true, more;
+  int pass;
+
+  for (pass=0;pass<2;pass++) {
+    struct replay *r=&res[pass];
+
+    replay_open(r, who, pass==0 ? name0 : name1, false, true, setup, pass);
+    do {
+      more=replay_step(r);
+      h=2166136261u;
+      for (i=0;i<HOST_FB_SIZE;i++)
+        h=(h^host_framebuffer()[i])*16777619u;
+      if (pass==0) {
+        if ((nhash&(nhash-1))==0 && (hash=realloc(hash, (nhash ? nhash*2 : 1)*sizeof(*hash)))==NULL) {
+          fprintf(stderr, "%s: no memory\n", who);
+          exit(1);
+        }
+        hash[nhash++]=h;
+      }
+      else if (r->steps>nhash || hash[r->steps-1]!=h)
+        same=false;
+    } while (more);
+    replay_close(r);
+  }
+  free(hash);
+  return same && res[0].steps==res[1].steps;
+}
+
+/* Play a DRF twice, in the way setup() sets up for each pass */
+static bool
+playtwice(char *name, const char *who, void (*setup)(struct digger_ctx *, int),
+          struct replay res[2])
+{
+  return playboth(name, name, who, setup, res);
+}
+
+static void
+batchsetup(struct digger_ctx *ctx, int pass)
+{
+  ctx->sprbatch.on=(pass==1);
+  ctx->sprbatch.hud=(pass==1);
+}
+
+/* Play a DRF drawing each sprite move as it comes and the whole HUD on
+   every change, then batching the moves per frame and drawing only the
+   HUD cells that changed. Report the pixels sprite.c and the HUD wrote per
+   step, the time taken by each and the steps in which the HUD drew. */
+static int
+benchbatch(char *name)
+{
+  struct replay r[2];
+  bool same=playtwice(name, "benchbatch", batchsetup, r);
+
+  printf("frames=%u steps=%u single=%.0fpx/step %.2fus/step "
+   "batched=%.0fpx/step %.2fus/step hud=%.1fpx/step in %u steps "
+   "changed=%.1fpx/step in %u steps %s\n", (unsigned int)r[1].getframe,
+   (unsigned int)r[1].steps,
+   r[0].pixels / r[0].steps, r[0].t / r[0].steps * 1e6,
+   r[1].pixels / r[1].steps, r[1].t / r[1].steps * 1e6,
+   r[0].hud / r[0].steps, (unsigned int)r[0].hudsteps,
+   r[1].hud / r[1].steps, (unsigned int)r[1].hudsteps,
+   same ? "match" : "MISMATCH");
+  return same ? 0 : 1;
+}
+
+static void
+soundsetup(struct digger_ctx *ctx, int pass)
+{
+  ctx->host.audio_fill=true;
+  ctx->host.audio_persample=(pass==0);
+  ctx->host.audio_hash=2166136261u;
+}
+
+/* Play a DRF making its sound a sample at a time, then in runs, and check
+   that both give the same samples. Report host_cycles() per second of
+   sound for each. */
+static int
+benchsoundplay(char *name)
+{
+  struct replay r[2];
+  bool same=playtwice(name, "benchsound", soundsetup, r);
+  double secs[2];
+  int pass;
+
+  same=same && r[0].samples==r[1].samples && r[0].audiohash==r[1].audiohash;
+  for (pass=0;pass<2;pass++)
+    secs[pass]=(r[pass].samples ? r[pass].samples : 1) / (double)BENCHSRATE;
+  printf("frames=%u samples=%llu persample=%.0fcycles/s runs=%.0fcycles/s "
+   "hash=%08x/%08x %s\n", (unsigned int)r[1].getframe,
+   (unsigned long long)r[1].samples, r[0].cycles / secs[0],
+   r[1].cycles / secs[1], (unsigned int)r[0].audiohash,
+   (unsigned int)r[1].audiohash, same ? "match" : "MISMATCH");
+  return same ? 0 : 1;
+}
+
+static void
+nosetup(struct digger_ctx *ctx, int pass)
+{
+  (void)ctx;
+  (void)pass;
+}
+
+#define RINGVSYNC 60              /* Hz the device's ticks are paced to */
+#define RINGMAXBUFS 16            /* AUDIO_MAX_BUFFERS */
+#define RINGPOOL 8192             /* AUDIO_POOL_SAMPLES */
+
+static struct spkfeed ringfeed;
+
+static void
+ringsetup(struct digger_ctx *ctx, int pass)
+{
+  (void)pass;
+  ctx->host.audio_fill=true;
+  spkfeed_init(&ringfeed, BENCHSRATE);
+  ctx->host.audio_feed=&ringfeed;
+}
+
+/* Play a DRF with its sound queued as on the device, and the queue emptied
+   by a DMA ring of count buffers of size samples, each filled as the one
+   before it finishes playing. Ticks are a whole number of vsyncs, ftime
+   apart on average, as with VSYNC_PACING on the device.
+   arg is "file,count,size". Report the buffers that were filled short, the
+   settings the queue dropped, the fewest and mean samples queued at a fill,
+   and the latency from a tick's sound being made to it being heard. */
+static int
+benchring(char *arg)
+{
+  static int16_t buf[RINGPOOL*2];
+  struct replay r;
+  struct spkfeed_stats fs;
+  char *p=strchr(arg, ',');
+  uint32_t count, size, buffers=0, under=0, i;
+  uint64_t err=0, clock=0, next, step;
+  bool more;
+
+  if (p==NULL) {
+    fprintf(stderr, "benchring: expected file,count,samples\n");
+    return 1;
+  }
+  *p++=0;
+  count=strtoul(p, &p, 10);
+  size=(*p==',') ? strtoul(p+1, NULL, 10) : 0;
+  if (count<2 || count>RINGMAXBUFS || size==0 || count*size>RINGPOOL) {
+    fprintf(stderr, "benchring: 2 to %d buffers of up to %d samples in all\n",
+     RINGMAXBUFS, RINGPOOL);
+    return 1;
+  }
+  replay_open(&r, "benchring", arg, false, true, ringsetup, 0);
+
+  /* The first tick is queued as the ring starts with every buffer filled;
+     from then on a buffer is filled each time one finishes */
+  more=replay_step(&r);
+  for (i=0;i<count;i++)
+    spkfeed_fill(&ringfeed, buf, size, 2);
+  next=size;
+  while (more) {
+    step=err+(uint64_t)dgctx->game.ftime*RINGVSYNC;
+    err=step%1000000;
+    clock+=step/1000000*(BENCHSRATE/RINGVSYNC);
+    for (;next<=clock;next+=size) {
+      if (spkfeed_fill(&ringfeed, buf, size, 2)<size)
+        under++;
+      buffers++;
+    }
+    more=replay_step(&r);
+  }
+  spkfeed_getstats(&ringfeed, &fs, false);
+  r.ctx->host.audio_feed=NULL;
+  replay_close(&r);
+
+  printf("frames=%u ring=%ux%u buffers=%u underruns=%u dropped=%u "
+   "minqueued=%u meanqueued=%.0f latency=%.1fms\n", (unsigned int)r.getframe,
+   (unsigned int)count, (unsigned int)size, (unsigned int)buffers,
+   (unsigned int)under, (unsigned int)fs.dropped,
+   (unsigned int)(fs.fills ? fs.minqueued : 0),
+   fs.fills ? (double)fs.queued / fs.fills : 0.0,
+   ((fs.fills ? (double)fs.queued / fs.fills : 0.0) + (count-1)*size)
+   * 1000.0 / BENCHSRATE);
+  return 0;
+}
+
+#define BENCHSTEPS 2000
+
+/* Step a batch of games with random input BENCHSTEPS times and report
+   the combined env-steps per second. arg is "games[,threads]". */
+static int
+benchenv(char *arg)
+{
+  struct dgenv *env;
+  struct dgenv_input *in;
+  int32_t *reward, total=0;
+  bool *done;
+  int ngames, nthreads=0, i, n, ndone=0;
+  uint32_t r=1;
+  double t0, t1;
+
+  ngames=atoi(arg);
+  if (strchr(arg, ',') != NULL)
+    nthreads=atoi(strchr(arg, ',')+1);
+  env=dgenv_create(ngames, nthreads, 1);
+  in=calloc(ngames, sizeof(*in));
+  reward=calloc(ngames, sizeof(*reward));
+  done=calloc(ngames, sizeof(*done));
+  if (env==NULL || in==NULL || reward==NULL || done==NULL) {
+    fprintf(stderr, "benchenv: cannot set up %d games\n", ngames);
+    return 1;
+  }
+  t0=wallclock();
+  for (n=0;n<BENCHSTEPS;n++) {
+    for (i=0;i<ngames;i++) {
+      r=r*0x15a4e35l+1;
+      in[i].dir=((r>>16)%5==4) ? DIR_NONE : ((r>>16)%5)*2;
+      in[i].fire=((r>>24)&15)==0;
+    }
+    dgenv_step(env, in, reward, done, NULL);
+    for (i=0;i<ngames;i++) {
+      total+=reward[i];
+      ndone+=done[i];
+    }
+  }
+  t1=wallclock();
+  printf("games=%d steps=%d wall=%.3fs env-steps/s=%.0f reward=%ld episodes=%d\n",
+   ngames, BENCHSTEPS, t1 - t0, (double)ngames * BENCHSTEPS / (t1 - t0),
+   (long)total, ndone);
+  dgenv_destroy(env);
+  free(in);
+  free(reward);
+  free(done);
+  return 0;
+}
+
+/* A growing buffer for drf2_fromtext() and drf2_totext() to write into */
+struct membuf {
+  uint8_t *p;
+  size_t len,size;
+};
+
+static bool
+memsink(void *arg, const void *buf, size_t len)
+{
+  struct membuf *m=arg;
+  uint8_t *p;
+
+  if (m->len+len>m->size) {
+    p=realloc(m->p, (m->len+len)*2);
+    if (p==NULL)
+      return false;
+    m->p=p;
+    m->size=(m->len+len)*2;
+  }
+  memcpy(m->p+m->len, buf, len);
+  m->len+=len;
+  return true;
+}
+
+static bool
+loadfile(const char *name, struct membuf *m)
+{
+  FILE *f=fopen(name, "rb");
+  uint8_t buf[4096];
+  size_t n;
+  bool ok=true;
+
+  memset(m, 0, sizeof(*m));
+  if (f==NULL)
+    return false;
+  while (ok && (n=fread(buf, 1, sizeof(buf), f))>0)
+    ok=memsink(m, buf, n);
+  ok=!ferror(f) && ok;
+  fclose(f);
+  return ok;
+}
+
+/* Convert a recording between text and binary, then check that the binary
+   one survives being turned into text and back unchanged, and that the text
+   and the binary player run the same game from the two: every frame the
+   same, and the same frame count, score and level at the end. arg is
+   "in,out". */
+static int
+convert(char *arg)
+{
+  char *out=strchr(arg, ',');
+  struct membuf bin, txt={NULL,0,0}, again={NULL,0,0};
+  struct replay r[2];
+  bool same, played;
+
+  if (out==NULL) {
+    fprintf(stderr, "Usage: /D:input.drf,output.drf\n");
+    return 1;
+  }
+  *out++=0;
+  if (!drfconvert(arg, out)) {
+    fprintf(stderr, "Cannot convert %s\n", arg);
+    return 1;
+  }
+  if (!loadfile(arg, &bin) || !drf2_detect(bin.p, bin.len)) {
+    free(bin.p);
+    if (!loadfile(out, &bin)) {
+      fprintf(stderr, "Cannot read %s\n", out);
+      return 1;
+    }
+  }
+  same=drf2_totext(bin.p, bin.len, memsink, &txt) &&
+    drf2_fromtext((char *)txt.p, txt.len, memsink, &again) &&
+    again.len==bin.len && memcmp(again.p, bin.p, bin.len)==0;
+  printf("binary=%lu text=%lu %s\n", (unsigned long)bin.len,
+   (unsigned long)txt.len, same ? "match" : "MISMATCH");
+  free(bin.p);
+  free(txt.p);
+  free(again.p);
+  played=playboth(arg, out, "convert", nosetup, r) &&
+    r[0].getframe==r[1].getframe && r[0].score==r[1].score &&
+    r[0].level==r[1].level;
+  printf("frames=%u/%u score=%d/%d level=%d/%d %s\n",
+   (unsigned int)r[0].getframe, (unsigned int)r[1].getframe,
+   (int)r[0].score, (int)r[1].score, r[0].level, r[1].level,
+   played ? "match" : "MISMATCH");
+  return same && played ? 0 : 1;
+}
+
+int
+hostbench(int argch, char *arg)
+{
+  int rval;
+
+  switch (argch) {
+  case 'T':
+    rval=benchplay(arg);
+    finish();
+    return rval;
+  case 'J':
+    rval=benchseek(arg);
+    finish();
+    return rval;
+  case 'W':
+    rval=benchrewind(arg);
+    finish();
+    return rval;
+  case 'B':
+    return benchenv(arg);
+  case 'F':
+    return benchtext();
+  case '1':
+    if (strchr(arg, ',')!=NULL)
+      return benchring(arg);
+    if (arg[0]!=0)
+      return benchsoundplay(arg);
+    return benchsound();
+  case 'A':
+    return benchsprites();
+  case 'N':
+    return benchline();
+  case 'Y':
+    return benchbatch(arg);
+  case 'Z':
+    maininit();
+    return benchlevel();
+  case 'D':
+    return convert(arg);
+  }
+  return -1;
+}
@@ -0,0 +1,306 @@
+/*
+ * host_env.c - Batched Game Environments for Bots and Play-Testing
+ *
+ * Every game owns a digger_ctx and is stepped one digger_step() at a time.
+ * A batch step is spread over a small thread pool: each worker starts on
+ * its own slice of the games and, once that is drained, steals games from
+ * the other slices, so a slow level end or death animation in one game
+ * does not leave the remaining cores idle.
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "def.h"
+#include "digger_types.h"
+#include "game_ctx.h"
+#include "main.h"
+#include "digger.h"
+#include "scores.h"
+#include "record.h"
+#include "input.h"
+#include "monster_obj.h"
+#include "host_env.h"
+
+struct dgenv_game {
+    struct digger_ctx *ctx;
+    uint32_t seed;
+    bool done;
+};
+
+struct dgenv_worker {
+    pthread_t tid;
+    struct dgenv *env;
+    int id;
+    atomic_int next;            /* next unclaimed game of this slice */
+    int end;
+};
+
+struct dgenv {
+    int ngames, nthreads;
+    struct dgenv_game *games;
+    struct dgenv_worker *workers;
+
+    pthread_mutex_t lock;
+    pthread_cond_t go, idle;
+    unsigned int gen;           /* bumped once per batch step */
+    int busy;                   /* helper threads still working */
+    bool quit;
+
+    const struct dgenv_input *in;
+    int32_t *reward;
+    bool *done;
+    struct dgenv_obs *obs;
+};
+
+/* Start a new one-player game and run it up to its first frame */
+static void env_reset(struct dgenv_game *g)
+{
+    dgctx->game.nplayers = 1;
+    dgctx->game.diggers = 1;
+    dgctx->game.startlev = 1;
+    dgctx->game.gauntlet = false;
+    dgctx->input.escape = false;
+    recinit();
+    /* Keep bots off the high score table and its initials prompt */
+    dgctx->record.drfvalid = false;
+    dgctx->main.randseed = g->seed;
+    startgame();
+    digger_step(NULL);
+    g->done = false;
+}
+
+static void env_observe(struct dgenv_obs *obs)
+{
+    struct digger_state *ds = &dgctx->digger;
+    struct obj_position pos;
+    int i;
+
+    memcpy(obs->field, dgctx->drawing.field, sizeof(obs->field));
+    memset(obs->emerald, 0, sizeof(obs->emerald));
+    for (i = 0; i < MSIZE; i++)
+        if (ds->emfield[i] & ds->emmask)
+            obs->emerald[i >> 3] |= 1 << (i & 7);
+    obs->digger.x = ds->digdat[0].dob.x;
+    obs->digger.y = ds->digdat[0].dob.y;
+    obs->digger.dir = ds->digdat[0].dob.dir;
+    obs->digger.alive = ds->digdat[0].dob.alive;
+    for (i = 0; i < MONSTERS; i++) {
+        struct monster *m = &dgctx->monster.mondat[i];
+
+        obs->monster[i].exist = m->flag;
+        obs->monster[i].nobbin = false;
+        obs->monster[i].x = obs->monster[i].y = 0;
+        if (m->flag && m->mop != NULL) {
+            CALL_METHOD(m->mop, getpos, &pos);
+            obs->monster[i].x = pos.x;
+            obs->monster[i].y = pos.y;
+            obs->monster[i].nobbin = CALL_METHOD(m->mop, isnobbin);
+        }
+    }
+    for (i = 0; i < BAGS; i++) {
+        obs->bag[i].exist = dgctx->bags.bagdat[i].exist;
+        obs->bag[i].x = dgctx->bags.bagdat[i].x;
+        obs->bag[i].y = dgctx->bags.bagdat[i].y;
+    }
+    obs->score = gettscore(0);
+    obs->level = levno();
+    obs->lives = getlives(0);
+}
+
+/* One frame of game i; runs on whichever thread claimed it */
+static void env_step_one(struct dgenv *env, int i)
+{
+    struct dgenv_game *g = &env->games[i];
+    const struct dgenv_input *in = &env->in[i];
+    struct digger_input din = {0};
+    int32_t score;
+
+    dgctx_bind(g->ctx);
+    if (g->done)
+        env_reset(g);
+    /* keycodes[0..3] are right, up, left, down: DIR_* >> 1 */
+    if (in->dir != DIR_NONE)
+        din.held |= 1 << (in->dir >> 1);
+    if (in->fire)
+        din.held |= 1 << 4;
+    score = gettscore(0);
+    if (!digger_step(&din)) {
+        /* Carry the RNG on so the next episode differs */
+        g->seed = dgctx->game.randv;
+        g->done = true;
+    }
+    env->reward[i] = gettscore(0) - score;
+    env->done[i] = g->done;
+    if (env->obs != NULL)
+        env_observe(&env->obs[i]);
+}
+
+static void env_run(struct dgenv_worker *self)
+{
+    struct dgenv *env = self->env;
+    struct dgenv_worker *victim;
+    int i, k;
+
+    for (k = 0; k < env->nthreads; k++) {
+        victim = &env->workers[(self->id + k) % env->nthreads];
+        while ((i = atomic_fetch_add(&victim->next, 1)) < victim->end)
+            env_step_one(env, i);
+    }
+}
+
+static void *env_thread(void *arg)
+{
+    struct dgenv_worker *self = arg;
+    struct dgenv *env = self->env;
+    unsigned int seen = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&env->lock);
+        while (env->gen == seen && !env->quit)
+            pthread_cond_wait(&env->go, &env->lock);
+        if (env->quit) {
+            pthread_mutex_unlock(&env->lock);
+            return NULL;
+        }
+        seen = env->gen;
+        pthread_mutex_unlock(&env->lock);
+
+        env_run(self);
+
+        pthread_mutex_lock(&env->lock);
+        if (--env->busy == 0)
+            pthread_cond_signal(&env->idle);
+        pthread_mutex_unlock(&env->lock);
+    }
+}
+
+struct dgenv *dgenv_create(int ngames, int nthreads, uint32_t seed)
+{
+    struct dgenv *env;
+    struct digger_ctx *octx;
+    int i;
+
+    if (ngames <= 0)
+        return NULL;
+    if (nthreads <= 0)
+        nthreads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    if (nthreads > ngames)
+        nthreads = ngames;
+    if (nthreads <= 0)
+        nthreads = 1;
+
+    env = calloc(1, sizeof(*env));
+    if (env == NULL)
+        return NULL;
+    env->ngames = ngames;
+    env->nthreads = nthreads;
+    env->games = calloc(ngames, sizeof(*env->games));
+    env->workers = calloc(nthreads, sizeof(*env->workers));
+    if (env->games == NULL || env->workers == NULL)
+        goto fail;
+
+    octx = dgctx;
+    for (i = 0; i < ngames; i++) {
+        struct dgenv_game *g = &env->games[i];
+
+        g->ctx = dgctx_new();
+        if (g->ctx == NULL) {
+            dgctx_bind(octx);
+            goto fail;
+        }
+        dgctx_bind(g->ctx);
+        inigame();
+        g->ctx->host.audio_fill = false;
+        maininit();
+        recstop();
+        g->seed = seed + i;
+        env_reset(g);
+    }
+    dgctx_bind(octx);
+
+    pthread_mutex_init(&env->lock, NULL);
+    pthread_cond_init(&env->go, NULL);
+    pthread_cond_init(&env->idle, NULL);
+    for (i = 0; i < nthreads; i++) {
+        env->workers[i].env = env;
+        env->workers[i].id = i;
+        atomic_init(&env->workers[i].next, 0);
+    }
+    /* Worker 0 is the thread calling dgenv_step() */
+    for (i = 1; i < nthreads; i++)
+        pthread_create(&env->workers[i].tid, NULL, env_thread, &env->workers[i]);
+    return env;
+
+fail:
+    if (env->games != NULL)
+        for (i = 0; i < ngames; i++)
+            if (env->games[i].ctx != NULL)
+                dgctx_free(env->games[i].ctx);
+    free(env->games);
+    free(env->workers);
+    free(env);
+    return NULL;
+}
+
+void dgenv_step(struct dgenv *env, const struct dgenv_input *in,
+                int32_t *reward, bool *done, struct dgenv_obs *obs)
+{
+    struct digger_ctx *octx;
+    int i;
+
+    env->in = in;
+    env->reward = reward;
+    env->done = done;
+    env->obs = obs;
+    for (i = 0; i < env->nthreads; i++) {
+        atomic_store(&env->workers[i].next, i * env->ngames / env->nthreads);
+        env->workers[i].end = (i + 1) * env->ngames / env->nthreads;
+    }
+
+    octx = dgctx;
+    pthread_mutex_lock(&env->lock);
+    env->busy = env->nthreads - 1;
+    env->gen++;
+    pthread_cond_broadcast(&env->go);
+    pthread_mutex_unlock(&env->lock);
+
+    env_run(&env->workers[0]);
+
+    pthread_mutex_lock(&env->lock);
+    while (env->busy != 0)
+        pthread_cond_wait(&env->idle, &env->lock);
+    pthread_mutex_unlock(&env->lock);
+    dgctx_bind(octx);
+}
+
+void dgenv_destroy(struct dgenv *env)
+{
+    int i;
+
+    pthread_mutex_lock(&env->lock);
+    env->quit = true;
+    pthread_cond_broadcast(&env->go);
+    pthread_mutex_unlock(&env->lock);
+    for (i = 1; i < env->nthreads; i++)
+        pthread_join(env->workers[i].tid, NULL);
+    pthread_mutex_destroy(&env->lock);
+    pthread_cond_destroy(&env->go);
+    pthread_cond_destroy(&env->idle);
+
+    for (i = 0; i < env->ngames; i++)
+        dgctx_free(env->games[i].ctx);
+    free(env->games);
+    free(env->workers);
+    free(env);
+}
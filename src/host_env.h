@@ -0,0 +1,61 @@
+/*
+ * host_env.h - Batched Game Environments for Bots and Play-Testing
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __HOST_ENV_H
+#define __HOST_ENV_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "def.h"
+
+/* Player 1 input for one step: DIR_NONE/DIR_RIGHT/DIR_UP/DIR_LEFT/DIR_DOWN */
+struct dgenv_input {
+    int8_t dir;
+    bool fire;
+};
+
+/* Logical view of one game after a step; positions are in screen pixels */
+struct dgenv_obs {
+    int16_t field[MSIZE];       /* tunnel bits per cell, as drawing.c keeps them */
+    uint8_t emerald[(MSIZE + 7) / 8]; /* bit (y*MWIDTH+x) set if an emerald is left */
+    struct {
+        int16_t x, y, dir;
+        bool alive;
+    } digger;
+    struct {
+        int16_t x, y;
+        bool exist, nobbin;
+    } monster[MONSTERS];
+    struct {
+        int16_t x, y;
+        bool exist;
+    } bag[BAGS];
+    int32_t score;
+    int16_t level, lives;
+};
+
+struct dgenv;
+
+/*
+ * Create ngames independent one-player games stepped by nthreads workers
+ * (0 = one per online CPU). Game i is seeded from seed + i.
+ */
+struct dgenv *dgenv_create(int ngames, int nthreads, uint32_t seed);
+void dgenv_destroy(struct dgenv *env);
+
+/*
+ * Advance every game by one frame. in, reward, done and obs hold ngames
+ * entries each; obs may be NULL. A game that reported done is started
+ * over on its next step.
+ */
+void dgenv_step(struct dgenv *env, const struct dgenv_input *in,
+                int32_t *reward, bool *done, struct dgenv_obs *obs);
+
+#endif
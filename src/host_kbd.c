@@ -0,0 +1,117 @@
+/*
+ * host_kbd.c - Headless Host Keyboard Backend
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "def.h"
+#include "hardware.h"
+#include "input.h"
+#include "host.h"
+#include "game_ctx.h"
+#include "ps2kbd/hid_codes.h"
+
+/*
+ * Same default mapping as rp2350_kbd.c, so DRF files and injected HID
+ * codes behave identically on both targets.
+ */
+int keycodes[NKEYS][5] = {
+    {HID_KEY_ARROW_RIGHT, -2, -2, -2, -2},  /* P1 Right */
+    {HID_KEY_ARROW_UP,    -2, -2, -2, -2},  /* P1 Up */
+    {HID_KEY_ARROW_LEFT,  -2, -2, -2, -2},  /* P1 Left */
+    {HID_KEY_ARROW_DOWN,  -2, -2, -2, -2},  /* P1 Down */
+    {HID_KEY_F1,          -2, -2, -2, -2},  /* P1 Fire */
+    {HID_KEY_S,           -2, -2, -2, -2},  /* P2 Right */
+    {HID_KEY_W,           -2, -2, -2, -2},  /* P2 Up */
+    {HID_KEY_A,           -2, -2, -2, -2},  /* P2 Left */
+    {HID_KEY_Z,           -2, -2, -2, -2},  /* P2 Down */
+    {HID_KEY_TAB,         -2, -2, -2, -2},  /* P2 Fire */
+    {HID_KEY_T,           -2, -2, -2, -2},  /* Cheat */
+    {HID_KEY_KEYPAD_ADD,  -2, -2, -2, -2},  /* Accelerate */
+    {HID_KEY_KEYPAD_SUBTRACT, -2, -2, -2, -2},  /* Brake */
+    {HID_KEY_F7,          -2, -2, -2, -2},  /* Music toggle */
+    {HID_KEY_F9,          -2, -2, -2, -2},  /* Sound toggle */
+    {HID_KEY_F10,         -2, -2, -2, -2},  /* Exit */
+    {HID_KEY_SPACE,       -2, -2, -2, -2},  /* Pause */
+    {HID_KEY_N,           -2, -2, -2, -2},  /* Change mode */
+    {HID_KEY_F8,          -2, -2, -2, -2},  /* Save DRF */
+    {HID_KEY_BACKSPACE,   -2, -2, -2, -2},  /* Rewind */
+    {HID_KEY_F5,          -2, -2, -2, -2},  /* Replay */
+};
+
+void host_pushkey(int16_t scancode) {
+    if (dgctx->host.klen < HOST_KBLEN)
+        dgctx->host.kbuffer[dgctx->host.klen++] = scancode;
+}
+
+void host_setkey(uint8_t key, bool held) {
+    dgctx->host.keyheld[key] = held;
+}
+
+/*
+ * kbdfeed - Take one step's keyboard state from the caller of digger_step().
+ */
+void kbdfeed(const struct digger_input *in) {
+    int i;
+
+    for (i = 0; i < 10; i++)
+        host_setkey(keycodes[i][0], (in->held >> i) & 1);
+    for (i = 0; i < in->nkeys; i++)
+        host_pushkey(in->keys[i]);
+}
+
+bool GetAsyncKeyState(int key) {
+    return dgctx->host.keyheld[(uint8_t)key];
+}
+
+void initkeyb(void) {
+    dgctx->host.klen = 0;
+    memset(dgctx->host.keyheld, 0, sizeof(dgctx->host.keyheld));
+}
+
+void restorekeyb(void) {
+}
+
+/*
+ * getkey - Return the next queued key.
+ *
+ * There is nobody to wait for on the host, so an empty queue yields
+ * the Exit key instead of blocking forever.
+ */
+int16_t getkey(bool scancode) {
+    int16_t result;
+
+    if (dgctx->host.klen == 0)
+        return scancode ? keycodes[DKEY_EXT][0] : 27;
+
+    result = dgctx->host.kbuffer[0];
+    dgctx->host.klen--;
+    if (dgctx->host.klen > 0)
+        memmove(dgctx->host.kbuffer, dgctx->host.kbuffer + 1,
+                dgctx->host.klen * sizeof(dgctx->host.kbuffer[0]));
+
+    if (!scancode) {
+        if (result >= HID_KEY_A && result <= HID_KEY_Z)
+            return 'A' + (result - HID_KEY_A);
+        if (result >= HID_KEY_1 && result <= HID_KEY_9)
+            return '1' + (result - HID_KEY_1);
+        if (result == HID_KEY_0)
+            return '0';
+        if (result == HID_KEY_ENTER)
+            return 13;
+        return 0;
+    }
+
+    return result;
+}
+
+bool kbhit(void) {
+    return dgctx->host.klen > 0;
+}
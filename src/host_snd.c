@@ -0,0 +1,90 @@
+/*
+ * host_snd.c - Headless Host Sound Backend (null sink)
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "def.h"
+#include "device.h"
+#include "hardware.h"
+#include "newsnd.h"
+#include "spkfeed.h"
+#include "host.h"
+#include "game_ctx.h"
+
+/* The null sink is always there; shared by every game context */
+bool wave_device_available = true;
+
+/* Same per-frame sample budget as rp2350_snd.c, so soundint() fires at
+ * the same game frames on both targets (death and level-end waits
+ * depend on it). */
+#define AUDIO_SAMPLES_PER_FRAME HOST_AUDIO_SAMPLES
+
+bool setsounddevice(uint16_t samprate, uint16_t bufsize) {
+    (void)samprate;
+    (void)bufsize;
+    dgctx->host.audio_initialized = true;
+    return true;
+}
+
+bool initsounddevice(void) {
+    return true;
+}
+
+void pausesounddevice(bool p) {
+    dgctx->host.audio_paused = p;
+    if (dgctx->host.audio_feed != NULL)
+        spkfeed_pause(dgctx->host.audio_feed, p);
+}
+
+/*
+ * host_setaudiofill - Enable/disable waveform generation.
+ *
+ * With fill disabled the sample clock still advances, so soundint()
+ * runs on the same frames and game behaviour is unchanged.
+ */
+void host_setaudiofill(bool fill) {
+    dgctx->host.audio_fill = fill;
+}
+
+/*
+ * audio_fill_and_submit - Generate one frame of stereo samples, as the
+ * device does, and drop them. The time taken and a hash of the samples
+ * are kept for /1. With audio_feed set, queue the frame's speaker settings
+ * there instead, for a simulated DMA ring to play.
+ */
+void audio_fill_and_submit(void) {
+    if (!dgctx->host.audio_initialized || dgctx->host.audio_paused)
+        return;
+
+    if (!dgctx->host.audio_fill) {
+        skipsamples(AUDIO_SAMPLES_PER_FRAME);
+        return;
+    }
+
+    struct host_state *h = &dgctx->host;
+    uint64_t start;
+
+    if (h->audio_feed != NULL) {
+        feedsamples(h->audio_feed, AUDIO_SAMPLES_PER_FRAME, dgctx->game.ftime);
+        return;
+    }
+    start = host_cycles();
+
+    if (h->audio_persample) {
+        for (int i = 0; i < AUDIO_SAMPLES_PER_FRAME; i++)
+            h->audio_buf[i * 2] = h->audio_buf[i * 2 + 1] = getsample();
+    } else {
+        getsamples(h->audio_buf, AUDIO_SAMPLES_PER_FRAME, 2);
+    }
+    h->audio_cycles += host_cycles() - start;
+    h->audio_samples += AUDIO_SAMPLES_PER_FRAME;
+    for (int i = 0; i < AUDIO_SAMPLES_PER_FRAME * 2; i++)
+        h->audio_hash = (h->audio_hash ^ (uint16_t)h->audio_buf[i]) * 16777619u;
+}
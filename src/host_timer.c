@@ -0,0 +1,60 @@
+/*
+ * host_timer.c - Headless Host Timer Backend
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "def.h"
+#include "hardware.h"
+#include "host.h"
+
+void inittimer(void) {
+}
+
+/*
+ * gethrt - Frame synchronization.
+ *
+ * Never sleeps: the host runs the game logic as fast as it can.
+ */
+void gethrt(bool minsleep) {
+    (void)minsleep;
+}
+
+uint64_t host_cycles(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000u + ts.tv_nsec;
+#endif
+}
+
+int32_t getkips(void) {
+    return 1;
+}
+
+void olddelay(int16_t t) {
+    (void)t;
+}
+
+/* Sound hardware stubs (timer-based sound control not used on host) */
+void s0soundoff(void) {}
+void s0setspkrt2(void) {}
+void s0settimer0(uint16_t t0v) {}
+void s0settimer2(uint16_t t0v, bool mode) {}
+void s0timer0(uint16_t t0v) {}
+void s0timer2(uint16_t t0v, bool mode) {}
+void s0soundinitglob(void) {}
+void s0soundkillglob(void) {}
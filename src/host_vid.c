@@ -0,0 +1,179 @@
+/*
+ * host_vid.c - Headless Host Video Backend
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "def.h"
+#include "hardware.h"
+#include "draw_api.h"
+#include "alpha.h"
+#include "host.h"
+#include "game_ctx.h"
+#include "cgasprite.h"
+#include "cgatext.h"
+
+/*
+ * In-memory framebuffer, same pixel layout as the RP2350 HDMI buffer
+ * (4-bit nibble-packed, low nibble = even x) but only the 320x200 game
+ * area, so no vertical offset is applied.
+ */
+#define FB_STRIDE (HOST_FB_WIDTH / 2)
+
+static inline uint8_t fb_get_pixel(int x, int y) {
+    if (y < 0 || y >= HOST_FB_HEIGHT || x < 0 || x >= HOST_FB_WIDTH)
+        return 0;
+    uint8_t b = dgctx->host.framebuffer[y * FB_STRIDE + (x >> 1)];
+    if (x & 1)
+        return (b >> 4) & 0x0F;
+    else
+        return b & 0x0F;
+}
+
+/*
+ * host_framebuffer - Raw framebuffer access for harnesses and tools.
+ */
+uint8_t *host_framebuffer(void) {
+    return dgctx->host.framebuffer;
+}
+
+/*
+ * host_palette - Current CGA palette and intensity.
+ */
+void host_palette(int16_t *pal, int16_t *inten) {
+    *pal = dgctx->host.pal;
+    *inten = dgctx->host.inten;
+}
+
+/*
+ * cgagetpal - Current palette and intensity, for savestates
+ */
+void cgagetpal(int16_t *pal, int16_t *inten) {
+    host_palette(pal, inten);
+}
+
+/* The framebuffer, for the sprite and text blitters */
+static inline struct cgafb hostfb(void) {
+    struct cgafb fb = {
+        dgctx->host.framebuffer, FB_STRIDE, HOST_FB_WIDTH, HOST_FB_HEIGHT, 0
+    };
+
+    return fb;
+}
+
+void cgainit(void) {
+    cgaspr_init();
+    cgatext_init();
+    memset(dgctx->host.framebuffer, 0, sizeof(dgctx->host.framebuffer));
+}
+
+void cgaclear(void) {
+    memset(dgctx->host.framebuffer, 0, sizeof(dgctx->host.framebuffer));
+}
+
+void cgapal(int16_t pal) {
+    dgctx->host.pal = pal;
+}
+
+void cgainten(int16_t inten) {
+    dgctx->host.inten = inten;
+}
+
+/*
+ * cgaputi - Copy raw 4-bit packed pixels from buffer p to framebuffer
+ */
+void cgaputi(int16_t x, int16_t y, uint8_t *p, int16_t w, int16_t h) {
+    int buf_stride = w * 2;
+
+    for (int row = 0; row < h; row++) {
+        if (y + row < 0 || y + row >= HOST_FB_HEIGHT)
+            continue;
+        memcpy(&dgctx->host.framebuffer[(y + row) * FB_STRIDE + (x >> 1)],
+               &p[row * buf_stride], buf_stride);
+    }
+}
+
+/*
+ * cgageti - Copy 4-bit packed pixels from framebuffer to buffer p
+ */
+void cgageti(int16_t x, int16_t y, uint8_t *p, int16_t w, int16_t h) {
+    int buf_stride = w * 2;
+
+    for (int row = 0; row < h; row++) {
+        if (y + row < 0 || y + row >= HOST_FB_HEIGHT)
+            continue;
+        memcpy(&p[row * buf_stride],
+               &dgctx->host.framebuffer[(y + row) * FB_STRIDE + (x >> 1)], buf_stride);
+    }
+}
+
+/*
+ * cgaputim - Draw CGA sprite with mask, same semantics as rp2350_vid.c
+ */
+void cgaputim(int16_t x, int16_t y, int16_t ch, int16_t w, int16_t h) {
+    struct cgafb fb = hostfb();
+
+    cgaspr_put(&fb, x, y, ch, w, h);
+}
+
+/*
+ * cgagetpix - Read 4 pixels as a CGA byte, MSB = leftmost pixel
+ */
+int16_t cgagetpix(int16_t x, int16_t y) {
+    int16_t rval = 0;
+
+    if (x < 0 || x > 319 || y < 0 || y > 199)
+        return 0xff;
+
+    for (int xi = 0; xi < 4; xi++)
+        rval |= (fb_get_pixel(x + xi, y) & 0x03) << (6 - xi * 2);
+
+    return rval;
+}
+
+/*
+ * cgawrite - Draw text character from the CGA alpha font
+ */
+void cgawrite(int16_t x, int16_t y, int16_t ch, int16_t c) {
+    struct cgafb fb = hostfb();
+
+    cgatext_put(&fb, x, y, ch, c);
+}
+
+/*
+ * cgafill - Set a rectangle to colour c
+ */
+void cgafill(int16_t x, int16_t y, int16_t w, int16_t h, int16_t c) {
+    struct cgafb fb = hostfb();
+
+    cgatext_fill(&fb, x, y, w, h, c);
+}
+
+/*
+ * cgatitle - Title screen border, same geometry as rp2350_vid.c
+ */
+void cgatitle(void) {
+    cgaclear();
+
+    cgafill(4, 16, 314, 3, 2);
+    cgafill(4, 183, 314, 3, 2);
+    cgafill(4, 16, 3, 170, 2);
+    cgafill(315, 16, 3, 170, 2);
+    cgafill(159, 16, 3, 170, 2);
+}
+
+void doscreenupdate(void) {
+}
+
+void graphicsoff(void) {
+}
+
+void gretrace(void) {
+}
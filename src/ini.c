@@ -1,8 +1,8 @@
 /* Digger Remastered
    Copyright (c) Andrew Jenner 1998-2004 */
 
-#ifdef _RP2350
-/* On RP2350, INI functions are no-ops that return defaults */
+#if defined(_RP2350) || defined(_HOST)
+/* On RP2350 and host, INI functions are no-ops that return defaults */
 #include <string.h>
 #include <stdlib.h>
 #include "def.h"
@@ -30,7 +30,7 @@ bool GetINIBool(const char *section,const char*key,bool def,const char*filename)
 
 void WriteINIBool(const char *section,const char*key,bool value,const char *filename) {}
 
-#else /* !_RP2350 */
+#else /* !_RP2350 && !_HOST */
 
 #include <stdio.h>
 #include <string.h>
@@ -218,4 +218,4 @@ void WriteINIBool(const char *section,const char*key,bool value,
   WriteINIString(section,key,value ? "True" : "False",filename);
 }
 
-#endif /* !_RP2350 */
+#endif /* !_RP2350 && !_HOST */
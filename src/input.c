@@ -8,29 +8,12 @@
 #include "hardware.h"
 #include "record.h"
 #include "digger.h"
-#include "game.h"
+#include "game_ctx.h"
 #include "rp2350_kbd.h"
 
 /* global variables first */
-bool escape=false,firepflag=false,fire2pflag=false,pausef=false,mode_change=false;
 bool krdf[NKEYS]={false,false,false,false,false,false,false,false,false,false,
-               false,false,false,false,false,false,false,false};
-
-static bool aleftpressed=false,arightpressed=false,
-     auppressed=false,adownpressed=false,start=false,af1pressed=false;
-static bool aleft2pressed=false,aright2pressed=false,
-     aup2pressed=false,adown2pressed=false,af12pressed=false;
-
-int16_t akeypressed;
-
-static int16_t dynamicdir=-1,dynamicdir2=-1,staticdir=-1,staticdir2=-1,joyx=0,joyy=0;
-
-static bool joybut1=false;
-
-static int16_t keydir=0,keydir2=0,jleftthresh=0,jupthresh=0,jrightthresh=0,
-      jdownthresh=0,joyanax=0,joyanay=0;
-
-static bool joyflag=false;
+               false,false,false,false,false,false,false,false,false,false};
 
 void readjoy(void);
 
@@ -44,76 +27,83 @@ void readjoy(void);
    other way around. */
 void checkkeyb(void)
 {
+  struct input_state *st=&dgctx->input;
   int i,j,k=0;
-  bool *aflagp[10]={&arightpressed,&auppressed,&aleftpressed,&adownpressed,
-                    &af1pressed,&aright2pressed,&aup2pressed,&aleft2pressed,
-                    &adown2pressed,&af12pressed};
+  bool *aflagp[10]={&st->arightpressed,&st->auppressed,&st->aleftpressed,&st->adownpressed,
+                    &st->af1pressed,&st->aright2pressed,&st->aup2pressed,&st->aleft2pressed,
+                    &st->adown2pressed,&st->af12pressed};
   if (leftpressed)
-    aleftpressed=true;
+    st->aleftpressed=true;
   if (rightpressed)
-    arightpressed=true;
+    st->arightpressed=true;
   if (uppressed)
-    auppressed=true;
+    st->auppressed=true;
   if (downpressed)
-    adownpressed=true;
+    st->adownpressed=true;
   if (f1pressed)
-    af1pressed=true;
+    st->af1pressed=true;
   if (left2pressed)
-    aleft2pressed=true;
+    st->aleft2pressed=true;
   if (right2pressed)
-    aright2pressed=true;
+    st->aright2pressed=true;
   if (up2pressed)
-    aup2pressed=true;
+    st->aup2pressed=true;
   if (down2pressed)
-    adown2pressed=true;
+    st->adown2pressed=true;
   if (f12pressed)
-    af12pressed=true;
+    st->af12pressed=true;
 
   while (kbhit()) {
-    akeypressed=getkey(true);
+    st->akeypressed=getkey(true);
     for (i=0;i<10;i++)
       for (j=2;j<5;j++)
-        if (akeypressed==keycodes[i][j])
+        if (st->akeypressed==keycodes[i][j])
           *aflagp[i]=true;
     for (i=10;i<NKEYS;i++)
       for (j=0;j<5;j++)
-        if (akeypressed==keycodes[i][j])
+        if (st->akeypressed==keycodes[i][j])
           k=i;
     switch (k) {
       case DKEY_CHT: /* Cheat! */
-        if (!dgstate.gauntlet) {
-          playing=false;
-          drfvalid=false;
+        if (!dgctx->game.gauntlet) {
+          dgctx->record.playing=false;
+          dgctx->record.drfvalid=false;
         }
         break;
       case DKEY_SUP: /* Increase speed */
-        if (dgstate.ftime>10000l)
-          dgstate.ftime-=10000l;
+        if (dgctx->game.ftime>10000l)
+          dgctx->game.ftime-=10000l;
         break;
       case DKEY_SDN: /* Decrease speed */
-        dgstate.ftime+=10000l;
+        dgctx->game.ftime+=10000l;
         break;
       case DKEY_MTG: /* Toggle music */
-        musicflag=!musicflag;
+        dgctx->sound.musicflag=!dgctx->sound.musicflag;
         break;
       case DKEY_STG: /* Toggle sound */
-        soundflag=!soundflag;
+        dgctx->sound.soundflag=!dgctx->sound.soundflag;
         break;
       case DKEY_EXT: /* Exit */
-        escape=true;
+        st->escape=true;
         break;
       case DKEY_PUS: /* Pause */
-        pausef=true;
+        st->pausef=true;
         break;
       case DKEY_MCH: /* Mode change */
-        mode_change=true;
+        st->mode_change=true;
         break;
       case DKEY_SDR: /* Save DRF */
-        savedrf=true;
+        dgctx->record.savedrf=true;
+        break;
+      case DKEY_RWD: /* Rewind */
+        st->rewindf=true;
+        break;
+      case DKEY_PLY: /* Replay */
+        st->replayf=true;
         break;
     }
-    if (!mode_change)
-      start=true;                                /* Change number of players */
+    if (!st->mode_change)
+      st->start=true;                                /* Change number of players */
   }
 }
 
@@ -125,130 +115,131 @@ void readjoy(void)
 
 void detectjoy(void)
 {
-  joyflag=false;
-  staticdir=dynamicdir=DIR_NONE;
+  struct input_state *st=&dgctx->input;
+  st->joyflag=false;
+  st->staticdir=st->dynamicdir=DIR_NONE;
 }
 
 /* Contrary to some beliefs, you don't need a separate OS call to flush the
    keyboard buffer. */
 void flushkeybuf(void)
 {
+  struct input_state *st=&dgctx->input;
   while (kbhit())
     getkey(true);
-  aleftpressed=arightpressed=auppressed=adownpressed=af1pressed=false;
-  aleft2pressed=aright2pressed=aup2pressed=adown2pressed=af12pressed=false;
+  st->aleftpressed=st->arightpressed=st->auppressed=st->adownpressed=st->af1pressed=false;
+  st->aleft2pressed=st->aright2pressed=st->aup2pressed=st->adown2pressed=st->af12pressed=false;
 }
 
 void clearfire(int n)
 {
+  struct input_state *st=&dgctx->input;
   if (n==0)
-    af1pressed=false;
+    st->af1pressed=false;
   else
-    af12pressed=false;
+    st->af12pressed=false;
 }
 
-bool oupressed=false,odpressed=false,olpressed=false,orpressed=false;
-bool ou2pressed=false,od2pressed=false,ol2pressed=false,or2pressed=false;
-
 void readdirect(int n)
 {
+  struct input_state *st=&dgctx->input;
   int16_t j;
   bool u=false,d=false,l=false,r=false;
   bool u2=false,d2=false,l2=false,r2=false;
 
   if (n==0) {
-    if (auppressed || uppressed) { u=true; auppressed=false; }
-    if (adownpressed || downpressed) { d=true; adownpressed=false; }
-    if (aleftpressed || leftpressed) { l=true; aleftpressed=false; }
-    if (arightpressed || rightpressed) { r=true; arightpressed=false; }
-    if (f1pressed || af1pressed) {
-      firepflag=true;
-      af1pressed=false;
+    if (st->auppressed || uppressed) { u=true; st->auppressed=false; }
+    if (st->adownpressed || downpressed) { d=true; st->adownpressed=false; }
+    if (st->aleftpressed || leftpressed) { l=true; st->aleftpressed=false; }
+    if (st->arightpressed || rightpressed) { r=true; st->arightpressed=false; }
+    if (f1pressed || st->af1pressed) {
+      st->firepflag=true;
+      st->af1pressed=false;
     }
     else
-      firepflag=false;
-    if (u && !oupressed)
-      staticdir=dynamicdir=DIR_UP;
-    if (d && !odpressed)
-      staticdir=dynamicdir=DIR_DOWN;
-    if (l && !olpressed)
-      staticdir=dynamicdir=DIR_LEFT;
-    if (r && !orpressed)
-      staticdir=dynamicdir=DIR_RIGHT;
-    if ((oupressed && !u && dynamicdir==DIR_UP) ||
-        (odpressed && !d && dynamicdir==DIR_DOWN) ||
-        (olpressed && !l && dynamicdir==DIR_LEFT) ||
-        (orpressed && !r && dynamicdir==DIR_RIGHT)) {
-      dynamicdir=DIR_NONE;
-      if (u) dynamicdir=staticdir=2;
-      if (d) dynamicdir=staticdir=6;
-      if (l) dynamicdir=staticdir=4;
-      if (r) dynamicdir=staticdir=0;
+      st->firepflag=false;
+    if (u && !st->oupressed)
+      st->staticdir=st->dynamicdir=DIR_UP;
+    if (d && !st->odpressed)
+      st->staticdir=st->dynamicdir=DIR_DOWN;
+    if (l && !st->olpressed)
+      st->staticdir=st->dynamicdir=DIR_LEFT;
+    if (r && !st->orpressed)
+      st->staticdir=st->dynamicdir=DIR_RIGHT;
+    if ((st->oupressed && !u && st->dynamicdir==DIR_UP) ||
+        (st->odpressed && !d && st->dynamicdir==DIR_DOWN) ||
+        (st->olpressed && !l && st->dynamicdir==DIR_LEFT) ||
+        (st->orpressed && !r && st->dynamicdir==DIR_RIGHT)) {
+      st->dynamicdir=DIR_NONE;
+      if (u) st->dynamicdir=st->staticdir=2;
+      if (d) st->dynamicdir=st->staticdir=6;
+      if (l) st->dynamicdir=st->staticdir=4;
+      if (r) st->dynamicdir=st->staticdir=0;
     }
-    oupressed=u;
-    odpressed=d;
-    olpressed=l;
-    orpressed=r;
-    keydir=staticdir;
-    if (dynamicdir!=DIR_NONE)
-      keydir=dynamicdir;
-    staticdir=DIR_NONE;
+    st->oupressed=u;
+    st->odpressed=d;
+    st->olpressed=l;
+    st->orpressed=r;
+    st->keydir=st->staticdir;
+    if (st->dynamicdir!=DIR_NONE)
+      st->keydir=st->dynamicdir;
+    st->staticdir=DIR_NONE;
   }
   else {
-    if (aup2pressed || up2pressed) { u2=true; aup2pressed=false; }
-    if (adown2pressed || down2pressed) { d2=true; adown2pressed=false; }
-    if (aleft2pressed || left2pressed) { l2=true; aleft2pressed=false; }
-    if (aright2pressed || right2pressed) { r2=true; aright2pressed=false; }
-    if (f12pressed || af12pressed) {
-      fire2pflag=true;
-      af12pressed=false;
+    if (st->aup2pressed || up2pressed) { u2=true; st->aup2pressed=false; }
+    if (st->adown2pressed || down2pressed) { d2=true; st->adown2pressed=false; }
+    if (st->aleft2pressed || left2pressed) { l2=true; st->aleft2pressed=false; }
+    if (st->aright2pressed || right2pressed) { r2=true; st->aright2pressed=false; }
+    if (f12pressed || st->af12pressed) {
+      st->fire2pflag=true;
+      st->af12pressed=false;
     }
     else
-      fire2pflag=false;
-    if (u2 && !ou2pressed)
-      staticdir2=dynamicdir2=DIR_UP;
-    if (d2 && !od2pressed)
-      staticdir2=dynamicdir2=DIR_DOWN;
-    if (l2 && !ol2pressed)
-      staticdir2=dynamicdir2=DIR_LEFT;
-    if (r2 && !or2pressed)
-      staticdir2=dynamicdir2=DIR_RIGHT;
-    if ((ou2pressed && !u2 && dynamicdir2==DIR_UP) ||
-        (od2pressed && !d2 && dynamicdir2==DIR_DOWN) ||
-        (ol2pressed && !l2 && dynamicdir2==DIR_LEFT) ||
-        (or2pressed && !r2 && dynamicdir2==DIR_RIGHT)) {
-      dynamicdir2=DIR_NONE;
-      if (u2) dynamicdir2=staticdir2=2;
-      if (d2) dynamicdir2=staticdir2=6;
-      if (l2) dynamicdir2=staticdir2=4;
-      if (r2) dynamicdir2=staticdir2=0;
+      st->fire2pflag=false;
+    if (u2 && !st->ou2pressed)
+      st->staticdir2=st->dynamicdir2=DIR_UP;
+    if (d2 && !st->od2pressed)
+      st->staticdir2=st->dynamicdir2=DIR_DOWN;
+    if (l2 && !st->ol2pressed)
+      st->staticdir2=st->dynamicdir2=DIR_LEFT;
+    if (r2 && !st->or2pressed)
+      st->staticdir2=st->dynamicdir2=DIR_RIGHT;
+    if ((st->ou2pressed && !u2 && st->dynamicdir2==DIR_UP) ||
+        (st->od2pressed && !d2 && st->dynamicdir2==DIR_DOWN) ||
+        (st->ol2pressed && !l2 && st->dynamicdir2==DIR_LEFT) ||
+        (st->or2pressed && !r2 && st->dynamicdir2==DIR_RIGHT)) {
+      st->dynamicdir2=DIR_NONE;
+      if (u2) st->dynamicdir2=st->staticdir2=2;
+      if (d2) st->dynamicdir2=st->staticdir2=6;
+      if (l2) st->dynamicdir2=st->staticdir2=4;
+      if (r2) st->dynamicdir2=st->staticdir2=0;
     }
-    ou2pressed=u2;
-    od2pressed=d2;
-    ol2pressed=l2;
-    or2pressed=r2;
-    keydir2=staticdir2;
-    if (dynamicdir2!=DIR_NONE)
-      keydir2=dynamicdir2;
-    staticdir2=DIR_NONE;
+    st->ou2pressed=u2;
+    st->od2pressed=d2;
+    st->ol2pressed=l2;
+    st->or2pressed=r2;
+    st->keydir2=st->staticdir2;
+    if (st->dynamicdir2!=DIR_NONE)
+      st->keydir2=st->dynamicdir2;
+    st->staticdir2=DIR_NONE;
   }
 
-  if (joyflag) {
+  if (st->joyflag) {
     incpenalty();
     incpenalty();
-    joyanay=0;
-    joyanax=0;
+    st->joyanay=0;
+    st->joyanax=0;
     for (j=0;j<4;j++) {
       readjoy();
-      joyanax+=joyx;
-      joyanay+=joyy;
+      st->joyanax+=st->joyx;
+      st->joyanay+=st->joyy;
     }
-    joyx=joyanax>>2;
-    joyy=joyanay>>2;
-    if (joybut1)
-      firepflag=true;
+    st->joyx=st->joyanax>>2;
+    st->joyy=st->joyanay>>2;
+    if (st->joybut1)
+      st->firepflag=true;
     else
-      firepflag=false;
+      st->firepflag=false;
   }
 }
 
@@ -256,48 +247,49 @@ void readdirect(int n)
    effectively if the user waggles the joystick in the title screen. */
 bool teststart(void)
 {
+  struct input_state *st=&dgctx->input;
   int16_t j;
   bool startf=false;
-  if (joyflag) {
+  if (st->joyflag) {
     readjoy();
-    if (joybut1)
+    if (st->joybut1)
       startf=true;
   }
-  if (start) {
-    start=false;
+  if (st->start) {
+    st->start=false;
     startf=true;
-    joyflag=false;
+    st->joyflag=false;
   }
   if (!startf)
     return false;
-  if (joyflag) {
-    joyanay=0;
-    joyanax=0;
+  if (st->joyflag) {
+    st->joyanay=0;
+    st->joyanax=0;
     for (j=0;j<50;j++) {
       readjoy();
-      joyanax+=joyx;
-      joyanay+=joyy;
+      st->joyanax+=st->joyx;
+      st->joyanay+=st->joyy;
     }
-    joyx=joyanax/50;
-    joyy=joyanay/50;
-    jleftthresh=joyx-35;
-    if (jleftthresh<0)
-      jleftthresh=0;
-    jleftthresh+=10;
-    jupthresh=joyy-35;
-    if (jupthresh<0)
-      jupthresh=0;
-    jupthresh+=10;
-    jrightthresh=joyx+35;
-    if (jrightthresh>255)
-      jrightthresh=255;
-    jrightthresh-=10;
-    jdownthresh=joyy+35;
-    if (jdownthresh>255)
-      jdownthresh=255;
-    jdownthresh-=10;
-    joyanax=joyx;
-    joyanay=joyy;
+    st->joyx=st->joyanax/50;
+    st->joyy=st->joyanay/50;
+    st->jleftthresh=st->joyx-35;
+    if (st->jleftthresh<0)
+      st->jleftthresh=0;
+    st->jleftthresh+=10;
+    st->jupthresh=st->joyy-35;
+    if (st->jupthresh<0)
+      st->jupthresh=0;
+    st->jupthresh+=10;
+    st->jrightthresh=st->joyx+35;
+    if (st->jrightthresh>255)
+      st->jrightthresh=255;
+    st->jrightthresh-=10;
+    st->jdownthresh=st->joyy+35;
+    if (st->jdownthresh>255)
+      st->jdownthresh=255;
+    st->jdownthresh-=10;
+    st->joyanax=st->joyx;
+    st->joyanay=st->joyy;
   }
   return true;
 }
@@ -306,29 +298,30 @@ bool teststart(void)
    mystery to me. */
 int16_t getdirect(int n)
 {
-  int16_t dir=((n==0) ? keydir : keydir2);
-  if (joyflag) {
+  struct input_state *st=&dgctx->input;
+  int16_t dir=((n==0) ? st->keydir : st->keydir2);
+  if (st->joyflag) {
     dir=DIR_NONE;
-    if (joyx<jleftthresh)
+    if (st->joyx<st->jleftthresh)
       dir=DIR_LEFT;
-    if (joyx>jrightthresh)
+    if (st->joyx>st->jrightthresh)
       dir=DIR_RIGHT;
-    if (joyx>=jleftthresh && joyx<=jrightthresh) {
-      if (joyy<jupthresh)
+    if (st->joyx>=st->jleftthresh && st->joyx<=st->jrightthresh) {
+      if (st->joyy<st->jupthresh)
         dir=DIR_UP;
-      if (joyy>jdownthresh)
+      if (st->joyy>st->jdownthresh)
         dir=DIR_DOWN;
     }
   }
   if (n==0) {
-    if (playing)
-      playgetdir(&dir,&firepflag);
-    recputdir(dir,firepflag);
+    if (dgctx->record.playing)
+      playgetdir(&dir,&st->firepflag);
+    recputdir(dir,st->firepflag);
   }
   else {
-    if (playing)
-      playgetdir(&dir,&fire2pflag);
-    recputdir(dir,fire2pflag);
+    if (dgctx->record.playing)
+      playgetdir(&dir,&st->fire2pflag);
+    recputdir(dir,st->fire2pflag);
   }
   return dir;
 }
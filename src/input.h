@@ -1,6 +1,11 @@
 /* Digger Remastered
    Copyright (c) Andrew Jenner 1998-2004 */
 
+#ifndef __INPUT_H
+#define __INPUT_H
+
+#include <stdint.h>
+
 void detectjoy(void);
 bool teststart(void);
 void readdirect(int n);
@@ -10,11 +15,8 @@ void flushkeybuf(void);
 void findkey(int kn);
 void clearfire(int n);
 
-extern bool firepflag,fire2pflag,escape;
-extern int8_t keypressed;
-extern int16_t akeypressed;
 
-#define NKEYS 19
+#define NKEYS 21
 
 #define DKEY_CHT 10 /* Cheat */
 #define DKEY_SUP 11 /* Increase speed */
@@ -25,7 +27,22 @@ extern int16_t akeypressed;
 #define DKEY_PUS 16 /* Pause */
 #define DKEY_MCH 17 /* Mode change */
 #define DKEY_SDR 18 /* Save DRF */
+#define DKEY_RWD 19 /* Rewind */
+#define DKEY_PLY 20 /* Replay */
 
 extern int keycodes[NKEYS][5];
 extern bool krdf[NKEYS];
-extern bool pausef,mode_change;
+
+/* Keyboard state for one digger_step(). Bit n of held is set while the
+   key of keycodes[n] is down, for the game keys 0-9 (right, up, left, down
+   and fire of player 1, then of player 2). keys are scancodes pressed since
+   the last step. */
+#define DIN_MAXKEYS 4
+
+struct digger_input {
+  uint16_t held;
+  int16_t nkeys;
+  int16_t keys[DIN_MAXKEYS];
+};
+
+#endif
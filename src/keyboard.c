@@ -14,12 +14,12 @@
 #include "ini.h"
 #include "keyboard.h"
 #include "main.h"
-#include "game.h"
+#include "game_ctx.h"
 
 const char *keynames[NKEYS]={"Right","Up","Left","Down","Fire",
                     "Right","Up","Left","Down","Fire",
                     "Cheat","Accel","Brake","Music","Sound","Exit","Pause",
-                    "Mode Change","Save DRF"};
+                    "Mode Change","Save DRF","Rewind","Replay"};
 
 #define FINDKEY_EX(i) {if (prockey(i) == -1) return;}
 
@@ -45,7 +45,7 @@ void redefkeyb(struct digger_draw_api *ddap, bool allf)
   outtext(ddap, "PRESS NEW KEY FOR",0,y,3);
   y+=CHR_H;
 
-  if (dgstate.diggers==2) {
+  if (dgctx->game.diggers==2) {
     outtext(ddap, "PLAYER 1:",0,y,3);
     y+=CHR_H;
   }
@@ -77,7 +77,7 @@ void redefkeyb(struct digger_draw_api *ddap, bool allf)
     }
   }
 
-  if (dgstate.diggers==2) {
+  if (dgctx->game.diggers==2) {
     outtext(ddap, "PLAYER 2:",0,y,3);
     y+=CHR_H;
     for (i=5;i<10;i++) {
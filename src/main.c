@@ -28,19 +28,14 @@ static const char copyright[]="Portions Copyright(c) 1983 Windmill Software Inc.
 #include "record.h"
 #include "main.h"
 #include "newsnd.h"
+#include "spkfeed.h"
 #include "ini.h"
 #include "draw_api.h"
-#include "game.h"
-
-static struct game
-{
-  int16_t level;
-  bool levdone;
-} gamedat[2];
-
-static bool levnotdrawn=false,alldead=false;
-static bool started;
-static int16_t penalty=0;
+#include "game_ctx.h"
+#include "rewind.h"
+#if defined(_HOST)
+#include "host.h"
+#endif
 
 #ifndef _RP2350
 FILE *digger_log = NULL;
@@ -51,7 +46,6 @@ static void switchnplayers(void);
 static void drawscreen(struct digger_draw_api *);
 static void initchars(void);
 static void checklevdone(void);
-static int16_t levno(void);
 static void calibrate(void);
 static void parsecmd(int argc,char *argv[]);
 static void initlevel(void);
@@ -60,9 +54,9 @@ static int getalllives(void);
 
 int16_t getlevch(int16_t x,int16_t y,int16_t l)
 {
-  if ((l==3 || l==4) && !dgstate.levfflag && dgstate.diggers==2 && y==9 && (x==6 || x==8))
+  if ((l==3 || l==4) && !dgctx->game.levfflag && dgctx->game.diggers==2 && y==9 && (x==6 || x==8))
     return 'H';
-  return dgstate.leveldat[l-1][y][x];
+  return dgctx->game.leveldat[l-1][y][x];
 }
 
 #ifdef INTDRF
@@ -79,162 +73,616 @@ game_dbg_info_emit(void)
    (unsigned int)getframe());
 }
 
-void game(void)
+/* Where digger_step() resumes: each place the game used to wait for the
+   next frame, and the steps between them */
+enum {
+  MS_IDLE,        /* nothing to run */
+  MS_TITLE,       /* draw the title screen */
+  MS_TITLEWAIT,   /* first frame of the title screen */
+  MS_ATTRACT,     /* title screen animation */
+  MS_TITLEDONE,   /* a key was pressed on the title screen */
+  MS_GAME,        /* start a new game */
+  MS_GAMELOOP,    /* next player or end of game */
+  MS_LEVELLOOP,   /* next level or life */
+  MS_LEVEL,       /* start a level */
+  MS_FLASH,       /* announce the player */
+  MS_LEVELGO,     /* level is drawn, start play */
+  MS_PLAY,        /* one frame of play */
+  MS_PAUSE,       /* paused, waiting for a key */
+  MS_UNPAUSE,     /* key pressed, resume play */
+  MS_ENDLEVEL,    /* level cleared or everybody died */
+  MS_SETTLE,      /* let the bags settle */
+  MS_LEVELEND,    /* tidy up the level */
+  MS_JINGLE,      /* level completed jingle */
+  MS_LEVELDONE,   /* account lives, advance the level */
+  MS_ENDGAME,     /* endofgame() screens */
+  MS_GAMEEND      /* game over, back to the title */
+};
+
+/* Set up lives, scores and the first level of each player for a new game.
+   Returns true if the current player should be announced first. */
+static bool newgame(void)
 {
-  int16_t t,c,i;
-  bool flashplayer=false;
-  if (dgstate.gauntlet) {
-    dgstate.cgtime=dgstate.gtime*1193181l;
-    dgstate.timeout=false;
+  struct main_state *st=&dgctx->main;
+  if (dgctx->game.gauntlet) {
+    dgctx->game.cgtime=dgctx->game.gtime*1193181l;
+    dgctx->game.timeout=false;
   }
   initlives();
-  gamedat[0].level=dgstate.startlev;
-  if (dgstate.nplayers==2)
-    gamedat[1].level=dgstate.startlev;
-  alldead=false;
+  st->gamedat[0].level=dgctx->game.startlev;
+  if (dgctx->game.nplayers==2)
+    st->gamedat[1].level=dgctx->game.startlev;
+  st->alldead=false;
   ddap->gclear();
-  dgstate.curplayer=0;
+  dgctx->game.curplayer=0;
   initlevel();
-  dgstate.curplayer=1;
+  dgctx->game.curplayer=1;
   initlevel();
   zeroscores();
-  bonusvisible=true;
-  if (dgstate.nplayers==2)
-    flashplayer=true;
-  dgstate.curplayer=0;
-  while (getalllives()!=0 && !escape && !dgstate.timeout) {
-    while (!alldead && !escape && !dgstate.timeout) {
-      initmbspr();
-
-      if (playing)
-        dgstate.randv=playgetrand();
-      else
-        dgstate.randv=0;
+  dgctx->digger.bonusvisible=true;
+  dgctx->game.curplayer=0;
+  return dgctx->game.nplayers==2;
+}
+
+static void flashframe(void)
+{
+  outtext(ddap, dgctx->game.pldispbuf,108,0,dgctx->main.modec);
+  writecurscore(ddap, dgctx->main.modec);
+}
+
+/* (Re)start the current level with dgstate.randv as the random seed. Returns
+   true if the player is to be announced first, see MS_FLASH. */
+static bool startlevel(void)
+{
+  struct main_state *st=&dgctx->main;
+  initmbspr();
 #ifdef INTDRF
-      fprintf(info,"%lu\n",dgstate.randv);
-      frame=0;
+  fprintf(info,"%lu\n",dgctx->game.randv);
+  frame=0;
 #endif
-      recputrand(dgstate.randv);
-      if (levnotdrawn) {
-        levnotdrawn=false;
-        drawscreen(ddap);
-        if (flashplayer) {
-          flashplayer=false;
-          strcpy(dgstate.pldispbuf,"PLAYER ");
-          if (dgstate.curplayer==0)
-            strcat(dgstate.pldispbuf,"1");
-          else
-            strcat(dgstate.pldispbuf,"2");
-          cleartopline();
-          for (t=0;t<15;t++)
-            for (c=1;c<=3;c++) {
-              outtext(ddap, dgstate.pldispbuf,108,0,c);
-              writecurscore(ddap, c);
-              newframe();
-              if (escape)
-                return;
-            }
-          drawscores(ddap);
-          for (i=0;i<dgstate.diggers;i++)
-            addscore(ddap, i,0);
-        }
-      }
+  recputrand(dgctx->game.randv);
+  if (st->levnotdrawn) {
+    st->levnotdrawn=false;
+    drawscreen(ddap);
+    if (st->flashplayer) {
+      st->flashplayer=false;
+      strcpy(dgctx->game.pldispbuf,"PLAYER ");
+      if (dgctx->game.curplayer==0)
+        strcat(dgctx->game.pldispbuf,"1");
       else
-        initchars();
-      erasetext(ddap, 8, 108,0,3);
-      initscores(ddap);
-      drawlives(ddap);
-      music(1, 1.0);
+        strcat(dgctx->game.pldispbuf,"2");
+      cleartopline();
+      st->modet=0;
+      st->modec=1;
+      flashframe();
+      return true;
+    }
+  }
+  else
+    initchars();
+  return false;
+}
 
-      flushkeybuf();
-      for (i=0;i<dgstate.diggers;i++)
-        readdirect(i);
-      while (!alldead && !gamedat[dgstate.curplayer].levdone && !escape && !dgstate.timeout) {
-        penalty=0;
-        dodigger(ddap);
-        domonsters(ddap);
-        dobags(ddap);
-        if (penalty>8)
-          incmont(penalty-8);
-        testpause();
-        checklevdone();
-      }
-      erasediggers();
-      musicoff();
-      t=20;
-      while ((getnmovingbags()!=0 || t!=0) && !escape && !dgstate.timeout) {
-        if (t!=0)
-          t--;
-        penalty=0;
-        dobags(ddap);
-        dodigger(ddap);
-        domonsters(ddap);
-        if (penalty<8)
-          t=0;
-      }
-      soundstop();
-      for (i=0;i<dgstate.diggers;i++)
-        killfire(i);
-      erasebonus(ddap);
-      cleanupbags();
-      savefield();
-      erasemonsters();
-      recputeol();
-      if (playing)
-        playskipeol();
-      if (escape)
-        recputeog();
-      if (gamedat[dgstate.curplayer].levdone) {
-        soundlevdone();
-        if (getenv("DIGGER_CI_RUN_DTL") != NULL) {
-          game_dbg_info_emit();
-        }
-      }
-      if (countem()==0 || gamedat[dgstate.curplayer].levdone) {
+static void beginlevel(void)
+{
+  int i;
+  erasetext(ddap, 8, 108,0,3);
+  initscores(ddap);
+  drawlives(ddap);
+  music(1, 1.0);
+
+  flushkeybuf();
+  for (i=0;i<dgctx->game.diggers;i++)
+    readdirect(i);
+}
+
+/* True while the current level is still being played */
+static bool levelrunning(void)
+{
+  struct main_state *st=&dgctx->main;
+  return !st->alldead && !st->gamedat[dgctx->game.curplayer].levdone &&
+         !dgctx->input.escape && !dgctx->game.timeout;
+}
+
+/* One frame of play */
+static void gametick(void)
+{
+  struct main_state *st=&dgctx->main;
+  newframe();
+  st->penalty=0;
+  dodigger(ddap);
+  domonsters(ddap);
+  dobags(ddap);
+  if (st->penalty>8)
+    incmont(st->penalty-8);
+  checklevdone();
+}
+
+/* Start the next frame of bag settling at the end of a level. Returns false
+   once the bags have come to rest. */
+static bool settle(void)
+{
+  struct main_state *st=&dgctx->main;
+  if ((getnmovingbags()==0 && st->modet==0) || dgctx->input.escape ||
+      dgctx->game.timeout)
+    return false;
+  if (st->modet!=0)
+    st->modet--;
+  st->penalty=0;
+  dobags(ddap);
+  return true;
+}
+
+static void tidylevel(void)
+{
+  int i;
+  soundstop();
+  for (i=0;i<dgctx->game.diggers;i++)
+    killfire(i);
+  erasebonus(ddap);
+  cleanupbags();
+  savefield();
+  erasemonsters();
+  recputeol();
+  if (dgctx->record.playing)
+    playskipeol();
+  if (dgctx->input.escape)
+    recputeog();
+}
+
+/* Account lives and move on to the next level if the last one was done */
+static void leveldone(void)
+{
+  struct main_state *st=&dgctx->main;
+  int16_t i;
+  if (st->gamedat[dgctx->game.curplayer].levdone &&
+      getenv("DIGGER_CI_RUN_DTL") != NULL)
+    game_dbg_info_emit();
+  if (countem()==0 || st->gamedat[dgctx->game.curplayer].levdone) {
 #ifdef INTDRF
-        fprintf(info,"%i\n",frame);
+    fprintf(info,"%i\n",frame);
 #endif
-        for (i=dgstate.curplayer;i<dgstate.diggers+dgstate.curplayer;i++)
-          if (getlives(i)>0 && !digalive(i))
-            declife(i);
-        drawlives(ddap);
-        gamedat[dgstate.curplayer].level++;
-        if (gamedat[dgstate.curplayer].level>1000)
-          gamedat[dgstate.curplayer].level=1000;
-        initlevel();
-      }
-      else
-        if (alldead) {
+    for (i=dgctx->game.curplayer;i<dgctx->game.diggers+dgctx->game.curplayer;i++)
+      if (getlives(i)>0 && !digalive(i))
+        declife(i);
+    drawlives(ddap);
+    st->gamedat[dgctx->game.curplayer].level++;
+    if (st->gamedat[dgctx->game.curplayer].level>1000)
+      st->gamedat[dgctx->game.curplayer].level=1000;
+    initlevel();
+  }
+  else
+    if (st->alldead) {
 #ifdef INTDRF
-          fprintf(info,"%i\n",frame);
+      fprintf(info,"%i\n",frame);
 #endif
-          for (i=dgstate.curplayer;i<dgstate.curplayer+dgstate.diggers;i++)
-            if (getlives(i)>0)
-              declife(i);
-          drawlives(ddap);
-        }
-      if ((alldead && getalllives()==0 && !dgstate.gauntlet && !escape) || dgstate.timeout)
-        endofgame(ddap);
+      for (i=dgctx->game.curplayer;i<dgctx->game.curplayer+dgctx->game.diggers;i++)
+        if (getlives(i)>0)
+          declife(i);
+      drawlives(ddap);
+    }
+}
+
+static void pausegame(void)
+{
+  soundpause();
+  cleartopline();
+  outtext(ddap, "PRESS ANY KEY",80,0,1);
+}
+
+static void unpausegame(void)
+{
+  int i;
+  getkey(true);
+  cleartopline();
+  drawscores(ddap);
+  for (i=0;i<dgctx->game.diggers;i++)
+    addscore(ddap, i,0);
+  drawlives(ddap);
+}
+
+/* Title screen: watch for the start keys and play the attract animation
+   for the current frame */
+static void titleframe(void)
+{
+  struct main_state *st=&dgctx->main;
+  struct obj_position newpos;
+  int16_t t;
+  st->started=teststart();
+  if (dgctx->input.mode_change) {
+    switchnplayers();
+    shownplayers();
+    dgctx->input.mode_change=false;
+  }
+  if (st->modet==0)
+    for (t=54;t<174;t+=12)
+      erasetext(ddap, 12, 164,t,0);
+  if (st->modet==50) {
+    if (st->nobbin != NULL) {
+      CALL_METHOD(st->nobbin, dtor);
+    }
+    st->nobbin = monster_obj_ctor(0, MON_NOBBIN, DIR_LEFT, 292, 63);
+    CALL_METHOD(st->nobbin, put);
+  }
+  if (st->modet>50 && st->modet<=77) {
+    CALL_METHOD(st->nobbin, getpos, &newpos);
+    newpos.x -= 4;
+    if (st->modet == 77) {
+      newpos.dir = DIR_RIGHT;
+    }
+    CALL_METHOD(st->nobbin, setpos, &newpos);
+  }
+  if (st->modet > 50) {
+    CALL_METHOD(st->nobbin, animate);
+  }
+
+  if (st->modet==83)
+    outtext(ddap, "NOBBIN",216,64,2);
+  if (st->modet==90) {
+    if (st->hobbin != NULL) {
+      CALL_METHOD(st->hobbin, dtor);
     }
-    alldead=false;
-    if (dgstate.nplayers==2 && getlives(1-dgstate.curplayer)!=0) {
-      dgstate.curplayer=1-dgstate.curplayer;
-      flashplayer=levnotdrawn=true;
+    st->hobbin = monster_obj_ctor(1, MON_NOBBIN, DIR_LEFT, 292, 82);
+    CALL_METHOD(st->hobbin, put);
+  }
+  if (st->modet>90 && st->modet<=117) {
+    CALL_METHOD(st->hobbin, getpos, &newpos);
+    newpos.x -= 4;
+    if (st->modet == 117) { 
+      newpos.dir = DIR_RIGHT;
     }
+    CALL_METHOD(st->hobbin, setpos, &newpos);
+  }
+  if (st->modet == 100) {
+    CALL_METHOD(st->hobbin, mutate);
+  }
+  if (st->modet > 90) {
+    CALL_METHOD(st->hobbin, animate);
+  }
+  if (st->modet==123)
+    outtext(ddap, "HOBBIN",216,83,2);
+  if (st->modet==130) {
+    digger_obj_init(&st->odigger, 0, DIR_LEFT, 292, 101);
+    CALL_METHOD(&st->odigger, put);
+  }
+  if (st->modet>130 && st->modet<=157) {
+    st->odigger.x -= 4;
+  }
+  if (st->modet>157) {
+    st->odigger.dir = DIR_RIGHT;
+  }
+  if (st->modet >= 130) {
+    CALL_METHOD(&st->odigger, animate);
+  }
+  if (st->modet==163)
+    outtext(ddap, "DIGGER",216,102,2);
+  if (st->modet==178) {
+    movedrawspr(FIRSTBAG,184,120);
+    drawgold(0,0,184,120);
+  }
+  if (st->modet==183)
+    outtext(ddap, "GOLD",216,121,2);
+  if (st->modet==198)
+    drawemerald(184,141);
+  if (st->modet==203)
+    outtext(ddap, "EMERALD",216,140,2);
+  if (st->modet==218)
+    drawbonus(184,158);
+  if (st->modet==223)
+    outtext(ddap, "BONUS",216,159,2);
+  if (st->modet == 235) {
+      CALL_METHOD(st->nobbin, damage);
+  }
+  if (st->modet == 239) {
+      CALL_METHOD(st->nobbin, kill);
+  }
+  if (st->modet == 242) {
+      CALL_METHOD(st->hobbin, damage);
   }
+  if (st->modet == 246) {
+      CALL_METHOD(st->hobbin, kill);
+  }
+}
+
+/* Run the game from st->mode up to the next frame boundary. Returns false
+   when there is nothing more to run. */
+static bool step(void)
+{
+  struct main_state *st=&dgctx->main;
+  int16_t i;
+  for (;;)
+    switch (st->mode) {
+      case MS_IDLE:
+        return false;
+
+      case MS_TITLE:
+        soundstop();
+        creatembspr();
+        detectjoy();
+        ddap->gclear();
+        ddap->gtitle();
+        outtext(ddap, "D I G G E R",100,0,3);
+        shownplayers();
+        showtable(ddap);
+        st->started=false;
+        st->modet=0;
+        dgctx->input.replayf=false;
+        st->mode=MS_TITLEWAIT;
+        return true;
+      case MS_TITLEWAIT:
+        newframe();
+        teststart();
+        titleframe();
+        st->mode=MS_ATTRACT;
+        return true;
+      case MS_ATTRACT:
+        newframe();
+        st->modet++;
+        if (st->modet>250)
+          st->modet=0;
+        if (!st->started) {
+          titleframe();
+          return true;
+        }
+        st->mode=MS_TITLEDONE;
+        break;
+      case MS_TITLEDONE:
+        st->mode=MS_TITLE;
+        if (dgctx->record.savedrf) {
+          if (dgctx->record.gotgame) {
+            recsavedrf();
+            dgctx->record.gotgame=false;
+          }
+          dgctx->record.savedrf=false;
+#ifndef _RP2350
+          if (dgctx->input.escape)
+            st->mode=MS_IDLE;
+#endif
+          break;
+        }
+        if (dgctx->input.replayf) {   /* Play the last game back */
+          dgctx->input.replayf=false;
+          if (playlast()) {
+            st->single=false;
+            st->mode=MS_GAME;
+          }
+          break;
+        }
+        if (dgctx->input.escape) {
+#ifdef _RP2350
+          dgctx->input.escape=false;  /* No OS to quit to - back to title */
+#else
+          st->mode=MS_IDLE;
+#endif
+          break;
+        }
+        recinit();
+        st->single=false;
+        st->mode=MS_GAME;
+        break;
+
+      case MS_GAME:
+        rewind_reset();
+        st->flashplayer=newgame();
+        st->mode=MS_GAMELOOP;
+        break;
+      case MS_GAMELOOP:
+        if (getalllives()!=0 && !dgctx->input.escape && !dgctx->game.timeout)
+          st->mode=MS_LEVELLOOP;
+        else
+          st->mode=MS_GAMEEND;
+        break;
+      case MS_LEVELLOOP:
+        if (!st->alldead && !dgctx->input.escape && !dgctx->game.timeout) {
+          st->mode=MS_LEVEL;
+          break;
+        }
+        st->alldead=false;
+        if (dgctx->game.nplayers==2 && getlives(1-dgctx->game.curplayer)!=0) {
+          dgctx->game.curplayer=1-dgctx->game.curplayer;
+          st->flashplayer=st->levnotdrawn=true;
+        }
+        st->mode=MS_GAMELOOP;
+        break;
+      case MS_LEVEL:
+        if (dgctx->record.playing)
+          dgctx->game.randv=playgetrand();
+        else
+          dgctx->game.randv=st->randseed;
+        if (startlevel()) {
+          st->mode=MS_FLASH;
+          return true;
+        }
+        st->mode=MS_LEVELGO;
+        break;
+      case MS_FLASH:
+        newframe();
+        if (dgctx->input.escape) {
+          st->mode=MS_GAMEEND;
+          break;
+        }
+        if (++st->modec>3) {
+          st->modec=1;
+          st->modet++;
+        }
+        if (st->modet<15) {
+          flashframe();
+          return true;
+        }
+        drawscores(ddap);
+        for (i=0;i<dgctx->game.diggers;i++)
+          addscore(ddap, i,0);
+        st->mode=MS_LEVELGO;
+        break;
+      case MS_LEVELGO:
+        beginlevel();
+        st->mode=MS_ENDLEVEL;
+        if (levelrunning()) {
+          st->mode=MS_PLAY;
+          return true;
+        }
+        break;
+      case MS_PLAY:
+        if (dgctx->input.rewindf) {
+          dgctx->input.rewindf=false;
+          if (!dgctx->record.playing && rewind_back(REWIND_STEP)) {
+            dgctx->record.drfvalid=false; /* Not a straight game any more */
+            return true;
+          }
+        }
+        rewind_capture();
+        gametick();
+        if (dgctx->input.pausef) {
+          pausegame();
+          st->mode=MS_PAUSE;
+          if (!kbhit())
+            return true;
+          break;
+        }
+        soundpauseoff();
+        if (levelrunning())
+          return true;
+        st->mode=MS_ENDLEVEL;
+        break;
+      case MS_PAUSE:
+        if (!kbhit())
+          return true;
+        unpausegame();
+        st->mode=MS_UNPAUSE;
+        return true;
+      case MS_UNPAUSE:
+        dgctx->input.pausef=false;
+        st->mode=MS_ENDLEVEL;
+        if (levelrunning()) {
+          st->mode=MS_PLAY;
+          return true;
+        }
+        break;
+
+      case MS_ENDLEVEL:
+        erasediggers();
+        musicoff();
+        st->modet=20;
+        st->mode=MS_LEVELEND;
+        if (settle()) {
+          st->mode=MS_SETTLE;
+          return true;
+        }
+        break;
+      case MS_SETTLE:
+        newframe();
+        dodigger(ddap);
+        domonsters(ddap);
+        if (st->penalty<8)
+          st->modet=0;
+        if (settle())
+          return true;
+        st->mode=MS_LEVELEND;
+        break;
+      case MS_LEVELEND:
+        tidylevel();
+        st->mode=MS_LEVELDONE;
+        if (st->gamedat[dgctx->game.curplayer].levdone && soundlevdone()) {
+          st->mode=MS_JINGLE;
+          return true;
+        }
+        break;
+      case MS_JINGLE:
+        if (soundlevdonetick())
+          return true;
+        st->mode=MS_LEVELDONE;
+        break;
+      case MS_LEVELDONE:
+        leveldone();
+        st->mode=MS_LEVELLOOP;
+        if ((st->alldead && getalllives()==0 && !dgctx->game.gauntlet &&
+             !dgctx->input.escape) || dgctx->game.timeout) {
+          st->mode=MS_ENDGAME;
+          if (endofgame(ddap))
+            return true;
+          st->mode=MS_LEVELLOOP;
+        }
+        break;
+      case MS_ENDGAME:
+        if (endofgame(ddap))
+          return true;
+        st->mode=MS_LEVELLOOP;
+        break;
+
+      case MS_GAMEEND:
 #ifdef INTDRF
-  fprintf(info,"-1\n%lu\n%i",getscore0(),gamedat[0].level);
+        fprintf(info,"-1\n%lu\n%i",getscore0(),st->gamedat[0].level);
 #endif
+        if (st->single) {
+          st->mode=MS_IDLE;
+          return false;
+        }
+        recend();
+        if (dgctx->record.playing)
+          playclose();
+        dgctx->record.gotgame=true;
+        if (dgctx->record.gotname) {
+          recsavedrf();
+          dgctx->record.gotgame=false;
+        }
+        dgctx->record.savedrf=false;
+        dgctx->input.escape=false;
+        st->mode=MS_TITLE;
+        break;
+    }
+}
+
+/*
+ * Run the game up to the next frame boundary. in, if not NULL, is the
+ * keyboard state for this frame; otherwise whatever the keyboard backend
+ * reports is used. Returns false when there is nothing more to run: the
+ * player quit from the title screen, or a game started with startgame()
+ * is over. A caller that wants real time waits for the next frame between
+ * calls; the game itself never sleeps.
+ */
+bool digger_step(const struct digger_input *in)
+{
+  struct main_state *st=&dgctx->main;
+  if (dgctx->record.playing)
+    playtick();
+  if (st->nextframe)
+    audio_fill_and_submit();  /* sound for the frame that just ended */
+  if (in!=NULL)
+    kbdfeed(in);
+  st->nextframe=step();
+  endsprframe();
+  return st->nextframe;
+}
+
+/* Set up a single game to be run by digger_step(), skipping the title
+   screen. digger_step() returns false once it is over. */
+void startgame(void)
+{
+  dgctx->main.single=true;
+  dgctx->main.mode=MS_GAME;
+}
+
+/* Step the game until it stops, waiting for each frame in between */
+static void run(void)
+{
+  while (digger_step(NULL))
+    gethrt(dgctx->sound.sounddiedone ? false : true);
+}
+
+/* Play one game, e.g. a recording, and return when it is over */
+void game(void)
+{
+  startgame();
+  run();
 }
 
 static bool quiet=false;
-static uint16_t sound_rate,sound_length;
+static uint16_t sound_rate=44100,sound_length=DEFAULT_BUFFER;
 
 void maininit(void)
 {
-  static int maininited = 0;
-
-  if (maininited != 0) {
+  struct main_state *st=&dgctx->main;
+  if (st->inited) {
     return;
   }
   calibrate();
@@ -245,7 +693,7 @@ void maininit(void)
   detectjoy();
   initsound();
   recstart();
-  maininited = 1;
+  st->inited = true;
 }
 
 #ifndef _RP2350
@@ -253,6 +701,7 @@ int main(int argc,char *argv[])
 {
   int rval;
 
+  dgctx_init(dgctx);
   inir();
   parsecmd(argc,argv);
   maininit();
@@ -267,158 +716,15 @@ int main(int argc,char *argv[])
 
 int mainprog(void)
 {
-  int16_t frame,t;
-  struct monster_obj *nobbin, *hobbin;
-  struct digger_obj odigger;
-  struct obj_position newpos;
+  struct main_state *st=&dgctx->main;
   loadscores();
-  escape=false;
-  nobbin = NULL;
-  hobbin = NULL;
-  do {
-    soundstop();
-    creatembspr();
-    detectjoy();
-    ddap->gclear();
-    ddap->gtitle();
-    outtext(ddap, "D I G G E R",100,0,3);
-    shownplayers();
-    showtable(ddap);
-    started=false;
-    frame=0;
-    newframe();
-    teststart();
-    while (!started) {
-      started=teststart();
-      if (mode_change) {
-        switchnplayers();
-        shownplayers();
-        mode_change=false;
-      }
-      if (frame==0)
-        for (t=54;t<174;t+=12)
-          erasetext(ddap, 12, 164,t,0);
-      if (frame==50) {
-        if (nobbin != NULL) {
-          CALL_METHOD(nobbin, dtor);
-        }
-        nobbin = monster_obj_ctor(0, MON_NOBBIN, DIR_LEFT, 292, 63);
-        CALL_METHOD(nobbin, put);
-      }
-      if (frame>50 && frame<=77) {
-        CALL_METHOD(nobbin, getpos, &newpos);
-        newpos.x -= 4;
-        if (frame == 77) {
-          newpos.dir = DIR_RIGHT;
-        }
-        CALL_METHOD(nobbin, setpos, &newpos);
-      }
-      if (frame > 50) {
-        CALL_METHOD(nobbin, animate);
-      }
-
-      if (frame==83)
-        outtext(ddap, "NOBBIN",216,64,2);
-      if (frame==90) {
-        if (hobbin != NULL) {
-          CALL_METHOD(hobbin, dtor);
-        }
-        hobbin = monster_obj_ctor(1, MON_NOBBIN, DIR_LEFT, 292, 82);
-        CALL_METHOD(hobbin, put);
-      }
-      if (frame>90 && frame<=117) {
-        CALL_METHOD(hobbin, getpos, &newpos);
-        newpos.x -= 4;
-        if (frame == 117) { 
-          newpos.dir = DIR_RIGHT;
-        }
-        CALL_METHOD(hobbin, setpos, &newpos);
-      }
-      if (frame == 100) {
-        CALL_METHOD(hobbin, mutate);
-      }
-      if (frame > 90) {
-        CALL_METHOD(hobbin, animate);
-      }
-      if (frame==123)
-        outtext(ddap, "HOBBIN",216,83,2);
-      if (frame==130) {
-        digger_obj_init(&odigger, 0, DIR_LEFT, 292, 101);
-        CALL_METHOD(&odigger, put);
-      }
-      if (frame>130 && frame<=157) {
-        odigger.x -= 4;
-      }
-      if (frame>157) {
-        odigger.dir = DIR_RIGHT;
-      }
-      if (frame >= 130) {
-        CALL_METHOD(&odigger, animate);
-      }
-      if (frame==163)
-        outtext(ddap, "DIGGER",216,102,2);
-      if (frame==178) {
-        movedrawspr(FIRSTBAG,184,120);
-        drawgold(0,0,184,120);
-      }
-      if (frame==183)
-        outtext(ddap, "GOLD",216,121,2);
-      if (frame==198)
-        drawemerald(184,141);
-      if (frame==203)
-        outtext(ddap, "EMERALD",216,140,2);
-      if (frame==218)
-        drawbonus(184,158);
-      if (frame==223)
-        outtext(ddap, "BONUS",216,159,2);
-      if (frame == 235) {
-          CALL_METHOD(nobbin, damage);
-      }
-      if (frame == 239) {
-          CALL_METHOD(nobbin, kill);
-      }
-      if (frame == 242) {
-          CALL_METHOD(hobbin, damage);
-      }
-      if (frame == 246) {
-          CALL_METHOD(hobbin, kill);
-      }
-      newframe();
-      frame++;
-      if (frame>250)
-        frame=0;
-    }
-    if (savedrf) {
-      if (gotgame) {
-        recsavedrf();
-        gotgame=false;
-      }
-      savedrf=false;
-      continue;
-    }
-#ifdef _RP2350
-    if (escape) {
-      escape=false;
-      continue;  /* No OS to quit to - return to title screen */
-    }
-#else
-    if (escape)
-      break;
-#endif
-    recinit();
-    game();
-    gotgame=true;
-    if (gotname) {
-      recsavedrf();
-      gotgame=false;
-    }
-    savedrf=false;
-    escape=false;
-#ifdef _RP2350
-  } while (1);  /* Never exit on RP2350 */
-#else
-  } while (!escape);
-#endif
+  if (!rewind_init(REWIND_RING))
+    fprintf(stderr,"No memory for the rewind ring: rewinding is off\n");
+  dgctx->input.escape=false;
+  st->nobbin = NULL;
+  st->hobbin = NULL;
+  st->mode=MS_TITLE;
+  run();
   finish();
   return 0;
 }
@@ -456,11 +762,11 @@ static int getnmode(void)
   int i;
 
   for (i = 0; !possible_modes[i].last;i++) {
-    if (possible_modes[i].gauntlet != dgstate.gauntlet)
+    if (possible_modes[i].gauntlet != dgctx->game.gauntlet)
       continue;
-    if (possible_modes[i].nplayers != dgstate.nplayers)
+    if (possible_modes[i].nplayers != dgctx->game.nplayers)
       continue;
-    if (possible_modes[i].diggers != dgstate.diggers)
+    if (possible_modes[i].diggers != dgctx->game.diggers)
       continue;
     break;
   }
@@ -481,7 +787,7 @@ static void shownplayers(void)
 static int getalllives(void)
 {
   int t=0,i;
-  for (i=dgstate.curplayer;i<dgstate.diggers+dgstate.curplayer;i++)
+  for (i=dgctx->game.curplayer;i<dgctx->game.diggers+dgctx->game.curplayer;i++)
     t+=getlives(i);
   return t;
 }
@@ -492,18 +798,19 @@ static void switchnplayers(void)
 
   i = getnmode();
   j = possible_modes[i].last ? 0 : i + 1;
-  dgstate.gauntlet = possible_modes[j].gauntlet;
-  dgstate.nplayers = possible_modes[j].nplayers;
-  dgstate.diggers = possible_modes[j].diggers;
+  dgctx->game.gauntlet = possible_modes[j].gauntlet;
+  dgctx->game.nplayers = possible_modes[j].nplayers;
+  dgctx->game.diggers = possible_modes[j].diggers;
 }
 
 static void initlevel(void)
 {
-  gamedat[dgstate.curplayer].levdone=false;
+  struct main_state *st=&dgctx->main;
+  st->gamedat[dgctx->game.curplayer].levdone=false;
   makefield();
   makeemfield();
   initbags();
-  levnotdrawn=true;
+  st->levnotdrawn=true;
 }
 
 static void drawscreen(struct digger_draw_api *ddap)
@@ -516,6 +823,23 @@ static void drawscreen(struct digger_draw_api *ddap)
   initmonsters();
 }
 
+/* The screen of a level in play drawn again from the game state, for a
+   savestate restored without it */
+void redrawscreen(void)
+{
+  struct sprite_state *sp=&dgctx->sprite;
+  bool enf[SPRITES];
+  memcpy(enf,sp->sprenf,sizeof(enf));
+  memset(sp->sprenf,0,sizeof(sp->sprenf));
+  ddap->gclear();
+  redrawfield(ddap);
+  drawemeralds();
+  redrawscores(ddap);
+  drawlives(ddap);
+  memcpy(sp->sprenf,enf,sizeof(enf));
+  drawsprites();
+}
+
 static void initchars(void)
 {
   initmbspr();
@@ -525,21 +849,21 @@ static void initchars(void)
 
 static void checklevdone(void)
 {
+  struct main_state *st=&dgctx->main;
   if ((countem()==0 || monleft()==0) && isalive())
-    gamedat[dgstate.curplayer].levdone=true;
+    st->gamedat[dgctx->game.curplayer].levdone=true;
   else
-    gamedat[dgstate.curplayer].levdone=false;
+    st->gamedat[dgctx->game.curplayer].levdone=false;
 }
 
 void incpenalty(void)
 {
-  penalty++;
+  dgctx->main.penalty++;
 }
 
 void cleartopline(void)
 {
-  erasetext(ddap, 26, 0,0,3);
-  erasetext(ddap, 1, 308,0,3);
+  ddap->gfill(0,0,MAX_W,CHR_H,0);
 }
 
 int16_t levplan(void)
@@ -552,49 +876,54 @@ int16_t levplan(void)
 
 int16_t levof10(void)
 {
-  if (gamedat[dgstate.curplayer].level>10)
+  struct main_state *st=&dgctx->main;
+  if (st->gamedat[dgctx->game.curplayer].level>10)
     return 10;
-  return gamedat[dgstate.curplayer].level;
+  return st->gamedat[dgctx->game.curplayer].level;
 }
 
-static int16_t levno(void)
+int16_t levno(void)
 {
-  return gamedat[dgstate.curplayer].level;
+  return dgctx->main.gamedat[dgctx->game.curplayer].level;
 }
 
 void setdead(bool df)
 {
-  alldead=df;
+  dgctx->main.alldead=df;
 }
 
-void testpause(void)
+static void calibrate(void)
 {
-  int i;
-  if (pausef) {
-    soundpause();
-    cleartopline();
-    outtext(ddap, "PRESS ANY KEY",80,0,1);
-    getkey(true);
-    cleartopline();
-    drawscores(ddap);
-    for (i=0;i<dgstate.diggers;i++)
-      addscore(ddap, i,0);
-    drawlives(ddap);
-    gethrt(true);
-    pausef=false;
-  }
-  else
-    soundpauseoff();
+  dgctx->sound.volume=(int16_t)(getkips()/291);
+  if (dgctx->sound.volume==0)
+    dgctx->sound.volume=1;
 }
 
-static void calibrate(void)
+#ifndef _RP2350
+/* Built-in defaults, same as inir_defaults() in rp2350_main.c, so that
+   host runs of a DRF behave exactly like the device. */
+static void inir(void)
 {
-  volume=(int16_t)(getkips()/291);
-  if (volume==0)
-    volume=1;
+  setupsound=s1setupsound;
+  killsound=s1killsound;
+  soundoff=s1soundoff;
+  setspkrt2=s1setspkrt2;
+  timer0=s1timer0;
+  timer2=s1timer2;
+  inigame();
+}
+
+/* Settings every game context starts with: inir() applies them to the
+   first one, harnesses running more games to each context they create. */
+void inigame(void)
+{
+  dgctx->game.gtime=120;
+  if (dgctx->game.ftime==0)
+    dgctx->game.ftime=80000l;
+  dgctx->sound.volume=1;
+  soundinitglob(sound_length,sound_rate);
 }
 
-#ifndef _RP2350
 #define read_levf_fail(s, p) fprintf(digger_log, "read_levf: %s: levels file %s error%s: %s\n", \
   levfname, (s), (p), strerror(errno))
 
@@ -614,13 +943,13 @@ read_levf(char *levfname)
 #endif
       return (-1);
   }
-  if (fread(&bonusscore, 2, 1, levf) < 1) {
+  if (fread(&dgctx->scores.bonusscore, 2, 1, levf) < 1) {
 #if defined(DIGGER_DEBUG)
     read_levf_fail("load", " #1");
 #endif
     goto eout_0;
   }
-  if (fread(dgstate.leveldat, 1200, 1, levf) <= 0) {
+  if (fread(dgctx->game.leveldat, 1200, 1, levf) <= 0) {
 #if defined(DIGGER_DEBUG)
     read_levf_fail("load", " #2");
 #endif
@@ -656,6 +985,7 @@ getarg(char argch, const char *allargs, bool *hasopt)
 #define BASE_OPTS "OUH?QM2CKVL:R:P:S:E:G:I:"
 #define X11_OPTS "X:"
 #define SDL_OPTS  "F"
+#define HOST_OPTS "T:B:W:J:D:Y:AFNZ1:"
 
 static void parsecmd(int argc,char *argv[])
 {
@@ -663,6 +993,9 @@ static void parsecmd(int argc,char *argv[])
   int argch;
   int16_t arg,i=0,j,speedmul;
   bool sf, gs, norepf, hasopt;
+#if defined(_HOST)
+  int rval;
+#endif
 
   gs = norepf = false;
 
@@ -674,6 +1007,8 @@ static void parsecmd(int argc,char *argv[])
 #else
 # if defined(_SDL)
       argch = getarg(word[1], (BASE_OPTS SDL_OPTS), &hasopt);
+# elif defined(_HOST)
+      argch = getarg(word[1], (BASE_OPTS HOST_OPTS), &hasopt);
 # else
       argch = getarg(word[1], BASE_OPTS, &hasopt);
 # endif
@@ -685,9 +1020,9 @@ static void parsecmd(int argc,char *argv[])
       if (argch == 'L') {
         j=0;
         while (word[i]!=0)
-          dgstate.levfname[j++]=word[i++];
-        dgstate.levfname[j]=word[i];
-        dgstate.levfflag=true;
+          dgctx->game.levfname[j++]=word[i++];
+        dgctx->game.levfname[j]=word[i];
+        dgctx->game.levfflag=true;
       }
 #if defined(UNIX) && defined(_SDL) && !defined(__EMSCRIPTEN__)
       if (argch == 'X') {
@@ -707,7 +1042,7 @@ static void parsecmd(int argc,char *argv[])
       if (argch =='P' || argch =='E') {
         maininit();
         openplay(word+i);
-        if (escape)
+        if (dgctx->input.escape)
           norepf=true;
       }
       if (argch == 'E') {
@@ -716,10 +1051,14 @@ static void parsecmd(int argc,char *argv[])
           game_dbg_info_emit();
 	  exit(0);
 	}
-        if (escape)
+        if (dgctx->input.escape)
           exit(0);
         exit(1);
       }
+#if defined(_HOST)
+      if ((rval=hostbench(argch,word+i))>=0)
+        exit(rval);
+#endif
       if (argch =='O' && !norepf) {
         arg=0;
         continue;
@@ -729,16 +1068,16 @@ static void parsecmd(int argc,char *argv[])
         while (word[i]!=0)
           speedmul=10*speedmul+word[i++]-'0';
         if (speedmul > 0) {
-          dgstate.ftime=speedmul*2000l;
+          dgctx->game.ftime=speedmul*2000l;
         } else {
-          dgstate.ftime = 1;
+          dgctx->game.ftime = 1;
         }
         gs=true;
       }
       if (argch == 'I')
-        sscanf(word+i,"%hi",&dgstate.startlev);
+        sscanf(word+i,"%hi",&dgctx->game.startlev);
       if (argch == 'U')
-        dgstate.unlimlives=true;
+        dgctx->game.unlimlives=true;
       if (argch == '?' || argch == 'H' || argch == -1) {
         if (argch == -1) {
           fprintf(stderr, "Unknown option \"%c%c\"\n", word[0], word[1]);
@@ -781,17 +1120,31 @@ static void parsecmd(int argc,char *argv[])
 #endif
 #if defined(_SDL)
                "/F = Full-Screen\n"
+#endif
+#if defined(_HOST)
+               "/T = Time playback at full speed and exit\n"
+               "/B:n[,t] = Time n games stepped on t threads and exit\n"
+               "/W = Time rewind capture during playback and exit\n"
+               "/J:file,frame[,frame...] = Seek playback through its index and exit\n"
+               "/D:in,out = Convert a recording between text and binary, check both play the same and exit\n"
+               "/A = Time the sprite blitters and exit\n"
+               "/F = Check and time text drawing and exit\n"
+               "/N = Check and time the HDMI scanline expansion and exit\n"
+               "/1[:file] = Check and time the sound generator, or a DRF's sound, and exit\n"
+               "/1:file,count,samples = Play a DRF's sound through a simulated DMA ring and exit\n"
+               "/Z = Check and time the level background redraw and exit\n"
+               "/Y:file = Check and time batched sprite drawing in playback and exit\n"
 #endif
                "/U = Allow unlimited lives\n"
                "/I = Start on a level other than 1\n", copyright);
         exit(1);
       }
       if (argch == 'Q')
-        soundflag=false;
+        dgctx->sound.soundflag=false;
       if (argch == 'M')
-        musicflag=false;
+        dgctx->sound.musicflag=false;
       if (argch == '2')
-        dgstate.diggers=2;
+        dgctx->game.diggers=2;
       if (argch == 'B' || argch == 'C') {
         ddap->ginit=cgainit;
         ddap->gpal=cgapal;
@@ -802,6 +1155,7 @@ static void parsecmd(int argc,char *argv[])
         ddap->ggeti=cgageti;
         ddap->gputim=cgaputim;
         ddap->gwrite=cgawrite;
+        ddap->gfill=cgafill;
         ddap->gtitle=cgatitle;
         ddap->ginit();
         ddap->gpal(0);
@@ -815,14 +1169,14 @@ static void parsecmd(int argc,char *argv[])
       if (argch == 'Q')
         quiet=true;
       if (argch == 'G') {
-        dgstate.gtime=0;
+        dgctx->game.gtime=0;
         while (word[i]!=0)
-          dgstate.gtime=10*dgstate.gtime+word[i++]-'0';
-        if (dgstate.gtime>3599)
-          dgstate.gtime=3599;
-        if (dgstate.gtime==0)
-          dgstate.gtime=120;
-        dgstate.gauntlet=true;
+          dgctx->game.gtime=10*dgctx->game.gtime+word[i++]-'0';
+        if (dgctx->game.gtime>3599)
+          dgctx->game.gtime=3599;
+        if (dgctx->game.gtime==0)
+          dgctx->game.gtime=120;
+        dgctx->game.gauntlet=true;
       }
     }
     else {
@@ -843,30 +1197,30 @@ static void parsecmd(int argc,char *argv[])
           speedmul=10*speedmul+word[j++]-'0';
         gs=true;
         if (speedmul > 0) {
-          dgstate.ftime=speedmul*2000l;
+          dgctx->game.ftime=speedmul*2000l;
         } else {
-          dgstate.ftime = 1;
+          dgctx->game.ftime = 1;
         }
       }
       else {
         j=0;
         while (word[j]!=0) {
-          dgstate.levfname[j]=word[j];
+          dgctx->game.levfname[j]=word[j];
           j++;
         }
-        dgstate.levfname[j]=word[j];
-        dgstate.levfflag=true;
+        dgctx->game.levfname[j]=word[j];
+        dgctx->game.levfflag=true;
       }
     }
   }
 
-  if (dgstate.levfflag) {
-    if (read_levf(dgstate.levfname) != 0) {
+  if (dgctx->game.levfflag) {
+    if (read_levf(dgctx->game.levfname) != 0) {
 #if defined(DIGGER_DEBUG)
       fprintf(digger_log, "levels load error\n");
       exit(1);
 #endif
-      dgstate.levfflag = false;
+      dgctx->game.levfflag = false;
     }
   }
 }
@@ -874,7 +1228,7 @@ static void parsecmd(int argc,char *argv[])
 
 int16_t randno(int16_t n)
 {
-  dgstate.randv=dgstate.randv*0x15a4e35l+1;
-  return (int16_t)((dgstate.randv&0x7fffffffl)%n);
+  dgctx->game.randv=dgctx->game.randv*0x15a4e35l+1;
+  return (int16_t)((dgctx->game.randv&0x7fffffffl)%n);
 }
 
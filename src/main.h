@@ -1,15 +1,21 @@
 /* Digger Remastered
    Copyright (c) Andrew Jenner 1998-2004 */
 
+struct digger_input;
+
 int16_t getlevch(int16_t bp6,int16_t bp8,int16_t bpa);
 void incpenalty(void);
 int16_t levplan(void);
 int16_t levof10(void);
+int16_t levno(void);
 void setdead(bool df);
 void cleartopline(void);
 void finish(void);
 int16_t randno(int16_t n);
 void game(void);
+void startgame(void);
+bool digger_step(const struct digger_input *in);
 void maininit(void);
+void inigame(void);
+void redrawscreen(void);
 int mainprog(void);
-void testpause(void);
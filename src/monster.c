@@ -15,19 +15,7 @@
 #include "sound.h"
 #include "scores.h"
 #include "record.h"
-#include "game.h"
-
-static struct monster
-{
-  int16_t h,v,xr,yr,dir,t,hnt,death,bag,dtime,stime,chase;
-  bool flag;
-  struct monster_obj *mop;
-} mondat[6];
-
-static int16_t nextmonster=0,totalmonsters=0,maxmononscr=0,nextmontime=0,mongaptime=0;
-static int16_t chase=0;
-
-static bool unbonusflag=false;
+#include "game_ctx.h"
 
 static void createmonster(void);
 static void monai(struct digger_draw_api *, int16_t mon);
@@ -41,15 +29,16 @@ static int16_t nmononscr(void);
 
 void initmonsters(void)
 {
+  struct monster_state *st=&dgctx->monster;
   int16_t i;
   for (i=0;i<MONSTERS;i++)
-    mondat[i].flag=false;
-  nextmonster=0;
-  mongaptime=45-(levof10()<<1);
-  totalmonsters=levof10()+5;
+    st->mondat[i].flag=false;
+  st->nextmonster=0;
+  st->mongaptime=45-(levof10()<<1);
+  st->totalmonsters=levof10()+5;
   switch (levof10()) {
     case 1:
-      maxmononscr=3;
+      st->maxmononscr=3;
       break;
     case 2:
     case 3:
@@ -57,57 +46,58 @@ void initmonsters(void)
     case 5:
     case 6:
     case 7:
-      maxmononscr=4;
+      st->maxmononscr=4;
       break;
     case 8:
     case 9:
     case 10:
-      maxmononscr=5;
+      st->maxmononscr=5;
   }
-  nextmontime=10;
-  unbonusflag=true;
+  st->nextmontime=10;
+  st->unbonusflag=true;
 }
 
 void erasemonsters(void)
 {
   int16_t i;
   for (i=0;i<MONSTERS;i++)
-    if (mondat[i].flag)
+    if (dgctx->monster.mondat[i].flag)
       erasespr(i+FIRSTMONSTER);
 }
 
 void domonsters(struct digger_draw_api *ddap)
 {
+  struct monster_state *st=&dgctx->monster;
   int16_t i;
-  if (nextmontime>0)
-    nextmontime--;
+  if (st->nextmontime>0)
+    st->nextmontime--;
   else {
-    if (nextmonster<totalmonsters && nmononscr()<maxmononscr && isalive() &&
-        !bonusmode)
+    if (st->nextmonster<st->totalmonsters && nmononscr()<st->maxmononscr && isalive() &&
+        !dgctx->digger.bonusmode)
       createmonster();
-    if (unbonusflag && nextmonster==totalmonsters && nextmontime==0)
+    if (st->unbonusflag && st->nextmonster==st->totalmonsters && st->nextmontime==0)
       if (isalive()) {
-        unbonusflag=false;
+        st->unbonusflag=false;
         createbonus();
       }
   }
   for (i=0;i<MONSTERS;i++)
-    if (mondat[i].flag) {
-      if (mondat[i].hnt>10-levof10()) {
-        if (ISNOB(mondat[i].mop)) {
-          CALL_METHOD(mondat[i].mop, mutate);
-          mondat[i].hnt=0;
+    if (st->mondat[i].flag) {
+      if (st->mondat[i].hnt>10-levof10()) {
+        if (ISNOB(st->mondat[i].mop)) {
+          CALL_METHOD(st->mondat[i].mop, mutate);
+          st->mondat[i].hnt=0;
         }
       }
-      if (CALL_METHOD(mondat[i].mop, isalive))
-        if (mondat[i].t==0) {
+      if (CALL_METHOD(st->mondat[i].mop, isalive))
+        if (st->mondat[i].t==0) {
           monai(ddap, i);
           if (randno(15-levof10())==0) /* Need to split for determinism */
-            if (ISNOB(mondat[i].mop) && CALL_METHOD(mondat[i].mop, isalive))
+            if (ISNOB(st->mondat[i].mop) && CALL_METHOD(st->mondat[i].mop, isalive))
               monai(ddap, i);
         }
         else
-          mondat[i].t--;
+          st->mondat[i].t--;
       else
         mondie(ddap, i);
     }
@@ -116,66 +106,66 @@ void domonsters(struct digger_draw_api *ddap)
 static void
 createmonster(void)
 {
+  struct monster_state *st=&dgctx->monster;
   int16_t i;
   for (i=0;i<MONSTERS;i++)
-    if (!mondat[i].flag) {
-      mondat[i].flag=true;
-      mondat[i].t=0;
-      mondat[i].hnt=0;
-      mondat[i].h=14;
-      mondat[i].v=0;
-      mondat[i].xr=0;
-      mondat[i].yr=0;
-      mondat[i].dir=DIR_LEFT;
-      mondat[i].chase=chase+dgstate.curplayer;
-      if (mondat[i].mop != NULL) {
-        CALL_METHOD(mondat[i].mop, dtor);
+    if (!st->mondat[i].flag) {
+      st->mondat[i].flag=true;
+      st->mondat[i].t=0;
+      st->mondat[i].hnt=0;
+      st->mondat[i].h=14;
+      st->mondat[i].v=0;
+      st->mondat[i].xr=0;
+      st->mondat[i].yr=0;
+      st->mondat[i].dir=DIR_LEFT;
+      st->mondat[i].chase=st->chase+dgctx->game.curplayer;
+      if (st->mondat[i].mop != NULL) {
+        CALL_METHOD(st->mondat[i].mop, dtor);
       }
-      mondat[i].mop = monster_obj_ctor(i, MON_NOBBIN, DIR_LEFT, 292, 18);
-      chase=(chase+1)%dgstate.diggers;
-      nextmonster++;
-      nextmontime=mongaptime;
-      mondat[i].stime=5;
-      CALL_METHOD(mondat[i].mop, put);
+      st->mondat[i].mop = monster_obj_ctor(i, MON_NOBBIN, DIR_LEFT, 292, 18);
+      st->chase=(st->chase+1)%dgctx->game.diggers;
+      st->nextmonster++;
+      st->nextmontime=st->mongaptime;
+      st->mondat[i].stime=5;
+      CALL_METHOD(st->mondat[i].mop, put);
       break;
     }
 }
 
-bool mongotgold=false;
-
 void mongold(void)
 {
-  mongotgold=true;
+  dgctx->monster.mongotgold=true;
 }
 
 static void
 monai(struct digger_draw_api *ddap, int16_t mon)
 {
+  struct monster_state *st=&dgctx->monster;
   int16_t monox,monoy,dir,mdirp1,mdirp2,mdirp3,mdirp4,t;
   int clcoll[SPRITES],clfirst[TYPES],i,m,dig;
   struct obj_position mopos;
   bool push, bagf, mopos_changed;
 
-  CALL_METHOD(mondat[mon].mop, getpos, &mopos);
+  CALL_METHOD(st->mondat[mon].mop, getpos, &mopos);
   monox = mopos.x;
   monoy = mopos.y;
-  if (mondat[mon].xr==0 && mondat[mon].yr==0) {
+  if (st->mondat[mon].xr==0 && st->mondat[mon].yr==0) {
 
     /* If we are here the monster needs to know which way to turn next. */
 
     /* Turn hobbin back into nobbin if it's had its time */
 
-    if (mondat[mon].hnt>30+(levof10()<<1))
-      if (ISHOB(mondat[mon].mop)) {
-        mondat[mon].hnt=0;
-        CALL_METHOD(mondat[mon].mop, mutate);
+    if (st->mondat[mon].hnt>30+(levof10()<<1))
+      if (ISHOB(st->mondat[mon].mop)) {
+        st->mondat[mon].hnt=0;
+        CALL_METHOD(st->mondat[mon].mop, mutate);
       }
 
     /* Set up monster direction properties to chase Digger */
 
-    dig=mondat[mon].chase;
+    dig=st->mondat[mon].chase;
     if (!digalive(dig))
-      dig=(dgstate.diggers-1)-dig;
+      dig=(dgctx->game.diggers-1)-dig;
 
     if (abs(diggery(dig)-mopos.y)>abs(diggerx(dig)-mopos.x)) {
       if (diggery(dig)<mopos.y) { mdirp1=DIR_UP;    mdirp4=DIR_DOWN; }
@@ -192,7 +182,7 @@ monai(struct digger_draw_api *ddap, int16_t mon)
 
     /* In bonus mode, run away from Digger */
 
-    if (bonusmode) {
+    if (dgctx->digger.bonusmode) {
       t=mdirp1; mdirp1=mdirp4; mdirp4=t;
       t=mdirp2; mdirp2=mdirp3; mdirp3=t;
     }
@@ -200,7 +190,7 @@ monai(struct digger_draw_api *ddap, int16_t mon)
     /* Adjust priorities so that monsters don't reverse direction unless they
        really have to */
 
-    dir=reversedir(mondat[mon].dir);
+    dir=reversedir(st->mondat[mon].dir);
     if (dir==mdirp1) {
       mdirp1=mdirp2;
       mdirp2=mdirp3;
@@ -228,72 +218,72 @@ monai(struct digger_draw_api *ddap, int16_t mon)
 
     /* Check field and find direction */
 
-    if (fieldclear(mdirp1,mondat[mon].h,mondat[mon].v))
+    if (fieldclear(mdirp1,st->mondat[mon].h,st->mondat[mon].v))
       dir=mdirp1;
     else
-      if (fieldclear(mdirp2,mondat[mon].h,mondat[mon].v))
+      if (fieldclear(mdirp2,st->mondat[mon].h,st->mondat[mon].v))
         dir=mdirp2;
       else
-        if (fieldclear(mdirp3,mondat[mon].h,mondat[mon].v))
+        if (fieldclear(mdirp3,st->mondat[mon].h,st->mondat[mon].v))
           dir=mdirp3;
         else
-          if (fieldclear(mdirp4,mondat[mon].h,mondat[mon].v))
+          if (fieldclear(mdirp4,st->mondat[mon].h,st->mondat[mon].v))
             dir=mdirp4;
 
     /* Hobbins don't care about the field: they go where they want. */
-    if (ISHOB(mondat[mon].mop))
+    if (ISHOB(st->mondat[mon].mop))
       dir=mdirp1;
 
     /* Monsters take a time penalty for changing direction */
 
-    if (mondat[mon].dir!=dir)
-      mondat[mon].t++;
+    if (st->mondat[mon].dir!=dir)
+      st->mondat[mon].t++;
 
     /* Save the new direction */
 
-    mondat[mon].dir=dir;
+    st->mondat[mon].dir=dir;
   }
 
   /* If monster is about to go off edge of screen, stop it. */
 
-  if ((mopos.x==292 && mondat[mon].dir==DIR_RIGHT) ||
-      (mopos.x==12 && mondat[mon].dir==DIR_LEFT) ||
-      (mopos.y==180 && mondat[mon].dir==DIR_DOWN) ||
-      (mopos.y==18 && mondat[mon].dir==DIR_UP))
-    mondat[mon].dir=DIR_NONE;
+  if ((mopos.x==292 && st->mondat[mon].dir==DIR_RIGHT) ||
+      (mopos.x==12 && st->mondat[mon].dir==DIR_LEFT) ||
+      (mopos.y==180 && st->mondat[mon].dir==DIR_DOWN) ||
+      (mopos.y==18 && st->mondat[mon].dir==DIR_UP))
+    st->mondat[mon].dir=DIR_NONE;
 
   /* Change hdir for hobbin */
 
-  if (mondat[mon].dir==DIR_LEFT || mondat[mon].dir==DIR_RIGHT) {
-    mopos.dir=mondat[mon].dir;
-    CALL_METHOD(mondat[mon].mop, setpos, &mopos);
+  if (st->mondat[mon].dir==DIR_LEFT || st->mondat[mon].dir==DIR_RIGHT) {
+    mopos.dir=st->mondat[mon].dir;
+    CALL_METHOD(st->mondat[mon].mop, setpos, &mopos);
   }
 
   /* Hobbins dig */
 
-  if (ISHOB(mondat[mon].mop))
-    eatfield(mopos.x, mopos.y, mondat[mon].dir);
+  if (ISHOB(st->mondat[mon].mop))
+    eatfield(mopos.x, mopos.y, st->mondat[mon].dir);
 
   /* (Draw new tunnels) and move monster */
   mopos_changed = true;
-  switch (mondat[mon].dir) {
+  switch (st->mondat[mon].dir) {
     case DIR_RIGHT:
-      if (ISHOB(mondat[mon].mop))
+      if (ISHOB(st->mondat[mon].mop))
         drawrightblob(mopos.x, mopos.y);
       mopos.x += 4;
       break;
     case DIR_UP:
-      if (ISHOB(mondat[mon].mop))
+      if (ISHOB(st->mondat[mon].mop))
         drawtopblob(mopos.x, mopos.y);
       mopos.y -= 3;
       break;
     case DIR_LEFT:
-      if (ISHOB(mondat[mon].mop))
+      if (ISHOB(st->mondat[mon].mop))
         drawleftblob(mopos.x, mopos.y);
       mopos.x -= 4;
       break;
     case DIR_DOWN:
-      if (ISHOB(mondat[mon].mop))
+      if (ISHOB(st->mondat[mon].mop))
         drawbottomblob(mopos.x, mopos.y);
       mopos.y += 3;
       break;
@@ -302,10 +292,10 @@ monai(struct digger_draw_api *ddap, int16_t mon)
   }
 
   /* Hobbins can eat emeralds */
-  if (ISHOB(mondat[mon].mop))
+  if (ISHOB(st->mondat[mon].mop))
     hitemerald((mopos.x-12)/20,(mopos.y-18)/18,
                (mopos.x-12)%20,(mopos.y-18)%18,
-               mondat[mon].dir);
+               st->mondat[mon].dir);
 
   /* If Digger's gone, don't bother */
   if (!isalive() && mopos_changed) {
@@ -316,8 +306,8 @@ monai(struct digger_draw_api *ddap, int16_t mon)
 
   /* If monster's just started, don't move yet */
 
-  if (mondat[mon].stime != 0) {
-    mondat[mon].stime--;
+  if (st->mondat[mon].stime != 0) {
+    st->mondat[mon].stime--;
     if (mopos_changed) {
       mopos.x = monox;
       mopos.y = monoy;
@@ -326,44 +316,44 @@ monai(struct digger_draw_api *ddap, int16_t mon)
   }
 
   /* Increase time counter for hobbin */
-  if (ISHOB(mondat[mon].mop) && mondat[mon].hnt < 100)
-    mondat[mon].hnt++;
+  if (ISHOB(st->mondat[mon].mop) && st->mondat[mon].hnt < 100)
+    st->mondat[mon].hnt++;
 
   if (mopos_changed) {
-    CALL_METHOD(mondat[mon].mop, setpos, &mopos);
+    CALL_METHOD(st->mondat[mon].mop, setpos, &mopos);
   }
 
   /* Draw monster */
 
   push=true;
-  CALL_METHOD(mondat[mon].mop, animate);
+  CALL_METHOD(st->mondat[mon].mop, animate);
   for (i=0;i<TYPES;i++)
-    clfirst[i]=first[i];
+    clfirst[i]=dgctx->sprite.first[i];
   for (i=0;i<SPRITES;i++)
-    clcoll[i]=coll[i];
+    clcoll[i]=dgctx->sprite.coll[i];
   incpenalty();
 
   /* Collision with another monster */
 
   if (clfirst[2]!=-1) {
-    mondat[mon].t++; /* Time penalty */
+    st->mondat[mon].t++; /* Time penalty */
     /* Ensure both aren't moving in the same dir. */
     i=clfirst[2];
     do {
       m=i-FIRSTMONSTER;
-      if (mondat[mon].dir==mondat[m].dir && mondat[m].stime==0 &&
-          mondat[mon].stime==0)
-        mondat[m].dir=reversedir(mondat[m].dir);
+      if (st->mondat[mon].dir==st->mondat[m].dir && st->mondat[m].stime==0 &&
+          st->mondat[mon].stime==0)
+        st->mondat[m].dir=reversedir(st->mondat[m].dir);
       /* The kludge here is to preserve playback for a bug in previous
          versions. */
-      if (!kludge)
+      if (!dgctx->record.kludge)
         incpenalty();
       else
         if (!(m&1))
           incpenalty();
       i=clcoll[i];
     } while (i!=-1);
-    if (kludge)
+    if (dgctx->record.kludge)
       if (clfirst[0]!=-1)
         incpenalty();
   }
@@ -381,25 +371,25 @@ monai(struct digger_draw_api *ddap, int16_t mon)
   }
 
   if (bagf) {
-    mondat[mon].t++; /* Time penalty */
-    mongotgold=false;
-    if (mondat[mon].dir==DIR_RIGHT || mondat[mon].dir==DIR_LEFT) { 
-      push=pushbags(ddap, mondat[mon].dir,clfirst,clcoll);      /* Horizontal push */
-      mondat[mon].t++; /* Time penalty */
+    st->mondat[mon].t++; /* Time penalty */
+    st->mongotgold=false;
+    if (st->mondat[mon].dir==DIR_RIGHT || st->mondat[mon].dir==DIR_LEFT) { 
+      push=pushbags(ddap, st->mondat[mon].dir,clfirst,clcoll);      /* Horizontal push */
+      st->mondat[mon].t++; /* Time penalty */
     }
     else
       if (!pushudbags(ddap, clfirst,clcoll)) /* Vertical push */
         push=false;
-    if (mongotgold) /* No time penalty if monster eats gold */
-      mondat[mon].t=0;
-    if (ISHOB(mondat[mon].mop) && mondat[mon].hnt>1)
+    if (st->mongotgold) /* No time penalty if monster eats gold */
+      st->mondat[mon].t=0;
+    if (ISHOB(st->mondat[mon].mop) && st->mondat[mon].hnt>1)
       removebags(clfirst,clcoll); /* Hobbins eat bags */
   }
 
   /* Increase hobbin cross counter */
 
-  if (ISNOB(mondat[mon].mop) && clfirst[2]!=-1 && isalive())
-    mondat[mon].hnt++;
+  if (ISNOB(st->mondat[mon].mop) && clfirst[2]!=-1 && isalive())
+    st->mondat[mon].hnt++;
 
   /* See if bags push monster back */
 
@@ -407,27 +397,27 @@ monai(struct digger_draw_api *ddap, int16_t mon)
     if (mopos_changed) {
       mopos.x = monox;
       mopos.y = monoy;
-      CALL_METHOD(mondat[mon].mop, setpos, &mopos);
+      CALL_METHOD(st->mondat[mon].mop, setpos, &mopos);
       mopos_changed = false;
     }
-    CALL_METHOD(mondat[mon].mop, animate);
+    CALL_METHOD(st->mondat[mon].mop, animate);
     incpenalty();
-    if (ISNOB(mondat[mon].mop)) /* The other way to create hobbin: stuck on h-bag */
-      mondat[mon].hnt++;
-    if ((mondat[mon].dir==DIR_UP || mondat[mon].dir==DIR_DOWN) &&
-        ISNOB(mondat[mon].mop))
-      mondat[mon].dir=reversedir(mondat[mon].dir); /* If vertical, give up */
+    if (ISNOB(st->mondat[mon].mop)) /* The other way to create hobbin: stuck on h-bag */
+      st->mondat[mon].hnt++;
+    if ((st->mondat[mon].dir==DIR_UP || st->mondat[mon].dir==DIR_DOWN) &&
+        ISNOB(st->mondat[mon].mop))
+      st->mondat[mon].dir=reversedir(st->mondat[mon].dir); /* If vertical, give up */
   }
 
   /* Collision with Digger */
 
   if (clfirst[4]!=-1 && isalive()) {
-    if (bonusmode) {
+    if (dgctx->digger.bonusmode) {
       killmon(mon);
       i=clfirst[4];
       while (i!=-1) {
-        if (digalive(i-FIRSTDIGGER+dgstate.curplayer))
-          sceatm(ddap, i-FIRSTDIGGER+dgstate.curplayer);
+        if (digalive(i-FIRSTDIGGER+dgctx->game.curplayer))
+          sceatm(ddap, i-FIRSTDIGGER+dgctx->game.curplayer);
         i=clcoll[i];
       }
       soundeatm(); /* Collision in bonus mode */
@@ -435,8 +425,8 @@ monai(struct digger_draw_api *ddap, int16_t mon)
     else {
       i=clfirst[4];
       while (i!=-1) {
-        if (digalive(i-FIRSTDIGGER+dgstate.curplayer))
-          killdigger(i-FIRSTDIGGER+dgstate.curplayer,3,0); /* Kill Digger */
+        if (digalive(i-FIRSTDIGGER+dgctx->game.curplayer))
+          killdigger(i-FIRSTDIGGER+dgctx->game.curplayer,3,0); /* Kill Digger */
         i=clcoll[i];
       }
     }
@@ -444,40 +434,41 @@ monai(struct digger_draw_api *ddap, int16_t mon)
 
   /* Update co-ordinates */
 
-  mondat[mon].h=(mopos.x-12)/20;
-  mondat[mon].v=(mopos.y-18)/18;
-  mondat[mon].xr=(mopos.x-12)%20;
-  mondat[mon].yr=(mopos.y-18)%18;
+  st->mondat[mon].h=(mopos.x-12)/20;
+  st->mondat[mon].v=(mopos.y-18)/18;
+  st->mondat[mon].xr=(mopos.x-12)%20;
+  st->mondat[mon].yr=(mopos.y-18)%18;
 }
 
 static void
 mondie(struct digger_draw_api *ddap, int16_t mon)
 {
+  struct monster_state *st=&dgctx->monster;
   struct obj_position monpos;
 
-  switch (mondat[mon].death) {
+  switch (st->mondat[mon].death) {
     case 1:
-      CALL_METHOD(mondat[mon].mop, getpos, &monpos);
-      if (bagy(mondat[mon].bag) + 6 > monpos.y) {
-        monpos.y = bagy(mondat[mon].bag);
-        CALL_METHOD(mondat[mon].mop, setpos, &monpos);
+      CALL_METHOD(st->mondat[mon].mop, getpos, &monpos);
+      if (bagy(st->mondat[mon].bag) + 6 > monpos.y) {
+        monpos.y = bagy(st->mondat[mon].bag);
+        CALL_METHOD(st->mondat[mon].mop, setpos, &monpos);
       }
-      CALL_METHOD(mondat[mon].mop, animate);
+      CALL_METHOD(st->mondat[mon].mop, animate);
       incpenalty();
-      if (getbagdir(mondat[mon].bag)==-1) {
-        mondat[mon].dtime=1;
-        mondat[mon].death=4;
+      if (getbagdir(st->mondat[mon].bag)==-1) {
+        st->mondat[mon].dtime=1;
+        st->mondat[mon].death=4;
       }
       break;
     case 4:
-      if (mondat[mon].dtime!=0)
-        mondat[mon].dtime--;
+      if (st->mondat[mon].dtime!=0)
+        st->mondat[mon].dtime--;
       else {
         killmon(mon);
-        if (dgstate.diggers==2)
+        if (dgctx->game.diggers==2)
           scorekill2(ddap);
         else
-          scorekill(ddap, dgstate.curplayer);
+          scorekill(ddap, dgctx->game.curplayer);
       }
   }
 }
@@ -515,19 +506,21 @@ fieldclear(int16_t dir,int16_t x,int16_t y)
 
 void checkmonscared(int16_t h)
 {
+  struct monster_state *st=&dgctx->monster;
   int16_t m;
   for (m=0;m<MONSTERS;m++)
-    if (h==mondat[m].h && mondat[m].dir==DIR_UP)
-      mondat[m].dir=DIR_DOWN;
+    if (h==st->mondat[m].h && st->mondat[m].dir==DIR_UP)
+      st->mondat[m].dir=DIR_DOWN;
 }
 
 void killmon(int16_t mon)
 {
-  if (mondat[mon].flag) {
-    mondat[mon].flag = false;
-    CALL_METHOD(mondat[mon].mop, kill);
-    if (bonusmode)
-      totalmonsters++;
+  struct monster_state *st=&dgctx->monster;
+  if (st->mondat[mon].flag) {
+    st->mondat[mon].flag = false;
+    CALL_METHOD(st->mondat[mon].mop, kill);
+    if (dgctx->digger.bonusmode)
+      st->totalmonsters++;
   }
 }
 
@@ -538,7 +531,7 @@ void squashmonsters(int16_t bag,int *clfirst,int *clcoll)
 
   while (next!=-1) {
     m=next-FIRSTMONSTER;
-    CALL_METHOD(mondat[m].mop, getpos, &monpos);
+    CALL_METHOD(dgctx->monster.mondat[m].mop, getpos, &monpos);
     if (monpos.y >= bagy(bag))
       squashmonster(m,1,bag);
     next=clcoll[next];
@@ -560,14 +553,16 @@ int16_t killmonsters(int *clfirst,int *clcoll)
 static void
 squashmonster(int16_t mon,int16_t death,int16_t bag)
 {
-  CALL_METHOD(mondat[mon].mop, damage);
-  mondat[mon].death=death;
-  mondat[mon].bag=bag;
+  struct monster_state *st=&dgctx->monster;
+  CALL_METHOD(st->mondat[mon].mop, damage);
+  st->mondat[mon].death=death;
+  st->mondat[mon].bag=bag;
 }
 
 int16_t monleft(void)
 {
-  return nmononscr()+totalmonsters-nextmonster;
+  struct monster_state *st=&dgctx->monster;
+  return nmononscr()+st->totalmonsters-st->nextmonster;
 }
 
 static int16_t
@@ -575,7 +570,7 @@ nmononscr(void)
 {
   int16_t i,n=0;
   for (i=0;i<MONSTERS;i++)
-    if (mondat[i].flag)
+    if (dgctx->monster.mondat[i].flag)
       n++;
   return n;
 }
@@ -586,10 +581,10 @@ void incmont(int16_t n)
   if (n>MONSTERS)
     n=MONSTERS;
   for (m=1;m<n;m++)
-    mondat[m].t++;
+    dgctx->monster.mondat[m].t++;
 }
 
 int16_t getfield(int16_t x,int16_t y)
 {
-  return field[y*15+x];
+  return dgctx->drawing.field[y*15+x];
 }
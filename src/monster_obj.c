@@ -244,6 +244,41 @@ monster_obj_isnobbin(struct monster_obj *self)
   return (self->priv->nobf);
 }
 
+void
+monster_obj_getstate(struct monster_obj *self, struct monster_obj_state *msp)
+{
+  struct monster_obj_private *mop;
+
+  mop = self->priv;
+  memset(msp, '\0', sizeof(struct monster_obj_state));
+  msp->m_id = mop->m_id;
+  msp->nobf = mop->nobf;
+  msp->alive = mop->alive;
+  msp->zombie = mop->zombie;
+  msp->dir = mop->pos.dir;
+  msp->x = mop->pos.x;
+  msp->y = mop->pos.y;
+  msp->monspr = mop->monspr;
+  msp->monspd = mop->monspd;
+}
+
+void
+monster_obj_setstate(struct monster_obj *self, const struct monster_obj_state *msp)
+{
+  struct monster_obj_private *mop;
+
+  mop = self->priv;
+  mop->m_id = msp->m_id;
+  mop->nobf = msp->nobf;
+  mop->alive = msp->alive;
+  mop->zombie = msp->zombie;
+  mop->pos.dir = msp->dir;
+  mop->pos.x = msp->x;
+  mop->pos.y = msp->y;
+  mop->monspr = msp->monspr;
+  mop->monspd = msp->monspd;
+}
+
 int
 monster_obj_dtor(struct monster_obj *self)
 {
@@ -55,6 +55,22 @@ struct monster_obj {
 struct monster_obj *monster_obj_ctor(uint16_t m_id,
  bool nobf, int16_t dir, int16_t x, int16_t y);
 
+/* Plain copy of a monster's private state, for savestates */
+struct monster_obj_state {
+    uint16_t m_id;
+    bool nobf;
+    bool alive;
+    bool zombie;
+    int16_t dir;
+    int16_t x;
+    int16_t y;
+    int16_t monspr;
+    int16_t monspd;
+};
+
+void monster_obj_getstate(struct monster_obj *self, struct monster_obj_state *msp);
+void monster_obj_setstate(struct monster_obj *self, const struct monster_obj_state *msp);
+
 #define MON_NOBBIN true 
 #define MON_HOBBIN false
 
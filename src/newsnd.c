@@ -10,6 +10,7 @@
 #include "sound.h"
 #endif
 #include "newsnd.h"
+#include "game_ctx.h"
 
 #define PIT_FREQ 0x1234ddul
 
@@ -23,14 +24,6 @@
    If DMA is used, doubling the buffer so the data is always continguous, and
    giving half of the buffer at once to the DMA driver may be a good idea. */
 
-static uint16_t t0rate;
-
-#if !defined(newsnd_test)
-extern int16_t spkrmode,pulsewidth;
-#else
-static int16_t spkrmode=0,pulsewidth=1;
-#endif
-
 /* Initialise circular buffer and PC speaker emulator
 
    bufsize = buffer size in samples
@@ -52,24 +45,91 @@ static int16_t spkrmode=0,pulsewidth=1;
 #include <assert.h>
 #include <math.h>
 #include "soundgen.h"
-
-static struct sgen_state *ssp;
-static unsigned int intmod;
+#include "spkfeed.h"
 
 int16_t getsample(void)
 {
+  struct newsnd_state *st=&dgctx->newsnd;
+
+  if ((sgen_getstep(st->ssp) + 1) % st->intmod == 0)
+    soundint();
+  return (sgen_getsample(st->ssp));
+}
 
-  if ((sgen_getstep(ssp) + 1) % intmod == 0)
+/* Same as calling getsample() n times, each sample written nchan times
+   into buf: the samples up to the next soundint() are made in one go. */
+void getsamples(int16_t *buf, unsigned int n, int nchan)
+{
+  struct newsnd_state *st=&dgctx->newsnd;
+  unsigned int k;
+
+  while (n > 0) {
+    k = (st->intmod - (sgen_getstep(st->ssp) + 1) % st->intmod) % st->intmod;
+    if (k >= n) {
+      sgen_fill(st->ssp, buf, n, nchan);
+      return;
+    }
+    sgen_fill(st->ssp, buf, k, nchan);
+    buf += k * nchan;
     soundint();
-  return (sgen_getsample(ssp));
+    sgen_fill(st->ssp, buf, 1, nchan);
+    buf += nchan;
+    n -= k + 1;
+  }
+}
+
+/* Same as calling getsample() n times and dropping the result: soundint()
+   still fires on exactly the same samples, but no waveform is computed. */
+void skipsamples(unsigned int n)
+{
+  struct newsnd_state *st=&dgctx->newsnd;
+  unsigned int k;
+
+  while (n > 0) {
+    k = (st->intmod - (sgen_getstep(st->ssp) + 1) % st->intmod) % st->intmod;
+    if (k >= n) {
+      sgen_advance(st->ssp, n);
+      return;
+    }
+    sgen_advance(st->ssp, k);
+    soundint();
+    sgen_advance(st->ssp, 1);
+    n -= k + 1;
+  }
+}
+
+/* Same as skipsamples(n), queueing on f what the speaker is set to from
+   each soundint() to the next: the n samples are a game tick of ftime
+   microseconds, and f plays them in that time. */
+void feedsamples(struct spkfeed *f, unsigned int n, uint32_t ftime)
+{
+  struct newsnd_state *st=&dgctx->newsnd;
+  struct sgen_voice v;
+  unsigned int k;
+
+  spkfeed_tick(f, n, ftime);
+  while (n > 0) {
+    k = (st->intmod - (sgen_getstep(st->ssp) + 1) % st->intmod) % st->intmod;
+    if (k == 0) {
+      soundint();
+      k = st->intmod;
+    }
+    if (k > n)
+      k = n;
+    sgen_getvoice(st->ssp, &v);
+    spkfeed_put(f, &v, k);
+    sgen_advance(st->ssp, k);
+    n -= k;
+  }
 }
 
 void soundinitglob(uint16_t bufsize,uint16_t samprate)
 {
+  struct newsnd_state *st=&dgctx->newsnd;
 
-  ssp = sgen_ctor(samprate, 2);
-  assert(ssp != NULL);
-  intmod = round(samprate / 72.8);
+  st->ssp = sgen_ctor(samprate, 2);
+  assert(st->ssp != NULL);
+  st->intmod = round(samprate / 72.8);
 #if !defined(newsnd_test)
   setsounddevice(samprate,bufsize);
 #endif
@@ -103,59 +163,63 @@ void s1killsound(void)
 
 void s1timer2(uint16_t t2, bool mode)
 {
+  struct newsnd_state *st=&dgctx->newsnd;
   double rphase;
 
   if (t2 > 40 && t2 < 0x4000) {
-    rphase = sgen_getphase(ssp, T2_BND);
+    rphase = sgen_getphase(st->ssp, T2_BND);
     if (!mode) {
-      sgen_setband(ssp, T2_BND, PIT_FREQ / t2, 1.0);
+      sgen_setband(st->ssp, T2_BND, PIT_FREQ / t2, 1.0);
     } else {
       double frq;
 
-      frq = (double)(PIT_FREQ / t2) - (double)(PIT_FREQ / t0rate);
-      sgen_setband_mod(ssp, T2_BND, frq, 1.0, 0.0);
-      if (sgen_setmuteband(ssp, T2_BND, 0))
+      frq = (double)(PIT_FREQ / t2) - (double)(PIT_FREQ / st->t0rate);
+      sgen_setband_mod(st->ssp, T2_BND, frq, 1.0, 0.0);
+      if (sgen_setmuteband(st->ssp, T2_BND, 0))
         rphase = 0.0;
     }
-    sgen_setphase(ssp, T2_BND, rphase);
+    sgen_setphase(st->ssp, T2_BND, rphase);
   } else {
-    sgen_setband(ssp, T2_BND, 0.0, 0.0);
+    sgen_setband(st->ssp, T2_BND, 0.0, 0.0);
   }
 }
 
 void s1soundoff(void)
 {
+  struct newsnd_state *st=&dgctx->newsnd;
 
-  sgen_setmuteband(ssp, 0, 1);
-  sgen_setmuteband(ssp, 1, 1);
+  sgen_setmuteband(st->ssp, 0, 1);
+  sgen_setmuteband(st->ssp, 1, 1);
 }
 
 void s1setspkrt2(void)
 {
-
-  if (spkrmode == 0) {
-      sgen_setmuteband(ssp, 0, 1);
-      sgen_setmuteband(ssp, 1, 0);
-  } else if (spkrmode == 1) {
-      sgen_setmuteband(ssp, 0, 0);
-      sgen_setmuteband(ssp, 1, 1);
+  struct newsnd_state *st=&dgctx->newsnd;
+
+  if (dgctx->sound.spkrmode == 0) {
+      sgen_setmuteband(st->ssp, 0, 1);
+      sgen_setmuteband(st->ssp, 1, 0);
+  } else if (dgctx->sound.spkrmode == 1) {
+      sgen_setmuteband(st->ssp, 0, 0);
+      sgen_setmuteband(st->ssp, 1, 1);
   } else {
-      sgen_setmuteband(ssp, 0, 1);
-      sgen_setmuteband(ssp, 1, 1);
+      sgen_setmuteband(st->ssp, 0, 1);
+      sgen_setmuteband(st->ssp, 1, 1);
   }
 }
 
 void s1timer0(uint16_t t0)
 {
+  struct newsnd_state *st=&dgctx->newsnd;
   double rphase;
 
   if (t0 > 40 && t0 < 0x4000) {
-    rphase = sgen_getphase(ssp, 0);
-    sgen_setband(ssp, 0, PIT_FREQ / t0, (pulsewidth - 1) / 49.0);
-    sgen_setphase(ssp, 0, rphase);
+    rphase = sgen_getphase(st->ssp, 0);
+    sgen_setband(st->ssp, 0, PIT_FREQ / t0, (dgctx->sound.pulsewidth - 1) / 49.0);
+    sgen_setphase(st->ssp, 0, rphase);
   } else {
-    sgen_setband(ssp, 0, 0.0, 0.0);
+    sgen_setband(st->ssp, 0, 0.0, 0.0);
   }
 
-  t0rate=t0;
+  st->t0rate=t0;
 }
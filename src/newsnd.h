@@ -14,3 +14,7 @@ void s1timer0(uint16_t t0);
 void s1timer2(uint16_t t2, bool mode);
 
 int16_t getsample(void);
+void getsamples(int16_t *buf, unsigned int n, int nchan);
+void skipsamples(unsigned int n);
+struct spkfeed;
+void feedsamples(struct spkfeed *f, unsigned int n, uint32_t ftime);
@@ -2,10 +2,16 @@
    Copyright (c) Andrew Jenner 1998-2004 */
 
 #include <assert.h>
+#include <ctype.h>
 #include <stdio.h>
 #include <stdarg.h>
+#include <stddef.h>
 #include <stdlib.h>
 #include <string.h>
+#ifdef _RP2350
+#include "hardware/flash.h"
+#include "hardware/sync.h"
+#endif
 #include "def.h"
 #include "record.h"
 #include "hardware.h"
@@ -14,50 +20,270 @@
 #include "main.h"
 #include "scores.h"
 #include "sprite.h"
-#include "game.h"
+#include "game_ctx.h"
+#include "snapshot.h"
+#include "drf2.h"
+
+static void makedir(int16_t *dir,bool *fire,char d);
+static char maked(int16_t dir,bool fire);
+static bool recopen(void);
+static bool recsink(void *arg,const void *buf,size_t len);
+static void recflush(void);
+
+/* Keep the game settings a recording changes, for playclose() */
+static void playbegin(void)
+{
+  struct record_state *st=&dgctx->record;
+  st->orig.gtime=dgctx->game.gtime;
+  st->orig.gauntlet=dgctx->game.gauntlet;
+  st->orig.startlev=dgctx->game.startlev;
+  st->orig.nplayers=dgctx->game.nplayers;
+  st->orig.diggers=dgctx->game.diggers;
+}
+
+static void playsettings(char *version,char *buf)
+{
+  struct record_state *st=&dgctx->record;
+  int x;
+  dgctx->game.gauntlet=false;
+  dgctx->game.startlev=1;
+  dgctx->game.nplayers=1;
+  dgctx->game.diggers=1;
+  /* Version for kludge switches */
+  if (atol(version+7)<=19981125l)
+    st->kludge=true;
+  /* Mode */
+  if (*buf=='1') {
+    dgctx->game.nplayers=1;
+    x=1;
+  }
+  else
+    if (*buf=='2') {
+      dgctx->game.nplayers=2;
+      x=1;
+    }
+    else {
+      if (*buf=='M') {
+        dgctx->game.diggers=buf[1]-'0';
+        x=2;
+      }
+      else
+        x=0;
+      if (buf[x]=='G') {
+        dgctx->game.gauntlet=true;
+        x++;
+        dgctx->game.gtime=atoi(buf+x);
+        while (buf[x]>='0' && buf[x]<='9')
+          x++;
+      }
+    }
+  if (buf[x]=='U') /* Unlimited lives are ignored on playback. */
+    x++;
+  if (buf[x]=='I')
+    dgctx->game.startlev=atoi(buf+x+1);
+}
+
+static void playstart(void)
+{
+  struct record_state *st=&dgctx->record;
+  st->playing=true;
+  st->playframe=0;
+  recinit();
+}
+
+/* Set up playback of the binary DRF of len bytes at buf, which has to stay
+   there until playclose() */
+static bool playbin(const uint8_t *buf,uint32_t len)
+{
+  struct record_state *st=&dgctx->record;
+  struct drf2_dec dec;
+  char version[80],mode[80];
+  int32_t bonus;
+  playbegin();
+  if (!drf2_open(&dec,buf,len,version,mode,&bonus,dgctx->game.leveldat))
+    return false;
+  playsettings(version,mode);
+  dgctx->scores.bonusscore=bonus;
+  st->plb=st->plp=(char *)buf;
+  st->plbin=true;
+  st->dec=dec;
+  playstart();
+  return true;
+}
+
+/* Where playback is in the recording */
+static uint32_t playpos(void)
+{
+  struct record_state *st=&dgctx->record;
+  return st->plbin ? st->dec.pos : (uint32_t)(st->plp-st->plb);
+}
 
 #ifdef _RP2350
-/* On RP2350: recording stubs (no filesystem) */
-bool playing=false,savedrf=false,gotname=false,gotgame=false,drfvalid=true,
-     kludge=false;
-
-static char huge *recb = NULL;
-static uint32_t recp = 0;
-static int reccc = 0, recrl = 0;
-
-void openplay(char *name) { escape = true; }
-void recstart(void) { recb = (char huge *)malloc(1024); recp = 0; }
-void recinit(void) { recp = 0; drfvalid = true; reccc = recrl = 0; }
-void recputdir(int16_t dir, bool fire) { (void)dir; (void)fire; }
-void recputrand(uint32_t randv) { (void)randv; }
-void recsavedrf(void) {}
-void playskipeol(void) {}
-uint32_t playgetrand(void) { return 0; }
-void playgetdir(int16_t *dir, bool *fire) { *dir = DIR_NONE; *fire = false; }
-void recputinit(char *init) { (void)init; }
-void recputeol(void) {}
-void recputeog(void) {}
-void recname(char *name) { (void)name; }
+/* On RP2350 games are recorded into flash, just below the high scores, in
+   two slots. A game goes into the slot that does not hold the last complete
+   recording, so that one can still be played back if the new game is never
+   finished. A slot is a header page, written when the game is over, and
+   the binary DRF after it. The recording collects in RAM and is written out
+   between levels, so flash is not erased or programmed during play. */
+#define RECFLASH_SLOT   (256*1024)
+#define RECFLASH_OFFSET (PICO_FLASH_SIZE_BYTES-FLASH_SECTOR_SIZE- \
+                         2*RECFLASH_SLOT)
+#define RECFLASH_MAGIC  0x46524744  /* "DGRF" */
+#define RECBUF_SIZE     4096
+
+struct recslot {
+  uint32_t magic,seq;
+  uint32_t len;             /* of the DRF after the header page */
+};
+
+static struct {
+  bool active;
+  uint32_t slot;            /* flash offset of the slot recorded into */
+  uint32_t seq;             /* sequence number it will get */
+  uint32_t flashed;         /* bytes of the DRF programmed so far */
+  uint32_t erased;          /* bytes of the slot erased so far */
+  uint32_t len;             /* bytes waiting in buf */
+  uint8_t buf[RECBUF_SIZE];
+} recfl;
+
+static const struct recslot *slothdr(int i)
+{
+  return (const struct recslot *)(XIP_BASE+RECFLASH_OFFSET+i*RECFLASH_SLOT);
+}
 
-#else /* !_RP2350 */
+/* The slot holding the last complete recording, or -1 */
+static int lastslot(void)
+{
+  int i,last=-1;
+  for (i=0;i<2;i++)
+    if (slothdr(i)->magic==RECFLASH_MAGIC &&
+        slothdr(i)->len<=RECFLASH_SLOT-FLASH_PAGE_SIZE &&
+        (last<0 || (int32_t)(slothdr(i)->seq-slothdr(last)->seq)>0))
+      last=i;
+  return last;
+}
 
-static char huge *recb,huge *plb,huge *plp;
+/* Program len bytes, a multiple of the page size, at off in the slot,
+   erasing it as far as needed first. As in writescores(), core 1 runs from
+   RAM, so only the interrupts of this core are held off. */
+static void slotprogram(uint32_t off,const uint8_t *p,uint32_t len)
+{
+  uint32_t ints=save_and_disable_interrupts();
+  while (recfl.erased<off+len) {
+    flash_range_erase(recfl.slot+recfl.erased,FLASH_SECTOR_SIZE);
+    recfl.erased+=FLASH_SECTOR_SIZE;
+  }
+  flash_range_program(recfl.slot+off,p,len);
+  restore_interrupts(ints);
+}
+
+void recstart(void)
+{
+}
 
-bool playing=false,savedrf=false,gotname=false,gotgame=false,drfvalid=true,
-     kludge=false;
+void recstop(void)
+{
+  recfl.active=false;
+  dgctx->record.enc.sink=NULL;
+}
 
-static char rname[128];
+static bool recopen(void)
+{
+  int last=lastslot();
+  recfl.active=!dgctx->record.playing;
+  recfl.slot=RECFLASH_OFFSET+(last==0 ? RECFLASH_SLOT : 0);
+  recfl.seq=(last<0) ? 1 : slothdr(last)->seq+1;
+  recfl.flashed=recfl.erased=recfl.len=0;
+  return recfl.active;
+}
 
-static int reccc=0,recrl=0,rlleft=0;
-static uint32_t recp=0;
-static char recd,rld;
+/* Write out the whole pages collected so far */
+static void recflush(void)
+{
+  uint32_t n=recfl.len&~(FLASH_PAGE_SIZE-1);
+  if (!recfl.active || n==0)
+    return;
+  slotprogram(FLASH_PAGE_SIZE+recfl.flashed,recfl.buf,n);
+  recfl.flashed+=n;
+  recfl.len-=n;
+  memmove(recfl.buf,recfl.buf+n,recfl.len);
+}
 
-static void mprintf(const char *f,...) __attribute__((format(printf, 1, 2)));
-static void makedir(int16_t *dir,bool *fire,char d);
-static char maked(int16_t dir,bool fire);
+static bool recsink(void *arg,const void *buf,size_t len)
+{
+  struct record_state *st=arg;
+  /* A rewind takes the encoder back, which works as long as what it goes
+     back over is still in RAM */
+  if (!recfl.active || st->enc.size<recfl.flashed ||
+      st->enc.size>recfl.flashed+recfl.len ||
+      FLASH_PAGE_SIZE+st->enc.size+len>RECFLASH_SLOT) {
+    recfl.active=false;
+    return false;
+  }
+  recfl.len=st->enc.size-recfl.flashed;
+  if (recfl.len+len>RECBUF_SIZE)
+    recflush();             /* A very long level: has to be done now */
+  memcpy(recfl.buf+recfl.len,buf,len);
+  recfl.len+=len;
+  return true;
+}
+
+/* The game is over: make its recording the one played back by
+   playlast() */
+void recend(void)
+{
+  struct record_state *st=&dgctx->record;
+  uint8_t page[FLASH_PAGE_SIZE];
+  struct recslot hdr;
+  uint32_t n;
+  if (!recfl.active || !st->drfvalid || st->playing)
+    return;
+  if (!drf2_end(&st->enc)) {
+    recfl.active=false;
+    return;
+  }
+  n=(recfl.len+FLASH_PAGE_SIZE-1)&~(FLASH_PAGE_SIZE-1);
+  memset(recfl.buf+recfl.len,0xff,n-recfl.len);
+  recfl.len=n;
+  recflush();
+  hdr.magic=RECFLASH_MAGIC;
+  hdr.seq=recfl.seq;
+  hdr.len=st->enc.size;
+  memset(page,0xff,sizeof(page));
+  memcpy(page,&hdr,sizeof(hdr));
+  slotprogram(0,page,sizeof(page));
+  recfl.active=false;
+}
+
+void recsavedrf(void)
+{
+}
+
+bool playlast(void)
+{
+  int i=lastslot();
+  if (i<0)
+    return false;
+  return playbin((const uint8_t *)slothdr(i)+FLASH_PAGE_SIZE,slothdr(i)->len);
+}
+
+#else /* !_RP2350 */
 
 #define DEFAULTSN "DIGGER.DRF"
 
+/* Seek index kept next to a recording as <name>.idx: a playidx_hdr, then
+   every PLAYIDX_EVERY frames of playback the position in the recording and
+   a snapshot of the game there. Each context has its own, in its
+   record_state. */
+#define PLAYIDX_VERSION 1
+
+struct idxent {
+  uint32_t frame,offset;
+};
+
+static void idxopen(char *name,int32_t l);
+static void idxclose(void);
+
 #ifdef INTDRF
 FILE *info;
 #endif
@@ -83,25 +309,86 @@ smart_fgets(char * restrict str, int size, FILE * restrict stream)
   return (rval);
 }
 
-void openplay(char *name)
+static bool filesink(void *arg,const void *buf,size_t len)
+{
+  return fwrite(buf,len,1,(FILE *)arg)==1;
+}
+
+/* Read the rest of f from the start into memory */
+static char *readfile(FILE *f,int32_t *len)
+{
+  char *buf;
+  long l;
+  if (fseek(f,0,SEEK_END)<0 || (l=ftell(f))<0 || fseek(f,0,SEEK_SET)<0 ||
+      (buf=malloc(l>0 ? l : 1))==NULL)
+    return NULL;
+  if (l>0 && fread(buf,l,1,f)!=1) {
+    free(buf);
+    return NULL;
+  }
+  *len=l;
+  return buf;
+}
+
+/* Convert a recording from text to binary or back, whichever it is not */
+bool drfconvert(char *in,char *out)
+{
+  FILE *f=fopen(in,"rb"),*g;
+  char *buf;
+  int32_t l;
+  bool ok;
+  if (f==NULL)
+    return false;
+  buf=readfile(f,&l);
+  fclose(f);
+  if (buf==NULL)
+    return false;
+  if ((g=fopen(out,"wb"))!=NULL) {
+    if (drf2_detect(buf,l))
+      ok=drf2_totext((uint8_t *)buf,l,filesink,g);
+    else
+      ok=drf2_fromtext(buf,l,filesink,g);
+    ok=fclose(g)==0 && ok;
+  }
+  else
+    ok=false;
+  free(buf);
+  return ok;
+}
+
+/* Load a recording and set the game up to play it back with game() or
+   startgame(). With index, seek keyframes are taken from, or added to, the
+   index file of the recording. */
+bool playopen(char *name,bool index)
 {
+  struct record_state *st=&dgctx->record;
   FILE *playf=fopen(name,"rb");
   int32_t l,i;
-  char buf[80];
-  int c,x,y,n,origgtime=dgstate.gtime;
-  bool origg=dgstate.gauntlet;
-  int16_t origstartlev=dgstate.startlev,orignplayers=dgstate.nplayers,origdiggers=dgstate.diggers;
+  char buf[80],version[80];
+  uint8_t magic[5];
+  int c,x,y,n;
+  playbegin();
 #ifdef INTDRF
   info=fopen("DRFINFO.TXT","wt");
 #endif
-  if (playf==NULL) {
-    escape=true;
-    return;
+  if (playf==NULL)
+    return false;
+  /* A binary recording is played straight from memory */
+  if (fread(magic,sizeof(magic),1,playf)==1 &&
+      drf2_detect(magic,sizeof(magic))) {
+    char *b=readfile(playf,&l);
+    fclose(playf);
+    if (b==NULL)
+      return false;
+    if (!playbin((uint8_t *)b,l)) {
+      free(b);
+      return false;
+    }
+    if (index)
+      idxopen(name,l);
+    return true;
   }
-  dgstate.gauntlet=false;
-  dgstate.startlev=1;
-  dgstate.nplayers=1;
-  dgstate.diggers=1;
+  rewind(playf);
   /* The file is in two distint parts. In the first, line breaks are used as
      separators. In the second, they are ignored. This is the first. */
 
@@ -112,49 +399,19 @@ void openplay(char *name)
   if (buf[0]!='D' || buf[1]!='R' || buf[2]!='F') {
     goto out_0;
   }
-  /* Get version for kludge switches */
-  if (smart_fgets(buf, 80, playf) == NULL) {
+  /* Get version and mode */
+  if (smart_fgets(version, 80, playf) == NULL) {
     goto out_0;
   }
-  if (atol(buf+7)<=19981125l)
-    kludge=true;
-  /* Get mode */
   if (smart_fgets(buf, 80, playf) == NULL) {
     goto out_0;
   }
-  if (*buf=='1') {
-    dgstate.nplayers=1;
-    x=1;
-  }
-  else
-    if (*buf=='2') {
-      dgstate.nplayers=2;
-      x=1;
-    }
-    else {
-      if (*buf=='M') {
-        dgstate.diggers=buf[1]-'0';
-        x=2;
-      }
-      else
-        x=0;
-      if (buf[x]=='G') {
-        dgstate.gauntlet=true;
-        x++;
-        dgstate.gtime=atoi(buf+x);
-        while (buf[x]>='0' && buf[x]<='9')
-          x++;
-      }
-    }
-  if (buf[x]=='U') /* Unlimited lives are ignored on playback. */
-    x++;
-  if (buf[x]=='I')
-    dgstate.startlev=atoi(buf+x+1);
+  playsettings(version,buf);
   /* Get bonus score */
   if (smart_fgets(buf, 80, playf) == NULL) {
     goto out_0;
   }
-  bonusscore=atoi(buf);
+  dgctx->scores.bonusscore=atoi(buf);
   for (n=0;n<8;n++)
     for (y=0;y<10;y++) {
       for (x=0;x<15;x++)
@@ -164,7 +421,7 @@ void openplay(char *name)
         goto out_0;
       }
       for (x=0;x<15;x++)
-        dgstate.leveldat[n][y][x]=buf[x];
+        dgctx->game.leveldat[n][y][x]=buf[x];
     }
 
   /* This is the second. The line breaks here really are only so that the file
@@ -176,8 +433,8 @@ void openplay(char *name)
   l=ftell(playf)-i;
   if (l < 0 || fseek(playf,i,SEEK_SET) < 0)
     goto out_0;
-  plb=plp=(char huge *)farmalloc(l);
-  if (plb==(char huge *)NULL) {
+  st->plb=st->plp=(char huge *)farmalloc(l+1);
+  if (st->plb==(char huge *)NULL) {
     goto out_0;
   }
 
@@ -186,232 +443,268 @@ void openplay(char *name)
     if (c == EOF)
       goto out_0;
     if (c>=' ')
-      *(plp++)= (char)c;
+      *(st->plp++)= (char)c;
   }
   fclose(playf);
-  plp=plb;
-
-  playing=true;
-  recinit();
-  game();
-  gotgame=true;
-  playing=false;
-  farfree(plb);
-  dgstate.gauntlet=origg;
-  dgstate.gtime=origgtime;
-  kludge=false;
-  dgstate.startlev=origstartlev;
-  dgstate.diggers=origdiggers;
-  dgstate.nplayers=orignplayers;
-  return;
+  *st->plp=0;   /* So that nothing is read past the end */
+  l=st->plp-st->plb;
+  st->plp=st->plb;
+
+  st->plbin=false;
+  playstart();
+  if (index)
+    idxopen(name,l);
+  return true;
 out_0:
   if (playf != NULL) {
     fclose(playf);
   }
-  escape = true;
+  return false;
 }
 
-void recstart(void)
+void openplay(char *name)
 {
-  uint32_t s=MAX_REC_BUFFER;
-  do {
-    recb=(char huge *)farmalloc(s);
-    if (recb==NULL)
-      s>>=1;
-  } while (recb==(char huge *)NULL && s>1024);
-  if (recb==NULL) {
-    finish();
-    printf("Cannot allocate memory for recording buffer.\n");
-    exit(1);
+  if (!playopen(name,false)) {
+    dgctx->input.escape=true;
+    return;
   }
-  recp=0;
+  game();
+  playclose();
 }
 
-static void mprintf(const char *f,...)
+static uint32_t idxhash(const char *p,int32_t l)
 {
-  va_list ap;
-  char buf[80];
-  int i,l;
-  va_start(ap,f);
-  vsprintf(buf,f,ap);
-  va_end(ap);
-  l=strlen(buf);
-  for (i=0;i<l;i++)
-    recb[recp+i]=buf[i];
-  recp+=l;
-  if (recp>MAX_REC_BUFFER-80)
-    recp=0;          /* Give up, file is too long */
+  uint32_t h=2166136261ul;
+  while (l-->0)
+    h=(h^(uint8_t)*p++)*16777619ul;
+  return h;
 }
 
-static void makedir(int16_t *dir,bool *fire,char d)
+static void idxopen(char *name,int32_t l)
 {
-  if (d>='A' && d<='Z') {
-    *fire=true;
-    d-='A'-'a';
-  }
-  else
-    *fire=false;
-  switch (d) {
-    case 's': *dir=DIR_NONE; break;
-    case 'r': *dir=DIR_RIGHT; break;
-    case 'u': *dir=DIR_UP; break;
-    case 'l': *dir=DIR_LEFT; break;
-    case 'd': *dir=DIR_DOWN; break;
+  struct record_state *st=&dgctx->record;
+  char iname[sizeof(st->rname)+4];
+  struct playidx_hdr hdr;
+  idxclose();
+  if (strlen(name)+5>sizeof(iname))
+    return;
+  sprintf(iname,"%s.idx",name);
+  memcpy(st->idx.hdr.magic,"DGIX",4);
+  st->idx.hdr.version=PLAYIDX_VERSION;
+  st->idx.hdr.every=PLAYIDX_EVERY;
+  st->idx.hdr.snapsize=snapshot(NULL,0,0);
+  st->idx.hdr.drflen=l;
+  st->idx.hdr.drfhash=idxhash(st->plb,l);
+  st->idx.hdr.count=0;
+  st->idx.snap=malloc(st->idx.hdr.snapsize);
+  if (st->idx.snap==NULL)
+    return;
+  st->idx.f=fopen(iname,"r+b");
+  if (st->idx.f!=NULL && fread(&hdr,sizeof(hdr),1,st->idx.f)==1 &&
+      memcmp(&hdr,&st->idx.hdr,offsetof(struct playidx_hdr,count))==0)
+    st->idx.hdr.count=hdr.count;  /* Made from this recording: carry on */
+  else {
+    if (st->idx.f!=NULL)
+      fclose(st->idx.f);
+    st->idx.f=fopen(iname,"w+b");
+    if (st->idx.f==NULL ||
+        fwrite(&st->idx.hdr,sizeof(st->idx.hdr),1,st->idx.f)!=1)
+      idxclose();
   }
 }
 
-void playgetdir(int16_t *dir,bool *fire)
+/* Close the index of the recording this context plays back */
+static void idxclose(void)
 {
-  if (rlleft>0) {
-    makedir(dir,fire,rld);
-    rlleft--;
-  }
-  else {
-    if (*plp=='E' || *plp=='e') {
-      escape=true;
-      return;
-    }
-    rld=*(plp++);
-    while (*plp>='0' && *plp<='9')
-      rlleft=rlleft*10+((*(plp++))-'0');
-    makedir(dir,fire,rld);
-    if (rlleft>0)
-      rlleft--;
+  struct record_state *st=&dgctx->record;
+  if (st->idx.f!=NULL)
+    fclose(st->idx.f);
+  free(st->idx.snap);
+  memset(&st->idx,0,sizeof(st->idx));
+}
+
+static long idxpos(uint32_t k)
+{
+  return sizeof(struct playidx_hdr)+
+         (long)k*(sizeof(struct idxent)+dgctx->record.idx.hdr.snapsize);
+}
+
+/* Write the keyframe for the current frame of playback */
+static void idxappend(void)
+{
+  struct record_state *st=&dgctx->record;
+  struct idxent ent;
+  ent.frame=st->playframe;
+  ent.offset=playpos();
+  snapshot(st->idx.snap,st->idx.hdr.snapsize,0);
+  if (fseek(st->idx.f,idxpos(st->idx.hdr.count),SEEK_SET)<0 ||
+      fwrite(&ent,sizeof(ent),1,st->idx.f)!=1 ||
+      fwrite(st->idx.snap,st->idx.hdr.snapsize,1,st->idx.f)!=1) {
+    idxclose();
+    return;
   }
+  st->idx.hdr.count++;
+  if (fseek(st->idx.f,0,SEEK_SET)<0 ||
+      fwrite(&st->idx.hdr,sizeof(st->idx.hdr),1,st->idx.f)!=1)
+    idxclose();
 }
 
-static char maked(int16_t dir,bool fire)
+/* Give up on an index that cannot be trusted: mark it empty, so it is
+   written afresh next time the recording is opened, and close it */
+static void idxdrop(void)
 {
-  char d;
-  if (dir==DIR_NONE)
-    d='s';
-  else
-    d="ruld"[dir>>1];
-  if (fire)
-    d+='A'-'a';
-  return d;
+  struct record_state *st=&dgctx->record;
+  st->idx.hdr.count=0;
+  if (fseek(st->idx.f,0,SEEK_SET)==0)
+    fwrite(&st->idx.hdr,sizeof(st->idx.hdr),1,st->idx.f);
+  idxclose();
 }
 
-void putrun(void)
+/* Restore keyframe k of the index. The index is a file on disk and may be
+   stale or damaged, so a keyframe that does not put playback where it says
+   it does is not trusted: the game goes back to how it was and the index is
+   dropped. */
+static bool idxrestore(uint32_t k)
 {
-  if (recrl>1)
-    mprintf("%c%i",recd,recrl);
-  else
-    mprintf("%c",recd);
-  reccc++;
-  if (recrl>1) {
-    reccc++;
-    if (recrl>=10) {
-      reccc++;
-      if (recrl>=100)
-        reccc++;
-    }
+  struct record_state *st=&dgctx->record;
+  struct idxent ent;
+  size_t size=st->idx.hdr.snapsize;
+  uint8_t *undo;
+  bool ok=false;
+  if ((undo=malloc(size))==NULL)
+    return false;
+  if (fseek(st->idx.f,idxpos(k),SEEK_SET)<0 ||
+      fread(&ent,sizeof(ent),1,st->idx.f)!=1 ||
+      ent.frame!=k*st->idx.hdr.every ||
+      fread(st->idx.snap,size,1,st->idx.f)!=1) {
+    free(undo);
+    idxdrop();
+    return false;
   }
-  if (reccc>=60) {
-    mprintf("\n");
-    reccc=0;
+  snapshot(undo,size,0);
+  if (restore(st->idx.snap,size)) {
+    ok=st->playframe==ent.frame && playpos()==ent.offset;
+    if (!ok)
+      restore(undo,size);
   }
+  free(undo);
+  if (!ok)
+    idxdrop();
+  return ok;
 }
 
-void recputdir(int16_t dir,bool fire)
+/* Move playback to the given frame: restore the nearest keyframe at or
+   before it, if that is closer than where we are, and play on from there.
+   Without a usable index only forward seeks are possible. */
+bool playseek(uint32_t frame)
 {
-  char d=maked(dir,fire);
-  if (recrl==0)
-    recd=d;
-  if (recd!=d) {
-    putrun();
-    recd=d;
-    recrl=1;
+  struct record_state *st=&dgctx->record;
+  uint32_t k=frame/PLAYIDX_EVERY;
+  if (!st->playing)
+    return false;
+  if (st->idx.f!=NULL && st->idx.hdr.count>0) {
+    if (k>=st->idx.hdr.count)
+      k=st->idx.hdr.count-1;
+    if (frame<st->playframe || k*st->idx.hdr.every>st->playframe)
+      idxrestore(k);
   }
-  else {
-    if (recrl==999) {
-      putrun(); /* This probably won't ever happen. */
-      recrl=0;
-    }
-    recrl++;
+  if (frame<st->playframe)
+    return false;
+  while (st->playframe<frame)
+    if (!digger_step(NULL))
+      return false;
+  return true;
+}
+
+/* The recording is encoded as it is played into a temporary file, which
+   recsavedrf() copies out. */
+void recstart(void)
+{
+  struct record_state *st=&dgctx->record;
+  if (st->recf==NULL)
+    st->recf=tmpfile();
+  if (st->recf==NULL) {
+    finish();
+    printf("Cannot create temporary file for recording.\n");
+    exit(1);
   }
 }
 
-void recinit(void)
+/* Games of this context are not recorded any more */
+void recstop(void)
 {
-  int x,y,l;
-  recp=0;
-  drfvalid=true;
+  struct record_state *st=&dgctx->record;
+  if (st->recf!=NULL)
+    fclose(st->recf);
+  st->recf=NULL;
+  st->enc.sink=NULL;
+}
 
-  mprintf("DRF\n"); /* Required at start of DRF */
-  if (kludge)
-    mprintf("AJ DOS 19981125\n");
-  else
-    mprintf(DIGGER_VERSION"\n");
-  if (dgstate.diggers>1) {
-    mprintf("M%i",dgstate.diggers);
-    if (dgstate.gauntlet)
-      mprintf("G%i",dgstate.gtime);
-  }
-  else
-    if (dgstate.gauntlet)
-      mprintf("G%i",dgstate.gtime);
-    else
-      mprintf("%i",dgstate.nplayers);
-/*  if (unlimlives)
-    mprintf("U"); */
-  if (dgstate.startlev>1)
-    mprintf("I%i",dgstate.startlev);
-  mprintf("\n%i\n",bonusscore);
-  for (l=0;l<8;l++) {
-    for (y=0;y<MHEIGHT;y++) {
-      for (x=0;x<MWIDTH;x++)
-        mprintf("%c",dgstate.leveldat[l][y][x]);
-      mprintf("\n");
-    }
-  }
-  reccc=recrl=0;
+static bool recopen(void)
+{
+  return dgctx->record.recf!=NULL;
 }
 
-void recputrand(uint32_t randv)
+/* The encoder may have been put back to an earlier point by restore(), so
+   each chunk goes where the encoder says it is. */
+static bool recsink(void *arg,const void *buf,size_t len)
 {
-  mprintf("%08lX\n", (unsigned long)randv);
-  reccc=recrl=0;
+  struct record_state *st=arg;
+  return fseek(st->recf,st->enc.size,SEEK_SET)==0 &&
+         fwrite(buf,len,1,st->recf)==1;
+}
+
+static void recflush(void)
+{
+  if (dgctx->record.recf!=NULL)
+    fflush(dgctx->record.recf);
+}
+
+/* The game is over: its recording is what playlast() plays back */
+void recend(void)
+{
+  drf2_end(&dgctx->record.enc);
 }
 
 void recsavedrf(void)
 {
+  struct record_state *st=&dgctx->record;
   FILE *recf;
   uint32_t i;
-  int j;
+  int j,c;
   bool gotfile=true;
   char nambuf[80],init[4];
-  if (!drfvalid)
+  if (!st->drfvalid || st->recf==NULL || !drf2_end(&st->enc))
     return;
-  if (gotname) {
-    if ((recf=fopen(rname,"wt"))==NULL)
-      gotname=false;
+  if (st->gotname) {
+    if ((recf=fopen(st->rname,"wb"))==NULL)
+      st->gotname=false;
     else
       gotfile=true;
   }
-  if (!gotname) {
-    if (dgstate.nplayers==2)
-      recf=fopen(DEFAULTSN,"wt"); /* Should get a name, really */
+  if (!st->gotname) {
+    if (dgctx->game.nplayers==2)
+      recf=fopen(DEFAULTSN,"wb"); /* Should get a name, really */
     else {
       for (j=0;j<3;j++) {
-        init[j]=scoreinit[0][j];
+        init[j]=dgctx->scores.scoreinit[0][j];
         if (!((init[j]>='A' && init[j]<='Z') ||
               (init[j]>='a' && init[j]<='z')))
           init[j]='_';
       }
       init[3]=0;
-      if (scoret<100000l)
-        sprintf(nambuf,"%s%i",init,scoret);
+      if (dgctx->scores.scoret<100000l)
+        sprintf(nambuf,"%s%i",init,dgctx->scores.scoret);
       else
         if (init[2]=='_')
-          sprintf(nambuf,"%c%c%i",init[0],init[1],scoret);
+          sprintf(nambuf,"%c%c%i",init[0],init[1],dgctx->scores.scoret);
         else
           if (init[0]=='_')
-            sprintf(nambuf,"%c%c%i",init[1],init[2],scoret);
+            sprintf(nambuf,"%c%c%i",init[1],init[2],dgctx->scores.scoret);
           else
-            sprintf(nambuf,"%c%c%i",init[0],init[2],scoret);
+            sprintf(nambuf,"%c%c%i",init[0],init[2],dgctx->scores.scoret);
       strcat(nambuf,".drf");
-      recf=fopen(nambuf,"wt");
+      recf=fopen(nambuf,"wb");
     }
     if (recf==NULL)
       gotfile=false;
@@ -420,59 +713,238 @@ void recsavedrf(void)
   }
   if (!gotfile)
     return;
-  for (i=0;i<recp;i++)
-    fputc(recb[i],recf);
+  if (fseek(st->recf,0,SEEK_SET)==0)
+    for (i=0;i<st->enc.size;i++)
+      if ((c=fgetc(st->recf))==EOF || fputc(c,recf)==EOF)
+        break;
   fclose(recf);
 }
 
+bool playlast(void)
+{
+  struct record_state *st=&dgctx->record;
+  uint8_t *buf;
+  if (st->recf==NULL || !st->enc.ended || st->enc.failed ||
+      (buf=malloc(st->enc.size))==NULL)
+    return false;
+  if (fseek(st->recf,0,SEEK_SET)<0 ||
+      fread(buf,st->enc.size,1,st->recf)!=1 ||
+      !playbin(buf,st->enc.size)) {
+    free(buf);
+    return false;
+  }
+  return true;
+}
+
+#endif /* !_RP2350 */
+
+/* Done playing back: put the game settings back as they were */
+void playclose(void)
+{
+  struct record_state *st=&dgctx->record;
+#ifndef _RP2350
+  idxclose();
+  farfree(st->plb);
+#endif
+  st->gotgame=true;
+  st->playing=false;
+  st->plb=st->plp=NULL;
+  st->plbin=false;
+  dgctx->game.gauntlet=st->orig.gauntlet;
+  dgctx->game.gtime=st->orig.gtime;
+  st->kludge=false;
+  dgctx->game.startlev=st->orig.startlev;
+  dgctx->game.diggers=st->orig.diggers;
+  dgctx->game.nplayers=st->orig.nplayers;
+}
+
+/* Called before each frame of playback */
+void playtick(void)
+{
+  struct record_state *st=&dgctx->record;
+#ifndef _RP2350
+  if (st->idx.f!=NULL && st->playframe%st->idx.hdr.every==0 &&
+      st->playframe/st->idx.hdr.every==st->idx.hdr.count)
+    idxappend();
+#endif
+  st->playframe++;
+}
+
+uint32_t playframe(void)
+{
+  return dgctx->record.playframe;
+}
+
+static void makedir(int16_t *dir,bool *fire,char d)
+{
+  if (d>='A' && d<='Z') {
+    *fire=true;
+    d-='A'-'a';
+  }
+  else
+    *fire=false;
+  switch (d) {
+    case 's': *dir=DIR_NONE; break;
+    case 'r': *dir=DIR_RIGHT; break;
+    case 'u': *dir=DIR_UP; break;
+    case 'l': *dir=DIR_LEFT; break;
+    case 'd': *dir=DIR_DOWN; break;
+  }
+}
+
+void playgetdir(int16_t *dir,bool *fire)
+{
+  struct record_state *st=&dgctx->record;
+  char d;
+  if (st->plbin) {
+    if (drf2_getdir(&st->dec,(uint8_t *)st->plb,&d))
+      makedir(dir,fire,d);
+    else
+      dgctx->input.escape=true;
+    return;
+  }
+  if (st->rlleft>0) {
+    makedir(dir,fire,st->rld);
+    st->rlleft--;
+  }
+  else {
+    if (*st->plp=='E' || *st->plp=='e') {
+      dgctx->input.escape=true;
+      return;
+    }
+    st->rld=*(st->plp++);
+    while (*st->plp>='0' && *st->plp<='9')
+      st->rlleft=st->rlleft*10+((*(st->plp++))-'0');
+    makedir(dir,fire,st->rld);
+    if (st->rlleft>0)
+      st->rlleft--;
+  }
+}
+
+static char maked(int16_t dir,bool fire)
+{
+  char d;
+  if (dir==DIR_NONE)
+    d='s';
+  else
+    d="ruld"[dir>>1];
+  if (fire)
+    d+='A'-'a';
+  return d;
+}
+
+void recputdir(int16_t dir,bool fire)
+{
+  drf2_putdir(&dgctx->record.enc,maked(dir,fire));
+}
+
+void recinit(void)
+{
+  struct record_state *st=&dgctx->record;
+  char mode[32];
+  int n=0;
+  st->drfvalid=true;
+
+  if (dgctx->game.diggers>1) {
+    n+=sprintf(mode+n,"M%i",dgctx->game.diggers);
+    if (dgctx->game.gauntlet)
+      n+=sprintf(mode+n,"G%i",dgctx->game.gtime);
+  }
+  else
+    if (dgctx->game.gauntlet)
+      n+=sprintf(mode+n,"G%i",dgctx->game.gtime);
+    else
+      n+=sprintf(mode+n,"%i",dgctx->game.nplayers);
+/*  if (unlimlives)
+    n+=sprintf(mode+n,"U"); */
+  if (dgctx->game.startlev>1)
+    n+=sprintf(mode+n,"I%i",dgctx->game.startlev);
+  drf2_begin(&st->enc,recopen() ? recsink : NULL,st,
+             st->kludge ? "AJ DOS 19981125" : DIGGER_VERSION,mode,
+             dgctx->scores.bonusscore,
+             (const int8_t (*)[10][15])dgctx->game.leveldat);
+}
+
+void recputrand(uint32_t randv)
+{
+  drf2_putrand(&dgctx->record.enc,randv);
+}
+
+/* At a level boundary the recording does not hold what the game expects:
+   it has got out of step, so stop playing it back rather than go on with
+   the rest of it read wrongly. Text and binary recordings stop at the same
+   place. */
+static void playlost(void)
+{
+  dgctx->input.escape=true;
+}
+
 void playskipeol(void)
 {
-  plp+=3;
+  struct record_state *st=&dgctx->record;
+  if (st->plbin) {
+    if (!drf2_skipeol(&st->dec,(uint8_t *)st->plb))
+      playlost();
+  }
+  else
+    if (toupper(st->plp[0])=='E' && toupper(st->plp[1])=='O' &&
+        toupper(st->plp[2])=='L')
+      st->plp+=3;
+    else
+      playlost();
 }
 
 uint32_t playgetrand(void)
 {
+  struct record_state *st=&dgctx->record;
   int i;
   uint32_t r=0;
   char p;
-  if ((*plp)=='*')
-    plp+=4;
+  if (st->plbin) {
+    if (!drf2_getrand(&st->dec,(uint8_t *)st->plb,&r))
+      playlost();
+    return r;
+  }
+  if ((*st->plp)=='*')
+    st->plp+=4;
   for (i=0;i<8;i++) {
-    p=*(plp++);
+    p=*st->plp;
     if (p>='0' && p<='9')
       r|=(uint32_t)(p-'0')<<((7-i)<<2);
-    if (p>='A' && p<='F')
+    else if (p>='A' && p<='F')
       r|=(uint32_t)(p-'A'+10)<<((7-i)<<2);
-    if (p>='a' && p<='f')
+    else if (p>='a' && p<='f')
       r|=(uint32_t)(p-'a'+10)<<((7-i)<<2);
+    else {
+      playlost();
+      return 0;
+    }
+    st->plp++;
   }
   return r;
 }
 
 void recputinit(char *init)
 {
-  mprintf("*%c%c%c\n",init[0],init[1],init[2]);
+  drf2_putinit(&dgctx->record.enc,init);
 }
 
+/* The end of a level is also when the recording is written out */
 void recputeol(void)
 {
-  if (recrl>0)
-    putrun();
-  if (reccc>0)
-    mprintf("\n");
-  mprintf("EOL\n");
+  drf2_puteol(&dgctx->record.enc);
+  recflush();
 }
 
 void recputeog(void)
 {
-  mprintf("EOG\n");
+  drf2_puteog(&dgctx->record.enc);
 }
 
 void recname(char *name)
 {
-  assert(strlen(name) < sizeof(rname));
-  gotname=true;
-  strcpy(rname,name);
+  struct record_state *st=&dgctx->record;
+  assert(strlen(name) < sizeof(st->rname));
+  st->gotname=true;
+  strcpy(st->rname,name);
 }
-
-#endif /* !_RP2350 */
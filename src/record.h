@@ -1,8 +1,17 @@
 /* Digger Remastered
    Copyright (c) Andrew Jenner 1998-2004 */
 
+/* Frames of playback between the keyframes of a seek index */
+#define PLAYIDX_EVERY 256
+
 void openplay(char *name);
+bool playopen(char *name,bool index);
+void playclose(void);
+void playtick(void);
+uint32_t playframe(void);
+bool playseek(uint32_t frame);
 void recstart(void);
+void recstop(void);
 void recname(char *name);
 void playgetdir(int16_t *dir,bool *fire);
 void recinit(void);
@@ -14,5 +23,7 @@ void recputeog(void);
 void playskipeol(void);
 void recputdir(int16_t dir,bool fire);
 void recsavedrf(void);
+void recend(void);
+bool playlast(void);
+bool drfconvert(char *in,char *out);
 
-extern bool playing,savedrf,gotname,gotgame,drfvalid,kludge;
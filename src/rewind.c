@@ -0,0 +1,293 @@
+/*
+ * rewind.c - Gameplay Rewind
+ *
+ * Every frame of play is saved with snapshot(), leaving the screen out: it
+ * is drawn again from the game state when a frame is gone back to. Only
+ * the newest frame is kept whole. Each one before it is kept in a
+ * fixed-size ring as the XOR against the frame after it, run-length coded
+ * in 32-bit words: a token byte 0x00-0x7f skips 1-128 words that did not
+ * change, 0x80-0xff is followed by 1-128 literal words. Only the sprites,
+ * the tunnels and a few counters change from one frame to the next, so a
+ * frame takes a few hundred bytes.
+ *
+ * Going back XORs the deltas into the newest frame, newest first. When the
+ * ring is full the oldest delta is just dropped. So rewinding takes the
+ * ring, two savestates (the newest frame and the one being captured) and
+ * the table of delta sizes.
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#if defined(_HOST)
+#include <time.h>
+#elif defined(_RP2350)
+#include "pico/time.h"
+#endif
+
+#include "def.h"
+#include "game_ctx.h"
+#include "snapshot.h"
+#include "rewind.h"
+
+/* Most frames held at once, however small */
+#define REWIND_MAXREC 1024
+
+#define RW_RUN 128
+
+static struct {
+    struct digger_ctx *ctx;     /* game the history belongs to */
+    uint8_t *ring;
+    size_t cap;
+    size_t head;                /* where the next delta starts */
+    size_t used;
+    uint32_t len[REWIND_MAXREC]; /* delta i leads from frame i + 1 to i */
+    int first, count;           /* deltas held before the newest frame */
+    bool haslast;
+    size_t snapsize, nwords;
+    uint32_t *last;             /* newest frame */
+    uint32_t *cur;              /* savestate being captured or restored */
+    size_t wlen;                /* bytes of the delta being written */
+    bool abort;
+    struct rewind_stats stats;
+} rw;
+
+#define LEN(i) rw.len[(rw.first + (i)) % REWIND_MAXREC]
+
+static void get(size_t *pos, void *p, size_t n)
+{
+    size_t k = rw.cap - *pos;
+
+    if (k > n)
+        k = n;
+    memcpy(p, rw.ring + *pos, k);
+    memcpy((uint8_t *)p + k, rw.ring, n - k);
+    *pos = (*pos + n) % rw.cap;
+}
+
+/* XOR the delta of len bytes that starts at off into out */
+static void decode(size_t off, size_t len, uint32_t *out)
+{
+    size_t pos = off, done = 0, i = 0, n;
+    uint32_t w;
+    uint8_t tok;
+
+    while (done < len) {
+        get(&pos, &tok, 1);
+        n = (tok & 0x7f) + 1;
+        done++;
+        if (tok & 0x80) {
+            done += n * 4;
+            while (n-- > 0) {
+                get(&pos, &w, 4);
+                out[i++] ^= w;
+            }
+        } else
+            i += n;
+    }
+}
+
+static bool drop_oldest(void)
+{
+    if (rw.count == 0)
+        return false;
+    rw.used -= LEN(0);
+    rw.first = (rw.first + 1) % REWIND_MAXREC;
+    rw.count--;
+    return true;
+}
+
+static void put(const void *p, size_t n)
+{
+    size_t pos, k;
+
+    if (rw.abort)
+        return;
+    while (rw.cap - rw.used - rw.wlen < n) {
+        if (!drop_oldest()) {
+            rw.abort = true;
+            return;
+        }
+    }
+    pos = (rw.head + rw.wlen) % rw.cap;
+    k = rw.cap - pos;
+    if (k > n)
+        k = n;
+    memcpy(rw.ring + pos, p, k);
+    memcpy(rw.ring, (const uint8_t *)p + k, n - k);
+    rw.wlen += n;
+}
+
+/* Write cur XOR ref as the current delta */
+static void encode(const uint32_t *cur, const uint32_t *ref)
+{
+    uint32_t lit[RW_RUN];
+    size_t i = 0, n = rw.nwords, run;
+    uint8_t tok;
+
+    while (i < n && !rw.abort) {
+        for (run = 0; i + run < n && run < RW_RUN; run++)
+            if (cur[i + run] != ref[i + run])
+                break;
+        if (run > 0) {
+            tok = run - 1;
+            put(&tok, 1);
+            i += run;
+            continue;
+        }
+        for (run = 0; i + run < n && run < RW_RUN; run++) {
+            lit[run] = cur[i + run] ^ ref[i + run];
+            if (lit[run] == 0)
+                break;
+        }
+        tok = 0x80 | (run - 1);
+        put(&tok, 1);
+        put(lit, run * 4);
+        i += run;
+    }
+}
+
+/* Drop the newest delta, returning where it started */
+static size_t pop(void)
+{
+    rw.count--;
+    rw.used -= LEN(rw.count);
+    rw.head = (rw.head + rw.cap - LEN(rw.count)) % rw.cap;
+    return rw.head;
+}
+
+static void swap(void)
+{
+    uint32_t *t = rw.last;
+
+    rw.last = rw.cur;
+    rw.cur = t;
+}
+
+bool rewind_init(size_t ringsize)
+{
+    rewind_free();
+    rw.snapsize = snapshot(NULL, 0, SNAP_NOSCREEN);
+    rw.nwords = (rw.snapsize + 3) / 4;
+    rw.ring = malloc(ringsize);
+    rw.last = calloc(rw.nwords, 4);
+    rw.cur = calloc(rw.nwords, 4);
+    if (rw.ring == NULL || rw.last == NULL || rw.cur == NULL) {
+        rewind_free();
+        return false;
+    }
+    rw.cap = ringsize;
+    rw.ctx = dgctx;
+    rewind_reset();
+    return true;
+}
+
+void rewind_free(void)
+{
+    free(rw.ring);
+    free(rw.last);
+    free(rw.cur);
+    memset(&rw, 0, sizeof(rw));
+}
+
+void rewind_reset(void)
+{
+    if (rw.ctx != dgctx)
+        return;
+    rw.first = rw.count = 0;
+    rw.head = rw.used = 0;
+    rw.haslast = false;
+}
+
+void rewind_capture(void)
+{
+#if defined(_HOST)
+    struct timespec t0, t1;
+#elif defined(_RP2350)
+    uint64_t t0;
+#endif
+
+    if (rw.ctx != dgctx)
+        return;
+#if defined(_HOST)
+    clock_gettime(CLOCK_MONOTONIC, &t0);
+#elif defined(_RP2350)
+    t0 = time_us_64();
+#endif
+    snapshot(rw.cur, rw.snapsize, SNAP_NOSCREEN);
+    rw.stats.captures++;
+    if (rw.haslast) {
+        rw.wlen = 0;
+        rw.abort = rw.count == REWIND_MAXREC && !drop_oldest();
+        encode(rw.last, rw.cur);
+        if (rw.abort) {
+            /* The delta is bigger than the whole ring: start over from here */
+            rw.first = rw.count = 0;
+            rw.head = rw.used = 0;
+        } else {
+            LEN(rw.count) = rw.wlen;
+            rw.head = (rw.head + rw.wlen) % rw.cap;
+            rw.used += rw.wlen;
+            rw.count++;
+            rw.stats.bytes += rw.wlen;
+        }
+    }
+    swap();
+    rw.haslast = true;
+#if defined(_HOST)
+    clock_gettime(CLOCK_MONOTONIC, &t1);
+    rw.stats.capture_ns += (t1.tv_sec - t0.tv_sec) * 1000000000ull +
+        t1.tv_nsec - t0.tv_nsec;
+#elif defined(_RP2350)
+    rw.stats.capture_ns += (time_us_64() - t0) * 1000;
+#endif
+}
+
+bool rewind_back(int frames)
+{
+    size_t pos = rw.head;
+    int t, i;
+
+    if (rw.ctx != dgctx || !rw.haslast)
+        return false;
+    /* Frame count is the newest, delta i leads back from frame i + 1 */
+    t = rw.count - frames;
+    if (t < 0)
+        t = 0;
+    memcpy(rw.cur, rw.last, rw.nwords * 4);
+    for (i = rw.count - 1; i >= t; i--) {
+        pos = (pos + rw.cap - LEN(i)) % rw.cap;
+        decode(pos, LEN(i), rw.cur);
+    }
+    if (!restore(rw.cur, rw.snapsize)) {
+        rewind_reset();
+        return false;
+    }
+    /* Play goes on from frame t, which is captured again: the history
+       ends at the frame before it */
+    if (t == 0) {
+        rewind_reset();
+        return true;
+    }
+    while (rw.count > t)
+        pop();
+    pos = pop();
+    decode(pos, LEN(rw.count), rw.cur);
+    swap();
+    return true;
+}
+
+void rewind_getstats(struct rewind_stats *rs)
+{
+    *rs = rw.stats;
+    rs->frames = rw.haslast ? rw.count + 1 : 0;
+    rs->used = rw.used;
+    rs->ring = rw.cap;
+    rs->mem = rw.ring == NULL ? 0 : rw.cap + 2 * rw.nwords * 4 + sizeof(rw);
+}
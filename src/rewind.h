@@ -0,0 +1,61 @@
+/*
+ * rewind.h - Gameplay Rewind
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __REWIND_H
+#define __REWIND_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+/* History kept for rewinding, in bytes of compressed frame deltas. The
+   device has less SRAM to spare, and a frame costs the same there. */
+#ifndef REWIND_RING
+#if defined(_RP2350)
+#define REWIND_RING (32 * 1024)
+#else
+#define REWIND_RING (64 * 1024)
+#endif
+#endif
+
+/* Frames stepped back per press of the rewind key: 3 s at the default speed */
+#define REWIND_STEP 38
+
+struct rewind_stats {
+    uint32_t captures;          /* savestates taken */
+    uint64_t bytes;             /* compressed bytes written, all captures */
+    uint32_t frames;            /* frames held right now */
+    size_t used, ring;          /* bytes held right now, ring size */
+    size_t mem;                 /* RAM taken, ring and savestates included */
+    uint64_t capture_ns;        /* time spent capturing */
+};
+
+/*
+ * Keep rewind history of the game bound to dgctx in a ring of ringsize
+ * bytes, plus two savestates without the screen. Returns false if there
+ * is not enough memory; rewinding is then not available.
+ */
+bool rewind_init(size_t ringsize);
+void rewind_free(void);
+
+/* Drop all history, e.g. when a new game starts */
+void rewind_reset(void);
+
+/* Save the current frame; called once per frame of play */
+void rewind_capture(void);
+
+/*
+ * Go back frames captures, or as far as the history reaches. The frames
+ * after it are dropped. Returns false if there was nothing to go back to.
+ */
+bool rewind_back(int frames);
+
+void rewind_getstats(struct rewind_stats *rs);
+
+#endif
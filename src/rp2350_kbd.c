@@ -26,6 +26,7 @@ struct kbent {
 
 static struct kbent kbuffer[KBLEN];
 static int16_t klen = 0;
+static uint16_t fedheld = 0;    /* game keys held according to kbdfeed() */
 
 /*
  * Key mappings using HID keycodes.
@@ -52,6 +53,8 @@ int keycodes[NKEYS][5] = {
     {HID_KEY_SPACE,       -2, -2, -2, -2},  /* Pause */
     {HID_KEY_N,           -2, -2, -2, -2},  /* Change mode */
     {HID_KEY_F8,          -2, -2, -2, -2},  /* Save DRF */
+    {HID_KEY_BACKSPACE,   -2, -2, -2, -2},  /* Rewind */
+    {HID_KEY_F5,          -2, -2, -2, -2},  /* Replay */
 };
 
 /*
@@ -84,12 +87,29 @@ static void poll_keyboard(void) {
  * Checks both PS/2 and USB keyboards.
  */
 bool GetAsyncKeyState(int key) {
+    int i;
+
+    for (i = 0; i < 10; i++)
+        if (((fedheld >> i) & 1) && keycodes[i][0] == key)
+            return true;
     ps2kbd_tick();
     usbhid_wrapper_tick();
     return ps2kbd_is_key_pressed((uint8_t)key)
         || usbhid_wrapper_is_key_pressed((uint8_t)key);
 }
 
+/*
+ * kbdfeed - Add one step's keyboard state from the caller of digger_step()
+ * to what the keyboards report.
+ */
+void kbdfeed(const struct digger_input *in) {
+    int i;
+
+    fedheld = in->held;
+    for (i = 0; i < in->nkeys && klen < KBLEN; i++)
+        kbuffer[klen++].scancode = in->keys[i];
+}
+
 /*
  * initkeyb - Initialize PS/2 keyboard driver.
  */
@@ -129,6 +149,8 @@ static int16_t hid_to_ascii(int16_t hid) {
 
 /*
  * getkey - Block until a key is pressed.
+ * The game only calls it once kbhit() says a key is waiting; the wait is
+ * left for redefkeyb().
  * If scancode=true, return raw HID scancode (for game controls).
  * If scancode=false, return ASCII character (for text input like initials).
  */
@@ -23,18 +23,23 @@
 #include "sound.h"
 #include "input.h"
 #include "main.h"
-#include "game.h"
+#include "game_ctx.h"
 #include "newsnd.h"
 #include "board_config.h"
 #include "HDMI.h"
+#include "audio.h"
 
 /* Digger log file (redirect to NULL on RP2350) */
 FILE *digger_log = NULL;
 
+/* Audio playback from rp2350_snd.c */
+extern void audio_start_on_this_core(void);
+
 /*
- * Core 1 entry: HDMI video output.
- * Initializes HDMI IRQ handler on this core, then loops forever.
- * The HDMI driver runs entirely from DMA interrupts.
+ * Core 1 entry: HDMI video output and audio synthesis.
+ * Initializes HDMI IRQ handler on this core, then the I2S DMA IRQ once
+ * Core 0 has set up the sound, then loops forever. Both drivers run
+ * entirely from DMA interrupts.
  */
 static void __not_in_flash_func(core1_main)(void) {
     graphics_init_irq_on_this_core();
@@ -42,10 +47,16 @@ static void __not_in_flash_func(core1_main)(void) {
     /* Signal Core 0 that HDMI IRQ handler is ready */
     multicore_fifo_push_blocking(1);
 
-    /* Loop forever in RAM. The HDMI DMA IRQ handler (__scratch_x) runs
-     * on this core. Keeping core1_main in RAM ensures Core 1 never
-     * accesses flash, so flash erase/program on Core 0 is safe without
-     * multicore lockout - and HDMI signal stays uninterrupted. */
+    /* Take the audio IRQ when Core 0 says I2S is set up, and say so */
+    multicore_fifo_pop_blocking();
+    audio_start_on_this_core();
+    multicore_fifo_push_blocking(1);
+
+    /* Loop forever in RAM. The HDMI DMA IRQ handler (__scratch_x) and
+     * the audio DMA IRQ handler (__not_in_flash_func) run on this core.
+     * Keeping core1_main in RAM ensures Core 1 never accesses flash, so
+     * flash erase/program on Core 0 is safe without multicore lockout -
+     * and HDMI signal and sound stay uninterrupted. */
     while (true) {
         tight_loop_contents();
     }
@@ -60,24 +71,26 @@ static void __not_in_flash_func(core1_main)(void) {
  * Initialize default game settings (replaces INI file loading).
  */
 static void inir_defaults(void) {
+    dgctx_init(dgctx);
+
     /* Game defaults */
-    dgstate.nplayers = 1;
-    dgstate.diggers = 1;
-    dgstate.curplayer = 0;
-    dgstate.startlev = 1;
-    dgstate.levfflag = false;
-    dgstate.gauntlet = false;
-    dgstate.gtime = 120;
-    dgstate.timeout = false;
-    dgstate.unlimlives = false;
-    dgstate.ftime = 80000;  /* 80ms per frame = 12.5 Hz */
-    dgstate.cgtime = 0;
-    dgstate.randv = 0;
+    dgctx->game.nplayers = 1;
+    dgctx->game.diggers = 1;
+    dgctx->game.curplayer = 0;
+    dgctx->game.startlev = 1;
+    dgctx->game.levfflag = false;
+    dgctx->game.gauntlet = false;
+    dgctx->game.gtime = 120;
+    dgctx->game.timeout = false;
+    dgctx->game.unlimlives = false;
+    dgctx->game.ftime = 80000;  /* 80ms per frame = 12.5 Hz */
+    dgctx->game.cgtime = 0;
+    dgctx->game.randv = 0;
 
     /* Sound defaults */
-    soundflag = true;
-    musicflag = true;
-    volume = 1;
+    dgctx->sound.soundflag = true;
+    dgctx->sound.musicflag = true;
+    dgctx->sound.volume = 1;
 
     /* Set up new sound engine */
     setupsound = s1setupsound;
@@ -86,7 +99,7 @@ static void inir_defaults(void) {
     setspkrt2 = s1setspkrt2;
     timer0 = s1timer0;
     timer2 = s1timer2;
-    soundinitglob(512, 44100);
+    soundinitglob(AUDIO_BUFFER_SAMPLES, AUDIO_SAMPLE_RATE);
 }
 
 /*
@@ -114,6 +127,10 @@ int main(void) {
     /* Initialize game with defaults (no INI file) */
     inir_defaults();
 
+    /* Sound is set up: start it with its IRQ on Core 1 */
+    multicore_fifo_push_blocking(1);
+    multicore_fifo_pop_blocking();
+
     /* Run the game */
     maininit();
     mainprog();
@@ -11,12 +11,18 @@
 #include <stdint.h>
 #include <stdbool.h>
 
+#include "pico/stdlib.h"
+#include "hardware/structs/m33.h"
+
 #include "def.h"
 #include "device.h"
 #include "hardware.h"
 #include "newsnd.h"
+#include "spkfeed.h"
+#include "game_ctx.h"
 #include "audio.h"
 #include "board_config.h"
+#include "debug_log.h"
 
 bool wave_device_available = false;
 
@@ -24,20 +30,89 @@ static i2s_config_t i2s_config;
 static bool audio_initialized = false;
 static bool audio_paused = false;
 
-/* Audio buffer for one game frame.
- * At 44100 Hz and ~12.5 Hz game rate: 44100/12.5 = 3528 samples per frame.
- * We use stereo (L+R), so 3528*2 = 7056 int16_t values per frame.
+/* Game samples per tick: 44100/12.5 = 3528. soundint() has to fire on the
+ * same ticks as on the host (death and level-end waits depend on it), so
+ * this stays fixed whatever the tick really takes.
  */
 #define AUDIO_SAMPLES_PER_FRAME 3528
-static int16_t audio_buf[AUDIO_SAMPLES_PER_FRAME * 2] __attribute__((aligned(4)));
+
+/*
+ * The game queues the speaker settings of each tick here, and the I2S
+ * DMA IRQ on core 1 plays them as it needs samples (see spkfeed.h).
+ */
+static struct spkfeed feed;
+
+/* Cycles audio_pull() has taken and the samples it made, counted up on
+ * core 1; the log on core 0 takes the difference from its last look */
+static volatile uint32_t gen_cycles, gen_samples;
+static uint32_t log_cycles, log_samples, gen_log_us;
+
+static inline uint32_t gen_cyccnt(void) {
+#ifndef __riscv
+    return m33_hw->dwt_cyccnt;
+#else
+    return 0;
+#endif
+}
+
+/*
+ * Every 5 seconds, print the cycles a second of sound takes to make, and
+ * how the ring has done since the start: buffers that went out short,
+ * writes that waited and for how long, and the fewest free buffers a write
+ * found (only pushed samples can overrun or wait). Then the settings the
+ * queue dropped, and the fewest (since the last line) and mean samples
+ * queued at a fill.
+ */
+static void gen_log(void) {
+    uint32_t now = time_us_32(), c, n;
+    struct i2s_stats is;
+    struct spkfeed_stats fs;
+
+    if (now - gen_log_us < 5000000)
+        return;
+    gen_log_us = now;
+    c = gen_cycles - log_cycles;
+    n = gen_samples - log_samples;
+    log_cycles += c;
+    log_samples += n;
+    if (n == 0)
+        return;
+    i2s_get_stats(&is, false);
+    spkfeed_getstats(&feed, &fs, true);
+    MII_DEBUG_PRINTF("Audio: %lu cycles per second of sound, ring %ux%u: "
+                     "%lu underruns, %lu overruns, %lu min free, %lu us waiting; "
+                     "queue: %lu dropped, %lu min %lu mean\n",
+                     (unsigned long)((uint64_t)c * i2s_config.sample_freq / n),
+                     (unsigned)i2s_config.buffer_count,
+                     (unsigned)i2s_config.dma_trans_count,
+                     (unsigned long)is.underruns, (unsigned long)is.overruns,
+                     (unsigned long)is.min_free, (unsigned long)is.wait_us,
+                     (unsigned long)fs.dropped, (unsigned long)fs.minqueued,
+                     (unsigned long)(fs.fills ? fs.queued / fs.fills : 0));
+}
+
+/* The DMA IRQ's fill: the next n stereo samples from the queue */
+static uint32_t __not_in_flash_func(audio_pull)(int16_t *samples, uint32_t n) {
+    uint32_t start = gen_cyccnt(), made;
+
+    made = spkfeed_fill(&feed, samples, n, 2);
+    gen_cycles += gen_cyccnt() - start;
+    gen_samples += n;
+    return made;
+}
 
 /*
  * setsounddevice - Initialize I2S audio hardware.
+ *
+ * The ring is AUDIO_BUFFER_COUNT buffers of bufsize samples; playback
+ * starts when core 1 calls audio_start_on_this_core().
  */
 bool setsounddevice(uint16_t samprate, uint16_t bufsize) {
+    spkfeed_init(&feed, samprate);
     i2s_config = i2s_get_default_config();
     i2s_config.sample_freq = samprate;
-    i2s_config.dma_trans_count = AUDIO_SAMPLES_PER_FRAME;
+    i2s_config.dma_trans_count = bufsize;
+    i2s_config.fill = audio_pull;
 
     i2s_init(&i2s_config);
     audio_initialized = true;
@@ -46,6 +121,21 @@ bool setsounddevice(uint16_t samprate, uint16_t bufsize) {
     return true;
 }
 
+/*
+ * audio_start_on_this_core - Start playback, with the DMA IRQ (and so the
+ * synthesis) on the calling core. Called on core 1 once setsounddevice()
+ * has run on core 0.
+ */
+void audio_start_on_this_core(void) {
+    if (!audio_initialized)
+        return;
+#ifndef __riscv
+    m33_hw->demcr |= M33_DEMCR_TRCENA_BITS;
+    m33_hw->dwt_ctrl |= M33_DWT_CTRL_CYCCNTENA_BITS;
+#endif
+    i2s_start_pull(&i2s_config);
+}
+
 /*
  * initsounddevice - Stub (init done in setsounddevice).
  */
@@ -58,24 +148,21 @@ bool initsounddevice(void) {
  */
 void pausesounddevice(bool p) {
     audio_paused = p;
+    spkfeed_pause(&feed, p);
 }
 
 /*
- * audio_fill_and_submit - Generate audio samples and submit to I2S.
+ * audio_fill_and_submit - Hand the tick's sound to the audio IRQ.
  *
- * Called once per game frame from the main loop.
- * Generates AUDIO_SAMPLES_PER_FRAME mono samples via getsample(),
- * duplicates to stereo, and submits to I2S DMA.
+ * Called once per game frame from the main loop. Runs soundint() through
+ * AUDIO_SAMPLES_PER_FRAME samples and queues what the speaker does in
+ * them, to be played in the ftime the tick takes. It never waits for the
+ * DAC.
  */
 void audio_fill_and_submit(void) {
     if (!audio_initialized || audio_paused)
         return;
 
-    for (int i = 0; i < AUDIO_SAMPLES_PER_FRAME; i++) {
-        int16_t s = getsample();
-        audio_buf[i * 2] = s;      /* Left */
-        audio_buf[i * 2 + 1] = s;  /* Right (mono->stereo) */
-    }
-
-    i2s_dma_write_count(&i2s_config, audio_buf, AUDIO_SAMPLES_PER_FRAME);
+    feedsamples(&feed, AUDIO_SAMPLES_PER_FRAME, dgctx->game.ftime);
+    gen_log();
 }
@@ -15,45 +15,165 @@
 #include "def.h"
 #include "hardware.h"
 #include "digger_math.h"
-#include "game.h"
-
-/* Audio fill from rp2350_snd.c - called each frame to generate samples */
-extern void audio_fill_and_submit(void);
+#include "game_ctx.h"
+#include "HDMI.h"
+#include "rewind.h"
+#include "debug_log.h"
 
 /* HDMI watchdog from HDMI.c - restarts DMA if stalled */
 extern bool hdmi_check_and_restart(void);
+extern void hdmi_log_irq_budget(void);
+
+/* Frame flip from rp2350_vid.c */
+extern void doscreenupdate(void);
 
 /* Frame timing state */
 static uint64_t next_frame_time_us = 0;
 static bool timer_initialized = false;
 
+#ifdef VSYNC_PACING
+/*
+ * Vsync pacing state. Each game tick lands on vsync pace_target: the
+ * ticks are ftime apart on average, as a whole number of vsyncs each.
+ * pace_err carries the remainder from tick to tick, in us * refresh rate,
+ * so 80 ms at 60 Hz goes 4, 5, 5, 5, 5 vsyncs.
+ */
+static uint32_t pace_target;
+static uint64_t pace_err;
+
+/* Ticks since inittimer(), ticks that found their vsync already gone, and
+   the game time they add up to, to compare with the time really taken */
+static uint32_t pace_ticks, pace_missed;
+static uint64_t pace_start_us, pace_game_us, pace_log_us;
+#endif
+
+/*
+ * Every 5 seconds, print what the rewind history costs: the time and the
+ * bytes a frame of play takes, the frames held and the RAM it all takes.
+ */
+static void rewind_log(void) {
+    static uint64_t log_us;
+    uint64_t now = time_us_64();
+    struct rewind_stats rs;
+
+    if (now - log_us < 5000000)
+        return;
+    log_us = now;
+    rewind_getstats(&rs);
+    if (rs.captures == 0)
+        return;
+    MII_DEBUG_PRINTF("Rewind: %lu us/capture, %lu bytes/frame, %lu frames "
+                     "held, %lu bytes RAM\n",
+                     (unsigned long)(rs.capture_ns / 1000 / rs.captures),
+                     (unsigned long)(rs.bytes / rs.captures),
+                     (unsigned long)rs.frames, (unsigned long)rs.mem);
+}
+
 /*
  * inittimer - Initialize frame timing.
  */
 void inittimer(void) {
-    next_frame_time_us = time_us_64() + dgstate.ftime;
+    next_frame_time_us = time_us_64() + dgctx->game.ftime;
     timer_initialized = true;
+#ifdef VSYNC_PACING
+    pace_target = get_frame_count();
+    pace_err = 0;
+    pace_ticks = pace_missed = 0;
+    pace_start_us = pace_log_us = time_us_64();
+    pace_game_us = 0;
+#endif
+}
+
+#ifdef VSYNC_PACING
+/*
+ * waitvsync - Wait for vsync number frame. False if the output has
+ * stopped and it does not come.
+ */
+static bool waitvsync(uint32_t frame) {
+    uint64_t limit = time_us_64() + 200000;
+
+    while ((int32_t)(get_frame_count() - frame) < 0) {
+        if (time_us_64() > limit)
+            return false;
+        sleep_us(200);
+    }
+    return true;
+}
+
+/*
+ * pacevsync - One game tick of vsync pacing.
+ *
+ * Waits for the vsync before the tick's own, so that the flip in
+ * doscreenupdate() shows the frame on it, then waits for that. Speed keys
+ * change ftime and so the number of vsyncs from the next tick on. If the
+ * game is fast enough to take less than a vsync, ticks share one and only
+ * the last of them is shown.
+ */
+static void pacevsync(void) {
+    int freq = graphics_get_video_mode(0).freq;
+    uint64_t step = pace_err + (uint64_t)dgctx->game.ftime * freq;
+    uint32_t n = step / 1000000;
+    uint64_t now = time_us_64();
+
+    pace_err = step % 1000000;
+    pace_target += n;
+    pace_ticks++;
+    pace_game_us += dgctx->game.ftime;
+
+    if (now - pace_log_us >= 5000000) {
+        pace_log_us = now;
+        MII_DEBUG_PRINTF("Pacing: %lu ticks, %lu missed, drift %ld us\n",
+                         (unsigned long)pace_ticks, (unsigned long)pace_missed,
+                         (long)(int64_t)(now - pace_start_us - pace_game_us));
+    }
+
+    if (n == 0)
+        return;
+    if ((int32_t)(get_frame_count() - pace_target) >= 0) {
+        /* Too late for this vsync: show the frame now and go on from here */
+        pace_missed++;
+        doscreenupdate();
+        pace_target = get_frame_count();
+        return;
+    }
+    if (waitvsync(pace_target - 1)) {
+        doscreenupdate();
+        if (waitvsync(pace_target))
+            return;
+    }
+    /* No vsync: keep the game going until the watchdog restarts HDMI */
+    doscreenupdate();
+    pace_target = get_frame_count();
 }
+#endif
 
 /*
  * gethrt - Frame synchronization.
  *
- * Waits until the next frame boundary, then advances the target time.
- * No need to call doscreenupdate() since HDMI DMA auto-refreshes.
+ * Shows the frame just drawn (doscreenupdate() flips to it at vsync when
+ * the screen is double-buffered) and waits for the next game tick. With
+ * VSYNC_PACING the ticks are counted in HDMI vsyncs, see pacevsync();
+ * otherwise it sleeps until the next frame time and advances it. The
+ * frame's audio is generated by digger_step().
  */
 void gethrt(bool minsleep) {
-    /* Pump audio each frame - generates samples and calls soundint() */
-    audio_fill_and_submit();
-
     /* Check HDMI DMA health, restart if stalled */
     hdmi_check_and_restart();
+    hdmi_log_irq_budget();
+    rewind_log();
 
-    if (!timer_initialized || dgstate.ftime <= 1) {
+    if (!timer_initialized || dgctx->game.ftime <= 1) {
+        doscreenupdate();
         if (minsleep)
             sleep_us(10000);  /* 10ms minimum sleep */
         return;
     }
 
+#ifdef VSYNC_PACING
+    pacevsync();
+#else
+    doscreenupdate();
+
     uint64_t now = time_us_64();
 
     if (now < next_frame_time_us) {
@@ -63,12 +183,13 @@ void gethrt(bool minsleep) {
         sleep_us(delay);
     }
 
-    next_frame_time_us += dgstate.ftime;
+    next_frame_time_us += dgctx->game.ftime;
 
     /* If we fell behind, reset to now + ftime */
     now = time_us_64();
     if (next_frame_time_us < now)
-        next_frame_time_us = now + dgstate.ftime;
+        next_frame_time_us = now + dgctx->game.ftime;
+#endif
 }
 
 /*
@@ -17,12 +17,8 @@
 #include "alpha.h"
 #include "board_config.h"
 #include "HDMI.h"
-
-/* CGA sprite table from cgagrafx.c */
-extern const uint8_t *cgatable[];
-
-/* CGA alpha font from alpha.c - 2bpp packed, 3 bytes/row, 12 rows */
-extern const uint8_t * const ascii2cga[];
+#include "cgasprite.h"
+#include "cgatext.h"
 
 /*
  * CGA Palette definitions (RGB888)
@@ -38,9 +34,47 @@ static const uint32_t cga_pal1i[] = {0x000000, 0x55FFFF, 0xFF55FF, 0xFFFFFF};
 static int16_t current_pal = 0;
 static int16_t current_inten = 0;
 
-/* Pointer to HDMI framebuffer (4-bit nibble-packed, 320x240) */
+/*
+ * Pointer to HDMI framebuffer (320x240, 2bpp or 4bpp, see FB_2BPP). With
+ * FB_DOUBLE it is the back buffer: everything is drawn and read back
+ * there, and doscreenupdate() shows it.
+ */
 static uint8_t *framebuffer;
 
+/* Framebuffer rows drawn since the last doscreenupdate(), lo to hi-1 */
+static int dirty_lo = 0, dirty_hi = 0;
+
+static inline void fb_dirty(int y, int h) {
+    int fb_y = y + DIGGER_Y_OFFSET;
+
+    if (fb_y < dirty_lo)
+        dirty_lo = fb_y < 0 ? 0 : fb_y;
+    if (fb_y + h > dirty_hi)
+        dirty_hi = fb_y + h > HDMI_HEIGHT ? HDMI_HEIGHT : fb_y + h;
+}
+
+#ifdef FB_2BPP
+/*
+ * Framebuffer access helpers.
+ * With FB_2BPP the HDMI framebuffer is laid out like CGA video memory:
+ * 4 pixels to a byte, leftmost pixel in bits 7-6. The HDMI IRQ expands
+ * each line to palette indices (see cgaline.h).
+ * Row stride = 320/4 = 80 bytes.
+ */
+#define FB_STRIDE (HDMI_WIDTH / 4)
+
+/* Bytes of a gputi()/ggeti() buffer row, w = width in 4-pixel units,
+   and the byte in a framebuffer row that pixel x is in */
+#define FB_ROWBYTES(w) (w)
+#define FB_XBYTE(x)    ((x) >> 2)
+
+static inline uint8_t fb_get_pixel(int x, int y) {
+    int fb_y = y + DIGGER_Y_OFFSET;
+    if (fb_y < 0 || fb_y >= HDMI_HEIGHT || x < 0 || x >= HDMI_WIDTH)
+        return 0;
+    return (framebuffer[fb_y * FB_STRIDE + (x >> 2)] >> (6 - (x & 3) * 2)) & 3;
+}
+#else
 /*
  * Framebuffer access helpers.
  * The HDMI framebuffer is 4-bit per pixel, nibble-packed.
@@ -49,16 +83,8 @@ static uint8_t *framebuffer;
  */
 #define FB_STRIDE (HDMI_WIDTH / 2)
 
-static inline void fb_set_pixel(int x, int y, uint8_t color) {
-    int fb_y = y + DIGGER_Y_OFFSET;
-    if (fb_y < 0 || fb_y >= HDMI_HEIGHT || x < 0 || x >= HDMI_WIDTH)
-        return;
-    int idx = fb_y * FB_STRIDE + (x >> 1);
-    if (x & 1)
-        framebuffer[idx] = (framebuffer[idx] & 0x0F) | ((color & 0x0F) << 4);
-    else
-        framebuffer[idx] = (framebuffer[idx] & 0xF0) | (color & 0x0F);
-}
+#define FB_ROWBYTES(w) ((w) * 2)
+#define FB_XBYTE(x)    ((x) >> 1)
 
 static inline uint8_t fb_get_pixel(int x, int y) {
     int fb_y = y + DIGGER_Y_OFFSET;
@@ -70,6 +96,12 @@ static inline uint8_t fb_get_pixel(int x, int y) {
     else
         return framebuffer[idx] & 0x0F;
 }
+#endif
+
+/* The same framebuffer, for the sprite and text blitters */
+static struct cgafb sprfb = {
+    NULL, FB_STRIDE, HDMI_WIDTH, HDMI_HEIGHT, DIGGER_Y_OFFSET
+};
 
 /*
  * Apply CGA palette to HDMI palette entries 0-3.
@@ -89,7 +121,12 @@ static void apply_palette(void) {
  * rp2350_init - Initialize HDMI video
  */
 void cgainit(void) {
-    framebuffer = graphics_get_buffer();
+    framebuffer = graphics_get_back_buffer();
+    sprfb.pixels = framebuffer;
+#ifndef FB_2BPP
+    cgaspr_init();
+    cgatext_init();
+#endif
     apply_palette();
 }
 
@@ -98,6 +135,8 @@ void cgainit(void) {
  */
 void cgaclear(void) {
     memset(framebuffer, 0, FB_STRIDE * HDMI_HEIGHT);
+    dirty_lo = 0;
+    dirty_hi = HDMI_HEIGHT;
 }
 
 /*
@@ -117,38 +156,47 @@ void cgainten(int16_t inten) {
 }
 
 /*
- * rp2350_puti - Copy raw 4-bit packed pixels from buffer p to framebuffer
+ * cgagetpal - Current palette and intensity, for savestates
+ */
+void cgagetpal(int16_t *pal, int16_t *inten) {
+    *pal = current_pal;
+    *inten = current_inten;
+}
+
+/*
+ * rp2350_puti - Copy raw packed pixels from buffer p to framebuffer
  *
- * Buffer format: 4-bit nibble-packed, same as framebuffer.
+ * Buffer format: same as framebuffer.
  * w = width in "sprite units" (w*4 = pixel width), h = height in pixels.
- * Buffer stores (w*4/2) = w*2 bytes per row.
+ * Buffer stores FB_ROWBYTES(w) bytes per row: w*2 at 4bpp, w at 2bpp.
  */
 void cgaputi(int16_t x, int16_t y, uint8_t *p, int16_t w, int16_t h) {
-    int pixel_w = w * 4;  /* width in pixels */
-    int buf_stride = pixel_w / 2;  /* bytes per row in buffer */
+    int buf_stride = FB_ROWBYTES(w);  /* bytes per row in buffer */
+    int xoff = FB_XBYTE(x);
 
+    fb_dirty(y, h);
     for (int row = 0; row < h; row++) {
         int fb_y = (y + row) + DIGGER_Y_OFFSET;
         if (fb_y < 0 || fb_y >= HDMI_HEIGHT)
             continue;
-        int fb_offset = fb_y * FB_STRIDE + (x >> 1);
+        int fb_offset = fb_y * FB_STRIDE + xoff;
         int buf_offset = row * buf_stride;
         memcpy(&framebuffer[fb_offset], &p[buf_offset], buf_stride);
     }
 }
 
 /*
- * rp2350_geti - Copy 4-bit packed pixels from framebuffer to buffer p
+ * rp2350_geti - Copy packed pixels from framebuffer to buffer p
  */
 void cgageti(int16_t x, int16_t y, uint8_t *p, int16_t w, int16_t h) {
-    int pixel_w = w * 4;
-    int buf_stride = pixel_w / 2;
+    int buf_stride = FB_ROWBYTES(w);
+    int xoff = FB_XBYTE(x);
 
     for (int row = 0; row < h; row++) {
         int fb_y = (y + row) + DIGGER_Y_OFFSET;
         if (fb_y < 0 || fb_y >= HDMI_HEIGHT)
             continue;
-        int fb_offset = fb_y * FB_STRIDE + (x >> 1);
+        int fb_offset = fb_y * FB_STRIDE + xoff;
         int buf_offset = row * buf_stride;
         memcpy(&p[buf_offset], &framebuffer[fb_offset], buf_stride);
     }
@@ -157,43 +205,18 @@ void cgageti(int16_t x, int16_t y, uint8_t *p, int16_t w, int16_t h) {
 /*
  * rp2350_putim - Draw CGA sprite with mask (transparency)
  *
- * CGA sprite data: 2 bits per pixel, 4 pixels per byte.
- * cgatable[ch*2] = sprite data, cgatable[ch*2+1] = mask.
- * w = bytes per row (each byte = 4 pixels), h = rows.
- *
- * For each pixel: result = (screen & mask) | sprite
- * Mask bit 1 = transparent (keep screen), mask bit 0 = opaque (use sprite)
- *
- * CGA 2-bit pixels map directly to palette indices 0-3.
+ * cgatable[ch*2] = sprite data, cgatable[ch*2+1] = mask, w bytes of 4
+ * pixels by h rows. At 2bpp the CGA bytes are blended straight into the
+ * screen; at 4bpp the pixels are drawn from the atlas built by cgainit().
+ * See cgasprite.c.
  */
 void cgaputim(int16_t x, int16_t y, int16_t ch, int16_t w, int16_t h) {
-    const uint8_t *sprite = cgatable[ch * 2];
-    const uint8_t *mask = cgatable[ch * 2 + 1];
-
-    for (int row = 0; row < h; row++) {
-        int px = x;
-        for (int col = 0; col < w; col++) {
-            uint8_t sbyte = sprite[row * w + col];
-            uint8_t mbyte = mask[row * w + col];
-
-            /* Each byte has 4 pixels at 2 bits each, MSB first */
-            for (int bit = 6; bit >= 0; bit -= 2) {
-                uint8_t spix = (sbyte >> bit) & 0x03;
-                uint8_t mpix = (mbyte >> bit) & 0x03;
-
-                if (mpix != 0x03) {
-                    /* Not fully transparent - blend */
-                    uint8_t screen_pix = fb_get_pixel(px, y + row);
-                    uint8_t result = (screen_pix & mpix) | spix;
-                    fb_set_pixel(px, y + row, result);
-                } else if (spix != 0) {
-                    /* Mask is fully transparent but sprite has data */
-                    fb_set_pixel(px, y + row, spix);
-                }
-                px++;
-            }
-        }
-    }
+    fb_dirty(y, h);
+#ifdef FB_2BPP
+    cgaspr_put2(&sprfb, x, y, ch, w, h);
+#else
+    cgaspr_put(&sprfb, x, y, ch, w, h);
+#endif
 }
 
 /*
@@ -215,6 +238,11 @@ int16_t cgagetpix(int16_t x, int16_t y) {
     if (x < 0 || x > 319 || y < 0 || y > 199)
         return 0xff;
 
+#ifdef FB_2BPP
+    /* Already a CGA byte when x is on a byte boundary */
+    if ((x & 3) == 0)
+        return framebuffer[(y + DIGGER_Y_OFFSET) * FB_STRIDE + (x >> 2)];
+#endif
     for (int xi = 0; xi < 4; xi++) {
         uint8_t pix = fb_get_pixel(x + xi, y) & 0x03;
         rval |= pix << (6 - xi * 2);
@@ -226,32 +254,30 @@ int16_t cgagetpix(int16_t x, int16_t y) {
 /*
  * rp2350_write - Draw text character
  *
- * CGA alpha font: 3 bytes per row, 12 rows.
- * Each byte = 4 pixels at 2 bits each = 12 pixels wide.
- * Font uses values 0 (background) and 3 (foreground).
- * Parameter c = CGA palette index for foreground color.
+ * CGA alpha font: 3 bytes per row, 12 rows, values 0 (background) and 3
+ * (foreground). Parameter c = CGA palette index for foreground color.
+ * At 4bpp the rows come from the expanded font built by cgainit(); see
+ * cgatext.c.
  */
 void cgawrite(int16_t x, int16_t y, int16_t ch, int16_t c) {
-    const uint8_t *font;
-
-    if (!isvalchar(ch))
-        return;
-
-    font = ascii2cga[ch - 32];
-    if (font == NULL)
-        return;
+    fb_dirty(y, 12);
+#ifdef FB_2BPP
+    cgatext_put2(&sprfb, x, y, ch, c);
+#else
+    cgatext_put(&sprfb, x, y, ch, c);
+#endif
+}
 
-    for (int row = 0; row < 12; row++) {
-        int px = x;
-        for (int col = 0; col < 3; col++) {
-            uint8_t byte = font[row * 3 + col];
-            for (int bit = 6; bit >= 0; bit -= 2) {
-                uint8_t pix = (byte >> bit) & 0x03;
-                fb_set_pixel(px, y + row, pix ? c : 0);
-                px++;
-            }
-        }
-    }
+/*
+ * rp2350_fill - Set a rectangle to colour c
+ */
+void cgafill(int16_t x, int16_t y, int16_t w, int16_t h, int16_t c) {
+    fb_dirty(y, h);
+#ifdef FB_2BPP
+    cgatext_fill2(&sprfb, x, y, w, h, c);
+#else
+    cgatext_fill(&sprfb, x, y, w, h, c);
+#endif
 }
 
 /*
@@ -262,8 +288,6 @@ void cgawrite(int16_t x, int16_t y, int16_t ch, int16_t c) {
  * and character animations on top.
  */
 void cgatitle(void) {
-    int x, y, t;
-
     cgaclear();
 
     /* Draw red border (color 2) with vertical divider.
@@ -276,28 +300,39 @@ void cgatitle(void) {
     #define BRD_DIV 160  /* vertical divider x center */
 
     /* Top and bottom horizontal bars */
-    for (x = BRD_L; x <= BRD_R; x++)
-        for (t = 0; t < BRD_W; t++) {
-            fb_set_pixel(x, BRD_T + t, 2);
-            fb_set_pixel(x, BRD_B - t, 2);
-        }
+    cgafill(BRD_L, BRD_T, BRD_R - BRD_L + 1, BRD_W, 2);
+    cgafill(BRD_L, BRD_B - BRD_W + 1, BRD_R - BRD_L + 1, BRD_W, 2);
     /* Left and right vertical bars */
-    for (y = BRD_T; y <= BRD_B; y++)
-        for (t = 0; t < BRD_W; t++) {
-            fb_set_pixel(BRD_L + t, y, 2);
-            fb_set_pixel(BRD_R - t, y, 2);
-        }
+    cgafill(BRD_L, BRD_T, BRD_W, BRD_B - BRD_T + 1, 2);
+    cgafill(BRD_R - BRD_W + 1, BRD_T, BRD_W, BRD_B - BRD_T + 1, 2);
     /* Vertical divider */
-    for (y = BRD_T; y <= BRD_B; y++)
-        for (t = 0; t < BRD_W; t++)
-            fb_set_pixel(BRD_DIV - 1 + t, y, 2);
+    cgafill(BRD_DIV - 1, BRD_T, BRD_W, BRD_B - BRD_T + 1, 2);
 }
 
 /*
- * rp2350_flush - No-op (HDMI DMA auto-reads framebuffer)
+ * rp2350_flush - Show what has been drawn
+ *
+ * Without FB_DOUBLE the HDMI IRQ reads the framebuffer as it is drawn and
+ * there is nothing to do. With it, the back buffer is shown from the next
+ * vsync on, and the rows drawn since the last flip are copied from it
+ * into the new back buffer, so both hold the same picture again. If
+ * nothing was drawn there is no need to wait for vsync.
  */
 void doscreenupdate(void) {
-    /* HDMI driver continuously DMA-reads the framebuffer */
+#ifdef FB_DOUBLE
+    uint8_t *front;
+
+    if (dirty_lo >= dirty_hi)
+        return;
+    graphics_flip();
+    front = graphics_get_buffer();
+    framebuffer = graphics_get_back_buffer();
+    sprfb.pixels = framebuffer;
+    memcpy(framebuffer + dirty_lo * FB_STRIDE, front + dirty_lo * FB_STRIDE,
+           (dirty_hi - dirty_lo) * FB_STRIDE);
+#endif
+    dirty_lo = HDMI_HEIGHT;
+    dirty_hi = 0;
 }
 
 /*
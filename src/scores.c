@@ -20,35 +20,16 @@
 #include "input.h"
 #include "digger.h"
 #include "record.h"
-#include "game.h"
-
-static struct scdat
-{
-  int32_t score, nextbs, tscore;
-} scdat[DIGGERS];
-
-static char highbuf[10];
-
-static int32_t scorehigh[12]={0,0,0,0,0,0,0,0,0,0,0,0};
-
-char scoreinit[11][4];
-
-int32_t scoret=0;
-
-static char hsbuf[36];
-
-static char scorebuf[512];
-
-uint16_t bonusscore=20000;
+#include "game_ctx.h"
 
 static void readscores(void);
 static void writescores(void);
 static void savescores(void);
 static void getinitials(struct digger_draw_api *);
 static void flashywait(struct digger_draw_api *, int16_t n);
-static int16_t getinitial(struct digger_draw_api *, int16_t x,int16_t y);
+static bool getinitial(struct digger_draw_api *);
 static void shufflehigh(void);
-static void writenum(struct digger_draw_api *, int32_t n,int16_t x,int16_t y,int16_t w,int16_t c);
+static void writescore(struct digger_draw_api *, int n,int16_t c);
 static void numtostring(char *p,int32_t n);
 
 #if defined FREEBSD && defined _VGL
@@ -68,13 +49,14 @@ static void numtostring(char *p,int32_t n);
 #ifdef INTDRF
 int32_t getscore0(void)
 {
-  return scdat[0].score;
+  return dgctx->scores.scdat[0].score;
 }
 #endif
 
 int32_t gettscore(int n)
 {
-  return scdat[n].tscore + scdat[n].score;
+  struct scores_state *st=&dgctx->scores;
+  return st->scdat[n].tscore + st->scdat[n].score;
 }
 
 #ifdef _RP2350
@@ -89,32 +71,33 @@ int32_t gettscore(int n)
 static void
 readscores(void)
 {
+  struct scores_state *st=&dgctx->scores;
 #ifdef _RP2350
   const uint8_t *flash_data = (const uint8_t *)SCORES_FLASH_ADDR;
   uint32_t magic;
   memcpy(&magic, flash_data, sizeof(magic));
   if (magic == SCORES_MAGIC) {
-    memcpy(scorebuf, flash_data + 4, 512);
+    memcpy(st->scorebuf, flash_data + 4, 512);
   } else {
-    scorebuf[0] = 0;
+    st->scorebuf[0] = 0;
   }
 #else
   FILE *in;
 
-  scorebuf[0]=0;
-  if (!dgstate.levfflag) {
+  st->scorebuf[0]=0;
+  if (!dgctx->game.levfflag) {
     in = fopen(SFNAME, "rb");
     if (in == NULL)
         return;
   } else {
-    in = fopen(dgstate.levfname, "rb");
+    in = fopen(dgctx->game.levfname, "rb");
     if (in == NULL)
         return;
     if (fseek(in, 1202, 0) < 0)
         goto out;
   }
-  if (fread(scorebuf, 512, 1, in) <= 0) {
-    scorebuf[0]=0;
+  if (fread(st->scorebuf, 512, 1, in) <= 0) {
+    st->scorebuf[0]=0;
   }
 out:
   fclose(in);
@@ -124,16 +107,18 @@ out:
 static void
 writescores(void)
 {
+  struct scores_state *st=&dgctx->scores;
 #ifdef _RP2350
   /* Write scores to flash. Core 1's code path is entirely in RAM
-   * (__not_in_flash_func + __scratch_x DMA handler), so we only need
+   * (__not_in_flash_func + __scratch_x DMA handler, and the audio IRQ
+   * with the synthesis it calls), so we only need
    * to disable Core 0 interrupts - no multicore lockout required.
    * This keeps HDMI signal uninterrupted during flash writes. */
   uint8_t buf[FLASH_SECTOR_SIZE];
   uint32_t magic = SCORES_MAGIC;
   memset(buf, 0xFF, sizeof(buf));
   memcpy(buf, &magic, sizeof(magic));
-  memcpy(buf + 4, scorebuf, 512);
+  memcpy(buf + 4, st->scorebuf, 512);
 
   uint32_t ints = save_and_disable_interrupts();
   flash_range_erase(SCORES_FLASH_OFFSET, FLASH_SECTOR_SIZE);
@@ -141,16 +126,16 @@ writescores(void)
   restore_interrupts(ints);
 #else
   FILE *out;
-  if (!dgstate.levfflag) {
+  if (!dgctx->game.levfflag) {
     if ((out=fopen(SFNAME,"wb"))!=NULL) {
-      fwrite(scorebuf,512,1,out);
+      fwrite(st->scorebuf,512,1,out);
       fclose(out);
     }
   }
   else
-    if ((out=fopen(dgstate.levfname,"r+b"))!=NULL) {
+    if ((out=fopen(dgctx->game.levfname,"r+b"))!=NULL) {
       if (fseek(out,1202,0) == 0)
-          fwrite(scorebuf,512,1,out);
+          fwrite(st->scorebuf,512,1,out);
       fclose(out);
     }
 #endif
@@ -159,148 +144,223 @@ writescores(void)
 void initscores(struct digger_draw_api *ddap)
 {
   int i;
-  for (i=0;i<dgstate.diggers;i++)
+  for (i=0;i<dgctx->game.diggers;i++)
     addscore(ddap, i,0);
 }
 
 void loadscores(void)
 {
+  struct scores_state *st=&dgctx->scores;
   int16_t p=0,i,x;
   readscores();
-  if (dgstate.gauntlet)
+  if (dgctx->game.gauntlet)
     p=111;
-  if (dgstate.diggers==2)
+  if (dgctx->game.diggers==2)
     p+=222;
-  if (scorebuf[p++]!='s')
+  if (st->scorebuf[p++]!='s')
     for (i=0;i<11;i++) {
-      scorehigh[i+1]=0;
-      strcpy(scoreinit[i],"...");
+      st->scorehigh[i+1]=0;
+      strcpy(st->scoreinit[i],"...");
     }
   else
     for (i=1;i<11;i++) {
       for (x=0;x<3;x++)
-        scoreinit[i][x]=scorebuf[p++];
+        st->scoreinit[i][x]=st->scorebuf[p++];
       p+=2;
       for (x=0;x<6;x++)
-        highbuf[x]=scorebuf[p++];
-      scorehigh[i+1]=atol(highbuf);
+        st->highbuf[x]=st->scorebuf[p++];
+      st->scorehigh[i+1]=atol(st->highbuf);
     }
 }
 
 void zeroscores(void)
 {
-  scdat[0].score = scdat[1].score = 0;
-  scdat[0].tscore = scdat[1].tscore = 0;
-  scdat[0].nextbs = scdat[1].nextbs = bonusscore;
-  scoret = 0;
+  struct scores_state *st=&dgctx->scores;
+  st->scdat[0].score = st->scdat[1].score = 0;
+  st->scdat[0].tscore = st->scdat[1].tscore = 0;
+  st->scdat[0].nextbs = st->scdat[1].nextbs = st->bonusscore;
+  st->scoret = 0;
 }
 
 void writecurscore(struct digger_draw_api *ddap, int col)
 {
-  if (dgstate.curplayer==0)
-    writenum(ddap, scdat[0].score,0,0,6,col);
-  else
-    if (scdat[1].score<100000l)
-      writenum(ddap, scdat[1].score,236,0,6,col);
-    else
-      writenum(ddap, scdat[1].score,248,0,6,col);
+  writescore(ddap, dgctx->game.curplayer,col);
 }
 
 void drawscores(struct digger_draw_api *ddap)
 {
-  writenum(ddap, scdat[0].score,0,0,6,3);
-  if (dgstate.nplayers==2 || dgstate.diggers==2) {
-    if (scdat[1].score<100000l)
-      writenum(ddap, scdat[1].score,236,0,6,3);
-    else
-      writenum(ddap, scdat[1].score,248,0,6,3);
-  }
+  writescore(ddap, 0,3);
+  if (dgctx->game.nplayers==2 || dgctx->game.diggers==2)
+    writescore(ddap, 1,3);
+}
+
+/* The scores drawn again in the colour they were last drawn in */
+void redrawscores(struct digger_draw_api *ddap)
+{
+  struct scores_state *st=&dgctx->scores;
+  writescore(ddap, 0,st->hudscore[0].c);
+  if (dgctx->game.nplayers==2 || dgctx->game.diggers==2)
+    writescore(ddap, 1,st->hudscore[1].c);
 }
 
 void addscore(struct digger_draw_api *ddap, int n,int16_t score)
 {
-  scdat[n].score+=score;
-  if (scdat[n].score>999999l) {
-    scdat[n].tscore += scdat[n].score;
-    scdat[n].score=0;
+  struct scores_state *st=&dgctx->scores;
+  st->scdat[n].score+=score;
+  if (st->scdat[n].score>999999l) {
+    st->scdat[n].tscore += st->scdat[n].score;
+    st->scdat[n].score=0;
   }
-  if (n==0)
-    writenum(ddap, scdat[n].score,0,0,6,1);
-  else
-    if (scdat[n].score<100000l)
-      writenum(ddap, scdat[n].score,236,0,6,1);
-    else
-      writenum(ddap, scdat[n].score,248,0,6,1);
-  if (scdat[n].score>=scdat[n].nextbs+n) { /* +n to reproduce original bug */
-    if (getlives(n)<5 || dgstate.unlimlives) {
-      if (dgstate.gauntlet)
-        dgstate.cgtime+=17897715l; /* 15 second time bonus instead of the life */
+  writescore(ddap, n,1);
+  if (st->scdat[n].score>=st->scdat[n].nextbs+n) { /* +n to reproduce original bug */
+    if (getlives(n)<5 || dgctx->game.unlimlives) {
+      if (dgctx->game.gauntlet)
+        dgctx->game.cgtime+=17897715l; /* 15 second time bonus instead of the life */
       else
         addlife(n);
       drawlives(ddap);
     }
-    scdat[n].nextbs+=bonusscore;
+    st->scdat[n].nextbs+=st->bonusscore;
   }
   incpenalty();
   incpenalty();
   incpenalty();
 }
 
-void endofgame(struct digger_draw_api *ddap)
+/* Where endofgame() resumes on the next frame */
+enum {
+  EOG_START,
+  EOG_TIMEUP,     /* "TIME UP" is on screen */
+  EOG_PLAYER,     /* check the next player for a high score */
+  EOG_INITIALS,   /* high score: ask for initials */
+  EOG_ENTRY,      /* waiting for an initial */
+  EOG_FLASH,      /* flashing the screen after the initials */
+  EOG_GAMEOVER    /* "GAME OVER" is on screen */
+};
+
+/* Show the end of a game. Call once per frame until it returns false. */
+bool endofgame(struct digger_draw_api *ddap)
 {
+  struct scores_state *st=&dgctx->scores;
   int16_t i;
-  bool initflag=false;
-  for (i=0;i<dgstate.diggers;i++)
-    addscore(ddap, i,0);
-  if (playing || !drfvalid)
-    return;
-  if (dgstate.gauntlet) {
-    cleartopline();
-    outtext(ddap, "TIME UP",120,0,3);
-    for (i=0;i<50 && !escape;i++)
-      newframe();
-    erasetext(ddap, 7, 120,0,3);
-  }
-  for (i=dgstate.curplayer;i<dgstate.curplayer+dgstate.diggers;i++) {
-    scoret=scdat[i].score;
-    if (scoret>scorehigh[11]) {
-      ddap->gclear();
-      drawscores(ddap);
-      strcpy(dgstate.pldispbuf,"PLAYER ");
-      if (i==0)
-        strcat(dgstate.pldispbuf,"1");
-      else
-        strcat(dgstate.pldispbuf,"2");
-      outtext(ddap, dgstate.pldispbuf,108,0,2);
-      outtext(ddap, " NEW HIGH SCORE ",64,40,2);
-      getinitials(ddap);
-      shufflehigh();
-      savescores();
-      initflag=true;
+  for (;;)
+    switch (st->eog) {
+      case EOG_START:
+        for (i=0;i<dgctx->game.diggers;i++)
+          addscore(ddap, i,0);
+        if (dgctx->record.playing || !dgctx->record.drfvalid)
+          return false;
+        st->initflag=false;
+        st->eogplayer=dgctx->game.curplayer;
+        st->eog=EOG_PLAYER;
+        if (dgctx->game.gauntlet) {
+          cleartopline();
+          outtext(ddap, "TIME UP",120,0,3);
+          st->eogtime=0;
+          if (!dgctx->input.escape) {
+            st->eog=EOG_TIMEUP;
+            return true;
+          }
+          erasetext(ddap, 7, 120,0,3);
+        }
+        break;
+      case EOG_TIMEUP:
+        newframe();
+        if (++st->eogtime<50 && !dgctx->input.escape)
+          return true;
+        erasetext(ddap, 7, 120,0,3);
+        st->eog=EOG_PLAYER;
+        break;
+      case EOG_PLAYER:
+        if (st->eogplayer<dgctx->game.curplayer+dgctx->game.diggers) {
+          i=st->eogplayer;
+          st->scoret=st->scdat[i].score;
+          if (st->scoret>st->scorehigh[11]) {
+            ddap->gclear();
+            drawscores(ddap);
+            strcpy(dgctx->game.pldispbuf,"PLAYER ");
+            if (i==0)
+              strcat(dgctx->game.pldispbuf,"1");
+            else
+              strcat(dgctx->game.pldispbuf,"2");
+            outtext(ddap, dgctx->game.pldispbuf,108,0,2);
+            outtext(ddap, " NEW HIGH SCORE ",64,40,2);
+            st->eog=EOG_INITIALS;
+            return true;
+          }
+          st->eogplayer++;
+          break;
+        }
+        st->eog=EOG_START;
+        if (st->initflag || dgctx->game.gauntlet)
+          return false;
+        cleartopline();
+        outtext(ddap, "GAME OVER",104,0,3);
+        st->eogtime=0;
+        if (!dgctx->input.escape) {
+          st->eog=EOG_GAMEOVER;
+          return true;
+        }
+        erasetext(ddap, 9, 104,0,3);
+        setretr(true);
+        return false;
+      case EOG_INITIALS:
+        getinitials(ddap);
+        st->eog=EOG_ENTRY;
+        if (!getinitial(ddap))
+          return true;
+        break;
+      case EOG_ENTRY:
+        flashywait(ddap, 15);
+        if (++st->initwait==80)
+          st->initwait=0;
+        if (!getinitial(ddap))
+          return true;
+        if (st->initpos<3)
+          break;
+        st->eogtime=0;
+        st->eog=EOG_FLASH;
+        return true;
+      case EOG_FLASH:
+        flashywait(ddap, 15);
+        if (++st->eogtime<20)
+          return true;
+        setupsound();
+        ddap->gclear();
+        ddap->gpal(0);
+        ddap->ginten(0);
+        setretr(true);
+        recputinit(st->scoreinit[0]);
+        shufflehigh();
+        savescores();
+        st->initflag=true;
+        st->eogplayer++;
+        st->eog=EOG_PLAYER;
+        break;
+      case EOG_GAMEOVER:
+        newframe();
+        if (++st->eogtime<50 && !dgctx->input.escape)
+          return true;
+        erasetext(ddap, 9, 104,0,3);
+        setretr(true);
+        st->eog=EOG_START;
+        return false;
     }
-  }
-  if (!initflag && !dgstate.gauntlet) {
-    cleartopline();
-    outtext(ddap, "GAME OVER",104,0,3);
-    for (i=0;i<50 && !escape;i++)
-      newframe();
-    erasetext(ddap, 9, 104,0,3);
-    setretr(true);
-  }
 }
 
 void showtable(struct digger_draw_api *ddap)
 {
+  struct scores_state *st=&dgctx->scores;
   int16_t i,col;
   outtext(ddap, "HIGH SCORES",16,25,3);
   col=2;
   for (i=1;i<11;i++) {
-    strcpy(hsbuf,"");
-    strcat(hsbuf,scoreinit[i]);
-    strcat(hsbuf,"  ");
-    numtostring(highbuf,scorehigh[i+1]);
-    strcat(hsbuf,highbuf);
-    outtext(ddap, hsbuf,16,31+13*i,col);
+    strcpy(st->hsbuf,"");
+    strcat(st->hsbuf,st->scoreinit[i]);
+    strcat(st->hsbuf,"  ");
+    numtostring(st->highbuf,st->scorehigh[i+1]);
+    strcat(st->hsbuf,st->highbuf);
+    outtext(ddap, st->hsbuf,16,31+13*i,col);
     col=1;
   }
 }
@@ -308,110 +368,107 @@ void showtable(struct digger_draw_api *ddap)
 static void
 savescores(void)
 {
+  struct scores_state *st=&dgctx->scores;
   int16_t i,p=0,j;
-  if (dgstate.gauntlet)
+  if (dgctx->game.gauntlet)
     p=111;
-  if (dgstate.diggers==2)
+  if (dgctx->game.diggers==2)
     p+=222;
-  strcpy(scorebuf+p,"s");
+  strcpy(st->scorebuf+p,"s");
   for (i=1;i<11;i++) {
-    strcpy(hsbuf,"");
-    strcat(hsbuf,scoreinit[i]);
-    strcat(hsbuf,"  ");
-    numtostring(highbuf,scorehigh[i+1]);
-    strcat(hsbuf,highbuf);
+    strcpy(st->hsbuf,"");
+    strcat(st->hsbuf,st->scoreinit[i]);
+    strcat(st->hsbuf,"  ");
+    numtostring(st->highbuf,st->scorehigh[i+1]);
+    strcat(st->hsbuf,st->highbuf);
     for (j=0;j<11;j++)
-      scorebuf[p+j+i*11-10]=hsbuf[j];
+      st->scorebuf[p+j+i*11-10]=st->hsbuf[j];
   }
   writescores();
 }
 
-void getinitials(struct digger_draw_api *ddap)
+static void getinitials(struct digger_draw_api *ddap)
 {
-  int16_t k,i;
+  struct scores_state *st=&dgctx->scores;
   newframe();
   outtext(ddap, "ENTER YOUR",100,70,3);
   outtext(ddap, " INITIALS",100,90,3);
   outtext(ddap, "_ _ _",128,130,3);
-  strcpy(scoreinit[0],"...");
+  strcpy(st->scoreinit[0],"...");
   killsound();
-  for (i=0;i<3;i++) {
-    k=0;
-    while (k==0) {
-      k=getinitial(ddap, i*24+128,130);
-      if (k==8 || k==127) {
-        if (i>0)
-          i--;
-        k=0;
-      }
-    }
-    if (k!=0) {
-      ddap->gwrite(i*24+128,130,k,3);
-      scoreinit[0][i]=k;
-    }
-  }
-  for (i=0;i<20;i++)
-    flashywait(ddap, 15);
-  setupsound();
-  ddap->gclear();
-  ddap->gpal(0);
-  ddap->ginten(0);
-  setretr(true);
-  recputinit(scoreinit[0]);
+  st->initpos=0;
+  st->initwait=0;
+  ddap->gwrite(128,130,'_',3);
 }
 
-void flashywait(struct digger_draw_api *ddap, int16_t n)
+/* The screen is flashed once per frame between these calls */
+static void flashywait(struct digger_draw_api *ddap, int16_t n)
 {
-  int16_t i,gt,cx,p=0;
-  int8_t gap=19;
+  int16_t i,cx,p=0;
 
-  gethrt(true);
   setretr(false);
   for (i=0;i<(n<<1);i++)
-    for (cx=0;cx<volume;cx++) {
+    for (cx=0;cx<dgctx->sound.volume;cx++) {
       ddap->gpal(p=1-p);
       ddap->gflush();
-      for (gt=0;gt<gap;gt++);
     }
 }
 
-int16_t getinitial(struct digger_draw_api *ddap, int16_t x,int16_t y)
+/* Take the keys typed since the last frame as initials. The cursor blinks
+   on a cycle of 80 frames, counted by initwait; alphanumeric keys are
+   accepted during the first half of it and any key during the second.
+   Returns true once all three initials are in. */
+static bool getinitial(struct digger_draw_api *ddap)
 {
-  int16_t i;
-  ddap->gwrite(x,y,'_',3);
-  do {
-    for (i=0;i<40;i++) {
-      if (kbhit()) {
-        int16_t key = getkey(false);
-	if (!isalnum(key))
-	  continue;
-        return key;
+  struct scores_state *st=&dgctx->scores;
+  int16_t x,k;
+  while (kbhit()) {
+    x=st->initpos*24+128;
+    if (st->initwait<40) {
+      k=getkey(false);
+      if (!isalnum(k)) {
+        if (++st->initwait==80)
+          st->initwait=0;
+        continue;
       }
-      flashywait(ddap, 15);
     }
-    for (i=0;i<40;i++) {
-      if (kbhit()) {
-        ddap->gwrite(x,y,'_',3);
-        return getkey(false);
-      }
-      flashywait(ddap, 15);
+    else {
+      ddap->gwrite(x,130,'_',3);
+      k=getkey(false);
+    }
+    st->initwait=0;
+    if (k==8 || k==127) {
+      if (st->initpos>0)
+        st->initpos--;
+      k=0;
     }
-  } while (1);
+    if (k==0) {
+      ddap->gwrite(st->initpos*24+128,130,'_',3);
+      continue;
+    }
+    ddap->gwrite(x,130,k,3);
+    st->scoreinit[0][st->initpos]=k;
+    if (++st->initpos==3)
+      return true;
+    ddap->gwrite(st->initpos*24+128,130,'_',3);
+  }
+  return false;
 }
 
 static void
 shufflehigh(void)
 {
+  struct scores_state *st=&dgctx->scores;
   int16_t i,j;
   for (j=10;j>1;j--)
-    if (scoret<scorehigh[j])
+    if (st->scoret<st->scorehigh[j])
       break;
   for (i=10;i>j;i--) {
-    scorehigh[i+1]=scorehigh[i];
-    strcpy(scoreinit[i],scoreinit[i-1]);
+    st->scorehigh[i+1]=st->scorehigh[i];
+    strcpy(st->scoreinit[i],st->scoreinit[i-1]);
   }
-  scorehigh[j+1]=scoret;
-  strcpy(scoreinit[j],scoreinit[0]);
+  st->scorehigh[j+1]=st->scoret;
+  strcpy(st->scoreinit[j],st->scoreinit[0]);
 }
 
 void scorekill(struct digger_draw_api *ddap, int n)
@@ -450,18 +507,27 @@ void scoreeatm(struct digger_draw_api *ddap, int n,int msc)
   addscore(ddap, n,msc*200);
 }
 
+/* The score of player n as 6 digits, at the left for player 1 and the
+   right for player 2. A leading 0 is not drawn, but what was there is left
+   as it was. Only the digits that changed are drawn again. */
 static void
-writenum(struct digger_draw_api *ddap, int32_t n,int16_t x,int16_t y,int16_t w,int16_t c)
+writescore(struct digger_draw_api *ddap, int n,int16_t c)
 {
-  int16_t d,xp=(w-1)*12+x;
-  while (w>0) {
-    d=(int16_t)(n%10);
-    if (w>1 || d>0)
-      ddap->gwrite(xp,y,d+'0',c);
-    n/=10;
-    w--;
-    xp-=12;
+  struct scores_state *st=&dgctx->scores;
+  int32_t score=st->scdat[n].score;
+  int16_t x=(n==0) ? 0 : 236,i;
+  char buf[7];
+  for (i=5;i>=0;i--) {
+    buf[i]=(char)(score%10)+'0';
+    score/=10;
   }
+  buf[6]=0;
+  if (n==1 && st->scdat[n].score>=100000l)
+    x+=12;
+  if (buf[0]=='0')
+    hudtext(ddap, &st->hudscore[n],HUD_SCORE+n,buf+1,x+12,c);
+  else
+    hudtext(ddap, &st->hudscore[n],HUD_SCORE+n,buf,x,c);
 }
 
 static void
@@ -8,8 +8,9 @@ void showtable(struct digger_draw_api *);
 void zeroscores(void);
 void writecurscore(struct digger_draw_api *, int col);
 void drawscores(struct digger_draw_api *);
+void redrawscores(struct digger_draw_api *);
 void initscores(struct digger_draw_api *);
-void endofgame(struct digger_draw_api *);
+bool endofgame(struct digger_draw_api *);
 void scorekill(struct digger_draw_api *, int n);
 void scorekill2(struct digger_draw_api *);
 void scoreemerald(struct digger_draw_api *, int n);
@@ -24,7 +25,4 @@ int32_t getscore0(void);
 #endif
 int32_t gettscore(int n);
 
-extern uint16_t bonusscore;
-extern int32_t scoret;
 
-extern char scoreinit[11][4];
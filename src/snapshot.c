@@ -0,0 +1,284 @@
+/*
+ * snapshot.c - Savestates
+ *
+ * A snapshot holds everything digger_step() needs to carry on from a frame
+ * bit-exactly: the module states of the game context, the monster objects,
+ * the sound generator and the screen. With SNAP_NOSCREEN the screen, two
+ * thirds of the size, is left out and drawn again from the state instead,
+ * close to but not quite as it was. Module states are stored as they are
+ * laid out in memory, so a snapshot only loads into the build that made it.
+ * Pointers are cleared in the snapshot and rebuilt on restore, so the same
+ * game state always gives the same bytes.
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "def.h"
+#include "digger_types.h"
+#include "hardware.h"
+#include "draw_api.h"
+#include "game_ctx.h"
+#include "monster_obj.h"
+#include "digger_obj.h"
+#include "bullet_obj.h"
+#include "soundgen.h"
+#include "sprite.h"
+#include "main.h"
+#include "snapshot.h"
+
+extern struct digger_draw_api *ddap;
+
+static const char snap_magic[4] = {'D', 'G', 'S', 'S'};
+
+struct snap_header {
+    char magic[4];
+    uint16_t version;
+    uint16_t flags;             /* SNAP_* */
+    uint32_t layout;            /* sizeof(struct digger_ctx), as a build check */
+    uint32_t size;              /* whole snapshot */
+};
+
+/* Monster objects: the ones in play, then the title screen cast */
+#define SNAP_MONOBJS (MONSTERS + 2)
+
+struct snap_misc {
+    int32_t sprmov[SPRITES];    /* offset into the context, -1 = none */
+    int32_t plp;                /* playback position, -1 = none */
+    int16_t pal, inten;
+    bool monexist[SNAP_MONOBJS];
+    struct monster_obj_state mon[SNAP_MONOBJS];
+};
+
+/* The screen, through ggeti()/gputi(): 320x200 nibble-packed pixels */
+#define SNAP_FBW (MAX_W / 4)
+#define SNAP_FBSIZE (MAX_W / 2 * MAX_H)
+
+static struct monster_obj **monobj(int i)
+{
+    if (i < MONSTERS)
+        return &dgctx->monster.mondat[i].mop;
+    return i == MONSTERS ? &dgctx->main.nobbin : &dgctx->main.hobbin;
+}
+
+/* Clear member m of the struct s that starts at p */
+#define CLEAR(p, s, m) \
+    memset((p) + offsetof(struct s, m), 0, sizeof(((struct s *)0)->m))
+
+/* Clear the method pointers of a digger or bullet object at p */
+#define CLEARMETHODS(p, s, first) \
+    memset((p) + offsetof(struct s, first), 0, \
+           sizeof(struct s) - offsetof(struct s, first))
+
+static uint8_t *put(uint8_t *p, const void *src, size_t n)
+{
+    memcpy(p, src, n);
+    return p + n;
+}
+
+static const uint8_t *get(const uint8_t *p, void *dst, size_t n)
+{
+    memcpy(dst, p, n);
+    return p + n;
+}
+
+static size_t snapsize(unsigned int flags)
+{
+    return sizeof(struct snap_header) + sizeof(dgctx->game) +
+        sizeof(dgctx->main) + sizeof(dgctx->digger) + sizeof(dgctx->monster) +
+        sizeof(dgctx->bags) + sizeof(dgctx->drawing) + sizeof(dgctx->sprite) +
+        sizeof(dgctx->sound) + sizeof(dgctx->newsnd) + sizeof(dgctx->scores) +
+        sizeof(dgctx->input) + sizeof(dgctx->record) +
+        sizeof(struct snap_misc) + sgen_getstate(dgctx->newsnd.ssp, NULL) +
+        ((flags & SNAP_NOSCREEN) ? 0 : SNAP_FBSIZE);
+}
+
+size_t snapshot(void *buf, size_t len, unsigned int flags)
+{
+    struct digger_ctx *ctx = dgctx;
+    struct snap_header hdr;
+    struct snap_misc misc;
+    uint8_t *p = buf, *s;
+    size_t size = snapsize(flags);
+    int i;
+
+    if (buf == NULL || len < size)
+        return size;
+
+    /* Queued sprite moves are not saved: put them on the screen first */
+    flushsprites();
+    memcpy(hdr.magic, snap_magic, sizeof(hdr.magic));
+    hdr.version = SNAPSHOT_VERSION;
+    hdr.flags = flags;
+    hdr.layout = sizeof(struct digger_ctx);
+    hdr.size = size;
+    p = put(p, &hdr, sizeof(hdr));
+
+    p = put(p, &ctx->game, sizeof(ctx->game));
+    s = p;
+    p = put(p, &ctx->main, sizeof(ctx->main));
+    CLEAR(s, main_state, nobbin);
+    CLEAR(s, main_state, hobbin);
+    CLEARMETHODS(s + offsetof(struct main_state, odigger), digger_obj, put);
+    s = p;
+    p = put(p, &ctx->digger, sizeof(ctx->digger));
+    for (i = 0; i < DIGGERS; i++) {
+        uint8_t *d = s + offsetof(struct digger_state, digdat) +
+            i * sizeof(struct digger);
+
+        CLEARMETHODS(d + offsetof(struct digger, dob), digger_obj, put);
+        CLEARMETHODS(d + offsetof(struct digger, bob), bullet_obj, put);
+    }
+    s = p;
+    p = put(p, &ctx->monster, sizeof(ctx->monster));
+    for (i = 0; i < MONSTERS; i++)
+        CLEAR(s + offsetof(struct monster_state, mondat) +
+              i * sizeof(struct monster), monster, mop);
+    p = put(p, &ctx->bags, sizeof(ctx->bags));
+    p = put(p, &ctx->drawing, sizeof(ctx->drawing));
+    s = p;
+    p = put(p, &ctx->sprite, sizeof(ctx->sprite));
+    CLEAR(s, sprite_state, sprmov);
+    p = put(p, &ctx->sound, sizeof(ctx->sound));
+    s = p;
+    p = put(p, &ctx->newsnd, sizeof(ctx->newsnd));
+    CLEAR(s, newsnd_state, ssp);
+    p = put(p, &ctx->scores, sizeof(ctx->scores));
+    p = put(p, &ctx->input, sizeof(ctx->input));
+    s = p;
+    p = put(p, &ctx->record, sizeof(ctx->record));
+    CLEAR(s, record_state, recf);
+    CLEAR(s + offsetof(struct record_state, enc), drf2_enc, sink);
+    CLEAR(s + offsetof(struct record_state, enc), drf2_enc, arg);
+    CLEAR(s, record_state, plb);
+    CLEAR(s, record_state, plp);
+    CLEAR(s, record_state, orig);
+    CLEAR(s, record_state, idx);
+
+    memset(&misc, 0, sizeof(misc));
+    for (i = 0; i < SPRITES; i++)
+        misc.sprmov[i] = ctx->sprite.sprmov[i] == NULL ? -1 :
+            (int32_t)(ctx->sprite.sprmov[i] - (uint8_t *)ctx);
+    misc.plp = ctx->record.plb == NULL ? -1 :
+        (int32_t)(ctx->record.plp - ctx->record.plb);
+    cgagetpal(&misc.pal, &misc.inten);
+    for (i = 0; i < SNAP_MONOBJS; i++) {
+        struct monster_obj *mop = *monobj(i);
+
+        misc.monexist[i] = mop != NULL;
+        if (mop != NULL)
+            monster_obj_getstate(mop, &misc.mon[i]);
+    }
+    p = put(p, &misc, sizeof(misc));
+
+    p += sgen_getstate(ctx->newsnd.ssp, p);
+    if (!(flags & SNAP_NOSCREEN))
+        ddap->ggeti(0, 0, p, SNAP_FBW, MAX_H);
+    return size;
+}
+
+bool restore(const void *buf, size_t len)
+{
+    struct digger_ctx *ctx = dgctx;
+    struct snap_header hdr;
+    struct snap_misc misc;
+    struct monster_obj *mop[SNAP_MONOBJS];
+    struct sgen_state *ssp = ctx->newsnd.ssp;
+    char *plb = ctx->record.plb;
+    FILE *recf = ctx->record.recf;
+    struct record_state keep = ctx->record;
+    drf2_sink_t recsink = ctx->record.enc.sink;
+    void *recarg = ctx->record.enc.arg;
+    struct digger_obj dtmpl;
+    struct bullet_obj btmpl;
+    const uint8_t *p = buf;
+    int i;
+
+    if (len < sizeof(hdr))
+        return false;
+    memcpy(&hdr, p, sizeof(hdr));
+    if (memcmp(hdr.magic, snap_magic, sizeof(hdr.magic)) != 0 ||
+        hdr.version != SNAPSHOT_VERSION ||
+        hdr.layout != sizeof(struct digger_ctx) ||
+        (hdr.flags & ~SNAP_NOSCREEN) != 0 ||
+        hdr.size != snapsize(hdr.flags) || len < hdr.size)
+        return false;
+    p += sizeof(hdr);
+
+    flushsprites();
+    /* The screen first: drawing it changes the HUD owners, which the
+       sprite state then puts back as they were */
+    if (!(hdr.flags & SNAP_NOSCREEN))
+        ddap->gputi(0, 0, (uint8_t *)buf + hdr.size - SNAP_FBSIZE, SNAP_FBW,
+                    MAX_H);
+    for (i = 0; i < SNAP_MONOBJS; i++)
+        mop[i] = *monobj(i);
+    p = get(p, &ctx->game, sizeof(ctx->game));
+    p = get(p, &ctx->main, sizeof(ctx->main));
+    p = get(p, &ctx->digger, sizeof(ctx->digger));
+    p = get(p, &ctx->monster, sizeof(ctx->monster));
+    p = get(p, &ctx->bags, sizeof(ctx->bags));
+    p = get(p, &ctx->drawing, sizeof(ctx->drawing));
+    p = get(p, &ctx->sprite, sizeof(ctx->sprite));
+    p = get(p, &ctx->sound, sizeof(ctx->sound));
+    p = get(p, &ctx->newsnd, sizeof(ctx->newsnd));
+    p = get(p, &ctx->scores, sizeof(ctx->scores));
+    p = get(p, &ctx->input, sizeof(ctx->input));
+    p = get(p, &ctx->record, sizeof(ctx->record));
+    p = get(p, &misc, sizeof(misc));
+
+    /* Put back what the pointers referred to */
+    ctx->newsnd.ssp = ssp;
+    ctx->record.recf = recf;
+    ctx->record.enc.sink = recsink;
+    ctx->record.enc.arg = recarg;
+    ctx->record.orig = keep.orig;
+    ctx->record.idx = keep.idx;
+    ctx->record.plb = plb;
+    ctx->record.plp = (plb != NULL && misc.plp >= 0) ? plb + misc.plp : plb;
+    for (i = 0; i < SPRITES; i++)
+        ctx->sprite.sprmov[i] = misc.sprmov[i] < 0 ? NULL :
+            (uint8_t *)ctx + misc.sprmov[i];
+    digger_obj_init(&dtmpl, 0, 0, 0, 0);
+    bullet_obj_init(&btmpl, 0, 0, 0, 0);
+    for (i = 0; i < DIGGERS; i++) {
+        memcpy((uint8_t *)&ctx->digger.digdat[i].dob + offsetof(struct digger_obj, put),
+               (uint8_t *)&dtmpl + offsetof(struct digger_obj, put),
+               sizeof(dtmpl) - offsetof(struct digger_obj, put));
+        memcpy((uint8_t *)&ctx->digger.digdat[i].bob + offsetof(struct bullet_obj, put),
+               (uint8_t *)&btmpl + offsetof(struct bullet_obj, put),
+               sizeof(btmpl) - offsetof(struct bullet_obj, put));
+    }
+    memcpy((uint8_t *)&ctx->main.odigger + offsetof(struct digger_obj, put),
+           (uint8_t *)&dtmpl + offsetof(struct digger_obj, put),
+           sizeof(dtmpl) - offsetof(struct digger_obj, put));
+    for (i = 0; i < SNAP_MONOBJS; i++) {
+        if (!misc.monexist[i]) {
+            if (mop[i] != NULL)
+                CALL_METHOD(mop[i], dtor);
+            mop[i] = NULL;
+        } else {
+            if (mop[i] == NULL)
+                mop[i] = monster_obj_ctor(misc.mon[i].m_id, misc.mon[i].nobf,
+                                          misc.mon[i].dir, misc.mon[i].x,
+                                          misc.mon[i].y);
+            if (mop[i] != NULL)
+                monster_obj_setstate(mop[i], &misc.mon[i]);
+        }
+        *monobj(i) = mop[i];
+    }
+
+    sgen_setstate(ssp, p);
+    if (hdr.flags & SNAP_NOSCREEN)
+        redrawscreen();
+    ddap->gpal(misc.pal);
+    ddap->ginten(misc.inten);
+    return true;
+}
@@ -0,0 +1,38 @@
+/*
+ * snapshot.h - Savestates
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __SNAPSHOT_H
+#define __SNAPSHOT_H
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#define SNAPSHOT_VERSION 2
+
+/*
+ * Leave the screen out, and draw it again from the game state on restore.
+ * Only for frames of a level in play; see redrawscreen().
+ */
+#define SNAP_NOSCREEN 1
+
+/*
+ * Save the game bound to dgctx into buf. Returns the size of the snapshot,
+ * which is written only if it fits into len bytes; snapshot(NULL, 0, flags)
+ * just asks for the size.
+ */
+size_t snapshot(void *buf, size_t len, unsigned int flags);
+
+/*
+ * Put the game bound to dgctx back into a saved state. The context must
+ * have been through maininit(). Returns false, leaving the game alone, if
+ * buf is not a snapshot of this version and build.
+ */
+bool restore(const void *buf, size_t len);
+
+#endif
@@ -8,17 +8,10 @@
 #include "main.h"
 #include "digger.h"
 #include "input.h"
+#include "game_ctx.h"
 
 extern bool wave_device_available;
 
-static int16_t wavetype=0,musvol=0;
-static uint16_t t2val=0,t0val=0;
-int16_t spkrmode=0,pulsewidth=1,volume=0;
-
-static int8_t timerclock=0;
-
-bool soundflag=true,musicflag=true;
-
 static void soundlevdoneoff(void);
 static void soundlevdoneupdate(void);
 static void soundfallupdate(void);
@@ -56,39 +49,35 @@ void (*timer0)(uint16_t t0v)=s0timer0;
 void (*timer2)(uint16_t t2v, bool mod)=s0timer2;
 void (*soundkillglob)(void)=s0soundkillglob;
 
-static bool sndflag=false,soundpausedflag=false;
-
-static int32_t randvs;
-
 static int16_t randnos(int16_t n)
 {
-  randvs=randvs*0x15a4e35l+1;
-  return (int16_t)((randvs&0x7fffffffl)%n);
+  struct sound_state *st=&dgctx->sound;
+  st->randvs=st->randvs*0x15a4e35l+1;
+  return (int16_t)((st->randvs&0x7fffffffl)%n);
 }
 
 static void sett2val(int16_t t2v, bool mode)
 {
-  if (sndflag)
+  if (dgctx->sound.sndflag)
     timer2(t2v, mode);
 }
 
-static bool soundlevdoneflag=false;
-
 void soundint(void)
 {
-  timerclock++;
-  if (soundflag && !sndflag)
-    sndflag=musicflag=true;
-  if (!soundflag && sndflag) {
-    sndflag=false;
+  struct sound_state *st=&dgctx->sound;
+  st->timerclock++;
+  if (st->soundflag && !st->sndflag)
+    st->sndflag=st->musicflag=true;
+  if (!st->soundflag && st->sndflag) {
+    st->sndflag=false;
     timer2(40, false);
     setsoundt2();
     soundoff();
   }
-  if (sndflag && !soundpausedflag) {
-    t0val=0x7d00;
-    t2val=40;
-    if (musicflag)
+  if (st->sndflag && !st->soundpausedflag) {
+    st->t0val=0x7d00;
+    st->t2val=40;
+    if (st->musicflag)
       musicupdate();
 #if !defined(NO_SND_EFFECTS)
     soundemeraldupdate();
@@ -104,15 +93,15 @@ void soundint(void)
     sound1upupdate();
     soundbonusupdate();
 #endif
-    if (t0val==0x7d00 || t2val!=40)
+    if (st->t0val==0x7d00 || st->t2val!=40)
       setsoundt2();
     else {
       setsoundmode();
       sett0(false);
     }
-    sett2val(t2val, false);
+    sett2val(st->t2val, false);
   }
-  if (soundlevdoneflag)
+  if (st->soundlevdoneflag)
     soundlevdoneupdate();
 }
 
@@ -136,32 +125,48 @@ void soundstop(void)
   sound1upoff();
 }
 
-static int16_t nljpointer=0,nljnoteduration=0;
+static bool soundlevdonewait(void)
+{
+  struct sound_state *st=&dgctx->sound;
+  if (!st->soundlevdoneflag || dgctx->input.escape) {
+    soundlevdoneoff();
+    return false;
+  }
+  if (!wave_device_available)
+    st->soundlevdoneflag=false;
+  return true;
+}
 
-void soundlevdone(void)
+/* Start the level completed jingle. Returns true if the caller has to wait
+   for it, by calling soundlevdonetick() once per frame. */
+bool soundlevdone(void)
 {
-  int16_t timer=0;
+  struct sound_state *st=&dgctx->sound;
   soundstop();
-  if (!sndflag)
-    return;
-  nljpointer=0;
-  nljnoteduration=20;
-  soundlevdoneflag=soundpausedflag=true;
-  while (soundlevdoneflag && !escape) {
-    if (!wave_device_available)
-      soundlevdoneflag=false;
-    gethrt(true);
-    if (timerclock==timer)
-      continue;
+  if (!st->sndflag)
+    return false;
+  st->nljpointer=0;
+  st->nljnoteduration=20;
+  st->levdonetimer=0;
+  st->soundlevdoneflag=st->soundpausedflag=true;
+  return soundlevdonewait();
+}
+
+/* Returns false once the jingle has finished or was cut short */
+bool soundlevdonetick(void)
+{
+  struct sound_state *st=&dgctx->sound;
+  if (st->timerclock!=st->levdonetimer) {
     checkkeyb();
-    timer=timerclock;
+    st->levdonetimer=st->timerclock;
   }
-  soundlevdoneoff();
+  return soundlevdonewait();
 }
 
 static void soundlevdoneoff(void)
 {
-  soundlevdoneflag=soundpausedflag=false;
+  struct sound_state *st=&dgctx->sound;
+  st->soundlevdoneflag=st->soundpausedflag=false;
 }
 
 static const int16_t newlevjingle[11]={0x8e8,0x712,0x5f2,0x7f0,0x6ac,0x54c,
@@ -169,298 +174,283 @@ static const int16_t newlevjingle[11]={0x8e8,0x712,0x5f2,0x7f0,0x6ac,0x54c,
 
 static void soundlevdoneupdate(void)
 {
+  struct sound_state *st=&dgctx->sound;
 
-  if (sndflag) {
-    if (nljpointer<11)
-      t2val=newlevjingle[nljpointer];
-    t0val=t2val+35;
-    musvol=50;
+  if (st->sndflag) {
+    if (st->nljpointer<11)
+      st->t2val=newlevjingle[st->nljpointer];
+    st->t0val=st->t2val+35;
+    st->musvol=50;
     setsoundmode();
     sett0(true);
-    sett2val(t2val, true);
-    if (nljnoteduration>0)
-      nljnoteduration--;
+    sett2val(st->t2val, true);
+    if (st->nljnoteduration>0)
+      st->nljnoteduration--;
     else {
-      nljnoteduration=20;
-      nljpointer++;
-      if (nljpointer>10)
+      st->nljnoteduration=20;
+      st->nljpointer++;
+      if (st->nljpointer>10)
         soundlevdoneoff();
     }
   }
   else
-    soundlevdoneflag=false;
+    st->soundlevdoneflag=false;
 }
 
-
-static bool soundfallflag=false,soundfallf=false;
-static int16_t soundfallvalue,soundfalln=0;
-
 void soundfall(void)
 {
-  soundfallvalue=1000;
-  soundfallflag=true;
+  struct sound_state *st=&dgctx->sound;
+  st->soundfallvalue=1000;
+  st->soundfallflag=true;
 }
 
 void soundfalloff(void)
 {
-  soundfallflag=false;
-  soundfalln=0;
+  struct sound_state *st=&dgctx->sound;
+  st->soundfallflag=false;
+  st->soundfalln=0;
 }
 
 static void soundfallupdate(void)
 {
-  if (soundfallflag) {
-    if (soundfalln<1) {
-      soundfalln++;
-      if (soundfallf)
-        t2val=soundfallvalue;
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundfallflag) {
+    if (st->soundfalln<1) {
+      st->soundfalln++;
+      if (st->soundfallf)
+        st->t2val=st->soundfallvalue;
     }
     else {
-      soundfalln=0;
-      if (soundfallf) {
-        soundfallvalue+=50;
-        soundfallf=false;
+      st->soundfalln=0;
+      if (st->soundfallf) {
+        st->soundfallvalue+=50;
+        st->soundfallf=false;
       }
       else
-        soundfallf=true;
+        st->soundfallf=true;
     }
   }
 }
 
-
-static bool soundbreakflag=false;
-static int16_t soundbreakduration=0,soundbreakvalue=0;
-
 void soundbreak(void)
 {
-  soundbreakduration=3;
-  if (soundbreakvalue<15000)
-    soundbreakvalue=15000;
-  soundbreakflag=true;
+  struct sound_state *st=&dgctx->sound;
+  st->soundbreakduration=3;
+  if (st->soundbreakvalue<15000)
+    st->soundbreakvalue=15000;
+  st->soundbreakflag=true;
 }
 
 static void soundbreakoff(void)
 {
-  soundbreakflag=false;
+  dgctx->sound.soundbreakflag=false;
 }
 
 static void soundbreakupdate(void)
 {
-  if (soundbreakflag) {
-    if (soundbreakduration!=0) {
-      soundbreakduration--;
-      t2val=soundbreakvalue;
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundbreakflag) {
+    if (st->soundbreakduration!=0) {
+      st->soundbreakduration--;
+      st->t2val=st->soundbreakvalue;
     }
     else
-      soundbreakflag=false;
+      st->soundbreakflag=false;
   }
 }
 
-
-static bool soundwobbleflag=false;
-static int16_t soundwobblen=0;
-
 void soundwobble(void)
 {
-  soundwobbleflag=true;
+  dgctx->sound.soundwobbleflag=true;
 }
 
 void soundwobbleoff(void)
 {
-  soundwobbleflag=false;
-  soundwobblen=0;
+  struct sound_state *st=&dgctx->sound;
+  st->soundwobbleflag=false;
+  st->soundwobblen=0;
 }
 
 static void soundwobbleupdate(void)
 {
-  if (soundwobbleflag) {
-    soundwobblen++;
-    if (soundwobblen>63)
-      soundwobblen=0;
-    switch (soundwobblen) {
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundwobbleflag) {
+    st->soundwobblen++;
+    if (st->soundwobblen>63)
+      st->soundwobblen=0;
+    switch (st->soundwobblen) {
       case 0:
-        t2val=0x7d0;
+        st->t2val=0x7d0;
         break;
       case 16:
       case 48:
-        t2val=0x9c4;
+        st->t2val=0x9c4;
         break;
       case 32:
-        t2val=0xbb8;
+        st->t2val=0xbb8;
         break;
     }
   }
 }
 
-
-static bool soundfireflag[FIREBALLS]={false,false},sff[FIREBALLS];
-static int16_t soundfirevalue[FIREBALLS],soundfiren[FIREBALLS]={0,0};
-static int soundfirew=0;
-
 void soundfire(int n)
 {
-  soundfirevalue[n]=500;
-  soundfireflag[n]=true;
+  struct sound_state *st=&dgctx->sound;
+  st->soundfirevalue[n]=500;
+  st->soundfireflag[n]=true;
 }
 
 void soundfireoff(int n)
 {
-  soundfireflag[n]=false;
-  soundfiren[n]=0;
+  struct sound_state *st=&dgctx->sound;
+  st->soundfireflag[n]=false;
+  st->soundfiren[n]=0;
 }
 
 static void soundfireupdate(void)
 {
+  struct sound_state *st=&dgctx->sound;
   int n;
   bool f=false;
   for (n=0;n<FIREBALLS;n++) {
-    sff[n]=false;
-    if (soundfireflag[n]) {
-      if (soundfiren[n]==1) {
-        soundfiren[n]=0;
-        soundfirevalue[n]+=soundfirevalue[n]/55;
-        sff[n]=true;
+    st->sff[n]=false;
+    if (st->soundfireflag[n]) {
+      if (st->soundfiren[n]==1) {
+        st->soundfiren[n]=0;
+        st->soundfirevalue[n]+=st->soundfirevalue[n]/55;
+        st->sff[n]=true;
         f=true;
-        if (soundfirevalue[n]>30000)
+        if (st->soundfirevalue[n]>30000)
           soundfireoff(n);
       }
       else
-        soundfiren[n]++;
+        st->soundfiren[n]++;
     }
   }
   if (f) {
     do {
-      n=soundfirew++;
-      if (soundfirew==FIREBALLS)
-        soundfirew=0;
-    } while (!sff[n]);
-    t2val=soundfirevalue[n]+randnos(soundfirevalue[n]>>3);
+      n=st->soundfirew++;
+      if (st->soundfirew==FIREBALLS)
+        st->soundfirew=0;
+    } while (!st->sff[n]);
+    st->t2val=st->soundfirevalue[n]+randnos(st->soundfirevalue[n]>>3);
   }
 }
 
-
-static bool soundexplodeflag[FIREBALLS]={false,false},sef[FIREBALLS];
-static int16_t soundexplodevalue[FIREBALLS],soundexplodeduration[FIREBALLS];
-static int soundexplodew=0;
-
 void soundexplode(int n)
 {
-  soundexplodevalue[n]=1500;
-  soundexplodeduration[n]=10;
-  soundexplodeflag[n]=true;
+  struct sound_state *st=&dgctx->sound;
+  st->soundexplodevalue[n]=1500;
+  st->soundexplodeduration[n]=10;
+  st->soundexplodeflag[n]=true;
   soundfireoff(n);
 }
 
 static void soundexplodeoff(int n)
 {
-  soundexplodeflag[n]=false;
+  dgctx->sound.soundexplodeflag[n]=false;
 }
 
 static void soundexplodeupdate(void)
 {
+  struct sound_state *st=&dgctx->sound;
   int n;
   bool f=false;
   for (n=0;n<FIREBALLS;n++) {
-    sef[n]=false;
-    if (soundexplodeflag[n]) {
-      if (soundexplodeduration[n]!=0) {
-        soundexplodevalue[n]=soundexplodevalue[n]-(soundexplodevalue[n]>>3);
-        soundexplodeduration[n]--;
-        sef[n]=true;
+    st->sef[n]=false;
+    if (st->soundexplodeflag[n]) {
+      if (st->soundexplodeduration[n]!=0) {
+        st->soundexplodevalue[n]=st->soundexplodevalue[n]-(st->soundexplodevalue[n]>>3);
+        st->soundexplodeduration[n]--;
+        st->sef[n]=true;
         f=true;
       }
       else
-        soundexplodeflag[n]=false;
+        st->soundexplodeflag[n]=false;
     }
   }
   if (f) {
     do {
-      n=soundexplodew++;
-      if (soundexplodew==FIREBALLS)
-        soundexplodew=0;
-    } while (!sef[n]);
-    t2val=soundexplodevalue[n];
+      n=st->soundexplodew++;
+      if (st->soundexplodew==FIREBALLS)
+        st->soundexplodew=0;
+    } while (!st->sef[n]);
+    st->t2val=st->soundexplodevalue[n];
   }
 }
 
-
-static bool soundbonusflag=false;
-static int16_t soundbonusn=0;
-
 void soundbonus(void)
 {
-  soundbonusflag=true;
+  dgctx->sound.soundbonusflag=true;
 }
 
 void soundbonusoff(void)
 {
-  soundbonusflag=false;
-  soundbonusn=0;
+  struct sound_state *st=&dgctx->sound;
+  st->soundbonusflag=false;
+  st->soundbonusn=0;
 }
 
 static void soundbonusupdate(void)
 {
-  if (soundbonusflag) {
-    soundbonusn++;
-    if (soundbonusn>15)
-      soundbonusn=0;
-    if (soundbonusn>=0 && soundbonusn<6)
-      t2val=0x4ce;
-    if (soundbonusn>=8 && soundbonusn<14)
-      t2val=0x5e9;
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundbonusflag) {
+    st->soundbonusn++;
+    if (st->soundbonusn>15)
+      st->soundbonusn=0;
+    if (st->soundbonusn>=0 && st->soundbonusn<6)
+      st->t2val=0x4ce;
+    if (st->soundbonusn>=8 && st->soundbonusn<14)
+      st->t2val=0x5e9;
   }
 }
 
-
-static bool soundemflag=false;
-
 void soundem(void)
 {
-  soundemflag=true;
+  dgctx->sound.soundemflag=true;
 }
 
 static void soundemoff(void)
 {
-  soundemflag=false;
+  dgctx->sound.soundemflag=false;
 }
 
 static void soundemupdate(void)
 {
-  if (soundemflag) {
-    t2val=1000;
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundemflag) {
+    st->t2val=1000;
     soundemoff();
   }
 }
 
-
-static bool soundemeraldflag=false;
-static int16_t soundemeraldduration,emerfreq,soundemeraldn;
-
 static const int16_t emfreqs[8]={0x8e8,0x7f0,0x712,0x6ac,0x5f2,0x54c,0x4b8,0x474};
 
 void soundemerald(int n)
 {
-  emerfreq=emfreqs[n];
-  soundemeraldduration=7;
-  soundemeraldn=0;
-  soundemeraldflag=true;
+  struct sound_state *st=&dgctx->sound;
+  st->emerfreq=emfreqs[n];
+  st->soundemeraldduration=7;
+  st->soundemeraldn=0;
+  st->soundemeraldflag=true;
 }
 
 static void soundemeraldoff(void)
 {
-  soundemeraldflag=false;
+  dgctx->sound.soundemeraldflag=false;
 }
 
 static void soundemeraldupdate(void)
 {
-  if (soundemeraldflag) {
-    if (soundemeraldduration!=0) {
-      if (soundemeraldn==0 || soundemeraldn==1)
-        t2val=emerfreq;
-      soundemeraldn++;
-      if (soundemeraldn>7) {
-        soundemeraldn=0;
-        soundemeraldduration--;
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundemeraldflag) {
+    if (st->soundemeraldduration!=0) {
+      if (st->soundemeraldn==0 || st->soundemeraldn==1)
+        st->t2val=st->emerfreq;
+      st->soundemeraldn++;
+      if (st->soundemeraldn>7) {
+        st->soundemeraldn=0;
+        st->soundemeraldduration--;
       }
     }
     else
@@ -468,197 +458,182 @@ static void soundemeraldupdate(void)
   }
 }
 
-
-static bool soundgoldflag=false,soundgoldf=false;
-static int16_t soundgoldvalue1,soundgoldvalue2,soundgoldduration;
-
 void soundgold(void)
 {
-  soundgoldvalue1=500;
-  soundgoldvalue2=4000;
-  soundgoldduration=30;
-  soundgoldf=false;
-  soundgoldflag=true;
+  struct sound_state *st=&dgctx->sound;
+  st->soundgoldvalue1=500;
+  st->soundgoldvalue2=4000;
+  st->soundgoldduration=30;
+  st->soundgoldf=false;
+  st->soundgoldflag=true;
 }
 
 static void soundgoldoff(void)
 {
-  soundgoldflag=false;
+  dgctx->sound.soundgoldflag=false;
 }
 
 static void soundgoldupdate(void)
 {
-  if (soundgoldflag) {
-    if (soundgoldduration!=0)
-      soundgoldduration--;
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundgoldflag) {
+    if (st->soundgoldduration!=0)
+      st->soundgoldduration--;
     else
-      soundgoldflag=false;
-    if (soundgoldf) {
-      soundgoldf=false;
-      t2val=soundgoldvalue1;
+      st->soundgoldflag=false;
+    if (st->soundgoldf) {
+      st->soundgoldf=false;
+      st->t2val=st->soundgoldvalue1;
     }
     else {
-      soundgoldf=true;
-      t2val=soundgoldvalue2;
+      st->soundgoldf=true;
+      st->t2val=st->soundgoldvalue2;
     }
-    soundgoldvalue1+=(soundgoldvalue1>>4);
-    soundgoldvalue2-=(soundgoldvalue2>>4);
+    st->soundgoldvalue1+=(st->soundgoldvalue1>>4);
+    st->soundgoldvalue2-=(st->soundgoldvalue2>>4);
   }
 }
 
-
-
-static bool soundeatmflag=false;
-static int16_t soundeatmvalue,soundeatmduration,soundeatmn;
-
 void soundeatm(void)
 {
-  soundeatmduration=20;
-  soundeatmn=3;
-  soundeatmvalue=2000;
-  soundeatmflag=true;
+  struct sound_state *st=&dgctx->sound;
+  st->soundeatmduration=20;
+  st->soundeatmn=3;
+  st->soundeatmvalue=2000;
+  st->soundeatmflag=true;
 }
 
 static void soundeatmoff(void)
 {
-  soundeatmflag=false;
+  dgctx->sound.soundeatmflag=false;
 }
 
 static void soundeatmupdate(void)
 {
-  if (soundeatmflag) {
-    if (soundeatmn!=0) {
-      if (soundeatmduration!=0) {
-        if ((soundeatmduration%4)==1)
-          t2val=soundeatmvalue;
-        if ((soundeatmduration%4)==3)
-          t2val=soundeatmvalue-(soundeatmvalue>>4);
-        soundeatmduration--;
-        soundeatmvalue-=(soundeatmvalue>>4);
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundeatmflag) {
+    if (st->soundeatmn!=0) {
+      if (st->soundeatmduration!=0) {
+        if ((st->soundeatmduration%4)==1)
+          st->t2val=st->soundeatmvalue;
+        if ((st->soundeatmduration%4)==3)
+          st->t2val=st->soundeatmvalue-(st->soundeatmvalue>>4);
+        st->soundeatmduration--;
+        st->soundeatmvalue-=(st->soundeatmvalue>>4);
       }
       else {
-        soundeatmduration=20;
-        soundeatmn--;
-        soundeatmvalue=2000;
+        st->soundeatmduration=20;
+        st->soundeatmn--;
+        st->soundeatmvalue=2000;
       }
     }
     else
-      soundeatmflag=false;
+      st->soundeatmflag=false;
   }
 }
 
-
-static bool soundddieflag=false;
-static int16_t soundddien,soundddievalue;
-
 void soundddie(void)
 {
-  soundddien=0;
-  soundddievalue=20000;
-  soundddieflag=true;
+  struct sound_state *st=&dgctx->sound;
+  st->soundddien=0;
+  st->soundddievalue=20000;
+  st->soundddieflag=true;
 }
 
 static void soundddieoff(void)
 {
-  soundddieflag=false;
+  dgctx->sound.soundddieflag=false;
 }
 
 static void soundddieupdate(void)
 {
-  if (soundddieflag) {
-    soundddien++;
-    if (soundddien==1)
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundddieflag) {
+    st->soundddien++;
+    if (st->soundddien==1)
       musicoff();
-    if (soundddien>=1 && soundddien<=10)
-      soundddievalue=20000-soundddien*1000;
-    if (soundddien>10)
-      soundddievalue+=500;
-    if (soundddievalue>30000)
+    if (st->soundddien>=1 && st->soundddien<=10)
+      st->soundddievalue=20000-st->soundddien*1000;
+    if (st->soundddien>10)
+      st->soundddievalue+=500;
+    if (st->soundddievalue>30000)
       soundddieoff();
-    t2val=soundddievalue;
+    st->t2val=st->soundddievalue;
   }
 }
 
-
-static bool sound1upflag=false;
-static int16_t sound1upduration=0;
-
 void sound1up(void)
 {
-  sound1upduration=96;
-  sound1upflag=true;
+  struct sound_state *st=&dgctx->sound;
+  st->sound1upduration=96;
+  st->sound1upflag=true;
 }
 
 static void sound1upoff(void)
 {
-  sound1upflag=false;
+  dgctx->sound.sound1upflag=false;
 }
 
 static void sound1upupdate(void)
 {
-  if (sound1upflag) {
-    if ((sound1upduration/3)%2!=0)
-      t2val=(sound1upduration<<2)+600;
-    sound1upduration--;
-    if (sound1upduration<1)
-      sound1upflag=false;
+  struct sound_state *st=&dgctx->sound;
+  if (st->sound1upflag) {
+    if ((st->sound1upduration/3)%2!=0)
+      st->t2val=(st->sound1upduration<<2)+600;
+    st->sound1upduration--;
+    if (st->sound1upduration<1)
+      st->sound1upflag=false;
   }
 }
 
-
-static bool musicplaying=false;
-static int16_t musicp=0,tuneno=0,noteduration=0,notevalue=0,musicmaxvol=0,
-      musicattackrate=0,musicsustainlevel=0,musicdecayrate=0,musicnotewidth=0,
-      musicreleaserate=0,musicstage=0,musicn=0,musicdfac=0;
-
-bool sounddiedone = true;
-
 void music(int16_t tune, double dfac)
 {
-  tuneno=tune;
-  musicp=0;
-  noteduration=0;
+  struct sound_state *st=&dgctx->sound;
+  st->tuneno=tune;
+  st->musicp=0;
+  st->noteduration=0;
 
-  if (!sndflag)
+  if (!st->sndflag)
     return;
   switch (tune) {
     case 0:
-      musicmaxvol=50;
-      musicattackrate=20;
-      musicsustainlevel=20;
-      musicdecayrate=10;
-      musicreleaserate=4;
-      musicdfac = 3.0 * dfac;
+      st->musicmaxvol=50;
+      st->musicattackrate=20;
+      st->musicsustainlevel=20;
+      st->musicdecayrate=10;
+      st->musicreleaserate=4;
+      st->musicdfac = 3.0 * dfac;
       break;
     case 1:
-      musicmaxvol=50;
-      musicattackrate=50;
-      musicsustainlevel=8;
-      musicdecayrate=15;
-      musicreleaserate=1;
-      musicdfac = 6.0 * dfac;
+      st->musicmaxvol=50;
+      st->musicattackrate=50;
+      st->musicsustainlevel=8;
+      st->musicdecayrate=15;
+      st->musicreleaserate=1;
+      st->musicdfac = 6.0 * dfac;
       break;
     case 2:
-      musicmaxvol=50;
-      musicattackrate=50;
-      musicsustainlevel=25;
-      musicdecayrate=5;
-      musicreleaserate=1;
-      musicdfac = 10.0 * dfac;
+      st->musicmaxvol=50;
+      st->musicattackrate=50;
+      st->musicsustainlevel=25;
+      st->musicdecayrate=5;
+      st->musicreleaserate=1;
+      st->musicdfac = 10.0 * dfac;
   }
-  musicplaying=true;
+  st->musicplaying=true;
   if (tune==2) {
     soundddieoff();
     if (!wave_device_available)
       return;
-    sounddiedone = false;
+    st->sounddiedone = false;
   }
 }
 
 void musicoff(void)
 {
-  musicplaying=false;
-  musicp=0;
+  struct sound_state *st=&dgctx->sound;
+  st->musicplaying=false;
+  st->musicp=0;
 }
 
 static const int16_t bonusjingle[321]={
@@ -713,140 +688,142 @@ static const int16_t dirge[]={
 
 static void musicupdate(void)
 {
-  if (!musicplaying)
+  struct sound_state *st=&dgctx->sound;
+  if (!st->musicplaying)
     return;
-  if (noteduration!=0)
-    noteduration--;
+  if (st->noteduration!=0)
+    st->noteduration--;
   else {
-    musicstage=musicn=0;
-    switch (tuneno) {
+    st->musicstage=st->musicn=0;
+    switch (st->tuneno) {
       case 0:
-        noteduration=bonusjingle[musicp+1]*musicdfac;
-        musicnotewidth=noteduration-musicdfac;
-        notevalue=bonusjingle[musicp];
-        musicp+=2;
-        if (bonusjingle[musicp]==0x7d64)
-          musicp=0;
+        st->noteduration=bonusjingle[st->musicp+1]*st->musicdfac;
+        st->musicnotewidth=st->noteduration-st->musicdfac;
+        st->notevalue=bonusjingle[st->musicp];
+        st->musicp+=2;
+        if (bonusjingle[st->musicp]==0x7d64)
+          st->musicp=0;
         break;
       case 1:
-        noteduration=backgjingle[musicp+1]*musicdfac;
-        musicnotewidth=musicdfac * 2;
-        notevalue=backgjingle[musicp];
-        musicp+=2;
-        if (backgjingle[musicp]==0x7d64)
-          musicp=0;
+        st->noteduration=backgjingle[st->musicp+1]*st->musicdfac;
+        st->musicnotewidth=st->musicdfac * 2;
+        st->notevalue=backgjingle[st->musicp];
+        st->musicp+=2;
+        if (backgjingle[st->musicp]==0x7d64)
+          st->musicp=0;
         break;
       case 2:
-        noteduration=dirge[musicp+1]*musicdfac;
-        musicnotewidth=noteduration-musicdfac;
-        notevalue=dirge[musicp];
-	if (musicp > 0 && notevalue==0x7d00)
-	  sounddiedone = true;
-        musicp+=2;
-        if (dirge[musicp]==0x7d64)
-          musicp=0;
+        st->noteduration=dirge[st->musicp+1]*st->musicdfac;
+        st->musicnotewidth=st->noteduration-st->musicdfac;
+        st->notevalue=dirge[st->musicp];
+	if (st->musicp > 0 && st->notevalue==0x7d00)
+	  st->sounddiedone = true;
+        st->musicp+=2;
+        if (dirge[st->musicp]==0x7d64)
+          st->musicp=0;
         break;
     }
   }
-  musicn++;
-  wavetype=1;
-  t0val=notevalue;
-  if (musicn>=musicnotewidth)
-    musicstage=2;
-  switch(musicstage) {
+  st->musicn++;
+  st->wavetype=1;
+  st->t0val=st->notevalue;
+  if (st->musicn>=st->musicnotewidth)
+    st->musicstage=2;
+  switch(st->musicstage) {
     case 0:
-      if (musvol+musicattackrate>=musicmaxvol) {
-        musicstage=1;
-        musvol=musicmaxvol;
+      if (st->musvol+st->musicattackrate>=st->musicmaxvol) {
+        st->musicstage=1;
+        st->musvol=st->musicmaxvol;
         break;
       }
-      musvol+=musicattackrate;
+      st->musvol+=st->musicattackrate;
       break;
     case 1:
-      if (musvol-musicdecayrate<=musicsustainlevel) {
-        musvol=musicsustainlevel;
+      if (st->musvol-st->musicdecayrate<=st->musicsustainlevel) {
+        st->musvol=st->musicsustainlevel;
         break;
       }
-      musvol-=musicdecayrate;
+      st->musvol-=st->musicdecayrate;
       break;
     case 2:
-      if (musvol-musicreleaserate<=1) {
-        musvol=1;
+      if (st->musvol-st->musicreleaserate<=1) {
+        st->musvol=1;
         break;
       }
-      musvol-=musicreleaserate;
+      st->musvol-=st->musicreleaserate;
   }
-  if (musvol==1)
-    t0val=0x7d00;
+  if (st->musvol==1)
+    st->t0val=0x7d00;
 }
 
-
 void soundpause(void)
 {
-  soundpausedflag=true;
+  dgctx->sound.soundpausedflag=true;
   pausesounddevice(true);
 }
 
 void soundpauseoff(void)
 {
-  soundpausedflag=false;
+  dgctx->sound.soundpausedflag=false;
   pausesounddevice(false);
 }
 
 static void sett0(bool mode)
 {
-  if (sndflag) {
+  struct sound_state *st=&dgctx->sound;
+  if (st->sndflag) {
     if (!mode)
-      timer2(t2val, mode);
-    if (t0val<1000 && (wavetype==1 || wavetype==2))
-      t0val=1000;
-    if (musvol<1)
-      musvol=1;
-    if (musvol>50)
-      musvol=50;
-    pulsewidth=musvol*volume;
-    timer0(t0val);
+      timer2(st->t2val, mode);
+    if (st->t0val<1000 && (st->wavetype==1 || st->wavetype==2))
+      st->t0val=1000;
+    if (st->musvol<1)
+      st->musvol=1;
+    if (st->musvol>50)
+      st->musvol=50;
+    st->pulsewidth=st->musvol*st->volume;
+    timer0(st->t0val);
     setsoundmode();
   }
 }
 
-static bool soundt0flag=false;
-
 void setsoundt2(void)
 {
-  if (soundt0flag) {
-    spkrmode=0;
-    soundt0flag=false;
+  struct sound_state *st=&dgctx->sound;
+  if (st->soundt0flag) {
+    st->spkrmode=0;
+    st->soundt0flag=false;
     setspkrt2();
   }
 }
 
 void setsoundmode(void)
 {
-  spkrmode=wavetype;
-  if (!soundt0flag && sndflag) {
-    soundt0flag=true;
+  struct sound_state *st=&dgctx->sound;
+  st->spkrmode=st->wavetype;
+  if (!st->soundt0flag && st->sndflag) {
+    st->soundt0flag=true;
     setspkrt2();
   }
 }
 
 void initsound(void)
 {
+  struct sound_state *st=&dgctx->sound;
   timer2(40, false);
   setspkrt2();
   timer0(0);
-  wavetype=2;
-  t0val=12000;
-  musvol=8;
-  t2val=40;
-  soundt0flag=true;
-  sndflag=true;
-  spkrmode=0;
+  st->wavetype=2;
+  st->t0val=12000;
+  st->musvol=8;
+  st->t2val=40;
+  st->soundt0flag=true;
+  st->sndflag=true;
+  st->spkrmode=0;
   setsoundt2();
   soundstop();
   setupsound();
   timer0(0x4000);
-  randvs=0;
+  st->randvs=0;
 }
 
 static void s0killsound(void)
@@ -5,7 +5,8 @@ void initsound(void);
 void soundstop(void);
 void music(int16_t tune, double dfac);
 void musicoff(void);
-void soundlevdone(void);
+bool soundlevdone(void);
+bool soundlevdonetick(void);
 void sound1up(void);
 void soundpause(void);
 void soundpauseoff(void);
@@ -33,9 +34,6 @@ void soundoff(void);
 void timer2(uint16_t t2v);
 */
 
-extern bool soundflag,musicflag;
-extern int16_t volume,timerrate,spkrmode,pulsewidth;
-extern bool sounddiedone;
 
 extern void (*setupsound)(void);
 extern void (*killsound)(void);
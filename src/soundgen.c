@@ -24,6 +24,7 @@
  * SUCH DAMAGE.
  */
 
+#include <assert.h>
 #include <math.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -35,27 +36,30 @@
 #include "soundgen.h"
 #include "spinlock.h"
 
-struct pdres {
-    uint64_t ires;
-    uint64_t nres;
-    uint64_t irem;
-    double frem;
-};
+#if defined(_RP2350)
+#include "pico/platform.h"
+/* Called from the audio IRQ on core 1, which must never run from flash */
+#define SGEN_RAMFUNC(f) __not_in_flash_func(f)
+#else
+#define SGEN_RAMFUNC(f) f
+#endif
+
+/*
+ * Each band is a square wave kept as a 32-bit phase accumulator: 2^32 is
+ * one period, and every sample adds freq / srate of it. The first half of
+ * the period gives lut[0], the second half lut[1]. So a sample costs an
+ * add and a shift per band, with no divides and no floating point; only
+ * setting a band works out its step in double precision.
+ */
 
 enum band_types {BND_GEN, BND_MOD};
 
 struct sgen_band {
     enum band_types b_type;
-    double freq;
-    double amp;
-    double phase;
-    struct {
-        double prd;
-        uint64_t lastspos;
-        int16_t lut[2];
-        double phi_off;
-	int disabled;
-    } wrk;
+    uint32_t acc;
+    uint32_t inc;
+    int16_t lut[2];
+    int disabled;
     int muted;
 };
 
@@ -63,16 +67,53 @@ struct sgen_state {
     uint64_t step;
     uint32_t srate;
     int nbands;
-    struct {
-        uint64_t lastipos;
-        uint64_t lastnpos;
-    } wrk;
     struct spinlock *lock;
     struct sgen_band bands[];
 };
 
-static void precisediv(uint64_t x, uint64_t y, struct pdres *pdrp);
-static void precisedivf(const struct pdres *xp, double y, struct pdres *pdrp);
+#define PHASE_ONE 4294967296.0  /* 1.0 as a phase */
+
+/* What the bands give now, with the lock held */
+static inline int16_t
+sgen_level(const struct sgen_state *ssp)
+{
+    int32_t osample;
+    int32_t omod;
+    int i, j;
+
+    osample = 0;
+    omod = INT16_MAX;
+    for (i = 0; i < ssp->nbands; i++) {
+        const struct sgen_band *sbp;
+
+        sbp = &ssp->bands[i];
+        if (sbp->disabled || sbp->muted)
+            continue;
+        j = sbp->acc >> 31;
+        if (sbp->b_type == BND_GEN) {
+            osample += sbp->lut[j];
+        } else {
+            omod *= sbp->lut[j];
+            omod /= INT16_MAX;
+        }
+    }
+    osample /= ssp->nbands;
+    if (omod != INT16_MAX) {
+        osample = (osample * omod) / INT16_MAX;
+    }
+    return (osample);
+}
+
+/* Move every band and the sample clock on by n samples */
+static inline void
+sgen_step(struct sgen_state *ssp, uint64_t n)
+{
+    int i;
+
+    ssp->step += n;
+    for (i = 0; i < ssp->nbands; i++)
+        ssp->bands[i].acc += ssp->bands[i].inc * (uint32_t)n;
+}
 
 struct sgen_state *
 sgen_ctor(uint32_t srate, int nbands)
@@ -94,7 +135,7 @@ sgen_ctor(uint32_t srate, int nbands)
     ssp->srate = srate;
     ssp->nbands = nbands;
     for (i = 0; i < nbands; i++) {
-        ssp->bands[i].wrk.disabled = 1;
+        ssp->bands[i].disabled = 1;
     }
     return (ssp);
 }
@@ -118,7 +159,61 @@ sgen_getstep(struct sgen_state *ssp)
     return (rval);
 }
 
-#include <assert.h>
+/*
+ * Move the sample clock forward without producing any output, as if
+ * nsteps samples had been generated and thrown away.
+ */
+void
+sgen_advance(struct sgen_state *ssp, uint64_t nsteps)
+{
+    spinlock_lock(ssp->lock);
+    sgen_step(ssp, nsteps);
+    spinlock_unlock(ssp->lock);
+}
+
+/*
+ * Copy the generator state (sample clock and bands) out to buf, or in
+ * from it, for savestates. sgen_getstate() with a NULL buf just returns
+ * the number of bytes needed.
+ */
+size_t
+sgen_getstate(struct sgen_state *ssp, void *buf)
+{
+    size_t bsize;
+    uint8_t *p;
+
+    bsize = ssp->nbands * sizeof(ssp->bands[0]);
+    if (buf == NULL)
+        return (sizeof(ssp->step) + bsize);
+    p = buf;
+    spinlock_lock(ssp->lock);
+    memcpy(p, &ssp->step, sizeof(ssp->step));
+    p += sizeof(ssp->step);
+    memcpy(p, ssp->bands, bsize);
+    spinlock_unlock(ssp->lock);
+    return (sizeof(ssp->step) + bsize);
+}
+
+void
+sgen_setstate(struct sgen_state *ssp, const void *buf)
+{
+    const uint8_t *p;
+
+    p = buf;
+    spinlock_lock(ssp->lock);
+    memcpy(&ssp->step, p, sizeof(ssp->step));
+    p += sizeof(ssp->step);
+    memcpy(ssp->bands, p, ssp->nbands * sizeof(ssp->bands[0]));
+    spinlock_unlock(ssp->lock);
+}
+
+/* The phase step of freq Hz, rounded to the nearest 2^-32 of a period */
+static uint32_t
+sgen_freqinc(const struct sgen_state *ssp, double freq)
+{
+
+    return ((uint32_t)(uint64_t)llround(freq * PHASE_ONE / ssp->srate));
+}
 
 void
 sgen_setband(struct sgen_state *ssp, int band, double freq, double amp)
@@ -127,81 +222,43 @@ sgen_setband(struct sgen_state *ssp, int band, double freq, double amp)
 
     spinlock_lock(ssp->lock);
     sbp = &ssp->bands[band];
-
-#if 0
-    if (band == 0 && (freq != sbp->freq || amp != sbp->amp)) {
-	printf("if (sgen_getstep(ssp) == %d) {sgen_setband(ssp, 0, %f, %f)}\n", (int)ssp->step, freq, amp);
-    }
-#endif
-
     sbp->b_type = BND_GEN;
-    sbp->freq = freq;
-    sbp->amp = amp;
     assert(signbit(freq) == 0);
     if (freq > 0.0 && amp > 0.0) {
-        sbp->wrk.prd = 1.0 / freq;
-        sbp->wrk.lut[0] = amp * INT16_MAX;
-        sbp->wrk.lut[1] = -amp * INT16_MAX;
-	sbp->wrk.disabled = 0;
+        sbp->inc = sgen_freqinc(ssp, freq);
+        sbp->lut[0] = amp * INT16_MAX;
+        sbp->lut[1] = -amp * INT16_MAX;
+        sbp->disabled = 0;
     } else {
-        sbp->wrk.disabled = 1;
+        sbp->disabled = 1;
     }
     spinlock_unlock(ssp->lock);
 }
 
-static void
-sgen_addphase(struct sgen_state *ssp, int band, double phase)
+/*
+ * A band keeps its phase across sgen_setband(), so setting back the phase
+ * read before it (as s1timer0() and s1timer2() do) only takes away the
+ * rounding of the double.
+ */
+void
+sgen_setphase(struct sgen_state *ssp, int band, double phase)
 {
-    struct sgen_band *sbp;
 
     spinlock_lock(ssp->lock);
     assert(signbit(phase) == 0);
-    assert(phase < 1.0);
-    sbp = &ssp->bands[band];
-    sbp->phase = fmod(sbp->phase + phase, 1.0);
-    sbp->wrk.phi_off = sbp->phase / sbp->freq;
+    ssp->bands[band].acc = (uint32_t)(uint64_t)(fmod(phase, 1.0) * PHASE_ONE);
     spinlock_unlock(ssp->lock);
 }
 
-void
-sgen_setphase(struct sgen_state *ssp, int band, double phase)
-{
-    double r1;
-    double perr;
-
-    r1 = sgen_getphase(ssp, band);
-    if (r1 == phase)
-        return;
-    if (r1 < phase) {
-        sgen_addphase(ssp, band, phase - r1);
-    } else {
-        sgen_addphase(ssp, band, 1.0 - r1 + phase);
-    }
-    perr = sgen_getphase(ssp, band) - phase;
-    assert(fabs(perr) < 1e-15 || fabs(1.0 - perr) < 1e-15);
-}
-
 double
 sgen_getphase(struct sgen_state *ssp, int band)
 {
-    struct pdres pos;
-    struct pdres cpos;
     struct sgen_band *sbp;
     double rval;
 
     spinlock_lock(ssp->lock);
     sbp = &ssp->bands[band];
-    if (sbp->wrk.disabled) {
-        rval = 0.0;
-        goto done;
-    }
-    precisediv(ssp->step - ssp->wrk.lastnpos, ssp->srate, &pos);
-    pos.ires += ssp->wrk.lastipos;
-    pos.ires -= sbp->wrk.lastspos;
-
-    precisedivf(&pos, sbp->wrk.prd, &cpos);
-    rval = fmod(sbp->phase + (cpos.frem * sbp->freq), 1.0);
-done:
+    rval = sbp->disabled ? 0.0 : sbp->acc / PHASE_ONE;
     spinlock_unlock(ssp->lock);
     return (rval);
 }
@@ -214,16 +271,14 @@ sgen_setband_mod(struct sgen_state *ssp, int band, double freq, double a0, doubl
     spinlock_lock(ssp->lock);
     sbp = &ssp->bands[band];
     sbp->b_type = BND_MOD;
-    sbp->freq = freq;
-    sbp->amp = a1 - a0;
     assert(signbit(freq) == 0);
     if (freq > 0.0) {
-        sbp->wrk.prd = 1.0 / freq;
-        sbp->wrk.lut[0] = a0 * INT16_MAX;
-        sbp->wrk.lut[1] = a1 * INT16_MAX;
-        sbp->wrk.disabled = 0;
+        sbp->inc = sgen_freqinc(ssp, freq);
+        sbp->lut[0] = a0 * INT16_MAX;
+        sbp->lut[1] = a1 * INT16_MAX;
+        sbp->disabled = 0;
     } else {
-        sbp->wrk.disabled = 1;
+        sbp->disabled = 1;
     }
     spinlock_unlock(ssp->lock);
 }
@@ -242,87 +297,181 @@ sgen_setmuteband(struct sgen_state *ssp, int band, int muted)
     return (rval);
 }
 
-static void
-precisediv(uint64_t x, uint64_t y, struct pdres *pdrp)
+int16_t
+sgen_getsample(struct sgen_state *ssp)
 {
+    int16_t rval;
 
-    pdrp->ires = x / y;
-    pdrp->nres = pdrp->ires * y;
-    pdrp->irem = x - pdrp->nres;
-    pdrp->frem = (double)(pdrp->irem) / y;
+    spinlock_lock(ssp->lock);
+    rval = sgen_level(ssp);
+    sgen_step(ssp, 1);
+    spinlock_unlock(ssp->lock);
+    return (rval);
 }
 
+/* The bands as a voice, with the lock held */
 static void
-precisedivf(const struct pdres *xp, double y, struct pdres *pdrp)
+sgen_tovoice(const struct sgen_state *ssp, struct sgen_voice *svp)
 {
-    double res, nres;
+    const struct sgen_band *sbp;
+    int i;
 
-    pdrp->ires = trunc(xp->ires / y);
-    nres = pdrp->ires * y;
-    pdrp->nres = trunc(nres);
-    res = xp->ires - nres;
-    pdrp->frem = fmod(res + xp->frem, y);
+    assert(ssp->nbands <= SGEN_VOICE_BANDS);
+    svp->nbands = ssp->nbands;
+    for (i = 0; i < ssp->nbands; i++) {
+        sbp = &ssp->bands[i];
+        svp->bands[i].inc = sbp->inc;
+        svp->bands[i].lut[0] = sbp->lut[0];
+        svp->bands[i].lut[1] = sbp->lut[1];
+        svp->bands[i].heard = !sbp->disabled && !sbp->muted;
+        svp->bands[i].mod = sbp->b_type != BND_GEN;
+    }
 }
 
-int16_t
-sgen_getsample(struct sgen_state *ssp)
+void
+sgen_getvoice(struct sgen_state *ssp, struct sgen_voice *svp)
 {
-    int32_t osample;
-    int32_t omod;
-    int i, j;
-    struct pdres pos;
 
     spinlock_lock(ssp->lock);
-    osample = 0;
-    omod = INT16_MAX;
-    precisediv(ssp->step - ssp->wrk.lastnpos, ssp->srate, &pos);
-    ssp->wrk.lastnpos += pos.nres;
-    pos.ires += ssp->wrk.lastipos;
-    for (i = 0; i < ssp->nbands; i++) {
-        struct sgen_band *sbp;
-        struct pdres cpos, tpos;
-
-        sbp = &ssp->bands[i];
-        if (sbp->wrk.disabled || sbp->muted)
-            continue;
-        tpos = pos;
-        tpos.ires -= sbp->wrk.lastspos;
+    sgen_tovoice(ssp, svp);
+    spinlock_unlock(ssp->lock);
+}
 
-        if (sbp->wrk.phi_off != 0.0) {
-            tpos.frem += sbp->wrk.phi_off;
+/*
+ * The output only changes at the edges of the bands that are heard, so it
+ * is made a run of equal samples at a time: the level, then how many
+ * samples are left before the first edge. A band that moves by half a
+ * period or more on every sample may change on the next one.
+ */
+void
+SGEN_RAMFUNC(sgen_voice_fill)(const struct sgen_voice *svp, uint32_t *acc,
+                              int16_t *buf, size_t n, int nchan)
+{
+    const struct sgen_vband *vbp;
+    int32_t osample;
+    int32_t omod;
+    uint32_t left, br;
+    size_t r, i;
+    int16_t s;
+    int b;
+
+    while (n > 0) {
+        r = n;
+        osample = 0;
+        omod = INT16_MAX;
+        for (b = 0; b < svp->nbands; b++) {
+            vbp = &svp->bands[b];
+            if (!vbp->heard)
+                continue;
+            if (vbp->mod) {
+                omod *= vbp->lut[acc[b] >> 31];
+                omod /= INT16_MAX;
+            } else {
+                osample += vbp->lut[acc[b] >> 31];
+            }
+            if (vbp->inc == 0 || r == 1)
+                continue;
+            if (vbp->inc >= 0x80000000u) {
+                r = 1;
+                continue;
+            }
+            left = 0x80000000u - (acc[b] & 0x7fffffffu);
+            br = (left - 1) / vbp->inc + 1;
+            if (br < r)
+                r = br;
+        }
+        osample /= svp->nbands;
+        if (omod != INT16_MAX) {
+            osample = (osample * omod) / INT16_MAX;
         }
+        s = osample;
+        for (b = 0; b < svp->nbands; b++)
+            acc[b] += svp->bands[b].inc * (uint32_t)r;
+        n -= r;
+        if (nchan == 2) {
+            for (i = 0; i < r; i++, buf += 2) {
+                buf[0] = s;
+                buf[1] = s;
+            }
+        } else {
+            for (r *= nchan; r > 0; r--)
+                *buf++ = s;
+        }
+    }
+}
 
-        precisedivf(&tpos, sbp->wrk.prd, &cpos);
-        if (cpos.nres > 0)
-            sbp->wrk.lastspos += cpos.nres;
+/*
+ * The next n samples, the same as n sgen_getsample() calls but under one
+ * lock, each written nchan times into buf (2 for interleaved stereo).
+ */
+void
+sgen_fill(struct sgen_state *ssp, int16_t *buf, size_t n, int nchan)
+{
+    struct sgen_voice sv;
+    uint32_t acc[SGEN_VOICE_BANDS];
+    int i;
 
-#if 0
-        if (sbp->wrk.phi_off != 0.0) {
-            cpos.frem -= sbp->wrk.phi_off;
-        }
-#endif
+    spinlock_lock(ssp->lock);
+    sgen_tovoice(ssp, &sv);
+    for (i = 0; i < ssp->nbands; i++)
+        acc[i] = ssp->bands[i].acc;
+    sgen_voice_fill(&sv, acc, buf, n, nchan);
+    for (i = 0; i < ssp->nbands; i++)
+        ssp->bands[i].acc = acc[i];
+    ssp->step += n;
+    spinlock_unlock(ssp->lock);
+}
 
-        if ((cpos.frem * 2) < sbp->wrk.prd) {
-	    j = 0;
-	} else {
-	    j = 1;
-	}
-        if (sbp->b_type == BND_GEN) {
-            osample += sbp->wrk.lut[j];
-	} else {
-	    omod *= sbp->wrk.lut[j];
-	    omod /= INT16_MAX;
-	}
-    }
-    osample /= ssp->nbands;
-    if (omod != INT16_MAX) {
-        osample = (osample * omod) / INT16_MAX;
+#if defined(sgen_test) || defined(_HOST)
+/*
+ * Count the samples of a square wave in obuf that are zero, positive and
+ * negative, the level changes, and the shortest and longest positive and
+ * negative runs after the first two changes.
+ */
+void
+sgen_wavestats(const int16_t *obuf, size_t n, struct sgen_wavestats *wsp)
+{
+    struct sgen_wavestats wstats_prev;
+    size_t i;
+
+    memset(wsp, '\0', sizeof(*wsp));
+    memset(&wstats_prev, '\0', sizeof(wstats_prev));
+    for (i = 0; i < n; i++) {
+        if (obuf[i] == 0) {
+            wsp->nzero++;
+        } else if (obuf[i] > 0) {
+            wsp->npos++;
+        } else {
+            wsp->nneg++;
+        }
+        if (i == 0 || obuf[i - 1] != obuf[i]) {
+            if (wsp->ntrans > 2) {
+                if (obuf[i - 1] > obuf[i]) {
+                    /* Falling edge */
+                    unsigned int posdur;
+
+                    posdur = wsp->npos - wstats_prev.npos;
+                    if (posdur > wsp->posdur_max)
+                        wsp->posdur_max = posdur;
+                    if (wsp->posdur_min == 0 || posdur < wsp->posdur_min)
+                       wsp->posdur_min = posdur;
+                } else {
+                    /* Rising edge */
+                    unsigned int negdur;
+
+                    negdur = wsp->nneg - wstats_prev.nneg;
+                    if (negdur > wsp->negdur_max)
+                        wsp->negdur_max = negdur;
+                    if (wsp->negdur_min == 0 || negdur < wsp->negdur_min)
+                        wsp->negdur_min = negdur;
+                }
+            }
+            wstats_prev = *wsp;
+            wsp->ntrans++;
+        }
     }
-    ssp->step += 1;
-    ssp->wrk.lastipos = pos.ires;
-    spinlock_unlock(ssp->lock);
-    return (osample);
 }
+#endif
 
 #if defined(sgen_test)
 
@@ -330,18 +479,12 @@ sgen_getsample(struct sgen_state *ssp)
 #define TEST_SRATE 384000
 #define TEST_DUR   100
 
-struct wavestats {
-   unsigned int npos, nneg, nzero, ntrans;
-   unsigned int posdur_min, posdur_max;
-   unsigned int negdur_min, negdur_max;
-};
-
 int
 sgen_test(void)
 {
     struct sgen_state *ssp;
     unsigned int i, j;
-    struct wavestats wstats, wstats_prev;
+    struct sgen_wavestats wstats;
     double rfreq, rphase;
     FILE *of;
     int16_t *obuf;
@@ -355,10 +498,8 @@ sgen_test(void)
     //sgen_setband_mod(ssp, 1, 3.0, 0.1, 1.0);
     for (j = 0; j < 1; j += 1) {
         ssp->step = ((uint64_t)1 << j) - 1;
-        memset(&wstats, '\0', sizeof(wstats));
-        memset(&wstats_prev, '\0', sizeof(wstats_prev));
         sgen_setband(ssp, 0, 1607.0, 1.0);
-        sgen_addphase(ssp, 0, 0.25);
+        sgen_setphase(ssp, 0, 0.25);
         for (i = 0; i < TEST_SRATE * TEST_DUR; i++) {
 #if 0
             rphase = sgen_getphase(ssp, 0);
@@ -374,39 +515,8 @@ sgen_test(void)
             }
 #endif
             obuf[i] = sgen_getsample(ssp);
-            if (obuf[i] == 0) {
-                wstats.nzero++;
-            } else if (obuf[i] > 0) {
-                wstats.npos++;
-            } else {
-                wstats.nneg++;
-            }
-            if (i == 0 || obuf[i - 1] != obuf[i]) {
-                if (wstats.ntrans > 2) {
-                    if (obuf[i - 1] > obuf[i]) {
-                        /* Falling edge */
-                        unsigned int posdur;
-
-                        posdur = wstats.npos - wstats_prev.npos;
-                        if (posdur > wstats.posdur_max)
-                            wstats.posdur_max = posdur;
-                        if (wstats.posdur_min == 0 || posdur < wstats.posdur_min)
-                           wstats.posdur_min = posdur;
-                    } else {
-                        /* Rising edge */
-                        unsigned int negdur;
-
-                        negdur = wstats.nneg - wstats_prev.nneg;
-                        if (negdur > wstats.negdur_max)
-                            wstats.negdur_max = negdur;
-                        if (wstats.negdur_min == 0 || negdur < wstats.negdur_min)
-                            wstats.negdur_min = negdur;
-                    }
-                }
-                wstats_prev = wstats;
-                wstats.ntrans++;
-            }
         }
+        sgen_wavestats(obuf, TEST_SRATE * TEST_DUR, &wstats);
         if (j == 0) {
             of = fopen("sgen_test.out", "w");
             assert(of != NULL);
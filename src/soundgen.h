@@ -24,14 +24,66 @@
  * SUCH DAMAGE.
  */
 
+#ifndef _SOUNDGEN_H_
+#define _SOUNDGEN_H_
+
 struct sgen_state;
 
+#define SGEN_VOICE_BANDS 2
+
+/*
+ * What the bands are set to, without their phases: a copy that can be
+ * played on somewhere else, from phases kept there.
+ */
+struct sgen_voice {
+    int nbands;
+    struct sgen_vband {
+        uint32_t inc;
+        int16_t lut[2];
+        uint8_t heard, mod;
+    } bands[SGEN_VOICE_BANDS];
+};
+
 struct sgen_state *sgen_ctor(uint32_t srate, int nbands);
 void sgen_dtor(struct sgen_state *ssp);
 uint64_t sgen_getstep(struct sgen_state *ssp);
+void sgen_advance(struct sgen_state *ssp, uint64_t nsteps);
 void sgen_setband(struct sgen_state *ssp, int band, double freq, double amp);
 void sgen_setband_mod(struct sgen_state *ssp, int band, double freq, double a0, double a1);
 int sgen_setmuteband(struct sgen_state *ssp, int band, int muted);
 int16_t sgen_getsample(struct sgen_state *ssp);
+void sgen_fill(struct sgen_state *ssp, int16_t *buf, size_t n, int nchan);
+void sgen_getvoice(struct sgen_state *ssp, struct sgen_voice *svp);
+/* n samples of svp from the phases in acc[], moving them on */
+void sgen_voice_fill(const struct sgen_voice *svp, uint32_t *acc, int16_t *buf,
+  size_t n, int nchan);
 void sgen_setphase(struct sgen_state *ssp, int band, double phase);
 double sgen_getphase(struct sgen_state *ssp, int band);
+size_t sgen_getstate(struct sgen_state *ssp, void *buf);
+void sgen_setstate(struct sgen_state *ssp, const void *buf);
+
+#if defined(sgen_test) || defined(_HOST)
+struct sgen_wavestats {
+   unsigned int npos, nneg, nzero, ntrans;
+   unsigned int posdur_min, posdur_max;
+   unsigned int negdur_min, negdur_max;
+};
+
+void sgen_wavestats(const int16_t *obuf, size_t n, struct sgen_wavestats *wsp);
+#endif
+
+#if defined(_HOST)
+/* The double-precision generator these replaced, in soundgen_ref.c */
+struct sgenref_state;
+
+struct sgenref_state *sgenref_ctor(uint32_t srate, int nbands);
+void sgenref_dtor(struct sgenref_state *ssp);
+void sgenref_setband(struct sgenref_state *ssp, int band, double freq, double amp);
+void sgenref_setband_mod(struct sgenref_state *ssp, int band, double freq, double a0, double a1);
+int sgenref_setmuteband(struct sgenref_state *ssp, int band, int muted);
+int16_t sgenref_getsample(struct sgenref_state *ssp);
+void sgenref_setphase(struct sgenref_state *ssp, int band, double phase);
+double sgenref_getphase(struct sgenref_state *ssp, int band);
+#endif
+
+#endif /* _SOUNDGEN_H_ */
@@ -0,0 +1,190 @@
+/*
+ * spkfeed.c - Speaker Settings Queue Between Game and Audio IRQ
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#include <string.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "spkfeed.h"
+
+#if defined(_RP2350)
+#include "pico/platform.h"
+#define SPKFEED_RAMFUNC(f) __not_in_flash_func(f)
+#else
+#define SPKFEED_RAMFUNC(f) f
+#endif
+
+#define MASK (SPKFEED_LEN - 1)
+
+/* Field by field, so that the IRQ side never calls memcpy() in flash */
+static inline void voicecopy(struct sgen_voice *d, const struct sgen_voice *s)
+{
+    d->nbands = s->nbands;
+    for (int b = 0; b < SGEN_VOICE_BANDS; b++) {
+        d->bands[b].inc = s->bands[b].inc;
+        d->bands[b].lut[0] = s->bands[b].lut[0];
+        d->bands[b].lut[1] = s->bands[b].lut[1];
+        d->bands[b].heard = s->bands[b].heard;
+        d->bands[b].mod = s->bands[b].mod;
+    }
+}
+
+void spkfeed_init(struct spkfeed *f, uint32_t srate)
+{
+    memset(f, 0, sizeof(*f));
+    f->srate = srate;
+    f->num = f->den = 1;
+    f->v.nbands = SGEN_VOICE_BANDS;     /* all of them silent */
+    f->minqueued = UINT32_MAX;
+    atomic_init(&f->head, 0);
+    atomic_init(&f->tail, 0);
+    atomic_init(&f->maxlag, srate / 5);
+    atomic_init(&f->paused, false);
+    atomic_init(&f->seq, 0);
+    atomic_init(&f->resets, 0);
+}
+
+/*
+ * A tick's n samples become ftime * srate / 10^6 of real time, so the
+ * queue fills as fast as the player empties it whatever speed the game is
+ * set to. Up to two ticks of it may be queued.
+ */
+void spkfeed_tick(struct spkfeed *f, uint32_t n, uint32_t ftime)
+{
+    uint32_t lag;
+
+    f->num = (uint64_t)ftime * f->srate;
+    f->den = (uint64_t)n * 1000000;
+    lag = f->num * 2 / 1000000;
+    if (lag < f->srate / 10)
+        lag = f->srate / 10;
+    atomic_store_explicit(&f->maxlag, lag, memory_order_relaxed);
+}
+
+/* A setting that lasts under a sample, or that finds the queue full, is
+   dropped: the next one follows on from where it would have ended. */
+void spkfeed_put(struct spkfeed *f, const struct sgen_voice *v, uint32_t n)
+{
+    unsigned int head = atomic_load_explicit(&f->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&f->tail, memory_order_acquire);
+    uint64_t t = n * f->num + f->rem;
+
+    f->rem = t % f->den;
+    if (t < f->den)
+        return;
+    if (head - tail >= SPKFEED_LEN) {
+        f->full++;
+        return;
+    }
+    voicecopy(&f->q[head & MASK].v, v);
+    f->q[head & MASK].n = t / f->den;
+    atomic_store_explicit(&f->head, head + 1, memory_order_release);
+}
+
+void spkfeed_pause(struct spkfeed *f, bool p)
+{
+    atomic_store_explicit(&f->paused, p, memory_order_relaxed);
+}
+
+uint32_t SPKFEED_RAMFUNC(spkfeed_fill)(struct spkfeed *f, int16_t *buf,
+                                       uint32_t n, int nchan)
+{
+    unsigned int head = atomic_load_explicit(&f->head, memory_order_acquire);
+    unsigned int tail = atomic_load_explicit(&f->tail, memory_order_relaxed);
+    bool paused = atomic_load_explicit(&f->paused, memory_order_relaxed);
+    uint32_t lag, maxlag, r, made = 0, want = n;
+    unsigned int i;
+
+    if (paused) {
+        for (i = 0; i < SGEN_VOICE_BANDS; i++)
+            f->v.bands[i].heard = 0;
+        f->left = 0;
+        tail = head;
+    }
+
+    /* Behind the game (it caught up after a slow tick): skip to the newest
+       settings rather than play late from here on */
+    maxlag = atomic_load_explicit(&f->maxlag, memory_order_relaxed);
+    lag = f->left;
+    for (i = tail; i != head; i++)
+        lag += f->q[i & MASK].n;
+    if (lag > maxlag) {
+        lag -= f->left;
+        f->left = 0;
+        for (; tail != head && lag > maxlag; tail++) {
+            voicecopy(&f->v, &f->q[tail & MASK].v);
+            lag -= f->q[tail & MASK].n;
+            f->late++;
+        }
+    }
+    if (!paused) {
+        unsigned int seq = atomic_load_explicit(&f->seq, memory_order_relaxed);
+        unsigned int resets = atomic_load_explicit(&f->resets,
+                                                   memory_order_relaxed);
+
+        atomic_store_explicit(&f->seq, seq + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        if (resets != f->resetsdone) {
+            f->resetsdone = resets;
+            f->minqueued = UINT32_MAX;
+        }
+        f->fills++;
+        f->queued += lag;
+        if (lag < f->minqueued)
+            f->minqueued = lag;
+        atomic_store_explicit(&f->seq, seq + 2, memory_order_release);
+    }
+
+    while (n > 0) {
+        if (f->left == 0 && tail != head) {
+            voicecopy(&f->v, &f->q[tail & MASK].v);
+            f->left = f->q[tail & MASK].n;
+            tail++;
+        }
+        r = n;
+        if (f->left != 0 && f->left < r)
+            r = f->left;
+        sgen_voice_fill(&f->v, f->acc, buf, r, nchan);
+        if (f->left != 0) {
+            f->left -= r;
+            made += r;
+        }
+        buf += r * nchan;
+        n -= r;
+    }
+    atomic_store_explicit(&f->tail, tail, memory_order_release);
+    if (paused)
+        return want;            /* silence, as asked */
+    if (made < want)
+        f->underruns++;
+    return made;
+}
+
+/* The player may be part way through a fill on another core: read its
+   counts again until seq says they were all from one fill. minqueued is
+   the player's, so it is asked to start it over rather than having it
+   written from here. */
+void spkfeed_getstats(struct spkfeed *f, struct spkfeed_stats *st, bool reset)
+{
+    unsigned int seq;
+
+    do {
+        seq = atomic_load_explicit(&f->seq, memory_order_acquire);
+        st->fills = f->fills;
+        st->minqueued = f->minqueued;
+        st->queued = f->queued;
+        atomic_thread_fence(memory_order_acquire);
+    } while ((seq & 1) != 0 ||
+             atomic_load_explicit(&f->seq, memory_order_relaxed) != seq);
+    st->underruns = f->underruns;
+    st->dropped = f->full + f->late;
+    if (reset)
+        atomic_fetch_add_explicit(&f->resets, 1, memory_order_relaxed);
+}
@@ -0,0 +1,91 @@
+/*
+ * spkfeed.h - Speaker Settings Queue Between Game and Audio IRQ
+ *
+ * Copyright (c) 2026 Mikhail Matveev <xtreme@rh1.tech>
+ * https://rh1.tech
+ *
+ * SPDX-License-Identifier: GPL-3.0-or-later
+ */
+
+#ifndef __SPKFEED_H
+#define __SPKFEED_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <stdatomic.h>
+
+#include "soundgen.h"
+
+/* Settings the queue holds, a power of 2; a game tick makes about 7 */
+#define SPKFEED_LEN 32
+
+/*
+ * The game runs soundint() as it always has, a tick's worth of samples at
+ * a time, and queues what the speaker was set to between each soundint()
+ * and the next, and for how many samples of real time. The player takes
+ * them off the queue as it needs samples, keeping the phases of the bands
+ * itself, so a change of pitch never jumps and its output is clocked only
+ * by the DAC. One writer and one reader, no locks.
+ */
+struct spkfeed {
+    struct spkfeed_entry {
+        struct sgen_voice v;
+        uint32_t n;                 /* samples it lasts */
+    } q[SPKFEED_LEN];
+    atomic_uint head;               /* moved on by the game */
+    atomic_uint tail;               /* moved on by the player */
+    atomic_uint maxlag;             /* samples queued before some are dropped */
+    atomic_bool paused;
+
+    /* Game side */
+    uint32_t srate;
+    uint64_t num, den, rem;         /* real samples per game sample */
+
+    uint32_t full;                  /* settings dropped, the queue was full */
+
+    /* Player side */
+    struct sgen_voice v;            /* playing now */
+    uint32_t left;                  /* samples of v still to play */
+    uint32_t acc[SGEN_VOICE_BANDS];
+    uint32_t fills, underruns;      /* fills, and those that ran out */
+    uint32_t late;                  /* settings dropped, too far behind */
+    uint32_t minqueued;             /* fewest samples queued at a fill */
+    uint64_t queued;                /* samples queued at all the fills */
+    unsigned int resetsdone;        /* of minqueued, as asked by resets */
+
+    /* Odd while the player updates fills, minqueued and queued, which then
+       have to be read again; see spkfeed_getstats() */
+    atomic_uint seq;
+    atomic_uint resets;             /* minqueued start-overs asked for */
+};
+
+/* What the queue has seen. The player's counts are read as of one fill,
+   so the reader can be on another core. */
+struct spkfeed_stats {
+    uint32_t fills, underruns, dropped;
+    uint32_t minqueued;             /* UINT32_MAX before the first fill */
+    uint64_t queued;
+};
+
+void spkfeed_init(struct spkfeed *f, uint32_t srate);
+
+/* Game side: the next n game samples are a tick that takes ftime us */
+void spkfeed_tick(struct spkfeed *f, uint32_t n, uint32_t ftime);
+
+/* Game side: queue v for n game samples of the tick */
+void spkfeed_put(struct spkfeed *f, const struct sgen_voice *v, uint32_t n);
+
+/* Game side: silence the player, and forget what is queued */
+void spkfeed_pause(struct spkfeed *f, bool p);
+
+/* Player side: the next n samples, each written nchan times into buf. With
+   nothing queued the last setting goes on playing. Returns how many of
+   them were queued. */
+uint32_t spkfeed_fill(struct spkfeed *f, int16_t *buf, uint32_t n, int nchan);
+
+/* A copy of the counts. With reset set, the player starts minqueued over
+   at its next fill; only one caller may ask for that. */
+void spkfeed_getstats(struct spkfeed *f, struct spkfeed_stats *st, bool reset);
+
+#endif
@@ -3,30 +3,13 @@
 
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "def.h"
 #include "sprite.h"
 #include "hardware.h"
 #include "draw_api.h"
-
-static bool retrflag=true;
-
-static bool sprrdrwf[SPRITES+1];
-static bool sprrecf[SPRITES+1];
-static bool sprenf[SPRITES];
-static int16_t sprch[SPRITES+1];
-static uint8_t *sprmov[SPRITES];
-static int16_t sprx[SPRITES+1];
-static int16_t spry[SPRITES+1];
-static int16_t sprwid[SPRITES+1];
-static int16_t sprhei[SPRITES+1];
-static int16_t sprbwid[SPRITES];
-static int16_t sprbhei[SPRITES];
-static int16_t sprnch[SPRITES];
-static int16_t sprnwid[SPRITES];
-static int16_t sprnhei[SPRITES];
-static int16_t sprnbwid[SPRITES];
-static int16_t sprnbhei[SPRITES];
+#include "game_ctx.h"
 
 static void clearrdrwf(void);
 static void clearrecf(void);
@@ -36,13 +19,29 @@ static bool bcollide(int16_t bx,int16_t si);
 static void putims(void);
 static void putis(void);
 static void bcollides(int bx);
+static void queuespr(int16_t n,int16_t x,int16_t y);
+static bool rectcollide(int16_t x1,int16_t y1,int16_t w1,int16_t h1,int16_t x2,
+                        int16_t y2,int16_t w2,int16_t h2);
+static void stamphud(int16_t x,int16_t y,int16_t w,int16_t h);
+static void sginit(void);
+static void sgclear(void);
+static void sgpal(int16_t pal);
+static void sginten(int16_t inten);
+static void sgputi(int16_t x,int16_t y,uint8_t *p,int16_t w,int16_t h);
+static void sggeti(int16_t x,int16_t y,uint8_t *p,int16_t w,int16_t h);
+static void sgputim(int16_t x,int16_t y,int16_t ch,int16_t w,int16_t h);
+static int16_t sggetpix(int16_t x,int16_t y);
+static void sgtitle(void);
+static void sgwrite(int16_t x,int16_t y,int16_t ch,int16_t c);
+static void sgfill(int16_t x,int16_t y,int16_t w,int16_t h,int16_t c);
+static void sgflush(void);
 
 #if defined(DIGGER_DEBUG)
 static void gwrite_debug(int16_t x, int16_t y, int16_t ch, int16_t c);
 #endif
 
-#ifdef _RP2350
-static const struct digger_draw_api dda_static = {
+#if defined(_RP2350) || defined(_HOST)
+static const struct digger_draw_api dda_raw = {
   .ginit = &cgainit,
   .gclear = &cgaclear,
   .gpal = &cgapal,
@@ -53,10 +52,11 @@ static const struct digger_draw_api dda_static = {
   .ggetpix = &cgagetpix,
   .gtitle = &cgatitle,
   .gwrite = &cgawrite,
+  .gfill = &cgafill,
   .gflush = &doscreenupdate
 };
 #else
-static const struct digger_draw_api dda_static = {
+static const struct digger_draw_api dda_raw = {
   .ginit = &vgainit,
   .gclear = &vgaclear,
   .gpal = &vgapal,
@@ -71,53 +71,93 @@ static const struct digger_draw_api dda_static = {
 #else
   .gwrite = &gwrite_debug,
 #endif
+  .gfill = &vgafill,
   .gflush = &doscreenupdate
 };
 #endif
 
+/* What the rest of the game draws with: the same, but anything that
+   touches the screen first puts queued sprite moves on it, so it sees
+   what drawing them one at a time would have left there. */
+static const struct digger_draw_api dda_static = {
+  .ginit = &sginit,
+  .gclear = &sgclear,
+  .gpal = &sgpal,
+  .ginten = &sginten,
+  .gputi = &sgputi,
+  .ggeti = &sggeti,
+  .gputim = &sgputim,
+  .ggetpix = &sggetpix,
+  .gtitle = &sgtitle,
+  .gwrite = &sgwrite,
+  .gfill = &sgfill,
+  .gflush = &sgflush
+};
+
 const struct digger_draw_api *ddap = &dda_static;
 
+/* Sprite code writes to the screen through these, to count pixels */
+static void rgputi(int16_t x,int16_t y,uint8_t *p,int16_t w,int16_t h)
+{
+  dgctx->sprbatch.pixels+=(uint32_t)(w<<2)*h;
+  dda_raw.gputi(x,y,p,w,h);
+  stamphud(x,y,w<<2,h);
+}
+
+static void rgputim(int16_t x,int16_t y,int16_t ch,int16_t w,int16_t h)
+{
+  dgctx->sprbatch.pixels+=(uint32_t)(w<<2)*h;
+  dda_raw.gputim(x,y,ch,w,h);
+  stamphud(x,y,w<<2,h);
+}
+
 void setretr(bool f)
 {
-  retrflag=f;
+  dgctx->sprite.retrflag=f;
 }
 
 void createspr(int16_t n,int16_t ch,uint8_t *mov,int16_t wid,int16_t hei,int16_t bwid,
                int16_t bhei)
 {
-  sprnch[n]=sprch[n]=ch;
-  sprmov[n]=mov;
-  sprnwid[n]=sprwid[n]=wid;
-  sprnhei[n]=sprhei[n]=hei;
-  sprnbwid[n]=sprbwid[n]=bwid;
-  sprnbhei[n]=sprbhei[n]=bhei;
-  sprenf[n]=false;
+  struct sprite_state *st=&dgctx->sprite;
+  flushsprites();
+  st->sprnch[n]=st->sprch[n]=ch;
+  st->sprmov[n]=mov;
+  st->sprnwid[n]=st->sprwid[n]=wid;
+  st->sprnhei[n]=st->sprhei[n]=hei;
+  st->sprnbwid[n]=st->sprbwid[n]=bwid;
+  st->sprnbhei[n]=st->sprbhei[n]=bhei;
+  st->sprenf[n]=false;
 }
 
 void movedrawspr(int16_t n,int16_t x,int16_t y)
 {
-  sprx[n]=x&-4;
-  spry[n]=y;
-  sprch[n]=sprnch[n];
-  sprwid[n]=sprnwid[n];
-  sprhei[n]=sprnhei[n];
-  sprbwid[n]=sprnbwid[n];
-  sprbhei[n]=sprnbhei[n];
+  struct sprite_state *st=&dgctx->sprite;
+  flushsprites();
+  st->sprx[n]=x&-4;
+  st->spry[n]=y;
+  st->sprch[n]=st->sprnch[n];
+  st->sprwid[n]=st->sprnwid[n];
+  st->sprhei[n]=st->sprnhei[n];
+  st->sprbwid[n]=st->sprnbwid[n];
+  st->sprbhei[n]=st->sprnbhei[n];
   clearrdrwf();
   setrdrwflgs(n);
   putis();
-  ddap->ggeti(sprx[n],spry[n],sprmov[n],sprwid[n],sprhei[n]);
-  sprenf[n]=true;
-  sprrdrwf[n]=true;
+  dda_raw.ggeti(st->sprx[n],st->spry[n],st->sprmov[n],st->sprwid[n],st->sprhei[n]);
+  st->sprenf[n]=true;
+  st->sprrdrwf[n]=true;
   putims();
 }
 
 void erasespr(int16_t n)
 {
-  if (!sprenf[n])
+  struct sprite_state *st=&dgctx->sprite;
+  if (!st->sprenf[n])
     return;
-  ddap->gputi(sprx[n],spry[n],sprmov[n],sprwid[n],sprhei[n]);
-  sprenf[n]=false;
+  flushsprites();
+  rgputi(st->sprx[n],st->spry[n],st->sprmov[n],st->sprwid[n],st->sprhei[n]);
+  st->sprenf[n]=false;
   clearrdrwf();
   setrdrwflgs(n);
   putims();
@@ -125,77 +165,349 @@ void erasespr(int16_t n)
 
 void drawspr(int16_t n,int16_t x,int16_t y)
 {
+  struct sprite_state *st=&dgctx->sprite;
   int16_t t1,t2,t3,t4;
   x&=-4;
+  if (dgctx->sprbatch.on && st->sprenf[n]) {
+    queuespr(n,x,y);
+    bcollides(n);
+    return;
+  }
+  flushsprites();
   clearrdrwf();
   setrdrwflgs(n);
-  t1=sprx[n];
-  t2=spry[n];
-  t3=sprwid[n];
-  t4=sprhei[n];
-  sprx[n]=x;
-  spry[n]=y;
-  sprwid[n]=sprnwid[n];
-  sprhei[n]=sprnhei[n];
+  t1=st->sprx[n];
+  t2=st->spry[n];
+  t3=st->sprwid[n];
+  t4=st->sprhei[n];
+  st->sprx[n]=x;
+  st->spry[n]=y;
+  st->sprwid[n]=st->sprnwid[n];
+  st->sprhei[n]=st->sprnhei[n];
   clearrecf();
   setrdrwflgs(n);
-  sprhei[n]=t4;
-  sprwid[n]=t3;
-  spry[n]=t2;
-  sprx[n]=t1;
-  sprrdrwf[n]=true;
+  st->sprhei[n]=t4;
+  st->sprwid[n]=t3;
+  st->spry[n]=t2;
+  st->sprx[n]=t1;
+  st->sprrdrwf[n]=true;
   putis();
-  sprenf[n]=true;
-  sprx[n]=x;
-  spry[n]=y;
-  sprch[n]=sprnch[n];
-  sprwid[n]=sprnwid[n];
-  sprhei[n]=sprnhei[n];
-  sprbwid[n]=sprnbwid[n];
-  sprbhei[n]=sprnbhei[n];
-  ddap->ggeti(sprx[n],spry[n],sprmov[n],sprwid[n],sprhei[n]);
+  st->sprenf[n]=true;
+  st->sprx[n]=x;
+  st->spry[n]=y;
+  st->sprch[n]=st->sprnch[n];
+  st->sprwid[n]=st->sprnwid[n];
+  st->sprhei[n]=st->sprnhei[n];
+  st->sprbwid[n]=st->sprnbwid[n];
+  st->sprbhei[n]=st->sprnbhei[n];
+  dda_raw.ggeti(st->sprx[n],st->spry[n],st->sprmov[n],st->sprwid[n],st->sprhei[n]);
   putims();
   bcollides(n);
 }
 
 void initspr(int16_t n,int16_t ch,int16_t wid,int16_t hei,int16_t bwid,int16_t bhei)
 {
-  sprnch[n]=ch;
-  sprnwid[n]=wid;
-  sprnhei[n]=hei;
-  sprnbwid[n]=bwid;
-  sprnbhei[n]=bhei;
+  struct sprite_state *st=&dgctx->sprite;
+  st->sprnch[n]=ch;
+  st->sprnwid[n]=wid;
+  st->sprnhei[n]=hei;
+  st->sprnbwid[n]=bwid;
+  st->sprnbhei[n]=bhei;
 }
 
 void initmiscspr(int16_t x,int16_t y,int16_t wid,int16_t hei)
 {
-  sprx[SPRITES]=x;
-  spry[SPRITES]=y;
-  sprwid[SPRITES]=wid;
-  sprhei[SPRITES]=hei;
+  struct sprite_state *st=&dgctx->sprite;
+  flushsprites();
+  st->sprx[SPRITES]=x;
+  st->spry[SPRITES]=y;
+  st->sprwid[SPRITES]=wid;
+  st->sprhei[SPRITES]=hei;
   clearrdrwf();
   setrdrwflgs(SPRITES);
   putis();
 }
 
+/* The same as initmiscspr() for many misc sprites drawn together, e.g. a
+   whole field of tunnel blobs: initmiscsprs(), addmiscspr() for each of
+   them, erasemiscsprs(), drawmiscspr() for each, then one getis(). The
+   sprites under any of them are taken off and put back once, not once a
+   blob. */
+void initmiscsprs(void)
+{
+  flushsprites();
+  clearrdrwf();
+}
+
+void addmiscspr(int16_t x,int16_t y,int16_t wid,int16_t hei)
+{
+  struct sprite_state *st=&dgctx->sprite;
+  st->sprx[SPRITES]=x;
+  st->spry[SPRITES]=y;
+  st->sprwid[SPRITES]=wid;
+  st->sprhei[SPRITES]=hei;
+  st->sprrecf[SPRITES]=false;
+  setrdrwflgs(SPRITES);
+}
+
+void erasemiscsprs(void)
+{
+  putis();
+}
+
 void getis(void)
 {
+  struct sprite_state *st=&dgctx->sprite;
   int16_t i;
   for (i=0;i<SPRITES;i++)
-    if (sprrdrwf[i])
-      ddap->ggeti(sprx[i],spry[i],sprmov[i],sprwid[i],sprhei[i]);
+    if (st->sprrdrwf[i])
+      dda_raw.ggeti(st->sprx[i],st->spry[i],st->sprmov[i],st->sprwid[i],st->sprhei[i]);
   putims();
 }
 
+/* Draw the sprites that are on over a screen drawn again under them. The
+   backgrounds they saved are kept, so each puts back what was there. */
+void drawsprites(void)
+{
+  struct sprite_state *st=&dgctx->sprite;
+  int i;
+  flushsprites();
+  for (i=0;i<SPRITES;i++)
+    if (st->sprenf[i])
+      rgputim(st->sprx[i],st->spry[i],st->sprch[i],st->sprwid[i],st->sprhei[i]);
+}
+
 void drawmiscspr(int16_t x,int16_t y,int16_t ch,int16_t wid,int16_t hei)
 {
-  sprx[SPRITES]=x&-4;
-  spry[SPRITES]=y;
-  sprch[SPRITES]=ch;
-  sprwid[SPRITES]=wid;
-  sprhei[SPRITES]=hei;
-  ddap->gputim(sprx[SPRITES],spry[SPRITES],sprch[SPRITES],sprwid[SPRITES],
-         sprhei[SPRITES]);
+  struct sprite_state *st=&dgctx->sprite;
+  flushsprites();
+  st->sprx[SPRITES]=x&-4;
+  st->spry[SPRITES]=y;
+  st->sprch[SPRITES]=ch;
+  st->sprwid[SPRITES]=wid;
+  st->sprhei[SPRITES]=hei;
+  rgputim(st->sprx[SPRITES],st->spry[SPRITES],st->sprch[SPRITES],st->sprwid[SPRITES],
+         st->sprhei[SPRITES]);
+}
+
+/*
+ * Frame batching. drawspr() of a sprite that is on the screen only moves
+ * it in the sprite table and queues it; bcollides() sees the new place at
+ * once, as before. flushsprites() then takes every queued sprite, and
+ * every sprite overlapping one where it was or is going, off the screen
+ * in one go, grabs the background under the queued ones at their new
+ * places and draws them all in sprite order. Each background buffer holds
+ * the screen as it is with no sprites, so the result is the same as
+ * drawing them a move at a time, in which sprites overlapping the moved
+ * one are taken off and redrawn on every move. Anything else that touches
+ * the screen (dda_static, the other sprite calls) flushes first.
+ */
+static void queuespr(int16_t n,int16_t x,int16_t y)
+{
+  struct sprite_state *st=&dgctx->sprite;
+  struct sprbatch_state *bt=&dgctx->sprbatch;
+  if (!bt->pend[n]) {
+    bt->pend[n]=true;
+    bt->npend++;
+    bt->oldx[n]=st->sprx[n];
+    bt->oldy[n]=st->spry[n];
+    bt->oldwid[n]=st->sprwid[n];
+    bt->oldhei[n]=st->sprhei[n];
+  }
+  st->sprx[n]=x;
+  st->spry[n]=y;
+  st->sprch[n]=st->sprnch[n];
+  st->sprwid[n]=st->sprnwid[n];
+  st->sprhei[n]=st->sprnhei[n];
+  st->sprbwid[n]=st->sprnbwid[n];
+  st->sprbhei[n]=st->sprnbhei[n];
+}
+
+/* True if sprite i, where it is on the screen, overlaps sprite j where it
+   is on the screen or is going */
+static bool batchcollide(int16_t i,int16_t j)
+{
+  struct sprite_state *st=&dgctx->sprite;
+  struct sprbatch_state *bt=&dgctx->sprbatch;
+  int16_t x=st->sprx[i],y=st->spry[i],w=st->sprwid[i],h=st->sprhei[i];
+  if (bt->pend[i]) {
+    x=bt->oldx[i];
+    y=bt->oldy[i];
+    w=bt->oldwid[i];
+    h=bt->oldhei[i];
+  }
+  if (rectcollide(x,y,w,h,st->sprx[j],st->spry[j],st->sprwid[j],st->sprhei[j]))
+    return true;
+  return bt->pend[j] &&
+         rectcollide(x,y,w,h,bt->oldx[j],bt->oldy[j],bt->oldwid[j],bt->oldhei[j]);
+}
+
+void flushsprites(void)
+{
+  struct sprite_state *st=&dgctx->sprite;
+  struct sprbatch_state *bt=&dgctx->sprbatch;
+  bool redraw[SPRITES],more;
+  int16_t i,j;
+  if (bt->npend==0)
+    return;
+  for (i=0;i<SPRITES;i++)
+    redraw[i]=bt->pend[i];
+  do {
+    more=false;
+    for (i=0;i<SPRITES;i++)
+      if (st->sprenf[i] && !redraw[i])
+        for (j=0;j<SPRITES;j++)
+          if (redraw[j] && batchcollide(i,j)) {
+            redraw[i]=more=true;
+            break;
+          }
+  } while (more);
+  for (i=0;i<SPRITES;i++)
+    if (redraw[i]) {
+      if (bt->pend[i])
+        rgputi(bt->oldx[i],bt->oldy[i],st->sprmov[i],bt->oldwid[i],bt->oldhei[i]);
+      else
+        rgputi(st->sprx[i],st->spry[i],st->sprmov[i],st->sprwid[i],st->sprhei[i]);
+    }
+  for (i=0;i<SPRITES;i++)
+    if (bt->pend[i]) {
+      dda_raw.ggeti(st->sprx[i],st->spry[i],st->sprmov[i],st->sprwid[i],st->sprhei[i]);
+      bt->pend[i]=false;
+    }
+  for (i=0;i<SPRITES;i++)
+    if (redraw[i])
+      rgputim(st->sprx[i],st->spry[i],st->sprch[i],st->sprwid[i],st->sprhei[i]);
+  bt->npend=0;
+}
+
+/* The end of a frame: put it all on the screen and start counting again */
+void endsprframe(void)
+{
+  struct sprbatch_state *bt=&dgctx->sprbatch;
+  flushsprites();
+  bt->framepixels=bt->pixels;
+  bt->pixels=0;
+  bt->framehud=bt->hudpixels;
+  bt->hudpixels=0;
+}
+
+/*
+ * HUD ownership of the top text row. Between sethud(owner) and
+ * sethud(HUD_NONE) everything drawn is counted as HUD pixels, and where it
+ * is on the top row, 4 pixels across at a time, it is stamped as owner's.
+ * Anything else drawn there stamps it HUD_NONE. So while hudintact() finds
+ * a cell still stamped as its owner's, the screen still shows what that
+ * owner last drew in it, and the HUD need not draw it again.
+ */
+void sethud(int16_t owner)
+{
+  flushsprites();
+  dgctx->sprite.hudowner=owner;
+}
+
+bool hudintact(int16_t owner,int16_t x,int16_t w)
+{
+  const uint8_t *o=dgctx->sprite.hudown;
+  int16_t x0=x>>2,x1=(x+w+3)>>2;
+  if (!dgctx->sprbatch.hud || owner==HUD_NONE || x<0 || x1>HUD_W)
+    return false;
+  for (;x0<x1;x0++)
+    if (o[x0]!=owner)
+      return false;
+  return true;
+}
+
+static void stamphud(int16_t x,int16_t y,int16_t w,int16_t h)
+{
+  struct sprite_state *st=&dgctx->sprite;
+  int16_t x0,x1;
+  if (st->hudowner!=HUD_NONE)
+    dgctx->sprbatch.hudpixels+=(uint32_t)w*h;
+  if (y>=CHR_H || y+h<=0)
+    return;
+  x0=(x<0) ? 0 : x>>2;
+  x1=(x+w+3)>>2;
+  if (x1>HUD_W)
+    x1=HUD_W;
+  for (;x0<x1;x0++)
+    st->hudown[x0]=st->hudowner;
+}
+
+static void sginit(void)
+{
+  flushsprites();
+  dda_raw.ginit();
+  memset(dgctx->sprite.hudown,HUD_NONE,sizeof(dgctx->sprite.hudown));
+}
+
+static void sgclear(void)
+{
+  flushsprites();
+  dda_raw.gclear();
+  memset(dgctx->sprite.hudown,HUD_NONE,sizeof(dgctx->sprite.hudown));
+}
+
+static void sgpal(int16_t pal)
+{
+  dda_raw.gpal(pal);
+}
+
+static void sginten(int16_t inten)
+{
+  dda_raw.ginten(inten);
+}
+
+static void sgputi(int16_t x,int16_t y,uint8_t *p,int16_t w,int16_t h)
+{
+  flushsprites();
+  dda_raw.gputi(x,y,p,w,h);
+  stamphud(x,y,w<<2,h);
+}
+
+static void sggeti(int16_t x,int16_t y,uint8_t *p,int16_t w,int16_t h)
+{
+  flushsprites();
+  dda_raw.ggeti(x,y,p,w,h);
+}
+
+static void sgputim(int16_t x,int16_t y,int16_t ch,int16_t w,int16_t h)
+{
+  flushsprites();
+  dda_raw.gputim(x,y,ch,w,h);
+  stamphud(x,y,w<<2,h);
+}
+
+static int16_t sggetpix(int16_t x,int16_t y)
+{
+  flushsprites();
+  return dda_raw.ggetpix(x,y);
+}
+
+static void sgtitle(void)
+{
+  flushsprites();
+  dda_raw.gtitle();
+  memset(dgctx->sprite.hudown,HUD_NONE,sizeof(dgctx->sprite.hudown));
+}
+
+static void sgwrite(int16_t x,int16_t y,int16_t ch,int16_t c)
+{
+  flushsprites();
+  dda_raw.gwrite(x,y,ch,c);
+  stamphud(x,y,CHR_W,CHR_H);
+}
+
+static void sgfill(int16_t x,int16_t y,int16_t w,int16_t h,int16_t c)
+{
+  flushsprites();
+  dda_raw.gfill(x,y,w,h,c);
+  stamphud(x,y,w,h);
+}
+
+static void sgflush(void)
+{
+  flushsprites();
+  dda_raw.gflush();
 }
 
 static void clearrdrwf(void)
@@ -203,105 +515,125 @@ static void clearrdrwf(void)
   int16_t i;
   clearrecf();
   for (i=0;i<SPRITES+1;i++)
-    sprrdrwf[i]=false;
+    dgctx->sprite.sprrdrwf[i]=false;
 }
 
 static void clearrecf(void)
 {
   int16_t i;
   for (i=0;i<SPRITES+1;i++)
-    sprrecf[i]=false;
+    dgctx->sprite.sprrecf[i]=false;
 }
 
 static void setrdrwflgs(int16_t n)
 {
+  struct sprite_state *st=&dgctx->sprite;
   int16_t i;
-  if (!sprrecf[n]) {
-    sprrecf[n]=true;
+  if (!st->sprrecf[n]) {
+    st->sprrecf[n]=true;
     for (i=0;i<SPRITES;i++)
-      if (sprenf[i] && i!=n) {
+      if (st->sprenf[i] && i!=n) {
         if (collide(i,n)) {
-          sprrdrwf[i]=true;
+          st->sprrdrwf[i]=true;
           setrdrwflgs(i);
         }
       }
   }
 }
 
+static bool rectcollide(int16_t x1,int16_t y1,int16_t w1,int16_t h1,int16_t x2,
+                        int16_t y2,int16_t w2,int16_t h2)
+{
+  if (x1>=x2) {
+    if (x1>(w2<<2)+x2-1)
+      return false;
+  }
+  else
+    if (x2>(w1<<2)+x1-1)
+      return false;
+  if (y1>=y2)
+    return y1<=h2+y2-1;
+  return y2<=h1+y1-1;
+}
+
 static bool collide(int16_t bx,int16_t si)
 {
-  if (sprx[bx]>=sprx[si]) {
-    if (sprx[bx]>(sprwid[si]<<2)+sprx[si]-1)
+  struct sprite_state *st=&dgctx->sprite;
+  if (st->sprx[bx]>=st->sprx[si]) {
+    if (st->sprx[bx]>(st->sprwid[si]<<2)+st->sprx[si]-1)
       return false;
   }
   else
-    if (sprx[si]>(sprwid[bx]<<2)+sprx[bx]-1)
+    if (st->sprx[si]>(st->sprwid[bx]<<2)+st->sprx[bx]-1)
       return false;
-  if (spry[bx]>=spry[si]) {
-    if (spry[bx]<=sprhei[si]+spry[si]-1)
+  if (st->spry[bx]>=st->spry[si]) {
+    if (st->spry[bx]<=st->sprhei[si]+st->spry[si]-1)
       return true;
     return false;
   }
-  if (spry[si]<=sprhei[bx]+spry[bx]-1)
+  if (st->spry[si]<=st->sprhei[bx]+st->spry[bx]-1)
     return true;
   return false;
 }
 
 static bool bcollide(int16_t bx,int16_t si)
 {
-  if (sprx[bx]>=sprx[si]) {
-    if (sprx[bx]+sprbwid[bx]>(sprwid[si]<<2)+sprx[si]-sprbwid[si]-1)
+  struct sprite_state *st=&dgctx->sprite;
+  if (st->sprx[bx]>=st->sprx[si]) {
+    if (st->sprx[bx]+st->sprbwid[bx]>(st->sprwid[si]<<2)+st->sprx[si]-st->sprbwid[si]-1)
       return false;
   }
   else
-    if (sprx[si]+sprbwid[si]>(sprwid[bx]<<2)+sprx[bx]-sprbwid[bx]-1)
+    if (st->sprx[si]+st->sprbwid[si]>(st->sprwid[bx]<<2)+st->sprx[bx]-st->sprbwid[bx]-1)
       return false;
-  if (spry[bx]>=spry[si]) {
-    if (spry[bx]+sprbhei[bx]<=sprhei[si]+spry[si]-sprbhei[si]-1)
+  if (st->spry[bx]>=st->spry[si]) {
+    if (st->spry[bx]+st->sprbhei[bx]<=st->sprhei[si]+st->spry[si]-st->sprbhei[si]-1)
       return true;
     return false;
   }
-  if (spry[si]+sprbhei[si]<=sprhei[bx]+spry[bx]-sprbhei[bx]-1)
+  if (st->spry[si]+st->sprbhei[si]<=st->sprhei[bx]+st->spry[bx]-st->sprbhei[bx]-1)
     return true;
   return false;
 }
 
 static void putims(void)
 {
+  struct sprite_state *st=&dgctx->sprite;
   int i;
   for (i=0;i<SPRITES;i++)
-    if (sprrdrwf[i])
-      ddap->gputim(sprx[i],spry[i],sprch[i],sprwid[i],sprhei[i]);
+    if (st->sprrdrwf[i])
+      rgputim(st->sprx[i],st->spry[i],st->sprch[i],st->sprwid[i],st->sprhei[i]);
 }
 
 static void putis(void)
 {
+  struct sprite_state *st=&dgctx->sprite;
   int i;
   for (i=0;i<SPRITES;i++)
-    if (sprrdrwf[i])
-      ddap->gputi(sprx[i],spry[i],sprmov[i],sprwid[i],sprhei[i]);
+    if (st->sprrdrwf[i])
+      rgputi(st->sprx[i],st->spry[i],st->sprmov[i],st->sprwid[i],st->sprhei[i]);
 }
 
-int first[TYPES],coll[SPRITES];
 static int firstt[TYPES]={FIRSTBONUS,FIRSTBAG,FIRSTMONSTER,FIRSTFIREBALL,FIRSTDIGGER};
 static int lastt[TYPES]={LASTBONUS,LASTBAG,LASTMONSTER,LASTFIREBALL,LASTDIGGER};
 
 static void bcollides(int spr)
 {
+  struct sprite_state *st=&dgctx->sprite;
   int spc,next,i;
   for (next=0;next<TYPES;next++)
-    first[next]=-1;
+    st->first[next]=-1;
   for (next=0;next<SPRITES;next++)
-    coll[next]=-1;
+    st->coll[next]=-1;
   for (i=0;i<TYPES;i++) {
     next=-1;
     for (spc=firstt[i];spc<lastt[i];spc++)
-      if (sprenf[spc] && spc!=spr)
+      if (st->sprenf[spc] && spc!=spr)
         if (bcollide(spr,spc)) {
           if (next==-1)
-            first[i]=next=spc;
+            st->first[i]=next=spc;
           else
-            coll[next=(coll[next]=spc)]=-1;
+            st->coll[next=(st->coll[next]=spc)]=-1;
 	}
   }
 }
@@ -10,7 +10,22 @@ void initspr(int16_t n,int16_t ch,int16_t wid,int16_t hei,int16_t bwid,int16_t b
 void drawspr(int16_t n,int16_t x,int16_t y);
 void initmiscspr(int16_t x,int16_t y,int16_t wid,int16_t hei);
 void getis(void);
+void drawsprites(void);
+void initmiscsprs(void);
+void addmiscspr(int16_t x,int16_t y,int16_t wid,int16_t hei);
+void erasemiscsprs(void);
 void drawmiscspr(int16_t x,int16_t y,int16_t ch,int16_t wid,int16_t hei);
+void flushsprites(void);
+void endsprframe(void);
+
+/* Who drew the top text row: nobody in particular, a player's score (plus
+   the player), or a player's lives, or in gauntlet mode the time */
+#define HUD_NONE 0
+#define HUD_SCORE 1
+#define HUD_LIVES 3
+
+void sethud(int16_t owner);
+bool hudintact(int16_t owner,int16_t x,int16_t w);
 
 struct digger_draw_api;
 #if 0
@@ -19,4 +34,3 @@ extern const struct digger_draw_api *ddap;
 
 extern void doscreenupdate(void);
 
-extern int first[TYPES],coll[SPRITES];
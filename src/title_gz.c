@@ -3,8 +3,8 @@
 
 #include "def.h"
 
-#ifdef _RP2350
-/* On RP2350: no zlib, title screen image is skipped (cgatitle() clears screen) */
+#if defined(_RP2350) || defined(_HOST)
+/* On RP2350 and host: no zlib, title screen image is skipped (cgatitle() clears screen) */
 void gettitle(unsigned char *buf) { (void)buf; }
 #else
 
@@ -167,5 +167,5 @@ void gettitle(unsigned char *buf)
 	assert(uncompress(buf, &uncomplen, title_gz, CTITLELEN) == Z_OK);
 }
 
-#endif /* !_RP2350 */
+#endif /* !_RP2350 && !_HOST */
 